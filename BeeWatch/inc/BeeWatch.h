@@ -14,11 +14,27 @@
 #include "stm32f1xx.h"
 #include "Graphic.h"
 #include "GPIO.h"
+#include "Pin.h"
 #include "ILI9163.h"
+#include "EventBus.h"
+#include "SpscRing.h"
 #include "ADXL345.h"
 #include "CC2530.h"
 #include "Z_stack.h"
+#include "TxWindow.h"
+#include "TxScheduler.h"
+#include "TelemetryFrame.h"
+#include "TelemetryLog.h"
+#include "CmdDispatcher.h"
+#include "RadioPolicy.h"
 #include "HeartRate.h"
+#include "SignalQuality.h"
+#include "ADCScan.h"
+#include "FuelGauge.h"
+#include "PPGCapture.h"
+#include "Profiler.h"
+#include "TimeSync.h"
+#include "NetworkJoin.h"
 
 namespace hv_driver {
 
@@ -31,29 +47,102 @@ public:
 		ACTIVITY, FREE_FALL, INACTIVITY
 	};
 	enum ZB_COMMAND {
-		STATUS = 0xABCD, FALL_ALERT = 0xABCE, HEART_RATE = 0xABCF
+		STATUS = 0xABCD, FALL_ALERT = 0xABCE, HEART_RATE = 0xABCF, TELEMETRY = 0xABD0, DIAGNOSTICS = 0xABD1, PROFILE = 0xABD2,
+		TIME_REQUEST = 0xABD3,
+		/* downlink, one contiguous range for the command table */
+		CFG_REPORT = 0xABE0, CFG_THRESHOLD = 0xABE1, TIME_SYNC = 0xABE2,
+		DOWNLINK_BASE = CFG_REPORT
+	};
+	enum TIMER_PARAM {
+		GYRO_IRQ_PRIORITY = 7,		// PB1 EXTI from ADXL345 INT1, below syscall level
+		FREE_FALL_HOLD_MS = 5000,	// free fall alert shown before activity resumes
+		ACT_COUNT_MS 			= 1000,	// activity minutes counted in seconds, on the RTC tick
+		MOTION_RING 			= 8,		// interrupt sources queued for updateStatus, power of two
+	};
+	enum TELEMETRY_PARAM {
+		TLM_HR_SERIES 		= 16,		// heart rate readings kept between reports
+		TLM_EVENTS 				= 4,
+		TLM_VOLTAGE_STEP 	= 20,		// mV, keeps ADC noise from defeating unchanged drops
+	};
+	enum PPM_PARAM {
+		PPM_MIN_CONFIDENCE = 50, // readings below are not shown or sent
+		PPM_WINDOW_MS = 30000, // scan kept on for one reading at most
+		PPM_PERIOD_MS = 300000, // a reading every 5 min, the scan and its STOP lock are off in between
+		PPM_CAPTURE_BAUD = 115200 // raw PPG stream on USART1 TX (PB6 remap)
+	};
+	enum BATTERY_PARAM {
+		BAT_DIVIDER 		= 2,		// VBAT resistor divider ratio on PA1
+		BAT_VREFINT_MV 	= 1200,	// internal reference voltage
+		BAT_FULL_SOC 		= 70,		// in %
+		BAT_MEDIUM_SOC 	= 30,
+		BAT_DECIMATION 	= 1000,	// 1kHz scan -> 1Hz battery, temperature
+	};
+	enum LOG_PARAM {
+		LOG_FLASH_BASE 		= 0x0800F000,	// last 4 KB, kept out of the linker IROM region
+		LOG_FLASH_PAGES 	= 3,
+		LOG_ALERT_BASE 		= 0x0800FC00,	// alerts, never evicted
+		LOG_ALERT_PAGES 	= 1,
+		LOG_DRAIN_BATCH 	= 4,					// backlog records handed over per report period
+	};
+	enum ZB_CACHE {
+		ZB_BKP_CACHE 				= RTC_BKP_DR2,	// to DR6, NetworkJoin; RTC_BKP_DR1 belongs to the RTC driver
+		PROFILE_BKP_OVERFLOW = RTC_BKP_DR7,	// task that overflowed its stack, kept over the reset
+		TIME_BKP_DRIFT 			= RTC_BKP_DR8,	// RTC drift / TIME_DRIFT_SCALE, int16
+	};
+	enum TIME_PARAM {
+		TIME_STAMP_LEN 		= 6,		// u32 s since 1 January 2000 | u16 ms
+		TIME_DRIFT_SCALE 	= 4,		// ppb per backup count, int16 covers the calibration range
+	};
+	enum ZB_PARAM {
+		ZB_RETRY_DELAY = 5000,		// ms between NetworkJoin starts
+		ZB_REPORT_PERIOD = 3000,	// ms between status and heart rate reports
+		ZB_REPORT_MIN = 1000,			// ms, limits of CFG_REPORT
+		ZB_REPORT_MAX = 3600000,
+		ZB_DIAG_PERIOD = 300000,	// ms between link diagnostics packets
+		ZB_QUEUED_POLL_RATE = 100,	// ms, while the parent has more queued
+		ZB_RESPONSE_POLL_RATE = 100	// ms, while waiting for a response
 	};
 public:
 	BeeWatch(void);
-	void init(void);
+	void initSensor(void);
+	uint16_t initDisplay(void);
+	uint16_t initClock(void);
 	void initGyro(void);
 	void initZigbee(void);
+	bool startZigbee(void);
+	bool isZigbeeConnected(void);
+	uint32_t getJoinTime(void);
+	uint16_t getShortAddr(void);
+	void setPPGCapture(bool enable);
+	uint32_t scheduleHeartRate(void);
 
 	void sendAlert(void);
-	void sendMessage(void);
-	void sendPPM(void);
+	void sendTelemetry(void);
+	void dispatchTelemetry(uint32_t timeout);
+	TelemetryLog* getTelemetryLogInstant(void);
+	void sendDiagnostics(void);
+	void stackOverflow(const char* taskName);
+	void updateRadio(void);
+	void syncTime(void);
+	uint32_t getReportPeriod(void);
 
 	void checkGyroStatus(void);
 	void drawBattery(uint8_t x, uint8_t y, BATTERY_LEVEL batLevel);
+	void updateBattery(uint8_t x, uint8_t y);
 	void drawHeart(uint8_t x, uint8_t y);
 	void updateHeartRate(uint8_t x, uint8_t y);
 	void updateTime(uint8_t x, uint8_t y);
 	void updateStatus(uint8_t x, uint8_t y);
 	void updateNetWork(uint8_t x, uint8_t y, bool isConnected);
+	void updateNetWorkStatus(uint8_t x, uint8_t y);
 	void ActivitySttScreen(uint32_t actTime, uint32_t inActTime);
 	
 	ADXL345* getGyroInstant(void);
 	ILI9163* getLCDInstant(void);
+	CC2530* getZNPInstant(void);
+	TxWindow* getTxWindowInstant(void);
+	TxScheduler* getTxSchedulerInstant(void);
+	EventBus* getEventBusInstant(void);
 	font_s& getFont(void){return this->Bigfont;}
 	font_s& getsmallFont(void){return this->smallFont;}
 
@@ -61,17 +150,46 @@ public:
 	
 	uint32_t getActMin(void);
 	uint32_t getInActMin(void);
+	uint16_t getBatteryVoltage(void);
+	int16_t getTemperature(void);
+	BATTERY_LEVEL getBatteryLevel(void);
+	FuelGauge* getFuelGaugeInstant(void);
 private:
-	bool isNewPPM;
+	typedef struct {
+		uint8_t code;
+		uint32_t time;
+	} event_s;
+
 	uint8_t heartRate;
+	uint8_t heartRateConfidence;
 	bitMap_s batteryBitmap;
 	picture_s beePicture;
 	font_s Bigfont;
 	font_s smallFont;
 	_RTC::time_s time;
 	ADXL345::IntVal_s status;
-	ADXL345::IntVal_s rawStatus;
+	ADXL345::IntVal_s rawStatus;		// last source read, checkGyroStatus only
+	SpscRing<ADXL345::IntVal_s, MOTION_RING> motionRing;
 	ACTIVITY_STATUS oldStatus;
+	BATTERY_LEVEL batLevel;
+	bool isBatteryDrawn;
+	bool isConnected;
+	bool isNetworkDrawn;
+	TelemetryFrame::hrSample_s hrSeries[TLM_HR_SERIES];
+	uint8_t hrCount;
+	uint8_t hrShift;		// readings dropped as oldest, wraps
+	uint32_t ppmStart;		// osKernelSysTick of the last scan start
+	bool isPpmRead;			// reading taken in this scan window
+	bool isPPGCapture;		// raw stream on, the scan never stops
+	event_s events[TLM_EVENTS];
+	uint8_t eventCount;
+	uint16_t nvPollRate;	// last poll rate known to be in ZNP NV, 0 if unknown
+	uint32_t diagTime;
+	
+	void showStatus(uint8_t x, uint8_t y);
+	void startScan(void);
+	void stopScan(void);
+	bool sendProfile(void);
 };
 
 }
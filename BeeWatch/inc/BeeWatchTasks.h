@@ -0,0 +1,28 @@
+/**
+  ******************************************************************************
+ * @file    BeeWatchTasks.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   BeeWatch task stacks and priorities
+ *
+ *	The tasks main.cpp starts, one type each so the host tests build the
+ *	same ones. Depths are in words. ZNP and ZigbeeTx were 128 words and are
+ *	192, activity 160: estimates from -fstack-usage of the host sources,
+ *	not measured on the target, read Profiler stackFree there before
+ *	making any of them smaller.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef BEEWATCH_TASKS_H
+#define BEEWATCH_TASKS_H
+
+#include "StaticTask.h"
+
+typedef hv_driver::StaticTask<3 * configMINIMAL_STACK_SIZE, osPriorityRealtime> BootTask; // then the main screen
+typedef hv_driver::StaticTask<2 * configMINIMAL_STACK_SIZE, osPriorityHigh> NetworkTask; // telemetry and profile frames
+typedef hv_driver::StaticTask<3 * configMINIMAL_STACK_SIZE / 2, osPriorityRealtime> ZnpTask; // downlinks to EventBus::publish
+typedef hv_driver::StaticTask<3 * configMINIMAL_STACK_SIZE / 2, osPriorityHigh> ZigbeeTxTask; // failed sends to a flash erase
+typedef hv_driver::StaticTask<5 * configMINIMAL_STACK_SIZE / 4, osPriorityNormal> ActivityTask; // heart rate sprintf
+
+#endif /* BEEWATCH_TASKS_H */
@@ -86,35 +86,38 @@
 #endif
 
 #define configUSE_PREEMPTION                    1
+#define configUSE_TICKLESS_IDLE                 1
 #define configUSE_IDLE_HOOK                     0
 #define configUSE_TICK_HOOK                     0
 #define configCPU_CLOCK_HZ                      ( SystemCoreClock )
 #define configTICK_RATE_HZ                      ( ( TickType_t ) 1000 )
 #define configMAX_PRIORITIES                    ( 7 )
 #define configMINIMAL_STACK_SIZE                ( ( uint16_t ) 128 )
-#define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 10 * 1024 ) )
+#define configTOTAL_HEAP_SIZE                   ( ( size_t ) ( 4 * 1024 ) )  /* TCBs, idle and timer stacks, sync objects, event bus; task stacks are static */
 #define configMAX_TASK_NAME_LEN                 ( 16 )
 #define configUSE_TRACE_FACILITY                1
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_MUTEXES                       1
 #define configQUEUE_REGISTRY_SIZE               8
-#define configCHECK_FOR_STACK_OVERFLOW          0
+#define configCHECK_FOR_STACK_OVERFLOW          2
 #define configUSE_RECURSIVE_MUTEXES             1
-#define configUSE_MALLOC_FAILED_HOOK            0
+#define configUSE_MALLOC_FAILED_HOOK            1
 #define configUSE_APPLICATION_TASK_TAG          0
 #define configUSE_COUNTING_SEMAPHORES           1
-#define configGENERATE_RUN_TIME_STATS           0
+#define configGENERATE_RUN_TIME_STATS           1
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                   0
 #define configMAX_CO_ROUTINE_PRIORITIES         ( 2 )
 
-/* Software timer definitions. */
-#define configUSE_TIMERS                        0
-#define configTIMER_TASK_PRIORITY               ( 2 )
+/* Software timer definitions. The daemon only sets the event bus bits
+published from interrupts, at the top priority they are set before any
+task runs. */
+#define configUSE_TIMERS                        1
+#define configTIMER_TASK_PRIORITY               ( configMAX_PRIORITIES - 1 )
 #define configTIMER_QUEUE_LENGTH                10
-#define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE * 2 )
+#define configTIMER_TASK_STACK_DEPTH            ( configMINIMAL_STACK_SIZE )
 
 /* Set the following definitions to 1 to include the API function, or zero
 to exclude the API function. */
@@ -128,6 +131,8 @@ to exclude the API function. */
 #define INCLUDE_xQueueGetMutexHolder            1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_eTaskGetState                   1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
+#define INCLUDE_xTimerPendFunctionCall          1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
@@ -158,6 +163,22 @@ See http://www.FreeRTOS.org/RTOS-Cortex-M3-M4.html. */
 header file. */
 #define configASSERT( x ) if( ( x ) == 0 ) { taskDISABLE_INTERRUPTS(); for( ;; ); }
 
+/* Tickless idle, STOP mode with the RTC alarm as wake up when no driver holds
+the clocks, the port SysTick sleep otherwise. Implemented in MISC.cpp. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+void Sys_suppressTicksAndSleep( uint32_t idleTicks );
+uint32_t Sys_runTimeCounter( void );
+#ifdef __cplusplus
+}
+#endif
+#define portSUPPRESS_TICKS_AND_SLEEP( xExpectedIdleTime ) Sys_suppressTicksAndSleep( xExpectedIdleTime )
+
+/* Run time stats in us from the DWT cycle counter, started by Sys_init. */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS()
+#define portGET_RUN_TIME_COUNTER_VALUE() Sys_runTimeCounter()
+
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
    standard names. */
 #define vPortSVCHandler    SVC_Handler
@@ -8,6 +8,7 @@
   */
 //-------------------------------------------------------------------------
 #include "BeeWatch.h"
+#include "string.h"
 
 using namespace hv_driver;
 
@@ -15,18 +16,22 @@ GPIO PB7(GPIOB, GPIO::PIN7);
 GPIO PB8(GPIOB, GPIO::PIN8);
 GPIO PB9(GPIOB, GPIO::PIN9);
 GPIO PA4(GPIOA, GPIO::PIN4);
-GPIO PA5(GPIOA, GPIO::PIN5);
-GPIO PA6(GPIOA, GPIO::PIN6);
-GPIO PA7(GPIOA, GPIO::PIN7);
 
 GPIO PB12(GPIOB, GPIO::PIN12); 
-GPIO PB13(GPIOB, GPIO::PIN13);
 GPIO PB14(GPIOB, GPIO::PIN14);
-GPIO PB15(GPIOB, GPIO::PIN15);
 GPIO PA8 (GPIOA, GPIO::PIN8);
 GPIO PA9 (GPIOA, GPIO::PIN9);
 GPIO PB1 (GPIOB, GPIO::PIN1);
 
+/* pins only the application touches */
+typedef PinInit<5, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH,
+				PinInit<6, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH,
+				PinInit<7, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH> > > ZnpSpiPins;		// SPI1 SCK, MISO, MOSI
+typedef PinInit<13, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH,
+				PinInit<15, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH> > LcdSpiPins;		// SPI2 SCK, MOSI
+typedef PinInit<6, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH> CaptureTxPin;	// USART1 TX remapped
+typedef Pin<GPIOB_BASE, 1> GyroInt;		// PB1, ADXL345 INT1, high until the source is read
+
 SPI spi2(SPI2);
 ILI9163 lcd(&spi2, &PB12, &PA9, &PA8, &PB14);
 _RTC clock;
@@ -35,42 +40,247 @@ ADXL345 gyro(&PB1);
 SPI spi1(SPI1);
 CC2530 znp(&PB7, &PB9, &PB8, &spi1, &PA4);
 Z_stack zigbee(&znp);
-HeartRate ppm(ADC1, ADC_CHANNEL_0, GPIOA, GPIO_PIN_0);
+TxWindow txWindow(&zigbee);
+TxScheduler txScheduler(&txWindow);
+Flash logFlash(BeeWatch::LOG_FLASH_BASE, BeeWatch::LOG_FLASH_PAGES);
+Flash alertFlash(BeeWatch::LOG_ALERT_BASE, BeeWatch::LOG_ALERT_PAGES);
+TelemetryLog tlmLog(&logFlash, &alertFlash);
+ADCScan adcScan(ADC1);
+HeartRate ppm;
+SignalQuality sqi;
+FuelGauge gauge;
+PPGCapture capture;
+CmdDispatcher downlink(BeeWatch::DOWNLINK_BASE);
+RadioPolicy radio;
+EventBus bus;
+Profiler profiler;
+TimeSync netTime;
+NetworkJoin network(&znp, &zigbee, &clock, BeeWatch::ZB_BKP_CACHE);
+
+/* latest decimated scan values, written from the DMA interrupt */
+__IO uint16_t vbatRaw = 0;
+__IO uint16_t tempRaw = 0;
+__IO uint16_t vrefRaw = 0;
 
-uint32_t freeFallTime;
+__IO bool freeFallHold = false;
+__IO uint32_t lastFall = 0;		// RadioPolicy, 0 is never
 
 __IO uint32_t actCount = 0;
 __IO uint32_t inActCount = 0;
+uint32_t actTick = 0;		// Sys_getTick counted up to, RTC interrupt only
 
 __IO uint32_t actMin = 0;
 __IO uint32_t inActMin = 0;
-bool actFlag = false;
+__IO bool actFlag = false; // written by the status task, read by ActivitySttCount
+
+/* joined state, written from the ZNP task */
+__IO bool zbConnected = false;
+
+/* downlink configuration, stored by the ZNP task and applied by the owner */
+__IO uint32_t reportPeriod = BeeWatch::ZB_REPORT_PERIOD;
+__IO uint32_t lastDownlink = 0;
+typedef struct {
+	__IO bool isPending;
+	uint16_t actThresh;			// mg, 0 keeps the current value
+	uint16_t freeFallThresh;	// mg
+	uint16_t freeFallTime;		// ms
+} gyroConfig_s;
+gyroConfig_s gyroConfig;
+typedef struct {
+	__IO bool isPending;
+	bool isExchange;							// reply to TIME_REQUEST, else time of day set by hand
+	_RTC::time_s time;
+	TimeSync::stamp_s request;		// t1, echoed
+	TimeSync::stamp_s reference;	// t2, coordinator
+	TimeSync::stamp_s reply;			// t4, taken on arrival
+} timeSync_s;
+timeSync_s timeSync;
 
 namespace hv_driver {
 
-void FreeFallCount(void){
-	freeFallTime--;
-	if(freeFallTime == 0){
-		Sys_subISRRemove(FreeFallCount);
-	}
+/* one shot, FREE_FALL_HOLD_MS after the fall */
+void FreeFallEnd(void){
+	freeFallHold = false;
+	bus.publish(EventBus::EV_MOTION);
 }
 
-void ActivitySttCount(void){
+/* on the RTC tick, not a Sys timer of its own that would keep idle out
+	 of STOP mode. Sys_getTick covers the seconds slept through in STOP.
+	 Returns EV_MINUTE when a minute was counted. */
+uint32_t ActivitySttCount(void){
+	uint32_t events = EventBus::EV_NONE;
+	uint32_t counts = (Sys_getTick() - actTick) / BeeWatch::ACT_COUNT_MS;
+
+	actTick += counts * BeeWatch::ACT_COUNT_MS;
 	if(actFlag == true){
-		actCount++;
-		if(actCount >= 60000){
-			actMin++; actCount = 0;
+		actCount += counts;
+		while(actCount >= 60000 / BeeWatch::ACT_COUNT_MS){
+			actMin++; actCount -= 60000 / BeeWatch::ACT_COUNT_MS;
+			events |= EventBus::EV_MINUTE;
 		}
 	} else {
-		inActCount++;
-		if(inActCount >= 60000){
-			inActMin++; inActCount = 0;
+		inActCount += counts;
+		while(inActCount >= 60000 / BeeWatch::ACT_COUNT_MS){
+			inActMin++; inActCount -= 60000 / BeeWatch::ACT_COUNT_MS;
+			events |= EventBus::EV_MINUTE;
 		}
 	}	
+	return events;
+}
+
+/* RTC second interrupt, seconds are on screen so every tick is shown.
+	 One publish, the minute and its second wake the screen once. */
+void TimeTick(uint8_t fields){
+	(void) fields;
+	bus.publish(ActivitySttCount() | EventBus::EV_SECOND);
+}
+
+/* PB1 rising edge, the source is read over I2C by the activity task */
+void gyroInterrupt(void){
+	bus.publish(EventBus::EV_GYRO);
+}
+
+void checkPPM(const uint16_t* samples, uint8_t len, uint32_t cycle, void* /* arg */){
+	uint32_t period = adcScan.getSamplePeriod();
+	bool isReady = ppm.isReady();
+
+	cycle -= (len - 1) * period; // timestamp of the first sample
+	capture.pushBlock(samples, len, cycle);
+	for(uint8_t i = 0; i < len; i++){
+		ppm.processSample(samples[i], cycle);
+		sqi.pushSample(samples[i]);
+		cycle += period;
+	}
+	if(isReady != true && ppm.isReady() == true){
+		bus.publish(EventBus::EV_HEART_RATE);
+	}
+}
+
+void storeADC(const uint16_t* samples, uint8_t len, uint32_t /* cycle */, void* arg){
+	*(__IO uint16_t*)arg = samples[len - 1];
+}
+
+void zigbeeStateChange(Z_stack::STATE_CHANGE state){
+	bool wasConnected = zbConnected;
+
+	switch(state){
+		case Z_stack::Zb_devEndDevice:
+		case Z_stack::Zb_devRouter:
+			zbConnected = true;
+			break;
+		case Z_stack::Zb_devNWKDisc:
+		case Z_stack::Zb_devNWKJoining:
+		case Z_stack::Zb_devNWKRejoin:
+		case Z_stack::Zb_devNWKOrphan:
+		case Z_stack::Zb_devHold:
+			zbConnected = false;
+			break;
+		default:
+			break;
+	}
+	if(zbConnected != wasConnected){
+		bus.publish(EventBus::EV_NETWORK);
+	}
+}
+
+void zigbeeReceive(Z_stack::RxPacket_s &rxPacket){
+	lastDownlink = osKernelSysTick() | 1; // 0 is never
+	downlink.dispatch(rxPacket.srcAddr, rxPacket.cmdID, rxPacket.rxPtr, rxPacket.len);
+}
+
+/* CFG_REPORT: period (u16, s) */
+bool setReportPeriod(uint16_t /* srcAddr */, const uint8_t* data, uint8_t /* len */, void* /* arg */){
+	uint32_t period = ((uint32_t)data[1] << 8 | data[0]) * 1000;
+	
+	if(period < BeeWatch::ZB_REPORT_MIN || period > BeeWatch::ZB_REPORT_MAX){
+		return false;
+	}
+	reportPeriod = period;
+	return true;
+}
+
+/* CFG_THRESHOLD: activity (u16, mg) | free fall (u16, mg) | free fall time (u16, ms) */
+bool setThreshold(uint16_t /* srcAddr */, const uint8_t* data, uint8_t /* len */, void* /* arg */){
+	if(gyroConfig.isPending == true){
+		return false; // previous one not applied yet
+	}
+	gyroConfig.actThresh = (uint16_t)(data[1] << 8) | data[0];
+	gyroConfig.freeFallThresh = (uint16_t)(data[3] << 8) | data[2];
+	gyroConfig.freeFallTime = (uint16_t)(data[5] << 8) | data[4];
+	gyroConfig.isPending = true;
+	bus.publish(EventBus::EV_GYRO); // applied by the activity task
+	return true;
+}
+
+/* u32 s | u16 ms, little endian */
+static void readStamp(const uint8_t* data, TimeSync::stamp_s &stamp){
+	stamp.seconds = ((uint32_t)data[3] << 24) | ((uint32_t)data[2] << 16) | ((uint32_t)data[1] << 8) | data[0];
+	stamp.ms = (uint16_t)(data[5] << 8) | data[4];
+}
+
+static void writeStamp(uint8_t* data, const TimeSync::stamp_s &stamp){
+	for(uint8_t i = 0; i < 4; i++){
+		data[i] = (uint8_t)(stamp.seconds >> (8 * i));
+	}
+	data[4] = (uint8_t)stamp.ms;
+	data[5] = (uint8_t)(stamp.ms >> 8);
+}
+
+/* TIME_SYNC: hours | minutes | seconds, set by hand
+	 or the reply to TIME_REQUEST: t1 echoed | coordinator t2, TIME_STAMP_LEN each */
+bool setTimeSync(uint16_t /* srcAddr */, const uint8_t* data, uint8_t len, void* /* arg */){
+	TimeSync::stamp_s reply;
+
+	clock.getStamp(reply.seconds, reply.ms); // t4 before anything else
+	if(timeSync.isPending == true){
+		return false; // previous one not applied yet
+	}
+	if(len >= 2 * BeeWatch::TIME_STAMP_LEN){
+		readStamp(data, timeSync.request);
+		readStamp(data + BeeWatch::TIME_STAMP_LEN, timeSync.reference);
+		if(timeSync.reference.ms > 999){
+			return false;
+		}
+		timeSync.reply = reply;
+		timeSync.isExchange = true;
+	} else {
+		if(data[0] > 23 || data[1] > 59 || data[2] > 59){
+			return false;
+		}
+		timeSync.time.hours = data[0];
+		timeSync.time.minutes = data[1];
+		timeSync.time.seconds = data[2];
+		timeSync.isExchange = false;
+	}
+	timeSync.isPending = true;
+	return true;
+}
+
+/* given up by the window, kept for when the coordinator is back */
+void zigbeeTxFail(const Z_stack::TxPacket_s &packet, void* /* arg */){
+	TelemetryLog::record_s record;
+	
+	if(packet.len > TelemetryLog::LOG_PAYLOAD){
+		return;
+	}
+	record.prio = (packet.cmdID == BeeWatch::FALL_ALERT) ? TxScheduler::PRIO_ALERT : TxScheduler::PRIO_LOW;
+	record.dstAddr = packet.dstAddr;
+	record.cmdID = packet.cmdID;
+	record.len = packet.len;
+	memcpy(record.data, packet.txPtr, packet.len);
+	if(tlmLog.store(record) != true){
+		txScheduler.post(record.prio, record.dstAddr, record.cmdID, record.data, record.len); // queued again
+	}
 }
 
-void checkPPM(void){
-	ppm.processing();
+/* a flash page erase stalls the CPU for longer than an ADC DMA half buffer */
+bool isLogEraseAllowed(void){
+	return (adcScan.isRunning() != true);
+}
+
+/* radio counted as transmitting while the window has packets out */
+void zigbeeTxBusy(bool isBusy){
+	gauge.setActive(FuelGauge::SUB_ZIGBEE_TX, isBusy);
 }
 
 BeeWatch::BeeWatch(void){
@@ -82,19 +292,99 @@ BeeWatch::BeeWatch(void){
 	this->time.minutes = 0;
 	this->time.seconds = 0;
 	this->heartRate = 0;
-	this->isNewPPM = false;
+	this->heartRateConfidence = 0;
+	this->hrCount = 0;
+	this->hrShift = 0;
+	this->ppmStart = 0;
+	this->isPpmRead = false;
+	this->isPPGCapture = false;
+	this->eventCount = 0;
+	this->nvPollRate = 0;
+	this->diagTime = 0;
+	this->batLevel = LOW;
+	this->isBatteryDrawn = false;
+	this->isConnected = false;
+	this->isNetworkDrawn = false;
 }
 
-void BeeWatch::init(void){
-
-	PB13.initAF(GPIO::PP, GPIO::HIGH);
-	PB15.initAF(GPIO::PP, GPIO::HIGH);
+/* event bus, fuel gauge, heart rate and the ADC scan, nothing to wait for.
+	 The bus comes first, every interrupt that publishes is enabled after. */
+void BeeWatch::initSensor(void){
+	bus.init();
+	gauge.init();
+	ppm.init();
+	sqi.init();
 	
-	lcd.init();
-	lcd.setScreen(BLACK);
-	clock.init();
+	adcScan.init();
+	uint8_t ppmRank = adcScan.addChannel(ADC_CHANNEL_0, ADC_SAMPLETIME_28CYCLES_5, GPIOA, GPIO_PIN_0);
+	uint8_t vbatRank = adcScan.addChannel(ADC_CHANNEL_1, ADC_SAMPLETIME_55CYCLES_5, GPIOA, GPIO_PIN_1);
+	uint8_t tempRank = adcScan.addChannel(ADC_CHANNEL_TEMPSENSOR, ADC_SAMPLETIME_239CYCLES_5);
+	uint8_t vrefRank = adcScan.addChannel(ADC_CHANNEL_VREFINT, ADC_SAMPLETIME_239CYCLES_5);
+	adcScan.subscribe(ppmRank, 1, checkPPM, NULL);
+	adcScan.subscribe(vbatRank, BAT_DECIMATION, storeADC, (void*)&vbatRaw);
+	adcScan.subscribe(tempRank, BAT_DECIMATION, storeADC, (void*)&tempRaw);
+	adcScan.subscribe(vrefRank, BAT_DECIMATION, storeADC, (void*)&vrefRaw);
+	this->startScan(); // first reading and battery values at boot
+}
+
+/* a new scan window, the pulses of the last one are stale */
+void BeeWatch::startScan(void){
 	ppm.init();
-	Sys_subISRAssign(checkPPM);
+	sqi.init();
+	this->isPpmRead = false;
+	this->ppmStart = osKernelSysTick();
+	adcScan.start();
+	gauge.setActive(FuelGauge::SUB_ADC, true);
+}
+
+void BeeWatch::stopScan(void){
+	adcScan.stop(); // releases its STOP mode lock
+	gauge.setActive(FuelGauge::SUB_ADC, false);
+}
+
+/**
+	* @brief  PPG scan on for one reading every PPM_PERIOD_MS and off in
+	*					between, battery and temperature are sampled with it. The
+	*					1 kHz scan holds the clocks, off it idle can use STOP mode.
+	* @retval ms until the next call is due, osWaitForever while the raw
+	*					PPG stream keeps the scan on
+	* @note		activity task only
+	*/
+uint32_t BeeWatch::scheduleHeartRate(void){
+	uint32_t elapsed = osKernelSysTick() - this->ppmStart;
+
+	if(this->isPPGCapture == true){
+		return osWaitForever;
+	}
+	if(adcScan.isRunning() == true){
+		if(this->isPpmRead != true && elapsed < PPM_WINDOW_MS){
+			return PPM_WINDOW_MS - elapsed;
+		}
+		this->stopScan();
+	}
+	if(elapsed >= PPM_PERIOD_MS){
+		this->startScan();
+		return PPM_WINDOW_MS;
+	}
+	return PPM_PERIOD_MS - elapsed;
+}
+
+/**
+	* @brief  LCD bring-up step, see BootSequencer
+	* @retval ms to wait before the next call, 0 when the screen is cleared
+	*/
+uint16_t BeeWatch::initDisplay(void){
+	uint16_t wait;
+
+	if(lcd.getInitState() == ILI9163::INIT_RESET){
+		PortInit<GPIOB_BASE, LcdSpiPins>::apply();
+	}
+	wait = lcd.initStep();
+	if(wait != 0){
+		return wait;
+	}
+	lcd.setScreen(BLACK);
+	gauge.setActive(FuelGauge::SUB_LCD, true);
 	
 	Bigfont.height = 24;
 	Bigfont.width = 24;
@@ -107,10 +397,33 @@ void BeeWatch::init(void){
 	smallFont.bkgColor = BLACK;
 	smallFont.textColor = WHITE;
 	smallFont.fontCode = Arial15x16;
+	return 0;
+}
+
+/**
+	* @brief  RTC bring-up step, the LSE takes up to seconds to start
+	* @retval ms to wait before the next call, 0 when the RTC runs
+	* @note		the first call already opens the backup registers
+	*/
+uint16_t BeeWatch::initClock(void){
+	uint16_t wait = clock.initStep();
+
+	if(wait == 0){
+		uint8_t cal;
+		bool isFast;
+
+		clock.startTick(TimeTick);
+		/* CAL survived with the drift, the prescaler was reset by init */
+		netTime.restore((int16_t)clock.readBackup(TIME_BKP_DRIFT) * TIME_DRIFT_SCALE);
+		netTime.getCalibration(cal, isFast);
+		clock.setCalibration(cal, isFast);
+		Sys_stopUnlock(); // RTC runs on LSE, tickless idle may use STOP mode
+	}
+	return wait;
 }
 
 void BeeWatch::initGyro(void){
-	PB1.initInput(GPIO::DOWN);
+	PB1.initExti(GPIO::EXT_INT_RISING, GPIO::DOWN, gyroInterrupt);
 	
 	this->status.isActivity = false;
 	this->status.isDataReady = false;
@@ -140,114 +453,311 @@ void BeeWatch::initGyro(void){
 	gyro.setFreeFallTime(30); // 30ms
 	
 	gyro.useInterrupt(ADXL345::INT_PIN_1);
+	PB1.enableEXTI(GYRO_IRQ_PRIORITY);
 	
-	Sys_subISRAssign(ActivitySttCount);
+	actTick = Sys_getTick();
 }
 
+/* hardware only, the ZNP is brought up by startZigbee once its task runs */
 void BeeWatch::initZigbee(void){	
 	__HAL_RCC_SPI1_CLK_ENABLE();
 	
-	PA5.initAF(GPIO::PP, GPIO::HIGH);
-	PA6.initAF(GPIO::PP, GPIO::HIGH);
-	PA7.initAF(GPIO::PP, GPIO::HIGH);
-	
-	zigbee.init(Z_stack::ZCD_startOpt_noClear, Z_stack::ZCD_endDevice, 0xFFFF);
+	PortInit<GPIOA_BASE, ZnpSpiPins>::apply();
 	
+	znp.init();
+	zigbee.setStateCallBack(zigbeeStateChange);
+	zigbee.setReceiveCallBack(zigbeeReceive);
+	downlink.add(CFG_REPORT, 2, setReportPeriod, NULL);
+	downlink.add(CFG_THRESHOLD, 6, setThreshold, NULL);
+	downlink.add(TIME_SYNC, 3, setTimeSync, NULL);
+	txWindow.init();
+	txWindow.setBusyCallBack(zigbeeTxBusy);
+	txWindow.setFailCallBack(zigbeeTxFail, NULL);
+	tlmLog.setEraseCallBack(isLogEraseAllowed);
+	tlmLog.init();
+}
+
+/* blocks until joined, the ZNP application is registered on every start */
+bool BeeWatch::startZigbee(void){
 	Z_stack::AppReg_s EndApp;
+	
 	EndApp.appEndPoint = 1;
 	EndApp.appProfileID = 0x000A;
 	EndApp.deviceID = 0x0001;
 	EndApp.deviceVersion = 0x01;
-	EndApp.inputCmdNum = 0;
+	EndApp.inputCmdNum = downlink.getCmdList(EndApp.inputCmd, 10);
 	EndApp.outputCmd[0] = STATUS;
 	EndApp.outputCmd[1] = FALL_ALERT;
 	EndApp.outputCmd[2] = HEART_RATE;
-	//EndApp.inputCmd[0] = 0xABCE;
-	EndApp.outputCmdNum = 3;
-	
-	lcd.putStr(10, 52, "BeeWatch", this->Bigfont);
-	this->updateNetWork(63, 0, false);
-	zigbee.appReg(EndApp);
-	zigbee.startReq();
-	Z_stack::START_COMFIRM_STATUS startStatus;
-	
-	while(1){
-		if(zigbee.getCallBack() == Z_stack::Zb_startConfirm){
-			startStatus = zigbee.startComfirm();
+	EndApp.outputCmd[3] = TELEMETRY;
+	EndApp.outputCmd[4] = DIAGNOSTICS;
+	EndApp.outputCmd[5] = TIME_REQUEST;
+	EndApp.outputCmdNum = 6;
+	network.setApp(EndApp, ZB_QUEUED_POLL_RATE, ZB_RESPONSE_POLL_RATE);
+	
+	if(network.join(ZB_RETRY_DELAY, 0) != true){
+		return false;
+	}
+	this->nvPollRate = 0; // the ZNP may have been reset
+	zbConnected = true;
+	return true;
+}
+
+uint32_t BeeWatch::getJoinTime(void){
+	return network.getJoinTime();
+}
+
+uint16_t BeeWatch::getShortAddr(void){
+	return network.getShortAddr();
+}
+
+bool BeeWatch::isZigbeeConnected(void){
+	return zbConnected;
+}
+
+/* stream raw PPG samples to a host for offline tuning of HeartRate */
+void BeeWatch::setPPGCapture(bool enable){
+	if(enable == true){
+		__HAL_RCC_AFIO_CLK_ENABLE();
+		__HAL_AFIO_REMAP_USART1_ENABLE(); // PA9 is used by the LCD
+		PortInit<GPIOB_BASE, CaptureTxPin>::apply();
+		capture.init(PPM_CAPTURE_BAUD, ADCScan::ADC_SCAN_RATE_HZ);
+		capture.start();
+		if(adcScan.isRunning() != true){
+			this->startScan();
+		}
+	} else {
+		capture.stop();
+	}
+	this->isPPGCapture = enable; // scheduleHeartRate leaves the scan on
+}
+
+/* heart rate series, activity, battery and events in one payload */
+void BeeWatch::sendTelemetry(void){
+	uint8_t buff[TelemetryFrame::TLM_MAX_SIZE];
+	TelemetryFrame frame(buff, sizeof(buff));
+	uint16_t voltage = this->getBatteryVoltage();
+	uint8_t hrSent, hrShift, eventSent = 0;
+	
+	voltage = (voltage + TLM_VOLTAGE_STEP / 2) / TLM_VOLTAGE_STEP * TLM_VOLTAGE_STEP;
+	
+	/* encode in place, the series is short */
+	__disable_irq();
+	for(; eventSent < this->eventCount; eventSent++){
+		if(frame.addEvent(this->events[eventSent].code, this->events[eventSent].time) != true){
 			break;
 		}
 	}
-	lcd.setScreen(BLACK);
+	frame.addActivity(actMin, inActMin);
+	frame.addBattery(gauge.getSoC(), voltage);
+	hrSent = frame.addHeartRate(this->hrSeries, this->hrCount);
+	hrShift = this->hrShift;
+	__enable_irq();
+	
+	if(txScheduler.post(TxScheduler::PRIO_NORMAL, 0x0000, TELEMETRY, buff, frame.getLength(),
+											TxScheduler::POST_DROP_UNCHANGED) != true){
+		return; // kept for the next frame
+	}
+	
+	/* drop what went out, new entries may have been added meanwhile */
+	__disable_irq();
+	hrShift = this->hrShift - hrShift; // sent readings already pushed out as oldest
+	hrSent = (hrShift < hrSent) ? (hrSent - hrShift) : 0;
+	this->hrCount -= hrSent;
+	memmove(this->hrSeries, this->hrSeries + hrSent, this->hrCount * sizeof(this->hrSeries[0]));
+	this->eventCount -= eventSent;
+	memmove(this->events, this->events + eventSent, this->eventCount * sizeof(this->events[0]));
+	__enable_irq();
 }
 
-void BeeWatch::sendPPM(void){
-	if(this->isNewPPM == true){
-	__IO Z_stack::STATUS zbStt;	
-	this->isNewPPM = false;
-	Z_stack::TxPacket_s txPacket;
-	txPacket.cmdID = HEART_RATE;
-	txPacket.dstAddr = 0x0000;
-	txPacket.handle = 2;
-	txPacket.len = 1;
-	txPacket.txPtr = &this->heartRate;
-	
-	zigbee.sendDataReq(txPacket, false, 10);
-		while(1){
-			if(zigbee.getCallBack() == Z_stack::Zb_sendDataConfirm){
-				zbStt = zigbee.sendDataComfirm(txPacket);
-				break;
-			}
-		}		
+/* ZNP link counters since the last packet, every ZB_DIAG_PERIOD */
+void BeeWatch::sendDiagnostics(void){
+	uint8_t buff[TelemetryFrame::TLM_MAX_SIZE];
+	TelemetryFrame frame(buff, sizeof(buff));
+	TelemetryFrame::link_s link;
+	CC2530::metrics_s metrics;
+	Z_stack::ConfirmMetrics_s confirm;
+	uint32_t now = osKernelSysTick();
+	
+	if(this->diagTime != 0 && now - this->diagTime < ZB_DIAG_PERIOD){
+		return;
+	}
+	znp.getMetrics(metrics);
+	zigbee.getConfirmMetrics(confirm);
+	link.srspTimeout = metrics.srspTimeout;
+	link.srdyTimeout = metrics.srdyTimeout;
+	link.srdyWait = metrics.srdyWait;
+	link.bytesOut = metrics.bytesOut;
+	link.bytesIn = metrics.bytesIn;
+	link.dropAREQ = metrics.dropAREQ;
+	link.retries = txWindow.getRetryCount();
+	link.txFail = txWindow.getFailCount();
+	link.confirmFail = confirm.failure;
+	for(uint8_t i = 0; i < TelemetryFrame::TLM_LATENCY_BINS; i++){
+		link.latency[i] = metrics.latency[i];
+	}
+	frame.addLink(link);
+	if(txScheduler.post(TxScheduler::PRIO_LOW, 0x0000, DIAGNOSTICS, buff, frame.getLength(),
+											TxScheduler::POST_COALESCE) == true && this->sendProfile() == true){
+		this->diagTime = now | 1;
 	}
 }
 
-void BeeWatch::sendMessage(void){
-	uint8_t data[9] = {0};
-	__IO Z_stack::STATUS zbStt;	
+/* CPU and stack use since the last diagnostics packet */
+bool BeeWatch::sendProfile(void){
+	uint8_t buff[TelemetryFrame::TLM_MAX_SIZE];
+	TelemetryFrame frame(buff, sizeof(buff));
+	TelemetryFrame::profile_s profile;
+	Profiler::report_s report;
+	
+	if(profiler.sample(report) != true){
+		return true; // more tasks than the profiler keeps, nothing to send
+	}
+	profile.period = report.period / 1000;
+	profile.heapFree = report.heapFree;
+	profile.heapMin = report.heapMin;
+	profile.overflow = clock.readBackup(PROFILE_BKP_OVERFLOW);
+	for(uint8_t i = 0; i < TelemetryFrame::TLM_PROFILE_ISR; i++){
+		profile.isr[i] = report.isr[i];
+	}
+	profile.taskCount = report.taskCount;
+	for(uint8_t i = 0; i < report.taskCount; i++){
+		profile.task[i].number = report.task[i].number;
+		profile.task[i].cpu = report.task[i].cpu;
+		profile.task[i].stackFree = report.task[i].stackFree;
+	}
+	frame.addProfile(profile);
+	if(txScheduler.post(TxScheduler::PRIO_LOW, 0x0000, PROFILE, buff, frame.getLength(),
+											TxScheduler::POST_COALESCE) != true){
+		return false;
+	}
+	if(profile.overflow != 0){
+		clock.writeBackup(PROFILE_BKP_OVERFLOW, 0);
+	}
+	return true;
+}
 
-	data[0] = 0xFF;
-	for(uint8_t i = 0; i < 4; i++){
-		data[i + 1] = actMin >> 8 * i;
-		data[i + 5] = inActMin >> 8 * i;		
-	}
-	
-	Z_stack::TxPacket_s txPacket;
-	txPacket.cmdID = STATUS;
-	txPacket.dstAddr = 0x0000;
-	txPacket.handle = 1;
-	txPacket.len = 9;
-	txPacket.txPtr = data;
-	
-		zigbee.sendDataReq(txPacket, false, 10);
-		while(1){
-			if(zigbee.getCallBack() == Z_stack::Zb_sendDataConfirm){
-				zbStt = zigbee.sendDataComfirm(txPacket);
-				break;
-			}
-		}
+/**
+	* @brief  stack overflow hook, keep the task for the next profile and reset
+	* @param  const char* taskName
+	* @retval none
+	*/
+void BeeWatch::stackOverflow(const char* taskName){
+	uint16_t tag = ((uint16_t)taskName[0] << 8) | (uint8_t)taskName[1];
+	
+	clock.writeBackup(PROFILE_BKP_OVERFLOW, (tag != 0) ? tag : 1);
+	NVIC_SystemReset();
 }
 
+/* queued even before the network is up, sent first once it is */
 void BeeWatch::sendAlert(void){
-	__IO Z_stack::STATUS zbStt;	
-	
-	Z_stack::TxPacket_s txPacket;
-	txPacket.cmdID = FALL_ALERT;
-	txPacket.dstAddr = 0x0000;
-	txPacket.handle = 2;
-	txPacket.len = 0;
-	
-		zigbee.sendDataReq(txPacket, false, 10);
-		while(1){
-			if(zigbee.getCallBack() == Z_stack::Zb_sendDataConfirm){
-				zbStt = zigbee.sendDataComfirm(txPacket);
-				break;
+	txScheduler.post(TxScheduler::PRIO_ALERT, 0x0000, FALL_ALERT, NULL, 0);
+}
+
+/* runs in the Network task, returns after timeout ms */
+void BeeWatch::dispatchTelemetry(uint32_t timeout){
+	/* network down, queued packets go to the log instead of failing
+		 retries, what it refuses stays queued */
+	if(zbConnected != true){
+		tlmLog.hold(txScheduler);
+		osDelay(timeout);
+		return;
+	}
+	tlmLog.drain(txScheduler, LOG_DRAIN_BATCH);
+	txScheduler.dispatch(timeout);
+}
+
+TelemetryLog* BeeWatch::getTelemetryLogInstant(void){
+	return &tlmLog;
+}
+
+/* poll and report faster on alerts and downlink, slower when idle or low */
+void BeeWatch::updateRadio(void){
+	RadioPolicy::input_s input;
+	
+	input.isActive = actFlag;
+	input.lastAlert = lastFall;
+	input.lastDownlink = lastDownlink;
+	input.soc = gauge.getSoC();
+	radio.setReportBase(reportPeriod);
+	radio.update(input, osKernelSysTick());
+	
+	/* retried on the next call if the write failed */
+	if(zbConnected == true && radio.getPollRate() != this->nvPollRate){
+		if(zigbee.updateConf(Z_stack::ZCD_NV_pollRate, radio.getPollRate()) == Z_stack::ZSuccess){
+			this->nvPollRate = radio.getPollRate();
+		}
+	}
+}
+
+/**
+	* @brief  apply a TIME_SYNC and send TIME_REQUEST when due, runs in the
+	*					Network task
+	* @note		a request goes out every TimeSync interval, up to a day apart
+	*					once the drift is calibrated out
+	*/
+void BeeWatch::syncTime(void){
+	TimeSync::stamp_s now;
+	uint8_t buff[TIME_STAMP_LEN];
+	int32_t step;
+	uint8_t cal;
+	bool isFast;
+
+	if(timeSync.isPending == true){
+		if(timeSync.isExchange != true){
+			clock.setTime(timeSync.time);
+			netTime.restart();
+		} else if(netTime.update(timeSync.request, timeSync.reference, timeSync.reply, step) == true){
+			if(step != 0){
+				clock.adjust(step);
 			}
+			netTime.getCalibration(cal, isFast);
+			clock.setCalibration(cal, isFast);
+			clock.writeBackup(TIME_BKP_DRIFT, (uint16_t)(int16_t)(netTime.getDrift() / TIME_DRIFT_SCALE));
 		}
+		timeSync.isPending = false;
+	}
+
+	clock.getStamp(now.seconds, now.ms);
+	if(zbConnected != true || netTime.isDue(now.seconds) != true){
+		return;
+	}
+	writeStamp(buff, now);
+	if(txScheduler.post(TxScheduler::PRIO_NORMAL, 0x0000, TIME_REQUEST, buff, sizeof(buff)) == true){
+		netTime.requested(now);
+	}
+}
+
+/* CFG_REPORT base scaled by the radio mode */
+uint32_t BeeWatch::getReportPeriod(void){
+	return radio.getReportPeriod();
 }
 
+/* on EV_GYRO in the activity task, the only user of the gyro bus. I2C
+	 waits on the tick, it must not run in an interrupt. */
 void BeeWatch::checkGyroStatus(void){
-	if(PB1.read() == 1){
+	if(gyroConfig.isPending == true){
+		if(gyroConfig.actThresh != 0){
+			gyro.setThreshActivity(gyroConfig.actThresh);
+		}
+		if(gyroConfig.freeFallThresh != 0){
+			gyro.setThreshFreeFall(gyroConfig.freeFallThresh);
+		}
+		if(gyroConfig.freeFallTime != 0){
+			gyro.setFreeFallTime(gyroConfig.freeFallTime);
+		}
+		gyroConfig.isPending = false;
+	}
+	if(GyroInt::read() == 1){
+		ADXL345::IntVal_s oldStatus = this->rawStatus;
 		gyro.readInterrupt(this->rawStatus);
+		if(memcmp(&oldStatus, &this->rawStatus, sizeof(oldStatus)) != 0){
+			this->motionRing.push(this->rawStatus); // a short free fall is not overwritten before the task sees it
+			bus.publish(EventBus::EV_MOTION);
+		}
+		if(GyroInt::read() == 1){
+			bus.publish(EventBus::EV_GYRO); // raised again before the read, no new edge
+		}
 	}
 }
 
@@ -275,10 +785,45 @@ void BeeWatch::drawBattery(uint8_t x, uint8_t y, BATTERY_LEVEL batLevel){
 	}
 }
 
+void BeeWatch::updateBattery(uint8_t x, uint8_t y){
+	BATTERY_LEVEL level;
+	
+	gauge.update(this->getBatteryVoltage());
+	level = this->getBatteryLevel();
+	
+	if(this->isBatteryDrawn == false || level != this->batLevel){
+		this->drawBattery(x, y, level);
+		this->batLevel = level;
+		this->isBatteryDrawn = true;
+	}
+}
+
 void BeeWatch::updateHeartRate(uint8_t x, uint8_t y){
 	char buff[5];
-	if(ppm.getHeartRate(this->heartRate) == true){
-		this->isNewPPM = true;
+	uint8_t newHeartRate;
+	SignalQuality::quality_s quality;
+	
+	if(ppm.getHeartRate(newHeartRate) == true){
+		/* drop readings taken from noise or motion */
+		if(sqi.evaluate(quality) != true || quality.confidence < PPM_MIN_CONFIDENCE){
+			return;
+		}
+		this->heartRate = newHeartRate;
+		this->heartRateConfidence = quality.confidence;
+		
+		TelemetryFrame::hrSample_s sample;
+		sample.time = clock.getEpoch();
+		sample.bpm = newHeartRate;
+		sample.confidence = quality.confidence;
+		__disable_irq();
+		if(this->hrCount == TLM_HR_SERIES){ // oldest reading gives way
+			this->hrCount--;
+			this->hrShift++;
+			memmove(this->hrSeries, this->hrSeries + 1, this->hrCount * sizeof(sample));
+		}
+		this->hrSeries[this->hrCount++] = sample;
+		__enable_irq();
+		this->isPpmRead = true;
 		sprintf((char*)buff, " %0.2d", this->heartRate);
 		lcd.putStr(x, y, buff, this->smallFont);
 	}
@@ -305,37 +850,58 @@ void BeeWatch::updateTime(uint8_t x, uint8_t y){
 	this->time = nowTime;
 }
 
+/* drains the sources queued by checkGyroStatus in order, with none queued
+	 it redraws from the last one once the free fall hold ends */
 void BeeWatch::updateStatus(uint8_t x, uint8_t y){
-		if(this->rawStatus.isFreeFall == true){
-			if(gyro.humanFallDetect() == ADXL345::NORMAL_FALL){
-				this->status.isFreeFall = true;
-			} else {
-				this->status.isActivity = true;
-			};
-		} else {
-			this->status = this->rawStatus;
-		}	
+	ADXL345::IntVal_s source;
+	bool isNew = this->motionRing.pop(source);
 	
-	if(this->status.isActivity == true && this->oldStatus != ACTIVITY && freeFallTime == 0){
+	do {
+		if(isNew == true){
+			if(source.isFreeFall == true){
+				if(gyro.humanFallDetect() == ADXL345::NORMAL_FALL){
+					this->status.isFreeFall = true;
+				} else {
+					this->status.isActivity = true;
+				};
+			} else {
+				this->status = source;
+			}	
+		}
+		this->showStatus(x, y);
+		isNew = this->motionRing.pop(source);
+	} while(isNew == true);
+}
+
+void BeeWatch::showStatus(uint8_t x, uint8_t y){
+	if(this->status.isActivity == true && this->oldStatus != ACTIVITY && freeFallHold != true){
 		this->smallFont.textColor = ORANGE;
 		lcd.putStr(x, y, "ACTIVITY  ", this->smallFont);
 		this->smallFont.textColor = WHITE;
 		this->oldStatus = ACTIVITY;
 		actFlag = true;
 	}
-	if(this->status.isInactivity == true && this->oldStatus != INACTIVITY && freeFallTime == 0){
+	if(this->status.isInactivity == true && this->oldStatus != INACTIVITY && freeFallHold != true){
 		lcd.putStr(x, y, "INACTIVITY", this->smallFont);
 		this->oldStatus = INACTIVITY;
 		actFlag = false;
 	}
 	if(this->status.isFreeFall == true && this->oldStatus != FREE_FALL){
 		this->sendAlert();
+		__disable_irq();
+		if(this->eventCount < TLM_EVENTS){
+			this->events[this->eventCount].code = TelemetryFrame::TLM_EVENT_FALL;
+			this->events[this->eventCount].time = clock.getEpoch();
+			this->eventCount++;
+		}
+		__enable_irq();
 		this->smallFont.textColor = RED;
 		lcd.putStr(x, y, "FREE FALL", this->smallFont);
 		this->smallFont.textColor = WHITE;
 		this->oldStatus = FREE_FALL;
-		freeFallTime = 5000;
-		Sys_subISRAssign(FreeFallCount);
+		freeFallHold = true;
+		lastFall = osKernelSysTick() | 1;
+		Sys_timerOnce(FreeFallEnd, FREE_FALL_HOLD_MS);
 	}	
 }
 
@@ -395,6 +961,45 @@ uint32_t BeeWatch::getInActMin(void){
 	return inActMin;
 }
 
+/* VDDA is measured through Vrefint, the divided VBAT is read against it */
+uint16_t BeeWatch::getBatteryVoltage(void){
+	uint16_t vref = vrefRaw;
+	
+	if(vref == 0){
+		return 0;
+	}
+	return (uint32_t)vbatRaw * BAT_VREFINT_MV * BAT_DIVIDER / vref; // in mV
+}
+
+/* die temperature in 0.1 degC, V25 = 1.43V, slope 4.3mV/degC */
+int16_t BeeWatch::getTemperature(void){
+	uint16_t vref = vrefRaw;
+	int32_t vsense;
+	
+	if(vref == 0){
+		return 0;
+	}
+	vsense = (uint32_t)tempRaw * BAT_VREFINT_MV / vref; // in mV
+	return (int16_t)((1430 - vsense) * 100 / 43 + 250);
+}
+
+BeeWatch::BATTERY_LEVEL BeeWatch::getBatteryLevel(void){
+	uint8_t soc = gauge.getSoC();
+	
+	if(gauge.isCharging() == true){
+		return CHARGING;
+	} else if(soc >= BAT_FULL_SOC){
+		return FULL;
+	} else if(soc >= BAT_MEDIUM_SOC){
+		return MEDIUM;
+	}
+	return LOW;
+}
+
+FuelGauge* BeeWatch::getFuelGaugeInstant(void){
+	return &gauge;
+}
+
 
 void BeeWatch::updateNetWork(uint8_t x, uint8_t y, bool isConnected){
 	this->beePicture.width = 32;
@@ -409,11 +1014,34 @@ void BeeWatch::updateNetWork(uint8_t x, uint8_t y, bool isConnected){
 	}
 }
 
+/* redraw the network icon only when the joined state changes */
+void BeeWatch::updateNetWorkStatus(uint8_t x, uint8_t y){
+	bool connected = zbConnected;
+	
+	if(this->isNetworkDrawn == false || connected != this->isConnected){
+		this->updateNetWork(x, y, connected);
+		this->isConnected = connected;
+		this->isNetworkDrawn = true;
+	}
+}
+
 ADXL345* BeeWatch::getGyroInstant(void){ 
 	return &gyro;
 }
 ILI9163* BeeWatch::getLCDInstant(void){
 	return &lcd;
 }
+CC2530* BeeWatch::getZNPInstant(void){
+	return &znp;
+}
+TxWindow* BeeWatch::getTxWindowInstant(void){
+	return &txWindow;
+}
+TxScheduler* BeeWatch::getTxSchedulerInstant(void){
+	return &txScheduler;
+}
+EventBus* BeeWatch::getEventBusInstant(void){
+	return &bus;
+}
 
 }
\ No newline at end of file
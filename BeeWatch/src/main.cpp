@@ -9,28 +9,41 @@
 //-------------------------------------------------------------------------
 #include "stm32f1xx.h"
 #include "GPIO.h"
+#include "Pin.h"
 #include "SPI.h"
 #include "ILI9163.h"
 #include "RTC.h"
 #include "BeeWatch.h" 
+#include "BootSequencer.h"
 #include "MISC.h"
+#include "BeeWatchTasks.h"
 #include "cmsis_os.h"
 
 using namespace hv_driver;
 
 /* Local Function prototype */
-void checkStatus(void);
-
+static void Boot(void const *argument);
 static void MainScreen(void const *argument);
 static void Network(void const *argument);
+static void ZNPTask(void const *argument);
+static void ZigbeeTx(void const *argument);
 static void ActivityStatus(void const *argument);
 static void updateTime(void const *argument);
+static uint16_t bootClock(void* arg);
+static uint16_t bootDisplay(void* arg);
+static uint16_t bootGyro(void* arg);
 
 /* Local Object */
-GPIO PC13(GPIOC, GPIO::PIN13); // led pin
-osThreadId ThreadMainScreen, ThreadNetwork, ThreadActivity, ThreadTime;
+typedef Pin<GPIOC_BASE, 13> Led;
+osThreadId ThreadBoot, ThreadNetwork, ThreadActivity, ThreadTime, ThreadZNP, ThreadZigbeeTx;
+BootTask taskBoot;
+NetworkTask taskNetwork;
+ZnpTask taskZNP;
+ZigbeeTxTask taskZigbeeTx;
+ActivityTask taskActivity;
 
 BeeWatch _BeeWatch;
+BootSequencer boot;
 
 /* Local Var */
 uint16_t count = 0;
@@ -42,63 +55,150 @@ int main(void){
 	__HAL_RCC_GPIOB_CLK_ENABLE();
 	__HAL_RCC_GPIOA_CLK_ENABLE();
 
-	PC13.initOutput(GPIO::PP, GPIO::MEDIUM); // init LED
-	PC13.set();
-	_BeeWatch.init();
-	_BeeWatch.initGyro();
-	_BeeWatch.initZigbee();
-	PC13.reset();
-
-  osThreadDef(MAIN_SCREEN, MainScreen, osPriorityNormal, 0, configMINIMAL_STACK_SIZE);
-  osThreadDef(ACTIVITY_STATUS, ActivityStatus, osPriorityNormal, 0, configMINIMAL_STACK_SIZE);
-  osThreadDef(NETWORK, Network, osPriorityHigh, 0, configMINIMAL_STACK_SIZE);
- 
-  ThreadMainScreen = osThreadCreate(osThread(MAIN_SCREEN), NULL);
-	ThreadActivity = osThreadCreate(osThread(ACTIVITY_STATUS), NULL);
-	ThreadNetwork = osThreadCreate(osThread(NETWORK), NULL);
+	PortInit<GPIOC_BASE, PinInit<13, GPIO::OUTPUT, GPIO::PP, GPIO::NONE, GPIO::MEDIUM> >::apply();
+	Led::set();
+
+	ThreadBoot = taskBoot.start("BOOT", Boot, NULL);
 	
   osKernelStart();
 	while(1){
 	}
 }
 
+/* device bring-up once the scheduler runs, the LSE start, LCD reset and
+	 ZNP reset wait at the same time. Application tasks start when done and
+	 the task carries on as the main screen, its stack can not be freed. */
+static void Boot(void const *argument){
+	uint16_t wait;
+	(void) argument;
+
+	_BeeWatch.initSensor();
+	boot.add(bootClock, NULL);
+	boot.add(bootDisplay, NULL);
+	boot.add(bootGyro, NULL);
+	wait = boot.poll(osKernelSysTick()); // opens the backup registers the network cache is in
+	
+	_BeeWatch.initZigbee();
+#ifdef BEEWATCH_PPG_CAPTURE
+	_BeeWatch.setPPGCapture(true);
+#endif
+	ThreadNetwork = taskNetwork.start("NETWORK", Network, NULL);
+	ThreadZNP = taskZNP.start("ZNP", ZNPTask, NULL);
+	ThreadZigbeeTx = taskZigbeeTx.start("ZIGBEE_TX", ZigbeeTx, NULL);
+
+	while(wait != BootSequencer::BOOT_DONE){
+		osDelay(wait);
+		wait = boot.poll(osKernelSysTick());
+	}
+	Led::reset();
+
+	ThreadActivity = taskActivity.start("ACTIVITY_STATUS", ActivityStatus, NULL);
+	osThreadSetPriority(NULL, osPriorityNormal);
+	MainScreen(argument);
+}
+
+static uint16_t bootClock(void* arg){
+	(void) arg;
+	return _BeeWatch.initClock();
+}
+
+static uint16_t bootDisplay(void* arg){
+	(void) arg;
+	return _BeeWatch.initDisplay();
+}
+
+static uint16_t bootGyro(void* arg){
+	(void) arg;
+	_BeeWatch.initGyro();
+	return BootSequencer::BOOT_DONE;
+}
+
+/* redraws only what an event says has changed */
 static void MainScreen(void const *argument){
 	(void) argument;
-	__IO uint8_t buff[10];
-	_BeeWatch.drawBattery(95, 0, BeeWatch::CHARGING);
-	_BeeWatch.updateNetWork(63, 0, true);
+	EventBus* bus = _BeeWatch.getEventBusInstant();
+	uint32_t events = EventBus::EV_SECOND | EventBus::EV_MINUTE | EventBus::EV_NETWORK;
+	char buff[16]; // "inact min " and up to 5 digits
+
+	bus->subscribe(events);
 	_BeeWatch.drawHeart(0, 20);
 	while(1){
-		sprintf((char*)buff, "act min %0.3d", _BeeWatch.getInActMin());
-		_BeeWatch.getLCDInstant()->putStr(0, 93, (const char*)buff, _BeeWatch.getsmallFont());
-		
-		sprintf((char*)buff, "inact min %0.3d", _BeeWatch.getActMin());
-		_BeeWatch.getLCDInstant()->putStr(0, 110, (const char*)buff, _BeeWatch.getsmallFont());
-		_BeeWatch.updateTime(0, 60);
-		osDelay(1000);
+		if(events & EventBus::EV_MINUTE){
+			snprintf(buff, sizeof(buff), "act min %03u", (unsigned)_BeeWatch.getInActMin());
+			_BeeWatch.getLCDInstant()->putStr(0, 93, buff, _BeeWatch.getsmallFont());
+			
+			snprintf(buff, sizeof(buff), "inact min %03u", (unsigned)_BeeWatch.getActMin());
+			_BeeWatch.getLCDInstant()->putStr(0, 110, buff, _BeeWatch.getsmallFont());
+		}
+		if(events & EventBus::EV_SECOND){
+			_BeeWatch.updateTime(0, 60);
+			_BeeWatch.updateBattery(95, 0);
+		}
+		if(events & EventBus::EV_NETWORK){
+			_BeeWatch.updateNetWorkStatus(63, 0);
+		}
+		events = bus->wait(osWaitForever);
 	}
 }
 
 static void Network(void const *argument){
 	(void) argument;
+	_BeeWatch.startZigbee(); // until joined
 	while(1){
-		_BeeWatch.sendMessage();
-		_BeeWatch.sendPPM();
-		osDelay(3000);
+		_BeeWatch.updateRadio();
+		_BeeWatch.syncTime();
+		_BeeWatch.sendTelemetry();
+#ifdef BEEWATCH_ZB_DIAG
+		_BeeWatch.sendDiagnostics();
+#endif
+		_BeeWatch.dispatchTelemetry(_BeeWatch.getReportPeriod());
 	}
 }
 
+/* SRDY interrupt and SPI DMA wake this task, it owns the ZNP link */
+static void ZNPTask(void const *argument){
+	(void) argument;
+	_BeeWatch.getZNPInstant()->run();
+}
+
+/* keeps several data requests in flight, retries failed ones */
+static void ZigbeeTx(void const *argument){
+	(void) argument;
+	_BeeWatch.getTxWindowInstant()->run();
+}
+
+/* runs on gyro, motion and heart rate events, owns the gyro bus and the
+	 heart rate scan window */
 static void ActivityStatus(void const *argument){
 	(void) argument;
-	Sys_subISRAssign(checkStatus);
+	EventBus* bus = _BeeWatch.getEventBusInstant();
+	uint32_t events = EventBus::EV_GYRO | EventBus::EV_MOTION | EventBus::EV_HEART_RATE;
+
+	bus->subscribe(events);
 	while(1){
-		_BeeWatch.updateStatus(0, 76);
-		_BeeWatch.updateHeartRate(35, 28);
-		osDelay(10);
+		if(events & EventBus::EV_GYRO){
+			_BeeWatch.checkGyroStatus(); // also INT1 raised before the EXTI was on
+		}
+		if(events & EventBus::EV_MOTION){
+			_BeeWatch.updateStatus(0, 76);
+		}
+		if(events & EventBus::EV_HEART_RATE){
+			_BeeWatch.updateHeartRate(35, 28);
+		}
+		events = bus->wait(_BeeWatch.scheduleHeartRate());
 	}
 }
 
-void checkStatus(void){
-	_BeeWatch.checkGyroStatus();
+/* configCHECK_FOR_STACK_OVERFLOW, checked on every switch out of the task */
+extern "C" void vApplicationStackOverflowHook(TaskHandle_t xTask, char* pcTaskName){
+	(void) xTask;
+	_BeeWatch.stackOverflow(pcTaskName);
 }
 
+/* configUSE_MALLOC_FAILED_HOOK, the heap only serves boot time objects so
+	 this means configTOTAL_HEAP_SIZE is too small */
+extern "C" void vApplicationMallocFailedHook(void){
+	taskDISABLE_INTERRUPTS();
+	while(1){
+	}
+}
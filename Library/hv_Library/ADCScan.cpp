@@ -0,0 +1,315 @@
+/**
+  ******************************************************************************
+ * @file    ADCScan.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   ADC1 regular group scan with DMA and per channel subscribers
+  */
+//-------------------------------------------------------------------------
+#include "ADCScan.h"
+#include "MISC.h"
+#include "string.h"
+
+/* boxcar anti-alias filter, 1/8 per tap in q15 */
+static q15_t ADCScan_firCoeffs[hv_driver::ADCScan::ADC_SCAN_FIR_TAPS] = {
+	4096, 4096, 4096, 4096, 4096, 4096, 4096, 4096
+};
+
+static const uint32_t ADCScan_rankTable[hv_driver::ADCScan::ADC_SCAN_MAX_CHANNEL] = {
+	ADC_REGULAR_RANK_1, ADC_REGULAR_RANK_2, ADC_REGULAR_RANK_3, ADC_REGULAR_RANK_4
+};
+
+static hv_driver::ADCScan* ADCScan_instance = NULL;
+
+namespace hv_driver {
+
+ADCScan::ADCScan(ADC_TypeDef* ADCx) {
+	_adcHandle.Instance = ADCx;
+	_timHandle.Instance = TIM3;
+	_channelNum = 0;
+	_cyclePerScan = 0;
+	_isRunning = false;
+	memset(_subscriber, 0, sizeof(_subscriber));
+}
+
+/**
+	* @brief  enable ADC, DMA and TIM3 clocks, calibrate ADC
+	* @param  none
+	* @retval none
+	* @note		channels are added after init and the scan runs after start
+	*/
+void ADCScan::init(void) {
+	RCC_PeriphCLKInitTypeDef PeriphClkInit;
+	PeriphClkInit.PeriphClockSelection = RCC_PERIPHCLK_ADC;
+	PeriphClkInit.AdcClockSelection = RCC_ADCPCLK2_DIV6;
+	HAL_RCCEx_PeriphCLKConfig(&PeriphClkInit);
+	__HAL_RCC_ADC1_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+	__HAL_RCC_TIM3_CLK_ENABLE();
+
+	_adcHandle.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+	_adcHandle.Init.ScanConvMode = ADC_SCAN_ENABLE;
+	_adcHandle.Init.ContinuousConvMode = DISABLE;
+	_adcHandle.Init.DiscontinuousConvMode = DISABLE;
+	_adcHandle.Init.NbrOfConversion = 1;
+	_adcHandle.Init.NbrOfDiscConversion = 1;
+	_adcHandle.Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T3_TRGO;
+	HAL_ADC_Init(&_adcHandle);
+	HAL_ADCEx_Calibration_Start(&_adcHandle);
+
+	/*	TIM3 update event triggers one scan every 1ms	*/
+	TIM_MasterConfigTypeDef masterConfig;
+	_timHandle.Init.Prescaler = (SystemCoreClock / 1000000) - 1;
+	_timHandle.Init.CounterMode = TIM_COUNTERMODE_UP;
+	_timHandle.Init.Period = (1000000 / ADC_SCAN_RATE_HZ) - 1;
+	_timHandle.Init.ClockDivision = TIM_CLOCKDIVISION_DIV1;
+	HAL_TIM_Base_Init(&_timHandle);
+	masterConfig.MasterOutputTrigger = TIM_TRGO_UPDATE;
+	masterConfig.MasterSlaveMode = TIM_MASTERSLAVEMODE_DISABLE;
+	HAL_TIMEx_MasterConfigSynchronization(&_timHandle, &masterConfig);
+
+	_cyclePerScan = SystemCoreClock / ADC_SCAN_RATE_HZ;
+	ADCScan_instance = this;
+
+	HAL_NVIC_SetPriority(DMA1_Channel1_IRQn, ADC_SCAN_IRQ_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel1_IRQn);
+}
+
+/**
+	* @brief  append a channel to the regular scan group
+	* @param  uint32_t channel - ADC_CHANNEL_x, ADC_CHANNEL_TEMPSENSOR, ADC_CHANNEL_VREFINT
+	* @param  uint32_t samplingTime - ADC_SAMPLETIME_x
+	* @param  GPIO_TypeDef* port, uint16_t pin - analog input pin, NULL for internal channels
+	* @retval rank of the channel in the scan, ADC_SCAN_INVALID if group full
+	* @note		call before start, temp sensor needs >= 17.1us sampling time
+	*/
+uint8_t ADCScan::addChannel(uint32_t channel, uint32_t samplingTime, GPIO_TypeDef* port, uint16_t pin) {
+	ADC_ChannelConfTypeDef sConf;
+
+	if (_channelNum >= ADC_SCAN_MAX_CHANNEL) {
+		return ADC_SCAN_INVALID;
+	}
+
+	if (port != NULL) {
+		if (port == GPIOA) {
+			__GPIOA_CLK_ENABLE();
+		} else if (port == GPIOB) {
+			__GPIOB_CLK_ENABLE();
+		} else if (port == GPIOC) {
+			__GPIOC_CLK_ENABLE();
+		}
+		GPIO_InitTypeDef GPIO_InitStruct;
+		GPIO_InitStruct.Pin = pin;
+		GPIO_InitStruct.Mode = GPIO_MODE_ANALOG;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		HAL_GPIO_Init(port, &GPIO_InitStruct);
+	}
+
+	sConf.Channel = channel;
+	sConf.Rank = ADCScan_rankTable[_channelNum];
+	sConf.SamplingTime = samplingTime;
+	HAL_ADC_ConfigChannel(&_adcHandle, &sConf);
+
+	_channelNum++;
+	MODIFY_REG(_adcHandle.Instance->SQR1, ADC_SQR1_L, (uint32_t)(_channelNum - 1) << 20);
+
+	return _channelNum - 1;
+}
+
+/**
+	* @brief  register a consumer of one scan channel
+	* @param  uint8_t rank - channel rank returned by addChannel
+	* @param  uint16_t decimation - 1 for every sample, 2, 4 or 8 for FIR
+	*					decimation, multiple of 8 to average FIR outputs further
+	* @param  callBack_t callBack - called from the DMA interrupt
+	* @param  void* arg - passed back to callBack
+	* @retval true if registered
+	*/
+bool ADCScan::subscribe(uint8_t rank, uint16_t decimation, callBack_t callBack, void* arg) {
+	uint8_t firFactor;
+	uint16_t avgFactor;
+
+	if (rank >= _channelNum || callBack == NULL || decimation == 0) {
+		return false;
+	}
+	if (decimation <= ADC_SCAN_BLOCK) {
+		if (ADC_SCAN_BLOCK % decimation != 0) {
+			return false;
+		}
+		firFactor = decimation;
+		avgFactor = 1;
+	} else {
+		if (decimation % ADC_SCAN_BLOCK != 0) {
+			return false;
+		}
+		firFactor = ADC_SCAN_BLOCK;
+		avgFactor = decimation / ADC_SCAN_BLOCK;
+	}
+
+	for (uint8_t i = 0; i < ADC_SCAN_MAX_SUBSCRIBER; i++) {
+		subscriber_s* sub = &_subscriber[i];
+		if (sub->callBack != NULL) {
+			continue;
+		}
+		sub->rank = rank;
+		sub->firFactor = firFactor;
+		sub->avgFactor = avgFactor;
+		sub->avgCount = 0;
+		sub->avgSum = 0;
+		sub->arg = arg;
+		if (firFactor > 1) {
+			arm_fir_decimate_init_q15(&sub->fir, ADC_SCAN_FIR_TAPS, firFactor,
+																ADCScan_firCoeffs, sub->firState, ADC_SCAN_BLOCK);
+		}
+		sub->callBack = callBack;	// set last, the slot goes live here
+		return true;
+	}
+	return false;
+}
+
+/**
+	* @brief  remove every subscription of a callback
+	* @param  callBack_t callBack
+	* @retval true if found
+	*/
+bool ADCScan::unsubscribe(callBack_t callBack) {
+	bool found = false;
+
+	for (uint8_t i = 0; i < ADC_SCAN_MAX_SUBSCRIBER; i++) {
+		if (_subscriber[i].callBack == callBack) {
+			_subscriber[i].callBack = NULL;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/**
+	* @brief  start circular DMA and the trigger timer
+	* @param  none
+	* @retval none
+	*/
+void ADCScan::start(void) {
+	uint16_t len = 2 * ADC_SCAN_BLOCK * _channelNum;
+
+	if (_channelNum == 0 || _isRunning == true) {
+		return;
+	}
+	Sys_stopLock(); // TIM3 trigger and DMA stop with the system clock
+	_isRunning = true;
+
+	/*	DMA1 channel 1: ADC1 DR -> buffer, half word, circular, half/full IRQ	*/
+	DMA1_Channel1->CCR = 0;
+	DMA1->IFCR = DMA_IFCR_CGIF1;
+	DMA1_Channel1->CPAR = (uint32_t)(uintptr_t)&_adcHandle.Instance->DR;
+	DMA1_Channel1->CMAR = (uint32_t)(uintptr_t)_dmaBuffer;
+	DMA1_Channel1->CNDTR = len;
+	DMA1_Channel1->CCR = DMA_CCR_PL_1 | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC
+										 | DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_EN;
+
+	SET_BIT(_adcHandle.Instance->CR2, ADC_CR2_DMA);
+	HAL_ADC_Start(&_adcHandle);
+	HAL_TIM_Base_Start(&_timHandle);
+}
+
+/**
+	* @brief  stop the trigger timer, ADC and DMA
+	* @param  none
+	* @retval none
+	*/
+void ADCScan::stop(void) {
+	HAL_TIM_Base_Stop(&_timHandle);
+	HAL_ADC_Stop(&_adcHandle);
+	CLEAR_BIT(_adcHandle.Instance->CR2, ADC_CR2_DMA);
+	DMA1_Channel1->CCR = 0;
+	if (_isRunning == true) {
+		_isRunning = false;
+		Sys_stopUnlock();
+	}
+}
+
+/**
+	* @brief  split one half buffer by channel and feed subscribers
+	* @param  const uint16_t* block - ADC_SCAN_BLOCK interleaved scans
+	* @param  uint32_t cycle - DWT timestamp of the last scan
+	* @retval none
+	*/
+void ADCScan::processBlock(const uint16_t* block, uint32_t cycle) {
+	for (uint8_t i = 0; i < ADC_SCAN_MAX_SUBSCRIBER; i++) {
+		subscriber_s* sub = &_subscriber[i];
+		uint8_t len;
+
+		if (sub->callBack == NULL) {
+			continue;
+		}
+
+		if (sub->firFactor == 1) {
+			for (uint8_t n = 0; n < ADC_SCAN_BLOCK; n++) {
+				_outBuffer[n] = block[n * _channelNum + sub->rank];
+			}
+			sub->callBack(_outBuffer, ADC_SCAN_BLOCK, cycle, sub->arg);
+			continue;
+		}
+
+		/*	12bit to q15, low pass and decimate	*/
+		for (uint8_t n = 0; n < ADC_SCAN_BLOCK; n++) {
+			_channelBuffer[n] = (q15_t)(block[n * _channelNum + sub->rank] << 3);
+		}
+		arm_fir_decimate_q15(&sub->fir, _channelBuffer, _channelBuffer, ADC_SCAN_BLOCK);
+		len = ADC_SCAN_BLOCK / sub->firFactor;
+		for (uint8_t n = 0; n < len; n++) {
+			_outBuffer[n] = (_channelBuffer[n] < 0) ? 0 : (uint16_t)(_channelBuffer[n] >> 3);
+		}
+
+		if (sub->avgFactor == 1) {
+			sub->callBack(_outBuffer, len, cycle, sub->arg);
+			continue;
+		}
+
+		/*	slow channels: average FIR outputs down to the requested rate	*/
+		sub->avgSum += _outBuffer[0];
+		sub->avgCount++;
+		if (sub->avgCount >= sub->avgFactor) {
+			_outBuffer[0] = (uint16_t)((sub->avgSum + sub->avgFactor / 2) / sub->avgFactor);
+			sub->avgSum = 0;
+			sub->avgCount = 0;
+			sub->callBack(_outBuffer, 1, cycle, sub->arg);
+		}
+	}
+}
+
+/**
+	* @brief  DMA half / full transfer handler
+	* @param  none
+	* @retval none
+	*/
+void ADCScan::IRQHandler(void) {
+	uint32_t isr = DMA1->ISR;
+	uint32_t cycle = Sys_getCycle();
+
+	if (isr & DMA_ISR_HTIF1) {
+		DMA1->IFCR = DMA_IFCR_CHTIF1;
+		processBlock(_dmaBuffer, cycle);
+	}
+	if (isr & DMA_ISR_TCIF1) {
+		DMA1->IFCR = DMA_IFCR_CTCIF1;
+		processBlock(&_dmaBuffer[ADC_SCAN_BLOCK * _channelNum], cycle);
+	}
+	if (isr & DMA_ISR_TEIF1) {
+		DMA1->IFCR = DMA_IFCR_CTEIF1;
+	}
+}
+
+} /* hv_driver */
+
+extern "C" {
+	void DMA1_Channel1_IRQHandler(void) {
+		uint32_t start = hv_driver::Sys_getCycle();
+
+		if (ADCScan_instance != NULL) {
+			ADCScan_instance->IRQHandler();
+		}
+		hv_driver::Sys_isrAccount(hv_driver::SYS_ISR_ADC_DMA, start);
+	}
+}
@@ -0,0 +1,79 @@
+/**
+  ******************************************************************************
+ * @file    ADCScan.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   ADC1 regular group scan with DMA and per channel subscribers
+  */
+//-------------------------------------------------------------------------
+
+#ifndef ADC_SCAN_H
+#define ADC_SCAN_H
+
+#include "stm32f1xx.h"
+#include "arm_math.h"
+
+namespace hv_driver {
+
+class ADCScan {
+public:
+	enum SCAN_PARAM {
+		ADC_SCAN_MAX_CHANNEL 		= 4,
+		ADC_SCAN_MAX_SUBSCRIBER = 6,
+		ADC_SCAN_BLOCK 					= 8,		// scans per DMA half buffer
+		ADC_SCAN_FIR_TAPS 			= 8,
+		ADC_SCAN_RATE_HZ 				= 1000,	// TIM3 trigger rate
+		ADC_SCAN_INVALID 				= 0xFF,
+		ADC_SCAN_IRQ_PRIORITY 	= 5,		// subscribers may signal tasks
+	};
+
+	/**
+		* @param  samples - 12bit samples of one channel, oldest first
+		* @param  len - number of samples
+		* @param  cycle - DWT timestamp of the last sample
+		* @param  arg - subscriber argument
+		*/
+	typedef void (*callBack_t)(const uint16_t* samples, uint8_t len, uint32_t cycle, void* arg);
+public:
+	ADCScan(ADC_TypeDef* ADCx);
+
+	void init(void);
+	uint8_t addChannel(uint32_t channel, uint32_t samplingTime, GPIO_TypeDef* port = NULL, uint16_t pin = 0);
+	bool subscribe(uint8_t rank, uint16_t decimation, callBack_t callBack, void* arg);
+	bool unsubscribe(callBack_t callBack);
+	void start(void);
+	void stop(void);
+	bool isRunning(void){return _isRunning;}
+
+	uint32_t getSamplePeriod(void){return _cyclePerScan;}
+	void IRQHandler(void);
+private:
+	typedef struct {
+		callBack_t callBack;
+		void* arg;
+		uint8_t rank;
+		uint8_t firFactor;		// FIR decimation inside a block
+		uint16_t avgFactor;		// extra averaging of FIR outputs
+		uint16_t avgCount;
+		uint32_t avgSum;
+		arm_fir_decimate_instance_q15 fir;
+		q15_t firState[ADC_SCAN_FIR_TAPS + ADC_SCAN_BLOCK - 1];
+	} subscriber_s;
+
+	void processBlock(const uint16_t* block, uint32_t cycle);
+
+	ADC_HandleTypeDef _adcHandle;
+	TIM_HandleTypeDef _timHandle;
+	uint8_t _channelNum;
+	uint32_t _cyclePerScan;
+	bool _isRunning;
+	subscriber_s _subscriber[ADC_SCAN_MAX_SUBSCRIBER];
+	uint16_t _dmaBuffer[2 * ADC_SCAN_BLOCK * ADC_SCAN_MAX_CHANNEL];
+	q15_t _channelBuffer[ADC_SCAN_BLOCK];
+	uint16_t _outBuffer[ADC_SCAN_BLOCK];
+};
+
+} /* hv_driver */
+
+#endif /* ADC_SCAN_H */
@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+ * @file    Flash.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   On-chip flash page driver for data storage
+  */
+//-------------------------------------------------------------------------
+#include "Flash.h"
+
+namespace hv_driver {
+
+/**
+	* @brief  area of whole pages, kept out of the linker IROM region
+	* @param  uint32_t base - page aligned address
+	* @param  uint8_t pages
+	*/
+Flash::Flash(uint32_t base, uint8_t pages){
+	this->base = base;
+	this->pages = pages;
+}
+
+/**
+	* @brief  erase one page of the area, about 20ms with the CPU stalled on
+	*					instruction fetch
+	* @retval true on success
+	*/
+bool Flash::erase(uint8_t page){
+	FLASH_EraseInitTypeDef eraseInit;
+	uint32_t pageError = 0;
+	HAL_StatusTypeDef status;
+
+	if(page >= this->pages){
+		return false;
+	}
+	eraseInit.TypeErase = FLASH_TYPEERASE_PAGES;
+	eraseInit.PageAddress = this->base + (uint32_t)page * FLASH_PAGE;
+	eraseInit.NbPages = 1;
+
+	HAL_FLASH_Unlock();
+	status = HAL_FLASHEx_Erase(&eraseInit, &pageError);
+	HAL_FLASH_Lock();
+	return (status == HAL_OK);
+}
+
+/**
+	* @brief  program a half word
+	* @param  uint32_t offset - even, from the start of the area
+	*/
+bool Flash::program(uint32_t offset, uint16_t value){
+	HAL_StatusTypeDef status;
+
+	if((offset & 1) != 0 || offset >= (uint32_t)this->pages * FLASH_PAGE){
+		return false;
+	}
+	HAL_FLASH_Unlock();
+	status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, this->base + offset, value);
+	HAL_FLASH_Lock();
+	return (status == HAL_OK);
+}
+
+/**
+	* @brief  program bytes, an odd length is padded with 0xFF
+	*/
+bool Flash::program(uint32_t offset, const uint8_t* data, uint16_t len){
+	HAL_StatusTypeDef status = HAL_OK;
+	uint16_t value;
+
+	if((offset & 1) != 0 || offset + len > (uint32_t)this->pages * FLASH_PAGE){
+		return false;
+	}
+	HAL_FLASH_Unlock();
+	for(uint16_t i = 0; i < len && status == HAL_OK; i += 2){
+		value = data[i];
+		value |= (i + 1 < len) ? (uint16_t)(data[i + 1] << 8) : 0xFF00;
+		status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_HALFWORD, this->base + offset + i, value);
+	}
+	HAL_FLASH_Lock();
+	return (status == HAL_OK);
+}
+
+uint16_t Flash::read(uint32_t offset){
+	return *(__IO uint16_t*)(uintptr_t)(this->base + offset);
+}
+
+void Flash::read(uint32_t offset, uint8_t* data, uint16_t len){
+	for(uint16_t i = 0; i < len; i++){
+		data[i] = *(__IO uint8_t*)(uintptr_t)(this->base + offset + i);
+	}
+}
+
+} /* hv_driver */
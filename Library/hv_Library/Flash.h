@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+ * @file    Flash.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   On-chip flash page driver for data storage
+ *
+ *	Pages are 1 KB and programmed by half word. An erased half word reads
+ *	0xFFFF, a programmed one can only be overwritten with 0x0000.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef FLASH_H
+#define FLASH_H
+
+#include "stm32f1xx.h"
+
+namespace hv_driver {
+
+class Flash {
+public:
+	enum FLASH_PARAM {
+		FLASH_PAGE = 0x400,
+	};
+public:
+	Flash(uint32_t base, uint8_t pages);
+
+	bool erase(uint8_t page);
+	bool program(uint32_t offset, uint16_t value);
+	bool program(uint32_t offset, const uint8_t* data, uint16_t len);
+	uint16_t read(uint32_t offset);
+	void read(uint32_t offset, uint8_t* data, uint16_t len);
+
+	uint8_t getPages(void){return this->pages;}
+private:
+	uint32_t base;
+	uint8_t pages;
+};
+
+} /* hv_driver */
+
+#endif /* FLASH_H */
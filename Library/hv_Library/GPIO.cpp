@@ -8,17 +8,13 @@
   */
 //-------------------------------------------------------------------------
 #include "GPIO.h"
+#include "MISC.h"
 
 bool extiTable[16] = {false}; 
 void (*CallBackTable[16])(void) = {NULL};
 
 namespace hv_driver {
 
-GPIO::GPIO(GPIO_TypeDef* GPIOx, PIN PINx){
-	this->GPIOx = GPIOx;
-	this->PINx = PINx;
-}
-
 void GPIO::init(MODE mode, OTYPE type, PULL pull, SPEED speed){
 	__IO uint32_t temp;
 	__IO uint8_t offset = 0;
@@ -74,8 +70,8 @@ void GPIO::init(MODE mode, OTYPE type, PULL pull, SPEED speed){
 		uint8_t gpioIndex = ((this->GPIOx == GPIOA) ? 0U : ((this->GPIOx == GPIOB) ? 1U : ((this->GPIOx == GPIOC) ? 2U : 3U)));
 		__HAL_RCC_AFIO_CLK_ENABLE();
 		temp = AFIO->EXTICR[this->PINx >> 2];
-		temp &= ~(0x000000F << (gpioIndex * 4));
-		temp |=  (gpioIndex << (gpioIndex * 4));
+		temp &= ~(0x000000F << ((this->PINx & 0x03) * 4));
+		temp |=  (gpioIndex << ((this->PINx & 0x03) * 4));
 		AFIO->EXTICR[this->PINx >> 2] = temp;
 		
 		EXTI->IMR |= 1 << (this->PINx); // set Interrupt mask reg
@@ -115,22 +111,10 @@ void GPIO::initAF(OTYPE type, SPEED speed){
 	this->init(AF, type, NONE, speed);
 }
 
-void GPIO::set(void){
-	this->GPIOx->BSRR |= 1 << this->PINx;
-}
-
-void GPIO::reset(void){
-	(this->GPIOx->BSRR) |= ((1 << this->PINx) << 16); 
-}
-
 void GPIO::toggle(void){
 	this->GPIOx->ODR ^= 1 << (this->PINx);
 }
 
-uint8_t GPIO::read(void){
-	return ((this->GPIOx->IDR >> this->PINx) & 1);
-}
-
 bool GPIO::enableEXTI(uint8_t priority){
 	if(this->mode != EXT_INT_RISING && this->mode != EXT_INT_FALLING && this->mode != EXT_INT_BOTH){
 		return false;
@@ -173,18 +157,22 @@ bool GPIO::enableEXTI(uint8_t priority){
 }
 
 bool GPIO::disableEXTI(void){
-	if(this->mode != EXT_INT_RISING || this->mode != EXT_INT_FALLING || this->mode != EXT_INT_BOTH){
+	if(this->mode != EXT_INT_RISING && this->mode != EXT_INT_FALLING && this->mode != EXT_INT_BOTH){
 		return false;
 	}
 	switch(this->PINx){
 		case PIN0:
 		  HAL_NVIC_DisableIRQ(EXTI0_IRQn);
+			break;
 		case PIN1:
 			HAL_NVIC_DisableIRQ(EXTI1_IRQn);
+			break;
 		case PIN2:
 			HAL_NVIC_DisableIRQ(EXTI2_IRQn);
+			break;
 		case PIN3:
 			HAL_NVIC_DisableIRQ(EXTI3_IRQn);
+			break;
 		case PIN4:
 			HAL_NVIC_DisableIRQ(EXTI4_IRQn);
 			break;
@@ -212,7 +200,7 @@ bool GPIO::lock(void){
 	this->GPIOx->LCKR = resetLCKK; // Reset LCKx bit(s): LCKK='0' + LCK[15-0] 
 	this->GPIOx->LCKR = setLCKK;  // Set LCKx bit(s): LCKK='1' + LCK[15-0] 
 	setLCKK = this->GPIOx->LCKR; // read LCKK
-	if((this->GPIOx->LCKR & GPIO_LCKR_LCKK) == 1){ // checking LCKK bit
+	if((this->GPIOx->LCKR & GPIO_LCKR_LCKK) != 0){ // checking LCKK bit
 		return true;
 	} else {
 		return false;
@@ -222,62 +210,86 @@ bool GPIO::lock(void){
 extern "C" {
 
 void EXTI0_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
+
+	EXTI->PR = (1 << 0); // write 1 to clear, only this line
 	if(extiTable[0] == true){
 		CallBackTable[0]();
-		EXTI->PR |= (1 << 0);
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 
 void EXTI1_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
+
+	EXTI->PR = (1 << 1); // write 1 to clear, only this line
 	if(extiTable[1] == true){
 		CallBackTable[1]();
-		EXTI->PR |= (1 << 1);
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 
 void EXTI2_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
+
+	EXTI->PR = (1 << 2); // write 1 to clear, only this line
 	if(extiTable[2] == true){
 		CallBackTable[2]();
-		EXTI->PR |= (1 << 2);
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 
 void EXTI3_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
+
+	EXTI->PR = (1 << 3); // write 1 to clear, only this line
 	if(extiTable[3] == true){
 		CallBackTable[3]();
-		EXTI->PR |= (1 << 3);
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 
 void EXTI4_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
+
+	EXTI->PR = (1 << 4); // write 1 to clear, only this line
 	if(extiTable[4] == true){
 		CallBackTable[4]();
-		EXTI->PR |= (1 << 4);
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 
 void EXTI9_5_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
   uint8_t i;
+
 	for(i = 5; i < 10; i++){
+		if((EXTI->PR & (1 << i)) == 0){ // line not pending
+			continue;
+		}
+		EXTI->PR = (1 << i);
 		if(extiTable[i] == true){
 			CallBackTable[i]();
-			EXTI->PR |= (1 << i);
 		}
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 
 void EXTI15_10_IRQHandler(void){
+	uint32_t start = Sys_getCycle();
   uint8_t i;
+
 	for(i = 10; i < 16; i++){
+		if((EXTI->PR & (1 << i)) == 0){ // line not pending
+			continue;
+		}
+		EXTI->PR = (1 << i);
 		if(extiTable[i] == true){
 			CallBackTable[i]();
-			EXTI->PR |= (1 << i);
 		}
 	}
+	Sys_isrAccount(SYS_ISR_EXTI, start);
 }
 } /* end extern C */
 
-GPIO::~GPIO(void){
-}
-
 } /* namespace hv_driver */
@@ -33,8 +33,8 @@ public:
 		NONE = 0x00, UP = 0x01, DOWN = 0x02
 	};
 public:
-	GPIO(GPIO_TypeDef* GPIOx, PIN PINx);
-	~GPIO(void);
+	/* inline and no destructor, a global GPIO needs no constructor call */
+	GPIO(GPIO_TypeDef* GPIOx, PIN PINx) : GPIOx(GPIOx), PINx(PINx) {}
 
 	void init(MODE mode, OTYPE type, PULL pull, SPEED speed);
 	void initOutput(OTYPE type, SPEED speed);
@@ -42,19 +42,20 @@ public:
 	void initExti(MODE edge, PULL pull, void (*CallBack)(void));
 	void initAF(OTYPE type, SPEED speed);
 		
-	void set(void);
-	void reset(void);
+	/* inline, one BSRR or IDR access, drivers call these per byte */
+	void set(void){this->GPIOx->BSRR = (uint32_t)1 << this->PINx;}
+	void reset(void){this->GPIOx->BSRR = ((uint32_t)1 << this->PINx) << 16;}
 	void toggle(void);
-	uint8_t read(void);
+	uint8_t read(void){return (uint8_t)((this->GPIOx->IDR >> this->PINx) & 1);}
 
 	bool enableEXTI(uint8_t priority);
 	bool disableEXTI(void);
 	bool lock(void);
 private:
-	MODE mode;
-	void (*CallBack)(void);
 	GPIO_TypeDef* GPIOx;
 	PIN PINx;
+	MODE mode;
+	void (*CallBack)(void);
 };
 
 }
@@ -8,13 +8,39 @@
   */
 //-------------------------------------------------------------------------
 #include "MISC.h"
+#include "FreeRTOS.h"
+#include "task.h"
 
-#define MAX_ISR 5
+extern "C" void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime);
+
+#define MAX_TIMER 8
+#define STOP_WAKE_MS 3				// PLL relock and RTC resync after STOP
+#define STOP_MAX_MS 600000		// keeps the sub tick math in 32 bits
+#define RTC_ALARM_NONE 0xFFFFFFFF
+
+typedef struct {
+	void (*pTimer)(void);
+	uint32_t period;		// ms, 0 for a one shot
+	uint32_t deadline;	// Sys_getTick value of the next call
+} timer_s;
 
 /* Local Variable */
-void (*subISRTable[MAX_ISR]) (void); // Sub ISR Table function pointer array
-__IO uint32_t tim4Tick = 0;
+timer_s timerTable[MAX_TIMER]; // deadline table, checked each tick against the earliest
+uint32_t timerNext = 0;
+bool isTimerArmed = false;
+uint32_t timerOverrun = 0;
+__IO uint32_t sysTick = 0; // ms, SysTick plus the ticks stepped over in tickless idle
+uint8_t stopLock = 1; // STOP mode needs the RTC, held until Sys_stopUnlock
+uint32_t rtcPrescaler = 32767; // PRL is write only, RTC_AUTO_1_SECOND on the LSE
+uint32_t stopRemainder = 0; // sub ms left of the last STOP, 1/(rtcPrescaler + 1) ms
+uint32_t stopCount = 0;
+uint32_t runTimeCycle = 0; // CYCCNT at the last run time update
+uint32_t runTimeCarry = 0; // cycles short of a us
+uint32_t runTime = 0; // us, CPU time stats clock
+uint32_t isrCycle[hv_driver::SYS_ISR_NUM]; // wraps, read as differences
+uint32_t isrCount[hv_driver::SYS_ISR_NUM];
 __IO USART_TypeDef* USARTx_ = USART1;
+RTC_HandleTypeDef rtcSync = {RTC}; // HAL_RTC_WaitForSynchro only reads Instance
 
 /* Local Function prototype */
 void SystemClock_Config(void);	
@@ -24,7 +50,11 @@ namespace hv_driver {
 void Sys_init(void){
 	HAL_Init();
 	SystemClock_Config();
-	Sys_timSystickInit();
+	Sys_cycleCounterInit();
+
+	/* RTC alarm on EXTI line 17 wakes tickless idle from STOP mode */
+	HAL_NVIC_SetPriority(RTC_Alarm_IRQn, 15, 0);
+	HAL_NVIC_EnableIRQ(RTC_Alarm_IRQn);
 }
 
 
@@ -66,29 +96,105 @@ void SystemClock_Config(void){
 }	
 
 /**
-  * @brief  Using Timer4 as alternative Systick timer
+  * @brief  cache the earliest deadline for the tick handler and tickless idle
   * @param  none
-  * @return	none
+  * @return none
   */
-void Sys_timSystickInit(void){
-	__HAL_RCC_TIM4_CLK_ENABLE();
+static void Sys_timerArm(void){
+	uint32_t primask = __get_PRIMASK();
+	uint32_t next = 0;
+	bool isFound = false;
 
-	TIM_HandleTypeDef 								TimSystick;
-	TimSystick.Instance								= TIM4;
-	TimSystick.Init.RepetitionCounter	= 0;
-	TimSystick.Init.CounterMode				= TIM_COUNTERMODE_UP;
-	TimSystick.Init.Period						= 10 - 1;	// 1kHz Interrupt
-	TimSystick.Init.Prescaler					= (SystemCoreClock/10000) - 1;	// 10kHz operation frequency
-	TimSystick.Init.ClockDivision			= 0;
-	
-  /* Set the TIM4 priority */
-  HAL_NVIC_SetPriority(TIM4_IRQn, 3, 0);
+	__disable_irq();
+	for (uint8_t i = 0; i < MAX_TIMER; i++) {
+		if (timerTable[i].pTimer != NULL
+				&& (isFound != true || (int32_t)(timerTable[i].deadline - next) < 0)) {
+			next = timerTable[i].deadline;
+			isFound = true;
+		}
+	}
+	timerNext = next;
+	isTimerArmed = isFound;
+	__set_PRIMASK(primask);
+}
 
-  /* Enable the TIM4 global Interrupt */
-  HAL_NVIC_EnableIRQ(TIM4_IRQn);
-	
-	HAL_TIM_Base_Init(&TimSystick);
-	HAL_TIM_Base_Start_IT(&TimSystick);	// start interrupt
+static bool Sys_timerSet(void (* pTimer)(void), uint32_t period, uint32_t delay){
+	uint32_t primask = __get_PRIMASK();
+	int8_t index = -1;
+
+	if (pTimer == NULL) {
+		return false;
+	}
+	__disable_irq();
+	for (uint8_t i = 0; i < MAX_TIMER; i++) {
+		if (timerTable[i].pTimer == pTimer) {
+			index = i;
+			break;
+		}
+		if (index < 0 && timerTable[i].pTimer == NULL) {
+			index = i;
+		}
+	}
+	if (index >= 0) {
+		timerTable[index].period = period;
+		timerTable[index].deadline = Sys_getTick() + delay;
+		timerTable[index].pTimer = pTimer;
+		Sys_timerArm();
+	}
+	__set_PRIMASK(primask);
+	return (index >= 0);
+}
+
+/**
+  * @brief  call a function from the SysTick interrupt every period
+  * @param  void (* pTimer)(void) - pointer to function, assigned again it
+  *					only gets the new period
+  * @param  uint32_t period_ms - first call one period from now
+  * @return	false if the table is full
+  */
+bool Sys_timerAssign(void (* pTimer)(void), uint32_t period_ms){
+	if (period_ms == 0) {
+		return false;
+	}
+	return Sys_timerSet(pTimer, period_ms, period_ms);
+}
+
+/**
+  * @brief  call a function from the SysTick interrupt once
+  * @param  void (* pTimer)(void) - pointer to function
+  * @param  uint32_t delay_ms
+  * @return	false if the table is full
+  */
+bool Sys_timerOnce(void (* pTimer)(void), uint32_t delay_ms){
+	return Sys_timerSet(pTimer, 0, delay_ms);
+}
+
+/**
+  * @brief  Remove function from the timer table, may be called by the timer
+  * @param  void (* pTimer)(void) - pointer to function
+  * @return true if found function on table remove success
+  */
+bool Sys_timerRemove(void (* pTimer)(void)){
+	uint32_t primask = __get_PRIMASK();
+	bool retVal = false;
+
+	__disable_irq();
+	for (uint8_t i = 0; i < MAX_TIMER; i++) {
+		if (timerTable[i].pTimer == pTimer) {
+			timerTable[i].pTimer = NULL;
+			retVal = true;
+		}
+	}
+	Sys_timerArm();
+	__set_PRIMASK(primask);
+	return retVal;
+}
+
+/**
+  * @brief  periodic calls that fell more than a period behind
+  */
+uint32_t Sys_getTimerOverrun(void){
+	return timerOverrun;
 }
 
 /**
@@ -97,24 +203,22 @@ void Sys_timSystickInit(void){
   * @return none
   */
 void Sys_subISRReset(void){
-	for (uint8_t i = 0; i < MAX_ISR; i++) {
-		subISRTable[i] = NULL;
+	__disable_irq();
+	for (uint8_t i = 0; i < MAX_TIMER; i++) {
+		timerTable[i].pTimer = NULL;
 	}
+	__enable_irq();
+	Sys_timerArm();
 }
 
 /**
-  * @brief  Assign function to ISR Table
+  * @brief  Assign function to ISR Table, called every 1ms
   * @param  void (* pSubISR)(void) - pointer to function
   * @return	true if available slot on Table assign success.
+  * @note		prefer Sys_timerAssign with the period the function needs
   */
 bool Sys_subISRAssign(void (* pSubISR)(void)){
-	for (uint8_t i = 0; i < MAX_ISR; i++) {
-		if(subISRTable[i] == NULL) {
-			subISRTable[i] = pSubISR; // assign interrupt function
-			return true;
-		}
-	}
-	return false;
+	return Sys_timerAssign(pSubISR, 1);
 }
 
 /**
@@ -123,64 +227,357 @@ bool Sys_subISRAssign(void (* pSubISR)(void)){
   * @return true if found function on table remove success
   */
 bool Sys_subISRRemove(void (* pSubISR)(void)){
-	for (uint8_t i = 0; i < MAX_ISR; i++) {
-		if(subISRTable[i] == pSubISR) {
-			subISRTable[i] = NULL;
-			return true;
-		}
-	}
-	return false;
+	return Sys_timerRemove(pSubISR);
 }
 
 /**
-  * @brief  ISR Handler excute all function in table
+  * @brief  ISR Handler excute due functions in table
   * @param  none
   * @return	none
   */
 void Sys_timISRHandler(void){
-	tim4Tick++; // increase tim4 tick
+	uint32_t now = Sys_getTick();
+	void (*pTimer)(void);
 	
-	for (uint8_t i = 0; i < MAX_ISR; i++) {
-		if (subISRTable[i] != NULL) {	
-			subISRTable[i] ();
+	for (uint8_t i = 0; i < MAX_TIMER; i++) {
+		timer_s &timer = timerTable[i];
+		if (timer.pTimer == NULL || (int32_t)(timer.deadline - now) > 0) {
+			continue;
 		}
+		pTimer = timer.pTimer;
+		if (timer.period == 0) {
+			timer.pTimer = NULL;
+		} else {
+			timer.deadline += timer.period; // no drift
+			if ((int32_t)(timer.deadline - now) <= 0) {
+				timer.deadline = now + timer.period;
+				timerOverrun++;
+			}
+		}
+		pTimer();
 	}
+	Sys_timerArm();
 }
 
 /**
-  * @brief  return tim4 tick value
+  * @brief  return ms tick, shared with the HAL and the RTOS tick
   * @param  none
-  * @return tim4Tick
+  * @return ms since start, keeps counting across tickless idle
   */
 uint32_t Sys_getTick(void){
-	return tim4Tick;
+	return sysTick;
+}
+
+/**
+  * @brief  keep idle out of STOP mode, for peripherals that stop with the
+  *					system clock (ADC scan, DMA streams)
+  * @param  none
+  * @return none
+  */
+void Sys_stopLock(void){
+	__disable_irq();
+	stopLock++;
+	__enable_irq();
+}
+
+void Sys_stopUnlock(void){
+	__disable_irq();
+	if (stopLock > 0) {
+		stopLock--;
+	}
+	__enable_irq();
+}
+
+uint32_t Sys_getStopCount(void){
+	return stopCount;
+}
+
+/**
+  * @brief  RTC prescaler the STOP mode time keeping counts with
+  * @param  uint32_t prl - value written to RTC PRL, one second is prl + 1
+  *					LSE clocks
+  * @return none
+  * @note		call whenever PRL is written, calibration changes it
+  */
+void Sys_setRtcPrescaler(uint32_t prl){
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (prl != rtcPrescaler) {
+		rtcPrescaler = prl;
+		stopRemainder = 0; // counted in the old unit
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  RTC counter and prescaler divider
+  * @param  uint32_t &cnt - RTC counter, s
+  * @return divider, rtcPrescaler down to 0 over the second
+  * @note		counter read again until the pair is consistent
+  */
+static uint32_t Sys_rtcRead(uint32_t &cnt){
+	uint32_t div;
+
+	do {
+		cnt = ((uint32_t)RTC->CNTH << 16) | RTC->CNTL;
+		div = ((uint32_t)(RTC->DIVH & RTC_DIVH_RTC_DIV) << 16) | RTC->DIVL;
+	} while (cnt != (((uint32_t)RTC->CNTH << 16) | RTC->CNTL));
+	return (div > rtcPrescaler) ? rtcPrescaler : div;
+}
+
+static void Sys_rtcAlarm(uint32_t alarm){
+	while ((RTC->CRL & RTC_CRL_RTOFF) == 0);
+	RTC->CRL |= RTC_CRL_CNF;
+	RTC->ALRH = alarm >> 16;
+	RTC->ALRL = alarm & 0xFFFF;
+	RTC->CRL &= ~(RTC_CRL_CNF | RTC_CRL_ALRF);
+	while ((RTC->CRL & RTC_CRL_RTOFF) == 0);
+}
+
+/* STOP mode wakes on HSI, bring the PLL back as SystemClock_Config set it */
+static void Sys_clockRestore(void){
+	RCC->CR |= RCC_CR_PLLON;
+	while ((RCC->CR & RCC_CR_PLLRDY) == 0);
+	RCC->CFGR = (RCC->CFGR & ~RCC_CFGR_SW) | RCC_CFGR_SW_PLL;
+	while ((RCC->CFGR & RCC_CFGR_SWS) != RCC_CFGR_SWS_PLL);
+}
+
+/**
+  * @brief  STOP mode until an RTC alarm on a second boundary or any EXTI
+  * @param  uint32_t idle - ms until the next task or timer is due
+  * @return ms slept, 0 if the idle time does not reach a second boundary
+  * @note		called with interrupts disabled and SysTick stopped
+  */
+static uint32_t Sys_stopSleep(uint32_t idle){
+	uint32_t second = rtcPrescaler + 1;
+	uint32_t cnt, startCnt, startDiv, endDiv, toSecond, ticks, scaled, slept;
+
+	startDiv = Sys_rtcRead(startCnt);
+	toSecond = (startDiv + 1) * 1000 / second + 1;
+	if (toSecond + STOP_WAKE_MS > idle) {
+		return 0;
+	}
+	Sys_rtcAlarm(startCnt + 1 + (idle - toSecond - STOP_WAKE_MS) / 1000);
+	EXTI->PR = EXTI_PR_PR17;
+	EXTI->RTSR |= EXTI_RTSR_TR17;
+	EXTI->IMR |= EXTI_IMR_MR17;
+
+	HAL_PWR_EnterSTOPMode(PWR_LOWPOWERREGULATOR_ON, PWR_STOPENTRY_WFI);
+
+	Sys_clockRestore();
+	HAL_RTC_WaitForSynchro(&rtcSync); // APB1 was off, registers are stale until resync
+	endDiv = Sys_rtcRead(cnt);
+	Sys_rtcAlarm(RTC_ALARM_NONE);
+	EXTI->PR = EXTI_PR_PR17;
+
+	/* prescaler clocks slept, whole seconds in ms and the fraction scaled
+		 by 1000 so nothing is dropped, it carries to the next sleep */
+	ticks = (cnt - startCnt) * second + startDiv - endDiv;
+	scaled = (ticks % second) * 1000 + stopRemainder;
+	slept = (ticks / second) * 1000 + scaled / second;
+	stopRemainder = scaled % second;
+	if (slept > idle) {
+		stopRemainder += (slept - idle) * second;
+		slept = idle; // woke late, the kernel must not step past its deadline
+	}
+	stopCount++;
+	return slept;
+}
+
+/**
+  * @brief  Start DWT cycle counter used as high resolution timestamp
+  * @param  none
+  * @return none
+  */
+void Sys_cycleCounterInit(void){
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // enable trace block
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+  * @brief  return core cycle counter, wrap around every 2^32 cycles (~67s at 64MHz)
+  * @param  none
+  * @return DWT cycle count
+  */
+uint32_t Sys_getCycle(void){
+	return DWT->CYCCNT;
+}
+
+/**
+  * @brief  us time base for the RTOS run time stats, the cycle counter
+  *					extended past its 67s wrap and carried over STOP mode
+  * @param  none
+  * @return us, wraps after 71 minutes, read as differences
+  * @note		called on every context switch and every 1024 ticks, well
+  *					inside one cycle counter wrap
+  */
+uint32_t Sys_getRunTime(void){
+	uint32_t primask = __get_PRIMASK();
+	uint32_t cycle, cyclePerUs = SystemCoreClock / 1000000;
+	uint32_t retVal;
+
+	__disable_irq();
+	cycle = DWT->CYCCNT;
+	runTimeCarry += cycle - runTimeCycle;
+	runTimeCycle = cycle;
+	runTime += runTimeCarry / cyclePerUs;
+	runTimeCarry %= cyclePerUs;
+	retVal = runTime;
+	__set_PRIMASK(primask);
+	return retVal;
+}
+
+/**
+  * @brief  add the time since startCycle to an interrupt's total
+  * @param  SYS_ISR isr
+  * @param  uint32_t startCycle - Sys_getCycle() on entry
+  * @return none
+  * @note		a nested interrupt is counted in the one it preempted as well
+  */
+void Sys_isrAccount(SYS_ISR isr, uint32_t startCycle){
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	isrCycle[isr] += DWT->CYCCNT - startCycle;
+	isrCount[isr]++;
+	__set_PRIMASK(primask);
+}
+
+/**
+  * @brief  copy the interrupt totals
+  * @param  uint32_t* cycles, uint32_t* count - SYS_ISR_NUM entries each
+  * @return none
+  */
+void Sys_getIsrTime(uint32_t* cycles, uint32_t* count){
+	__disable_irq();
+	for (uint8_t i = 0; i < SYS_ISR_NUM; i++) {
+		cycles[i] = isrCycle[i];
+		count[i] = isrCount[i];
+	}
+	__enable_irq();
 }
 
 /**
   * @brief  Delay milisecond function
   * @param  uint16_t time_ms - amount of time wanto delay
   * @return	none
+  * @note		blocks the calling task only once the scheduler runs, spins
+  *					before that and in interrupts, on the cycle counter where
+  *					SysTick can not come in
   */
 void Sys_Delayms(__IO uint16_t time_ms){
 	uint32_t tickStart = 0;
 
+	if (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING && __get_IPSR() == 0) {
+		vTaskDelay(time_ms);
+		return;
+	}
+	if (__get_IPSR() != 0 || __get_PRIMASK() != 0) {
+		/* the tick can not advance in here, count core cycles instead */
+		for (; time_ms > 0; time_ms--) {
+			tickStart = Sys_getCycle();
+			while (Sys_getCycle() - tickStart < SystemCoreClock / 1000);
+		}
+		return;
+	}
 	tickStart = Sys_getTick();
 	while (Sys_getTick() - tickStart < time_ms);
 }
 
 extern "C" {
 /**
-  * @brief  TIM4 SysTick handles 
+  * @brief  SysTick 1ms count, replaces the HAL one so HAL, RTOS and Sys
+  *					timers share one time base
   * @param  None
   * @retval None
   */
-void TIM4_IRQHandler(void) {
-	if (((TIM4->SR & TIM_FLAG_UPDATE) == TIM_FLAG_UPDATE) != RESET) {	// check interrupt flag
-		if ((((TIM4->DIER & TIM_IT_UPDATE) == TIM_IT_UPDATE) ? SET : RESET) != RESET) {	// check interrupt type
-			TIM4->SR = ~TIM_IT_UPDATE; // clear interrupt
-			Sys_timISRHandler(); // call tim Systick handler
+void HAL_IncTick(void) {
+	uint32_t start = Sys_getCycle();
+
+	sysTick++;
+	if ((sysTick & 0x3FF) == 0) {
+		Sys_getRunTime(); // stays inside one cycle counter wrap with no task switch
+	}
+	if (isTimerArmed == true && (int32_t)(sysTick - timerNext) >= 0) {
+		Sys_timISRHandler(); // call due timers
+	}
+	Sys_isrAccount(SYS_ISR_TICK, start);
+}
+
+uint32_t HAL_GetTick(void) {
+	return sysTick;
+}
+
+/**
+  * @brief  portSUPPRESS_TICKS_AND_SLEEP, called by the idle task with the
+  *					scheduler suspended. STOP mode when nothing holds the clocks,
+  *					the SysTick tickless sleep of the port otherwise. Either way the
+  *					sleep ends by the next Sys timer deadline.
+  * @param  uint32_t idleTicks - ticks until the next task unblocks
+  * @retval None
+  */
+void Sys_suppressTicksAndSleep(uint32_t idleTicks) {
+	uint32_t slept = 0;
+	TickType_t before;
+
+	if (isTimerArmed == true) {
+		int32_t left = (int32_t)(timerNext - sysTick);
+		if (left < (int32_t)idleTicks) {
+			idleTicks = (left > 0) ? left : 0;
 		}
 	}
+	if (idleTicks < 2) {
+		return;
+	}
+
+	if (stopLock == 0 && idleTicks > 1000) {
+		if (idleTicks > STOP_MAX_MS) {
+			idleTicks = STOP_MAX_MS;
+		}
+		__disable_irq();
+		if (eTaskConfirmSleepModeStatus() == eAbortSleep) {
+			__enable_irq();
+			return;
+		}
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		slept = Sys_stopSleep(idleTicks);
+		if (slept != 0) {
+			vTaskStepTick(slept);
+			sysTick += slept;
+			runTime += slept * 1000; // the cycle counter stops with the clock
+		}
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		__enable_irq(); // the wake up interrupt runs here
+		if (slept != 0) {
+			return;
+		}
+	}
+
+	before = xTaskGetTickCount();
+	vPortSuppressTicksAndSleep(idleTicks);
+	sysTick += xTaskGetTickCount() - before; // stepped ticks, the pended one was counted
+}
+
+/**
+  * @brief  portGET_RUN_TIME_COUNTER_VALUE
+  * @param  None
+  * @retval us, see Sys_getRunTime
+  */
+uint32_t Sys_runTimeCounter(void) {
+	return Sys_getRunTime();
+}
+
+/**
+  * @brief  RTC alarm, only wakes the core from STOP mode
+  * @param  None
+  * @retval None
+  */
+void RTC_Alarm_IRQHandler(void) {
+	EXTI->PR = EXTI_PR_PR17;
+	RTC->CRL &= ~RTC_CRL_ALRF;
 }
 }
 
@@ -14,14 +14,36 @@
 #include "stm32f1xx.h"
 
 namespace hv_driver {
+
+/* interrupt time accounted by Sys_isrAccount */
+enum SYS_ISR {
+	SYS_ISR_TICK, 		// SysTick, Sys timers
+	SYS_ISR_EXTI, 		// all EXTI lines
+	SYS_ISR_ADC_DMA, 	// DMA1 channel 1, ADC scan callbacks
+	SYS_ISR_SPI_DMA, 	// DMA1 channel 2, ZNP SPI
+	SYS_ISR_UART_DMA, // DMA1 channel 4, PPG capture
+	SYS_ISR_NUM
+};
 	
 void Sys_init(void);
 void Sys_subISRReset(void);
 bool Sys_subISRAssign(void (* pSubISR)(void));
 bool Sys_subISRRemove(void (* pSubISR)(void));
+bool Sys_timerAssign(void (* pTimer)(void), uint32_t period_ms);
+bool Sys_timerOnce(void (* pTimer)(void), uint32_t delay_ms);
+bool Sys_timerRemove(void (* pTimer)(void));
+uint32_t Sys_getTimerOverrun(void);
 uint32_t Sys_getTick(void);
+void Sys_stopLock(void);
+void Sys_stopUnlock(void);
+uint32_t Sys_getStopCount(void);
+void Sys_setRtcPrescaler(uint32_t prl);
+void Sys_cycleCounterInit(void);
+uint32_t Sys_getCycle(void);
+uint32_t Sys_getRunTime(void);
+void Sys_isrAccount(SYS_ISR isr, uint32_t startCycle);
+void Sys_getIsrTime(uint32_t* cycles, uint32_t* count);
 void Sys_Delayms(__IO uint16_t time_ms);
-void Sys_timSystickInit(void);
 void SystemClock_Config(void);	
 
 } /* hv_driver */
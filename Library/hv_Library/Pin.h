@@ -0,0 +1,125 @@
+/**
+  ******************************************************************************
+ * @file    Pin.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Compile time GPIO pins
+ *
+ *	Port base and pin number are template arguments, so set / reset / read
+ *	inline to one BSRR or IDR access with the address and mask as constants
+ *	and there is no object to construct. PinGroup changes several pins of a
+ *	port in one BSRR store. PinInit entries chain into a table of one port
+ *	that PortInit writes with one CRL and one CRH store, the mode bits are
+ *	the ones GPIO::init writes. EXTI pins and pins a driver takes as GPIO*
+ *	stay GPIO objects.
+ *
+ *	typedef Pin<GPIOC_BASE, 13> Led;
+ *	PortInit<GPIOC_BASE, PinInit<13, GPIO::OUTPUT, GPIO::PP, GPIO::NONE, GPIO::MEDIUM> >::apply();
+ *	Led::set();
+  */
+//-------------------------------------------------------------------------
+
+#ifndef PIN_H
+#define PIN_H
+
+#include "stm32f1xx.h"
+#include "GPIO.h"
+
+namespace hv_driver {
+
+/* CNF | MODE bits of one pin */
+template <GPIO::MODE Mode, GPIO::OTYPE Type, GPIO::PULL Pull, GPIO::SPEED Speed>
+struct PinMode {
+	/* compile error here: EXTI pins need GPIO::initExti */
+	typedef char mode_check[(Mode <= GPIO::ANALOG) ? 1 : -1];
+
+	static const uint32_t CR = (Mode == GPIO::OUTPUT) ? (Speed | ((Type == GPIO::OD) ? GPIO_CRL_CNF0_0 : 0))
+		: (Mode == GPIO::AF) ? (Speed | ((Type == GPIO::OD) ? GPIO_CRL_CNF0 : GPIO_CRL_CNF0_1))
+		: (Mode == GPIO::ANALOG) ? 0
+		: (Pull != GPIO::NONE) ? GPIO_CRL_CNF0_1 : GPIO_CRL_CNF0_0;
+	/* an input pull is chosen by its ODR bit */
+	static const uint32_t PULL_UP = (Mode == GPIO::INPUT && Pull == GPIO::UP) ? 1 : 0;
+	static const uint32_t PULL_DOWN = (Mode == GPIO::INPUT && Pull == GPIO::DOWN) ? 1 : 0;
+};
+
+template <uintptr_t Port, unsigned Num>
+struct Pin {
+	/* compile error here: pins are 0..15 */
+	typedef char pin_check[(Num < 16) ? 1 : -1];
+
+	static const uint16_t MASK = 1u << Num;
+
+	static GPIO_TypeDef* port(void){return (GPIO_TypeDef*)Port;}
+	static void set(void){port()->BSRR = MASK;}
+	static void reset(void){port()->BSRR = (uint32_t)MASK << 16;}
+	static void write(bool level){port()->BSRR = (level == true) ? (uint32_t)MASK : (uint32_t)MASK << 16;}
+	static void toggle(void){port()->ODR ^= MASK;} // read-modify-write, not from two contexts
+	static uint8_t read(void){return (uint8_t)((port()->IDR >> Num) & 1);}
+};
+
+/* pins of one port changed in a single store */
+template <uintptr_t Port, uint16_t Mask>
+struct PinGroup {
+	static GPIO_TypeDef* port(void){return (GPIO_TypeDef*)Port;}
+	static void set(void){port()->BSRR = Mask;}
+	static void reset(void){port()->BSRR = (uint32_t)Mask << 16;}
+	/* every pin of Mask takes its bit of value */
+	static void write(uint16_t value){port()->BSRR = ((uint32_t)(~value & Mask) << 16) | (value & Mask);}
+	static uint16_t read(void){return (uint16_t)(port()->IDR & Mask);}
+};
+
+/* end of a PinInit table */
+struct PinEnd {
+	static const uint32_t CRL_MASK = 0;
+	static const uint32_t CRL = 0;
+	static const uint32_t CRH_MASK = 0;
+	static const uint32_t CRH = 0;
+	static const uint32_t BSRR = 0;
+};
+
+/* one pin of a PortInit table, Next chains the rest */
+template <unsigned Num, GPIO::MODE Mode, GPIO::OTYPE Type, GPIO::PULL Pull, GPIO::SPEED Speed,
+					class Next = PinEnd>
+struct PinInit {
+	typedef PinMode<Mode, Type, Pull, Speed> mode;
+
+	static const uint32_t SHIFT = 4 * (Num & 7);
+	static const uint32_t CRL_MASK = ((Num < 8) ? (0xFu << SHIFT) : 0) | Next::CRL_MASK;
+	static const uint32_t CRL = ((Num < 8) ? (mode::CR << SHIFT) : 0) | Next::CRL;
+	static const uint32_t CRH_MASK = ((Num >= 8) ? (0xFu << SHIFT) : 0) | Next::CRH_MASK;
+	static const uint32_t CRH = ((Num >= 8) ? (mode::CR << SHIFT) : 0) | Next::CRH;
+	static const uint32_t BSRR = (mode::PULL_UP << Num) | (mode::PULL_DOWN << (Num + 16)) | Next::BSRR;
+
+	/* compile error here: pin out of range or twice in the table */
+	typedef char pin_check[(Num < 16 && ((0xFu << SHIFT) & ((Num < 8) ? Next::CRL_MASK : Next::CRH_MASK)) == 0) ? 1 : -1];
+};
+
+template <uintptr_t Port, class Table>
+struct PortInit {
+	/**
+		* @brief  pulls first, then one CRL and one CRH store
+		* @note		pins left out keep their mode, a half the table fills
+		*					completely is written without reading it
+		*/
+	static void apply(void) {
+		GPIO_TypeDef* port = (GPIO_TypeDef*)Port;
+
+		if (Table::BSRR != 0) {
+			port->BSRR = Table::BSRR;
+		}
+		if (Table::CRL_MASK == 0xFFFFFFFF) {
+			port->CRL = Table::CRL;
+		} else if (Table::CRL_MASK != 0) {
+			port->CRL = (port->CRL & ~Table::CRL_MASK) | Table::CRL;
+		}
+		if (Table::CRH_MASK == 0xFFFFFFFF) {
+			port->CRH = Table::CRH;
+		} else if (Table::CRH_MASK != 0) {
+			port->CRH = (port->CRH & ~Table::CRH_MASK) | Table::CRH;
+		}
+	}
+};
+
+} /* hv_driver */
+#endif /* PIN_H */
@@ -8,8 +8,11 @@
   */
 //-------------------------------------------------------------------------
 #include "RTC.h"
+#include "MISC.h"
 
-#define RTC_STATUS_TIME_OK	0x1234
+#define RTC_STATUS_TIME_OK	0x2000	// counter in s since RTC_EPOCH_YEAR, 0x1234 was the HAL time of day
+#define RTC_LSE_TIMEOUT			RCC_LSE_TIMEOUT_VALUE	// ms
+#define RTC_LSE_POLL_MS			50
 #define RTC_LEAP_YEAR(year)             ((((year) % 4 == 0) && ((year) % 100 != 0)) || ((year) % 400 == 0))
 
 /* Days in a month */
@@ -18,93 +21,126 @@ static uint8_t RTC_Months[2][12] = {
 	{31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31}	/* Leap year */
 };
 
+static hv_driver::_RTC* RTC_instance = NULL;
+
 namespace hv_driver {
 
 _RTC::_RTC(void){
+	this->initState = INIT_START;
+	this->initStart = 0;
+	this->timeValid = false;
+	this->prescaler = RTC_PRESCALER;
+	this->isTicking = false;
+	this->tickCallback = NULL;
+	this->epoch = 0;
+	this->pendingStep = 0;
 }		
 	
+/**
+	* @brief  blocking init, for use before the scheduler starts
+	* @retval true if the time survived the last reset
+	*/
 bool _RTC::init(void){
-	uint16_t BKPstatus;
-
-	/*	Config RTC time Async	*/
-	rtcHandle.Instance = RTC;
-	rtcHandle.Init.AsynchPrediv = RTC_AUTO_1_SECOND;
+	uint16_t wait;
 
-	/* Enable PWR peripheral clock */
-	__HAL_RCC_PWR_CLK_ENABLE();
-
-	/* Allow access to BKP Domain */
-	HAL_PWR_EnableBkUpAccess();
-	__HAL_RCC_BKP_CLK_ENABLE();
+	this->initState = INIT_START;
+	while((wait = this->initStep()) != 0){
+		HAL_Delay(wait);
+	}
+	return this->timeValid;
+}	
 
-  RCC_OscInitTypeDef        RCC_OscInitStruct;
-  RCC_PeriphCLKInitTypeDef  PeriphClkInitStruct;
+/**
+	* @brief  resumable init, returns while the LSE starts up instead of
+	*					blocking for it
+	* @retval ms to wait before the next call, 0 when the RTC runs
+	*/
+uint16_t _RTC::initStep(void){
+	switch(this->initState){
+		case INIT_START:
+			/*	Config RTC time Async	*/
+			rtcHandle.Instance = RTC;
+			rtcHandle.Init.AsynchPrediv = RTC_AUTO_1_SECOND;
+
+			/* Enable PWR peripheral clock */
+			__HAL_RCC_PWR_CLK_ENABLE();
+
+			/* Allow access to BKP Domain */
+			HAL_PWR_EnableBkUpAccess();
+			__HAL_RCC_BKP_CLK_ENABLE();
+
+			/*	LSE as RTC clock source, up to seconds to start	*/
+			__HAL_RCC_LSE_CONFIG(RCC_LSE_ON);
+			this->initStart = HAL_GetTick();
+			this->initState = INIT_LSE;
+			/* fall through */
+		case INIT_LSE:
+			if(__HAL_RCC_GET_FLAG(RCC_FLAG_LSERDY) == RESET &&
+				 HAL_GetTick() - this->initStart < RTC_LSE_TIMEOUT){
+				return RTC_LSE_POLL_MS;
+			}
+			break;
+		default:
+			return 0;
+	}
 
-  /*	Configue LSE as RTC clock soucre */
-	RCC_OscInitStruct.OscillatorType =  RCC_OSCILLATORTYPE_LSE;
-	RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
-	RCC_OscInitStruct.LSEState = RCC_LSE_ON;
-	HAL_RCC_OscConfig(&RCC_OscInitStruct);
+	RCC_PeriphCLKInitTypeDef  PeriphClkInitStruct;
 
 	PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_RTC;
 	PeriphClkInitStruct.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
 	HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct);
 
-//  RCC_OscInitStruct.OscillatorType =  RCC_OSCILLATORTYPE_LSI | RCC_OSCILLATORTYPE_LSE;
-//  RCC_OscInitStruct.PLL.PLLState = RCC_PLL_NONE;
-//  RCC_OscInitStruct.LSIState = RCC_LSI_ON;
-//  RCC_OscInitStruct.LSEState = RCC_LSE_OFF;
-//  HAL_RCC_OscConfig(&RCC_OscInitStruct);
-
-  PeriphClkInitStruct.PeriphClockSelection = RCC_PERIPHCLK_RTC;
-  PeriphClkInitStruct.RTCClockSelection = RCC_RTCCLKSOURCE_LSE;
-  HAL_RCCEx_PeriphCLKConfig(&PeriphClkInitStruct);
-
-
-  /* Enable RTC Clock */
-    __HAL_RCC_RTC_ENABLE();
+	/* Enable RTC Clock */
+	__HAL_RCC_RTC_ENABLE();
 
-  BKPstatus = HAL_RTCEx_BKUPRead(&rtcHandle, RTC_BKP_DR1);
-  if (BKPstatus == RTC_STATUS_TIME_OK) { // DR register already write no need to config date and tim
+	this->initState = INIT_DONE;
+	if (HAL_RTCEx_BKUPRead(&rtcHandle, RTC_BKP_DR1) == RTC_STATUS_TIME_OK) { // DR register already write no need to config date and tim
 
-  	/* Wait for RTC APB registers synchronisation (needed after start-up from Reset) */
-  	HAL_RTC_WaitForSynchro(&rtcHandle);
+		/* Wait for RTC APB registers synchronisation (needed after start-up from Reset) */
+		HAL_RTC_WaitForSynchro(&rtcHandle);
 
-  	/* Clear reset flags */
-  	__HAL_RCC_CLEAR_RESET_FLAGS();
+		/* Clear reset flags */
+		__HAL_RCC_CLEAR_RESET_FLAGS();
 
-  	/*	Init RTC peripherals	*/
-  	HAL_RTC_Init(&rtcHandle);
+		/*	Init RTC peripherals	*/
+		HAL_RTC_Init(&rtcHandle);
 
-  	return true;
-  } else { // DR register not write before set default date and time
-  	date_s date_s;
-  	time_s time_s;
+		this->timeValid = true;
+	} else { // DR register not write before set default date and time
+		date_s date_s;
+		time_s time_s;
 
-  	date_s.day = 22;
-  	date_s.month = 3;
-  	date_s.weekday = SATURDAY;
-  	date_s.year = 2016;
-  	setDate(date_s);
+		date_s.day = 22;
+		date_s.month = 3;
+		date_s.weekday = SATURDAY;
+		date_s.year = 2016;
 
-  	time_s.hours = 3;
-  	time_s.minutes = 21;
-  	time_s.seconds = 0;
-  	setTime(time_s);
+		time_s.hours = 3;
+		time_s.minutes = 21;
+		time_s.seconds = 0;
 
-  	/*	Init RTC peripherals	*/
-  	HAL_RTC_Init(&rtcHandle);
-  	/*	write Backup register */
-  	HAL_RTCEx_BKUPWrite(&rtcHandle, RTC_BKP_DR1, RTC_STATUS_TIME_OK);
+		/*	Init RTC peripherals	*/
+		HAL_RTC_Init(&rtcHandle);
+		this->writeCounter(toSeconds(date_s, time_s));
+		/*	write Backup register */
+		HAL_RTCEx_BKUPWrite(&rtcHandle, RTC_BKP_DR1, RTC_STATUS_TIME_OK);
 
-  	return false;	
+		this->timeValid = false;
 	}
+	this->loadCache(this->readCounter());
+	return 0;
 }	
 	
 
+/**
+	* @brief  set the date, the time of day is kept
+	* @param  date_s &date_s - the weekday follows from the date
+	* @retval false for a date out of 2000..2099
+	*/
 bool _RTC::setDate(date_s &date_s) {
-	RTC_DateTypeDef rtcDate;
-	uint8_t year = date_s.year - 2000;
+	time_s time_s;
+	uint32_t counter;
+	uint8_t year = date_s.year - RTC_EPOCH_YEAR;
 
 	/* check a valid date data */
 	if(date_s.month > 12 ||
@@ -115,13 +151,11 @@ bool _RTC::setDate(date_s &date_s) {
 			return false;
 	}
 
-	/* Fill date	*/
-	rtcDate.Date = date_s.day;
-	rtcDate.Month = date_s.month;
-	rtcDate.WeekDay = (WEEKDAY)date_s.weekday;
-	rtcDate.Year = year;
-
-	HAL_RTC_SetDate(&this->rtcHandle, &rtcDate, RTC_FORMAT_BIN);
+	counter = this->readCounter() % 86400;
+	time_s.hours = counter / 3600;
+	time_s.minutes = (counter / 60) % 60;
+	time_s.seconds = counter % 60;
+	this->setCounter(toSeconds(date_s, time_s));
 
 	return true;
 }
@@ -137,18 +171,18 @@ bool _RTC::setDate(WEEKDAY weekday, uint8_t day, uint8_t month, uint16_t year) {
 	return setDate(date_s);
 }
 
+/* the date is kept */
 bool _RTC::setTime(time_s &time_s) {
-  RTC_TimeTypeDef rtcTime;
+  uint32_t counter;
   if (time_s.seconds > 59 ||
   		time_s.minutes > 59 ||
 			time_s.hours > 23) {
   	return false;
   }
-  rtcTime.Seconds = time_s.seconds;
-  rtcTime.Minutes = time_s.minutes;
-  rtcTime.Hours = time_s.hours;
+  counter = this->readCounter();
+  counter -= counter % 86400;
 
-  HAL_RTC_SetTime(&this->rtcHandle, &rtcTime, RTC_FORMAT_BIN);
+  this->setCounter(counter + time_s.hours * 3600 + time_s.minutes * 60 + time_s.seconds);
 
   return true;
 }
@@ -166,37 +200,318 @@ bool _RTC::setTime(uint8_t hours, uint8_t minutes, uint8_t seconds) {
 	* @brief  get date data
 	* @param  rtc_date_s& date_s - output date struct
 	* @retval true if get date success
+	* @note		the second tick cache once startTick ran
 	*/
 bool _RTC::getDate(date_s& date_s) {
-	RTC_DateTypeDef rtcDate;
-	if (HAL_RTC_GetDate(&this->rtcHandle, &rtcDate, RTC_FORMAT_BIN) == HAL_OK) {
-		date_s.day = rtcDate.Date;
-		date_s.month = rtcDate.Month;
-		date_s.weekday = (WEEKDAY)rtcDate.WeekDay;
-		date_s.year = rtcDate.Year + 2000;
-
+	time_s time_s;
+	if (this->isTicking == true) {
+		__disable_irq();
+		date_s = this->nowDate;
+		__enable_irq();
 		return true;
-	} else {
-		return false;
 	}
+	toCalendar(this->readCounter(), date_s, time_s);
+	return true;
 }
 
 /**
 	* @brief  get time data
 	* @param  rtc_date_s& time_s - output time struct
 	* @retval true if get time success
+	* @note		the second tick cache once startTick ran
 	*/
 bool _RTC::getTime(time_s &time_s) {
-	RTC_TimeTypeDef rtcTime;
-	if (HAL_RTC_GetTime(&this->rtcHandle, &rtcTime, RTC_FORMAT_BIN) == HAL_OK) {
-		time_s.seconds = rtcTime.Seconds;
-		time_s.minutes = rtcTime.Minutes;
-		time_s.hours = rtcTime.Hours;
-
+	date_s date_s;
+	if (this->isTicking == true) {
+		__disable_irq();
+		time_s = this->nowTime;
+		__enable_irq();
 		return true;
-	} else {
+	}
+	toCalendar(this->readCounter(), date_s, time_s);
+	return true;
+}
+
+/**
+	* @brief  set date and time from s since RTC_EPOCH_YEAR
+	* @param  uint32_t seconds
+	* @retval true
+	* @note		one counter write, a step still pending is dropped
+	*/
+bool _RTC::setEpoch(uint32_t seconds) {
+	this->setCounter(seconds);
+	return true;
+}
+
+/**
+	* @brief  step the time, the fraction of the second is kept
+	* @param  int32_t seconds
+	* @retval false before startTick or before RTC_EPOCH_YEAR
+	* @note		the next second interrupt applies it right after the counter
+	*					ticked, getStamp includes it until then
+	*/
+bool _RTC::adjust(int32_t seconds) {
+	bool isDone = false;
+
+	if (this->isTicking != true) {
 		return false;
 	}
+	__disable_irq();
+	if ((int64_t)this->readCounter() + this->pendingStep + seconds >= 0) {
+		this->pendingStep += seconds;
+		isDone = true;
+	}
+	__enable_irq();
+	return isDone;
+}
+
+/**
+	* @brief  time with the fraction of the second from the prescaler
+	* @param  uint32_t &seconds - since RTC_EPOCH_YEAR
+	* @param  uint16_t &ms
+	* @note		valid once startTick ran, also ahead of a pending tick
+	*/
+void _RTC::getStamp(uint32_t &seconds, uint16_t &ms) {
+	uint32_t counter, div;
+
+	__disable_irq();
+	do {
+		counter = this->readCounter();
+		div = ((uint32_t)(RTC->DIVH & RTC_DIVH_RTC_DIV) << 16) | RTC->DIVL;
+	} while (counter != this->readCounter());
+	seconds = counter + this->pendingStep;
+	__enable_irq();
+
+	if (div > this->prescaler) {
+		div = this->prescaler;
+	}
+	ms = (uint16_t)((this->prescaler - div) * 1000 / (this->prescaler + 1));
 }
 
-} /* hv_driver */
\ No newline at end of file
+/**
+	* @brief  clock calibration for the LSE drift
+	* @param  uint8_t cal - BKP RTCCR, clocks dropped per 2^20, up to 121 ppm slower
+	* @param  bool isFast - prescaler one count short, 30.5 ppm faster
+	* @note		CAL is kept in the backup domain, the prescaler is written
+	*					again by init, call after every reset
+	*/
+void _RTC::setCalibration(uint8_t cal, bool isFast) {
+	uint32_t prescaler = (isFast == true) ? RTC_PRESCALER - 1 : RTC_PRESCALER;
+
+	HAL_RTCEx_SetSmoothCalib(&this->rtcHandle, 0, 0, cal & BKP_RTCCR_CAL);
+	if (prescaler == this->prescaler) {
+		return;
+	}
+	while ((RTC->CRL & RTC_CRL_RTOFF) == 0);
+	RTC->CRL |= RTC_CRL_CNF;
+	RTC->PRLH = prescaler >> 16;
+	RTC->PRLL = prescaler & 0xFFFF;
+	RTC->CRL &= ~RTC_CRL_CNF;
+	while ((RTC->CRL & RTC_CRL_RTOFF) == 0);
+	this->prescaler = prescaler;
+	Sys_setRtcPrescaler(prescaler); // STOP mode sleeps are timed in RTC seconds
+}
+
+/**
+	* @brief  backup data register, kept over reset while VBAT is present
+	* @param  uint32_t reg - RTC_BKP_DR2.., RTC_BKP_DR1 is used by the driver
+	* @retval register value
+	*/
+uint16_t _RTC::readBackup(uint32_t reg) {
+	return (uint16_t)HAL_RTCEx_BKUPRead(&this->rtcHandle, reg);
+}
+
+void _RTC::writeBackup(uint32_t reg, uint16_t value) {
+	HAL_RTCEx_BKUPWrite(&this->rtcHandle, reg, value);
+}
+
+/**
+	* @brief  keep time and date in RAM, advanced by the RTC second interrupt
+	*					instead of converting the counter on every read
+	* @param  void (*callback)(uint8_t fields) - TIME_FIELD bits that changed,
+	*					called from the interrupt, may be NULL
+	* @retval false before init is done
+	*/
+bool _RTC::startTick(void (*callback)(uint8_t fields)) {
+	if (this->initState != INIT_DONE) {
+		return false;
+	}
+	RTC_instance = this;
+	this->tickCallback = callback;
+	__disable_irq();
+	this->loadCache(this->readCounter());
+	__enable_irq();
+	this->isTicking = true;
+
+	RTC->CRL &= ~RTC_CRL_SECF; // the HAL macro writes CNF as well
+	__HAL_RTC_SECOND_ENABLE_IT(&this->rtcHandle, RTC_IT_SEC);
+	HAL_NVIC_SetPriority(RTC_IRQn, RTC_IRQ_PRIORITY, 0);
+	HAL_NVIC_EnableIRQ(RTC_IRQn);
+	return true;
+}
+
+/**
+	* @brief  second interrupt, catches up on seconds missed in STOP mode
+	*					and applies a step from adjust
+	* @param  none
+	* @retval none
+	*/
+void _RTC::tickHandler(void) {
+	uint32_t counter;
+	uint8_t fields;
+
+	RTC->CRL &= ~RTC_CRL_SECF;
+	counter = this->readCounter();
+	if (this->pendingStep != 0) {
+		/* the prescaler just reloaded, the written second starts whole */
+		counter += this->pendingStep;
+		this->pendingStep = 0;
+		this->writeCounter(counter);
+		this->loadCache(counter);
+		fields = FIELD_SECOND | FIELD_MINUTE | FIELD_HOUR | FIELD_DATE;
+	} else if (counter == this->epoch) {
+		return;
+	} else {
+		fields = this->advance(counter - this->epoch);
+	}
+	if (this->tickCallback != NULL) {
+		this->tickCallback(fields);
+	}
+}
+
+/* counter pair read again until consistent */
+uint32_t _RTC::readCounter(void) {
+	uint32_t counter;
+
+	do {
+		counter = ((uint32_t)RTC->CNTH << 16) | RTC->CNTL;
+	} while (counter != (((uint32_t)RTC->CNTH << 16) | RTC->CNTL));
+	return counter;
+}
+
+/* counter in CNF mode, both halves at once */
+void _RTC::writeCounter(uint32_t counter) {
+	while ((RTC->CRL & RTC_CRL_RTOFF) == 0);
+	RTC->CRL |= RTC_CRL_CNF;
+	RTC->CNTH = counter >> 16;
+	RTC->CNTL = counter & 0xFFFF;
+	RTC->CRL &= ~RTC_CRL_CNF;
+	while ((RTC->CRL & RTC_CRL_RTOFF) == 0);
+}
+
+/* the time set, the cache follows it before the next tick */
+void _RTC::setCounter(uint32_t counter) {
+	__disable_irq();
+	this->pendingStep = 0;
+	this->writeCounter(counter);
+	this->loadCache(counter);
+	__enable_irq();
+}
+
+/* full conversion, at start and after the time is set, interrupts off */
+void _RTC::loadCache(uint32_t counter) {
+	time_s time_s;
+	date_s date_s;
+
+	toCalendar(counter, date_s, time_s);
+	this->nowTime = time_s;
+	this->nowDate = date_s;
+	this->epoch = counter;
+}
+
+/* s since RTC_EPOCH_YEAR to date and time */
+void _RTC::toCalendar(uint32_t seconds, date_s &date_s, time_s &time_s) {
+	uint32_t days = seconds / 86400;
+	uint16_t yearDays;
+
+	date_s.weekday = (WEEKDAY)((days + SATURDAY) % 7); // 1 January 2000
+	date_s.year = RTC_EPOCH_YEAR;
+	while (days >= (yearDays = RTC_LEAP_YEAR(date_s.year) ? 366 : 365)) {
+		days -= yearDays;
+		date_s.year++;
+	}
+	date_s.month = 1;
+	while (days >= RTC_Months[RTC_LEAP_YEAR(date_s.year) ? 1 : 0][date_s.month - 1]) {
+		days -= RTC_Months[RTC_LEAP_YEAR(date_s.year) ? 1 : 0][date_s.month - 1];
+		date_s.month++;
+	}
+	date_s.day = days + 1;
+
+	seconds %= 86400;
+	time_s.hours = seconds / 3600;
+	time_s.minutes = (seconds / 60) % 60;
+	time_s.seconds = seconds % 60;
+}
+
+/* date and time to s since RTC_EPOCH_YEAR, the weekday is not used */
+uint32_t _RTC::toSeconds(const date_s &date_s, const time_s &time_s) {
+	uint32_t days = 0;
+
+	for (uint16_t year = RTC_EPOCH_YEAR; year < date_s.year; year++) {
+		days += RTC_LEAP_YEAR(year) ? 366 : 365;
+	}
+	for (uint8_t month = 1; month < date_s.month; month++) {
+		days += RTC_Months[RTC_LEAP_YEAR(date_s.year) ? 1 : 0][month - 1];
+	}
+	days += date_s.day - 1;
+	return days * 86400 + time_s.hours * 3600 + time_s.minutes * 60 + time_s.seconds;
+}
+
+/**
+	* @brief  move the cached time forward, each field only rolls over when
+	*					the one below it carries
+	* @param  uint32_t seconds - 1 per tick, more after STOP mode
+	* @retval TIME_FIELD bits that changed
+	*/
+uint8_t _RTC::advance(uint32_t seconds) {
+	uint8_t fields = FIELD_SECOND;
+	uint32_t carry;
+
+	this->epoch += seconds;
+	carry = this->nowTime.seconds + seconds;
+	this->nowTime.seconds = carry % 60;
+	carry /= 60;
+	if (carry == 0) {
+		return fields;
+	}
+	fields |= FIELD_MINUTE;
+	carry += this->nowTime.minutes;
+	this->nowTime.minutes = carry % 60;
+	carry /= 60;
+	if (carry == 0) {
+		return fields;
+	}
+	fields |= FIELD_HOUR;
+	carry += this->nowTime.hours;
+	this->nowTime.hours = carry % 24;
+	carry /= 24;
+	if (carry == 0) {
+		return fields;
+	}
+	fields |= FIELD_DATE;
+	this->nowDate.weekday = (WEEKDAY)((this->nowDate.weekday + carry) % 7);
+	while (carry-- > 0) {
+		if (this->nowDate.day < RTC_Months[RTC_LEAP_YEAR(this->nowDate.year) ? 1 : 0][this->nowDate.month - 1]) {
+			this->nowDate.day++;
+			continue;
+		}
+		this->nowDate.day = 1;
+		if (this->nowDate.month < 12) {
+			this->nowDate.month++;
+		} else {
+			this->nowDate.month = 1;
+			this->nowDate.year++;
+		}
+	}
+	return fields;
+}
+
+} /* hv_driver */
+
+extern "C" {
+	void RTC_IRQHandler(void) {
+		if (RTC_instance != NULL) {
+			RTC_instance->tickHandler();
+		}
+	}
+}
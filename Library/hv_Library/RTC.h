@@ -34,15 +34,35 @@ typedef struct {
 	uint16_t year;
 } date_s;
 
+enum INIT_STATE {
+	INIT_START = 0, INIT_LSE, INIT_DONE
+};
+
 typedef struct {
 	uint8_t seconds;
 	uint8_t minutes;
 	uint8_t hours;
 } time_s;
+
+/* fields changed by a second tick */
+enum TIME_FIELD {
+	FIELD_SECOND = 0x01,
+	FIELD_MINUTE = 0x02,
+	FIELD_HOUR = 0x04,
+	FIELD_DATE = 0x08
+};
+
+enum RTC_PARAM {
+	RTC_IRQ_PRIORITY = 6,		// tick callback may signal tasks
+	RTC_EPOCH_YEAR = 2000,	// getEpoch counts from 1 January
+	RTC_PRESCALER = 32767	// RTC_AUTO_1_SECOND on the LSE
+};
 public:
 	_RTC(void);
 
 	bool init(void);
+	uint16_t initStep(void);
+	bool isTimeValid(void){return this->timeValid;}
 
 	bool setDate(date_s &date);
 	bool setDate(WEEKDAY weekday, uint8_t day, uint8_t month, uint16_t year);
@@ -52,8 +72,40 @@ public:
 	bool getDate(date_s &date_s);
 	bool getTime(time_s &time_s);
 
+	bool startTick(void (*callback)(uint8_t fields));
+	uint32_t getEpoch(void){return this->epoch;}
+	void getStamp(uint32_t &seconds, uint16_t &ms);
+	bool setEpoch(uint32_t seconds);
+	bool adjust(int32_t seconds);
+	void setCalibration(uint8_t cal, bool isFast);
+	void tickHandler(void);
+
+	uint16_t readBackup(uint32_t reg);
+	void writeBackup(uint32_t reg, uint16_t value);
+
 private:	
 	RTC_HandleTypeDef rtcHandle;
+	INIT_STATE initState;
+	uint32_t initStart;
+	bool timeValid;			// kept by the backup domain over the last reset
+	uint32_t prescaler;	// PRL is write only
+
+	/* second tick cache, valid once startTick ran */
+	bool isTicking;
+	void (*tickCallback)(uint8_t fields);
+	__IO uint32_t epoch;	// s since RTC_EPOCH_YEAR, the counter at the last tick
+	__IO int32_t pendingStep;	// s, adjust for the next tick
+	time_s nowTime;
+	date_s nowDate;
+
+	uint32_t readCounter(void);
+	void writeCounter(uint32_t counter);
+	void setCounter(uint32_t counter);
+	void loadCache(uint32_t counter);
+	uint8_t advance(uint32_t seconds);
+
+	static void toCalendar(uint32_t seconds, date_s &date, time_s &time);
+	static uint32_t toSeconds(const date_s &date, const time_s &time);
 };
 } /* hv_driver namespace */
 
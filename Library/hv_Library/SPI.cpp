@@ -8,12 +8,20 @@
   */
 //-------------------------------------------------------------------------
 #include "SPI.h"
+#include "MISC.h"
+
+static hv_driver::SPI* SPI1_DMAInstance = NULL;
 
 namespace hv_driver {
 
 SPI::SPI(SPI_TypeDef* SPIx){
 	this->SPIx = SPIx;
 	this->mode = MASTER;
+	this->rxChannel = NULL;
+	this->txChannel = NULL;
+	this->CallBack = NULL;
+	this->rxDummy = 0;
+	this->txDummy = 0;
 }	
 
 void SPI::init(MODE mode, BAUD_DIV baud, NSS nss, CPHA cpha, CPOL cpol){
@@ -94,4 +102,111 @@ void SPI::receive(uint8_t *rxPtr, uint8_t size){
 	}
 }
 
-} /* namespace hv_driver */
\ No newline at end of file
+/**
+	* @brief  enable DMA transfer, SPI1 only: RX DMA1 channel 2, TX DMA1 channel 3
+	* @param  uint8_t priority - RX complete interrupt priority
+	* @param  void (*CallBack)(void) - called from the interrupt when a transfer is done
+	* @retval true if the SPI has DMA channels available
+	* @note		SPI2 channels are not supported, DMA1 channel 4 serves USART1 TX
+	*/
+bool SPI::initDMA(uint8_t priority, void (*CallBack)(void)){
+	if(this->SPIx != SPI1){
+		return false;
+	}
+	__HAL_RCC_DMA1_CLK_ENABLE();
+	this->rxChannel = DMA1_Channel2;
+	this->txChannel = DMA1_Channel3;
+	this->CallBack = CallBack;
+	SPI1_DMAInstance = this;
+	
+	HAL_NVIC_SetPriority(DMA1_Channel2_IRQn, priority, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel2_IRQn);
+	return true;
+}
+
+/**
+	* @brief  start a full duplex DMA transfer
+	* @param  uint8_t *txPtr - NULL to clock out zeros
+	* @param  uint8_t *rxPtr - NULL to discard received bytes
+	* @param  uint16_t size
+	* @retval false if DMA not initialised or size is 0
+	* @note		completion is reported through the initDMA callback
+	*/
+bool SPI::transferDMA(uint8_t *txPtr, uint8_t *rxPtr, uint16_t size){
+	uint32_t temp;
+	
+	if(this->rxChannel == NULL || size == 0){
+		return false;
+	}
+	this->rxChannel->CCR = 0;
+	this->txChannel->CCR = 0;
+	DMA1->IFCR = DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3;
+	temp = this->SPIx->DR; // flush stale rx data
+	(void)temp;
+	
+	this->rxChannel->CPAR = (uint32_t)(uintptr_t)&this->SPIx->DR;
+	this->rxChannel->CMAR = (uint32_t)(uintptr_t)((rxPtr != NULL) ? rxPtr : &this->rxDummy);
+	this->rxChannel->CNDTR = size;
+	this->rxChannel->CCR = DMA_CCR_PL_1 | DMA_CCR_TCIE | ((rxPtr != NULL) ? DMA_CCR_MINC : 0) | DMA_CCR_EN;
+	
+	this->txChannel->CPAR = (uint32_t)(uintptr_t)&this->SPIx->DR;
+	this->txChannel->CMAR = (uint32_t)(uintptr_t)((txPtr != NULL) ? txPtr : &this->txDummy);
+	this->txChannel->CNDTR = size;
+	this->txChannel->CCR = DMA_CCR_DIR | ((txPtr != NULL) ? DMA_CCR_MINC : 0) | DMA_CCR_EN;
+	
+	if((this->SPIx->CR1 & SPI_CR1_SPE) != SPI_CR1_SPE){ // if spi not enable
+		this->SPIx->CR1 |= SPI_CR1_SPE; // enable spi
+	}
+	this->SPIx->CR2 |= SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN; // rx first so no byte is missed
+	return true;
+}
+
+/**
+	* @brief  stop a DMA transfer that did not complete
+	* @param  none
+	* @retval none
+	* @note		both channels off and their interrupt cleared, no callback
+	*					follows and the buffers are free on return
+	*/
+void SPI::abortDMA(void){
+	if(this->rxChannel == NULL){
+		return;
+	}
+	this->SPIx->CR2 &= ~(SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+	this->rxChannel->CCR = 0;
+	this->txChannel->CCR = 0;
+	DMA1->IFCR = DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3;
+	HAL_NVIC_ClearPendingIRQ(DMA1_Channel2_IRQn);
+}
+
+/**
+	* @brief  RX channel transfer complete, last byte is clocked in
+	* @param  none
+	* @retval none
+	*/
+void SPI::DMAHandler(void){
+	if((DMA1->ISR & DMA_ISR_TCIF2) == 0){
+		DMA1->IFCR = DMA_IFCR_CGIF2;
+		return;
+	}
+	DMA1->IFCR = DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3;
+	this->SPIx->CR2 &= ~(SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN);
+	this->rxChannel->CCR = 0;
+	this->txChannel->CCR = 0;
+	if(this->CallBack != NULL){
+		this->CallBack();
+	}
+}
+
+} /* namespace hv_driver */
+
+extern "C" {
+	void DMA1_Channel2_IRQHandler(void){
+		uint32_t start = hv_driver::Sys_getCycle();
+
+		if(SPI1_DMAInstance != NULL){
+			SPI1_DMAInstance->DMAHandler();
+		}
+		hv_driver::Sys_isrAccount(hv_driver::SYS_ISR_SPI_DMA, start);
+	}
+}
\ No newline at end of file
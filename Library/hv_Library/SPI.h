@@ -42,9 +42,19 @@ public:
 	void transceiver(uint8_t *txPtr, uint8_t *rxPtr, uint8_t size);
 	void transmit(uint8_t *txPtr, uint8_t size);
 	void receive(uint8_t *rxPtr, uint8_t size);
+
+	bool initDMA(uint8_t priority, void (*CallBack)(void));
+	bool transferDMA(uint8_t *txPtr, uint8_t *rxPtr, uint16_t size);
+	void abortDMA(void);
+	void DMAHandler(void);
 private:
 	SPI_TypeDef* SPIx;
 	MODE mode;
+	DMA_Channel_TypeDef* rxChannel;
+	DMA_Channel_TypeDef* txChannel;
+	void (*CallBack)(void);
+	uint8_t rxDummy; // sink for discarded bytes
+	uint8_t txDummy; // zero clocked out when no tx data
 };	
 		
 } /* hv_driver namespace */
@@ -0,0 +1,117 @@
+/**
+  ******************************************************************************
+ * @file    SpscRing.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Single producer, single consumer ring for interrupt to task data
+ *
+ *	One side only pushes (usually an interrupt), the other only pops (a
+ *	task). Each index is written by one side alone and is a single 16 bit
+ *	store, so no critical section or LDREX / STREX is needed. The indices
+ *	run free and wrap, N must be a power of two up to 32768. T is copied
+ *	by assignment, keep it plain data.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include "stm32f1xx.h"
+
+namespace hv_driver {
+
+template <typename T, uint16_t N>
+class SpscRing {
+	/* compile error here: N is not a power of two */
+	typedef char capacity_check[(N != 0 && (N & (N - 1)) == 0 && N <= 32768) ? 1 : -1];
+public:
+	SpscRing(void) {
+		_head = 0;
+		_tail = 0;
+	}
+
+	/* producer */
+	bool push(const T &item) {
+		uint16_t head = _head;
+
+		if ((uint16_t)(head - _tail) == N) {
+			return false;
+		}
+		_buff[head & (N - 1)] = item;
+		__DMB(); // item stored before the consumer can see it
+		_head = head + 1;
+		return true;
+	}
+
+	/**
+		* @brief  copy as many items as fit
+		* @retval items pushed
+		*/
+	uint16_t push(const T* items, uint16_t count) {
+		uint16_t head = _head;
+		uint16_t room = N - (uint16_t)(head - _tail);
+
+		if (count > room) {
+			count = room;
+		}
+		for (uint16_t i = 0; i < count; i++) {
+			_buff[(uint16_t)(head + i) & (N - 1)] = items[i];
+		}
+		__DMB();
+		_head = head + count;
+		return count;
+	}
+
+	/* consumer */
+	bool pop(T &item) {
+		uint16_t tail = _tail;
+
+		if (tail == _head) {
+			return false;
+		}
+		__DMB(); // head read before the item
+		item = _buff[tail & (N - 1)];
+		__DMB(); // item read before the producer may reuse the slot
+		_tail = tail + 1;
+		return true;
+	}
+
+	/**
+		* @brief  take up to count items, oldest first
+		* @retval items popped
+		*/
+	uint16_t pop(T* items, uint16_t count) {
+		uint16_t tail = _tail;
+		uint16_t used = (uint16_t)(_head - tail);
+
+		if (count > used) {
+			count = used;
+		}
+		__DMB();
+		for (uint16_t i = 0; i < count; i++) {
+			items[i] = _buff[(uint16_t)(tail + i) & (N - 1)];
+		}
+		__DMB();
+		_tail = tail + count;
+		return count;
+	}
+
+	/* consumer, drops everything pushed so far */
+	void clear(void) {
+		_tail = _head;
+	}
+
+	/* either side, may be stale by the time it is used */
+	uint16_t getCount(void){return (uint16_t)(_head - _tail);}
+	bool isEmpty(void){return _head == _tail;}
+	bool isFull(void){return (uint16_t)(_head - _tail) == N;}
+	uint16_t getCapacity(void){return N;}
+private:
+	T _buff[N];
+	__IO uint16_t _head;	// producer only
+	__IO uint16_t _tail;	// consumer only
+};
+
+} /* hv_driver */
+#endif /* SPSC_RING_H */
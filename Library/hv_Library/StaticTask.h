@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+ * @file    StaticTask.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Thread with its stack sized at compile time
+ *
+ *	The stack is a member, so a global StaticTask is placed by the linker
+ *	and an application that does not fit RAM fails to link instead of
+ *	failing in osThreadCreate. Only the task control block still comes
+ *	from the RTOS heap, this kernel version has no static TCB.
+ *	The kernel frees the stack of a deleted task whatever its origin, a
+ *	StaticTask must never be terminated.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef STATIC_TASK_H
+#define STATIC_TASK_H
+
+#include "stm32f1xx.h"
+#include "cmsis_os.h"
+
+namespace hv_driver {
+
+template <uint16_t Stack, osPriority Prio>
+class StaticTask {
+public:
+	enum TASK_PARAM {
+		TASK_STACK = Stack,		// words
+		TASK_PRIORITY = Prio
+	};
+	StaticTask(void) {
+		_id = NULL;
+	}
+
+	/**
+		* @brief  create the thread on the member stack, once
+		* @param  const char* name - configMAX_TASK_NAME_LEN
+		* @param  os_pthread thread
+		* @param  void* argument
+		* @retval thread id, NULL if the TCB could not be allocated
+		*/
+	osThreadId start(const char* name, os_pthread thread, void* argument) {
+		TaskHandle_t handle;
+
+		if (_id != NULL) {
+			return _id;
+		}
+		if (xTaskGenericCreate((TaskFunction_t)thread, name, Stack, argument,
+													 tskIDLE_PRIORITY + (Prio - osPriorityIdle), &handle, _stack, NULL) != pdPASS) {
+			return NULL;
+		}
+		_id = handle;
+		return _id;
+	}
+	osThreadId getId(void){return _id;}
+private:
+	StackType_t _stack[Stack];
+	osThreadId _id;
+};
+
+} /* hv_driver */
+#endif /* STATIC_TASK_H */
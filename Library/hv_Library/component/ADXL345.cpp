@@ -8,6 +8,7 @@
   */
 //-------------------------------------------------------------------------
 #include "ADXL345.h"
+#include "Pin.h"
 
 namespace hv_driver {
 
@@ -16,11 +17,9 @@ ADXL345::ADXL345(GPIO* intPin){
 }
 
 bool ADXL345::init(RANGE range, DATA_RATE dataRate){
-	GPIO PB10(GPIOB, GPIO::PIN10);
-	GPIO PB11(GPIOB, GPIO::PIN11);
-	
-	PB10.init(GPIO::AF, GPIO::OD, GPIO::NONE, GPIO::MEDIUM);
-	PB11.init(GPIO::AF, GPIO::OD, GPIO::NONE, GPIO::MEDIUM);
+	/* I2C2 SCL, SDA in one CRH write */
+	PortInit<GPIOB_BASE, PinInit<10, GPIO::AF, GPIO::OD, GPIO::NONE, GPIO::MEDIUM,
+												PinInit<11, GPIO::AF, GPIO::OD, GPIO::NONE, GPIO::MEDIUM> > >::apply();
 	
 	/* Init I2C peripherals */
 	__HAL_RCC_I2C2_CLK_ENABLE();	
@@ -89,19 +88,19 @@ uint16_t ADXL345::getOffSet(AXIS axis){
 			value = readByte(OFSZ_REG);
 			break;
 	}
-	return value * 15.6; // add scale factor
+	return value * 156 / 10; // add scale factor (15.6mg/LSB)
 }
 
 void ADXL345::setOffSet(AXIS axis, uint16_t value_mg){
 	switch (axis) {
 		case AXIS_X:
-			writeByte(OFSX_REG, (uint8_t)(value_mg / 15.6));
+			writeByte(OFSX_REG, (uint8_t)(value_mg * 10 / 156));
 			break;
 		case AXIS_Y:
-			writeByte(OFSY_REG, (uint8_t)(value_mg / 15.6));
+			writeByte(OFSY_REG, (uint8_t)(value_mg * 10 / 156));
 			break;
 		case AXIS_Z:
-			writeByte(OFSZ_REG, (uint8_t)(value_mg / 15.6));
+			writeByte(OFSZ_REG, (uint8_t)(value_mg * 10 / 156));
 			break;
 	}
 }
@@ -191,7 +190,7 @@ void ADXL345::clearSettings(void){
   * @return tap thress value in mg
   */
 uint16_t ADXL345::getTapThressHold(void){
-	return (uint16_t)(readByte(THRESH_TAP_REG) * 62.5);
+	return (uint16_t)(readByte(THRESH_TAP_REG) * 625 / 10);
 }
 
 /**
@@ -200,7 +199,7 @@ uint16_t ADXL345::getTapThressHold(void){
   * @return none
   */
 void ADXL345::setTapThressHold(uint16_t value_mg){
-	return writeByte(THRESH_TAP_REG, (value_mg / 62.5));
+	return writeByte(THRESH_TAP_REG, (value_mg * 10 / 625));
 }
 
 /**
@@ -228,7 +227,7 @@ void ADXL345::setTapDuration(uint8_t duration_ms){
   * @return latency time in milisecond
   */
 uint16_t ADXL345::getLatencyTime(void){
-	return (uint16_t)((readByte(LATENT_REG) * 1.25));
+	return (uint16_t)((readByte(LATENT_REG) * 5 / 4));
 }
 
 /**
@@ -238,7 +237,7 @@ uint16_t ADXL345::getLatencyTime(void){
   * @return none
   */
 void ADXL345::setLatencyTime(uint16_t time_ms){
-	writeByte(LATENT_REG, (uint8_t)((time_ms / 1.25)));
+	writeByte(LATENT_REG, (uint8_t)((time_ms * 4 / 5)));
 }
 
 /**
@@ -248,7 +247,7 @@ void ADXL345::setLatencyTime(uint16_t time_ms){
   * @return windows time value in ms
   */
 uint16_t ADXL345::getWindowTime(void){
-	return (uint16_t)((readByte(WINDOW_REG) * 1.25));
+	return (uint16_t)((readByte(WINDOW_REG) * 5 / 4));
 }
 
 /**
@@ -258,7 +257,7 @@ uint16_t ADXL345::getWindowTime(void){
   * @return none
   */
 void ADXL345::setWindowTime(uint16_t time_ms){
-	writeByte(WINDOW_REG, (uint8_t)((time_ms / 1.25)));
+	writeByte(WINDOW_REG, (uint8_t)((time_ms * 4 / 5)));
 }
 
 /**
@@ -339,7 +338,7 @@ void ADXL345::getActTapStatus(TapStatus_s& TapStatus){
   * @return thresshold value in mg
   */
 uint16_t ADXL345::getThreshActivity(void){
-	return (uint16_t)(readByte(THRESH_ACT_REG) * 62.5);
+	return (uint16_t)(readByte(THRESH_ACT_REG) * 625 / 10);
 }
 
 /**
@@ -348,7 +347,7 @@ uint16_t ADXL345::getThreshActivity(void){
   * @return none
   */
 void ADXL345::setThreshActivity(uint16_t actThresh_mg){
-	writeByte(THRESH_ACT_REG, (uint8_t)(actThresh_mg / 62.5));
+	writeByte(THRESH_ACT_REG, (uint8_t)(actThresh_mg * 10 / 625));
 }
 
 /**
@@ -403,7 +402,7 @@ bool ADXL345::getActControl(AXIS axis){
   * @return inactivity thresshold in mg
   */
 uint16_t ADXL345::getThreshInactivity(void){
-	return (uint16_t)(readByte(THRESH_INACT_REG) * 62.5);
+	return (uint16_t)(readByte(THRESH_INACT_REG) * 625 / 10);
 }
 
 /**
@@ -412,7 +411,7 @@ uint16_t ADXL345::getThreshInactivity(void){
   * @return none
   */
 void ADXL345::setThreshInactivity(uint16_t inactThresh_mg){
-	writeByte(THRESH_INACT_REG, (uint8_t)(inactThresh_mg / 62.5));
+	writeByte(THRESH_INACT_REG, (uint8_t)(inactThresh_mg * 10 / 625));
 }
 
 /**
@@ -487,7 +486,7 @@ bool ADXL345::getInactControl(AXIS axis){
   * @return Free-Fall thresshold in mg
   */
 uint16_t ADXL345::getThreshFreeFall(void){
-	return (uint16_t)(readByte(THRESH_FF_REG) * 62.5);
+	return (uint16_t)(readByte(THRESH_FF_REG) * 625 / 10);
 }
 
 /**
@@ -496,7 +495,7 @@ uint16_t ADXL345::getThreshFreeFall(void){
   * @return none
   */
 void ADXL345::setThreshFreeFall(uint16_t freefallThresh_mg){
-	writeByte(THRESH_FF_REG, (uint8_t)(freefallThresh_mg / 62.5));
+	writeByte(THRESH_FF_REG, (uint8_t)(freefallThresh_mg * 10 / 625));
 }
 
 /**
@@ -549,15 +548,15 @@ bool ADXL345::readBit(uint8_t address, uint8_t bitPos){
 void ADXL345::writeByte(uint8_t address, uint8_t wData){
 	uint8_t data[2] = {address, wData};
 	/* send slave address + write cmd + register address to write to + data */
-	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, data, 2, 1000);
+	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, data, 2, ADXL_TIMEOUT);
 }
 
 uint8_t ADXL345::readByte(uint8_t address){
 	uint8_t data = 0;
 	/* first send Slave address and register address to read form */
-	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, &address, 1, 1000);
+	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, &address, 1, ADXL_TIMEOUT);
 	/* receive 1 byte data */
-	HAL_I2C_Master_Receive(&this->i2c2, (uint16_t)ADXL_READ, &data, 1, 1000);
+	HAL_I2C_Master_Receive(&this->i2c2, (uint16_t)ADXL_READ, &data, 1, ADXL_TIMEOUT);
 	return data;
 }
 
@@ -567,15 +566,15 @@ void ADXL345::writeMultiByte(uint8_t startAddress, uint8_t* txBuf, uint8_t size)
 	for (int index = 1; index <= size; index++) {
 		pData[index] = txBuf[index - 1];
 	}
-	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, pData, size + 1, 1000);
+	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, pData, size + 1, ADXL_TIMEOUT);
 	delete[] pData;
 }
 
 void ADXL345::readMultiByte(uint8_t startAddress, uint8_t* rxBuf, uint8_t size){
 	/* first send Slave address and register address to read form */
-	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, &startAddress, 1, 1000);
+	HAL_I2C_Master_Transmit(&this->i2c2, (uint16_t)ADXL_WRITE, &startAddress, 1, ADXL_TIMEOUT);
 	/* receive multi byte data */
-	HAL_I2C_Master_Receive(&this->i2c2, (uint16_t)ADXL_READ, rxBuf, size, 1000);
+	HAL_I2C_Master_Receive(&this->i2c2, (uint16_t)ADXL_READ, rxBuf, size, ADXL_TIMEOUT);
 }
 
 } /* hv_driver namespace */
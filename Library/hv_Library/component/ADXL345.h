@@ -90,6 +90,7 @@ enum DATA_RATE{
 enum I2C_CMD{
 	ADXL_WRITE = 0xA6,
 	ADXL_READ =  0xA7,
+	ADXL_TIMEOUT = 10,	// ms, a transfer takes < 1ms at 100kHz, keeps a missing sensor from stalling boot
 };
 
 /* adxl345 axis type */
@@ -123,11 +124,11 @@ typedef struct {
   bool isDataReady;
 } IntVal_s;
 
-/*	Axis read value	*/
+/*	Axis read value	in raw LSB	*/
 typedef struct {
-	float X;
-	float Y;
-	float Z;
+	int16_t X;
+	int16_t Y;
+	int16_t Z;
 } AxisValue_s;
 
 /*	Tap read status	*/
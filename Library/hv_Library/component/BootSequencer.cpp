@@ -0,0 +1,111 @@
+/**
+  ******************************************************************************
+ * @file    BootSequencer.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Interleaved driver bring-up from resumable init steps
+  */
+//-------------------------------------------------------------------------
+#include "BootSequencer.h"
+
+namespace hv_driver {
+
+BootSequencer::BootSequencer(void) {
+	_count = 0;
+	_start = 0;
+	_isStarted = false;
+}
+
+/**
+	* @brief  register a step, first called by the next poll
+	* @retval false if the table is full
+	*/
+bool BootSequencer::add(BootStep_t step, void* arg) {
+	if (_count >= BOOT_MAX_STEP || step == NULL) {
+		return false;
+	}
+	_step[_count].step = step;
+	_step[_count].arg = arg;
+	_step[_count].due = 0;
+	_step[_count].isDone = false;
+	_count++;
+	return true;
+}
+
+/**
+	* @brief  run every step that is due
+	* @param  uint32_t now - ms
+	* @retval ms until the earliest pending step, BOOT_DONE when all finished
+	*/
+uint16_t BootSequencer::poll(uint32_t now) {
+	uint32_t next = 0;
+	bool isPending = false;
+	uint16_t wait;
+
+	if (_isStarted != true) {
+		_start = now;
+		_isStarted = true;
+		for (uint8_t i = 0; i < _count; i++) {
+			_step[i].due = now;
+		}
+	}
+	for (uint8_t i = 0; i < _count; i++) {
+		entry_s &entry = _step[i];
+		if (entry.isDone == true) {
+			continue;
+		}
+		if ((int32_t)(entry.due - now) <= 0) {
+			wait = entry.step(entry.arg);
+			if (wait == BOOT_DONE) {
+				entry.isDone = true;
+				entry.due = now;
+				continue;
+			}
+			entry.due = now + wait;
+		}
+		if (isPending != true || (int32_t)(entry.due - next) < 0) {
+			next = entry.due;
+			isPending = true;
+		}
+	}
+	if (isPending != true) {
+		return BOOT_DONE;
+	}
+	return ((int32_t)(next - now) > 0) ? (uint16_t)(next - now) : 1;
+}
+
+bool BootSequencer::isDone(void) {
+	for (uint8_t i = 0; i < _count; i++) {
+		if (_step[i].isDone != true) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+	* @brief  ms from the first poll to the end of a step
+	*/
+uint32_t BootSequencer::getDoneTime(uint8_t index) {
+	if (index >= _count || _step[index].isDone != true) {
+		return 0;
+	}
+	return _step[index].due - _start;
+}
+
+/**
+	* @brief  ms from the first poll to the end of the last step
+	*/
+uint32_t BootSequencer::getBootTime(void) {
+	uint32_t time = 0;
+
+	for (uint8_t i = 0; i < _count; i++) {
+		if (getDoneTime(i) > time) {
+			time = getDoneTime(i);
+		}
+	}
+	return time;
+}
+
+} /* hv_driver */
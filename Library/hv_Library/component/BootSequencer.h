@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+ * @file    BootSequencer.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Interleaved driver bring-up from resumable init steps
+ *
+ *	Each driver init is a step function that does what it can without
+ *	waiting and returns how long to wait before it is called again, 0 once
+ *	it is done. poll() runs the steps that are due and tells the caller how
+ *	long to sleep, so the device delays overlap and boot takes about the
+ *	longest of them instead of their sum. The caller owns the clock, no RTOS
+ *	dependency.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef BOOT_SEQUENCER_H
+#define BOOT_SEQUENCER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace hv_driver {
+
+class BootSequencer {
+public:
+	enum BOOT_PARAM {
+		BOOT_MAX_STEP 		= 6,
+		BOOT_DONE 				= 0,
+	};
+	/**
+		* @brief  init step
+		* @param  void* arg - registered argument
+		* @retval ms until the next call, BOOT_DONE when finished
+		*/
+	typedef uint16_t (*BootStep_t)(void* arg);
+public:
+	BootSequencer(void);
+
+	bool add(BootStep_t step, void* arg);
+	uint16_t poll(uint32_t now);
+	bool isDone(void);
+	uint32_t getDoneTime(uint8_t index);
+	uint32_t getBootTime(void);
+private:
+	typedef struct {
+		BootStep_t step;
+		void* arg;
+		uint32_t due;			// next call, done time once finished
+		bool isDone;
+	} entry_s;
+
+	entry_s _step[BOOT_MAX_STEP];
+	uint8_t _count;
+	uint32_t _start;
+	bool _isStarted;
+};
+
+} /* hv_driver */
+#endif /* BOOT_SEQUENCER_H */
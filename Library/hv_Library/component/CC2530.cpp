@@ -5,115 +5,523 @@
  * @version 1.0
  * @date    11-5-2015
  * @brief   CC2530 Zigbee Network Processor driver
+ *
+ *	All SPI traffic runs in the ZNP task (run). SRDY edges come from EXTI
+ *	and SPI transfers use DMA, the task sleeps on task notifications in
+ *	between. Other tasks queue one SREQ at a time and wait for the SRSP
+ *	with a timeout, AREQ frames are dispatched through a callback table.
   */
 //-------------------------------------------------------------------------
 #include "CC2530.h"
+#include "string.h"
+
+static hv_driver::CC2530* CC2530_instance = NULL;
+
+static void CC2530_srdyISR(void){
+	CC2530_instance->srdyHandler();
+}
+
+static void CC2530_dmaISR(void){
+	CC2530_instance->dmaHandler();
+}
 
 namespace hv_driver {
 
+osMutexDef(ZNP_REQ);
+osSemaphoreDef(ZNP_SRSP);
+osSemaphoreDef(ZNP_RESET);
+
 CC2530::CC2530(GPIO* rstPin, GPIO* srdyPin, GPIO* mrdyPin, SPI* spi,GPIO* ssPin){
 	this->rstPin = rstPin;
 	this->srdyPin = srdyPin;
 	this->mrdyPin = mrdyPin;
 	this->spi	= spi;
 	this->ssPin = ssPin;
-	
-	this->retCMD = NONE;
-	this->retLen = 0;
+
+	this->taskId = NULL;
+	this->reqMutex = NULL;
+	this->srspSem = NULL;
+	this->resetSem = NULL;
+	this->dmaDone = false;
+	this->reqState = REQ_IDLE;
+	this->reqSrsp = NULL;
+	this->reqFrame = NULL;
+	this->reqPtr = NULL;
+	this->reqLen = 0;
+	memset(&this->metrics, 0, sizeof(this->metrics));
 	this->isInit = false;
-}	
+	memset(this->AREQTable, 0, sizeof(this->AREQTable));
+}
 
+/**
+	* @brief  init pins, SPI DMA, SRDY interrupt and RTOS objects
+	* @param  none
+	* @retval true if done
+	* @note		call before the scheduler starts, then run() in the ZNP task
+	*					and reset() from a client task
+	*/
 bool CC2530::init(void){
+	CC2530_instance = this;
+
 	this->rstPin->initOutput(GPIO::PP, GPIO::MEDIUM);
 	this->ssPin->initOutput(GPIO::PP, GPIO::MEDIUM);
 	this->mrdyPin->initOutput(GPIO::PP, GPIO::MEDIUM);
-	this->srdyPin->initInput(GPIO::NONE);
-	
+	this->srdyPin->initExti(GPIO::EXT_INT_BOTH, GPIO::NONE, CC2530_srdyISR);
+
 	this->spi->init(SPI::MASTER, SPI::BAUDRATE_DIV32, SPI::NSS_SOFT, SPI::CPHA_2EDGE, SPI::CPOL_HIGH);
+	if(this->spi->initDMA(ZNP_IRQ_PRIORITY, CC2530_dmaISR) != true){
+		return false;
+	}
 	this->rstPin->reset();
 	this->mrdyPin->set();
 	this->ssPin->set();
-	
-	if(this->reset() != true){
+
+	this->reqMutex = osMutexCreate(osMutex(ZNP_REQ));
+	this->srspSem = osSemaphoreCreate(osSemaphore(ZNP_SRSP), 1);
+	this->resetSem = osSemaphoreCreate(osSemaphore(ZNP_RESET), 1);
+	if(this->reqMutex == NULL || this->srspSem == NULL || this->resetSem == NULL){
 		return false;
 	}
-	this->isInit = true;
+	/* binary semaphores are created available */
+	osSemaphoreWait(this->srspSem, 0);
+	osSemaphoreWait(this->resetSem, 0);
+
+	this->srdyPin->enableEXTI(ZNP_IRQ_PRIORITY);
 	return true;
 }
 
-void CC2530::Poll(void){
-	uint8_t temp[3] = {0, 0, 0};
-	
-	while(this->srdyPin->read() == 1);
-	this->mrdyPin->reset();
-	this->ssPin->reset();
-	
-	this->spi->transmit(temp, 3);
-	while(this->srdyPin->read() == 0);
-	
-	this->spi->receive(temp, 3);
-	this->spi->receive(this->retData, temp[0]);
-	this->retCMD = (COMMAND)((uint16_t)(temp[1] << 8) + (uint16_t)(temp[2]));
-	this->retLen = temp[0];
-	
-	this->mrdyPin->set();
-	this->ssPin->set();
+/**
+	* @brief  SRDY edge interrupt, wakes the ZNP task
+	*/
+void CC2530::srdyHandler(void){
+	if(this->taskId != NULL){
+		osSignalSet(this->taskId, ZNP_SIGNAL_SRDY);
+	}
+}
+
+/**
+	* @brief  SPI DMA complete interrupt, wakes the ZNP task
+	*/
+void CC2530::dmaHandler(void){
+	this->dmaDone = true;
+	if(this->taskId != NULL){
+		osSignalSet(this->taskId, ZNP_SIGNAL_DMA);
+	}
+}
+
+void CC2530::select(bool enable){
+	if(enable == true){
+		this->mrdyPin->reset();
+		this->ssPin->reset();
+	} else {
+		this->mrdyPin->set();
+		this->ssPin->set();
+	}
+}
+
+/**
+	* @brief  sleep until SRDY reaches a level
+	* @param  uint8_t level - 0 or 1
+	* @param  uint32_t timeout - in ms
+	* @retval true if level reached
+	*/
+bool CC2530::waitSrdy(uint8_t level, uint32_t timeout){
+	uint32_t start = osKernelSysTick();
+	uint32_t elapsed = 0;
+
+	while(this->srdyPin->read() != level){
+		elapsed = osKernelSysTick() - start;
+		if(elapsed >= timeout){
+			this->metrics.srdyWait += elapsed;
+			this->metrics.srdyTimeout++;
+			return false;
+		}
+		osSignalWait(ZNP_SIGNAL_SRDY, timeout - elapsed);
+		elapsed = osKernelSysTick() - start;
+	}
+	this->metrics.srdyWait += elapsed;
+	return true;
 }
 
-bool CC2530::SREQ(uint16_t cmd, uint8_t *txPtr, uint8_t len){
-	uint8_t temp[3] = {0, 0, 0};
-	
-	if((txPtr == NULL && len != 0) || (txPtr != NULL && len == 0)){
+/**
+	* @brief  one DMA transfer, the task sleeps until it completes
+	* @param  uint8_t* txPtr, uint8_t* rxPtr - NULL for dummy / discard
+	* @param  uint8_t size
+	* @retval true if done in time
+	*/
+bool CC2530::transfer(uint8_t* txPtr, uint8_t* rxPtr, uint8_t size){
+	uint32_t start = osKernelSysTick();
+
+	if(size == 0){
+		return true;
+	}
+	this->dmaDone = false;
+	this->spi->transferDMA(txPtr, rxPtr, size);
+	while(this->dmaDone != true){
+		uint32_t elapsed = osKernelSysTick() - start;
+		if(elapsed >= ZNP_SPI_TIMEOUT){
+			this->spi->abortDMA(); // the channels must not run into the next transfer
+			this->metrics.dmaTimeout++;
+			return false;
+		}
+		osSignalWait(ZNP_SIGNAL_DMA, ZNP_SPI_TIMEOUT - elapsed);
+	}
+	return true;
+}
+
+/**
+	* @brief  read a frame once SRDY went high into a pooled buffer
+	* @param  ZNPBuffer* &frame - NULL if the pool was empty, the frame is
+	*					still clocked out
+	* @retval true if done
+	*/
+bool CC2530::readFrame(ZNPBuffer* &frame){
+	uint8_t header[3];
+	uint8_t len = 0;
+
+	frame = NULL;
+	if(this->transfer(NULL, header, 3) != true){
+		return false;
+	}
+	this->metrics.bytesIn += 3 + header[0];
+	frame = ZNPBuffer::alloc(0);
+	if(frame != NULL){
+		len = (header[0] > frame->getRoom()) ? frame->getRoom() : header[0];
+		if(this->transfer(NULL, frame->append(len), len) != true){
+			frame->release();
+			frame = NULL;
+			return false;
+		}
+		frame->setCmd((uint16_t)(header[1] << 8) + (uint16_t)header[2]);
+	}
+	if(this->transfer(NULL, NULL, header[0] - len) != true){
+		if(frame != NULL){
+			frame->release();
+			frame = NULL;
+		}
 		return false;
 	}
-	this->mrdyPin->reset();
-	this->ssPin->reset();
-	while(this->srdyPin->read() == 1);
-	
-	temp[0] = len;
-	temp[1] = (uint8_t)(cmd >> 8);
-	temp[2] = (uint8_t)(cmd);
-	this->spi->transmit(temp, 3);
-	this->spi->transmit(txPtr, len);
-	while(this->srdyPin->read() == 0);
-	
-	this->spi->receive(temp, 3);
-	this->spi->receive(this->retData, temp[0]);
-	this->retCMD = (COMMAND)((uint16_t)(temp[1] << 8) + (uint16_t)(temp[2]));
-	this->retLen = temp[0];
-	
-	this->mrdyPin->set();
-	this->ssPin->set();
 	return true;
 }
 
-bool CC2530::reset(void){
-	this->rstPin->reset();
-	HAL_Delay(2);
-	this->rstPin->set();
-	HAL_Delay(5);
-	
-	this->Poll();
-	if(this->retCMD != SYS_RESET_IND){
+/**
+	* @brief  run the queued SREQ and hand the SRSP to the waiting task
+	*/
+void CC2530::processRequest(void){
+	ZNPBuffer* rxFrame = NULL;
+	bool retVal;
+
+	this->select(true);
+	retVal = this->waitSrdy(0, ZNP_SRDY_TIMEOUT);
+	if(retVal == true){
+		retVal = this->transfer(this->reqPtr, NULL, this->reqLen); // header is in the headroom
+		this->metrics.bytesOut += this->reqLen;
+	}
+	this->reqFrame->pull(ZNPBuffer::ZNP_SPI_HEADER);
+	this->reqFrame->release();
+	this->reqFrame = NULL;
+	if(retVal == true){
+		retVal = this->waitSrdy(1, ZNP_SRSP_TIMEOUT);
+	}
+	if(retVal == true){
+		retVal = this->readFrame(rxFrame);
+	}
+	this->select(false);
+
+	__disable_irq();
+	if(this->reqState == REQ_ACTIVE){
+		frame_s* srsp = this->reqSrsp;
+		if(retVal == true && rxFrame != NULL){
+			srsp->cmd = rxFrame->getCmd();
+			srsp->len = (rxFrame->getLen() > srsp->size) ? srsp->size : rxFrame->getLen();
+			memcpy(srsp->data, rxFrame->getData(), srsp->len); // SRSPs are a few bytes
+		} else {
+			srsp->cmd = NONE;
+			srsp->len = 0;
+		}
+		this->reqState = REQ_DONE;
+	} else {
+		this->reqState = REQ_IDLE; // requester gave up
+	}
+	__enable_irq();
+	if(rxFrame != NULL){
+		rxFrame->release();
+	}
+	osSemaphoreRelease(this->srspSem);
+}
+
+/**
+	* @brief  POLL the AREQ the ZNP signalled with SRDY low and dispatch it
+	*/
+void CC2530::processAREQ(void){
+	ZNPBuffer* frame = NULL;
+	uint8_t* data;
+	bool retVal;
+
+	this->select(true);
+	retVal = this->transfer(NULL, NULL, 3); // POLL command, all zero
+	this->metrics.bytesOut += 3;
+	if(retVal == true){
+		retVal = this->waitSrdy(1, ZNP_SRSP_TIMEOUT);
+	}
+	if(retVal == true){
+		retVal = this->readFrame(frame);
+	}
+	this->select(false);
+	if(retVal != true || frame == NULL){
+		this->metrics.dropAREQ += (retVal == true); // no free buffer
+		return;
+	}
+	this->metrics.areq++;
+
+	data = frame->getData();
+	if(frame->getCmd() == SYS_RESET_IND && frame->getLen() >= 6){
+		/*	get chip release ID	*/
+		this->revID.resetReason =  data[0];
+		this->revID.transportRev = data[1];
+		this->revID.productID = 	 data[2];
+		this->revID.releaseNum = 	 (uint16_t)(data[4] << 8) + (uint16_t)data[3];
+		this->revID.hwRev = 			 data[5];
+		this->isInit = true;
+		osSemaphoreRelease(this->resetSem);
+		frame->release();
+		return;
+	}
+	for(uint8_t i = 0; i < ZNP_MAX_AREQ; i++){
+		if(this->AREQTable[i].callBack != NULL && this->AREQTable[i].cmd == frame->getCmd()){
+			this->AREQTable[i].callBack(frame->getCmd(), frame, this->AREQTable[i].arg);
+			frame->release();
+			return;
+		}
+	}
+	this->metrics.dropAREQ++;
+	frame->release();
+}
+
+/**
+	* @brief  ZNP task body, never returns
+	* @param  none
+	* @retval none
+	*/
+void CC2530::run(void){
+	this->taskId = osThreadGetId();
+
+	while(1){
+		if(this->reqState == REQ_QUEUED){
+			__disable_irq();
+			if(this->reqState == REQ_QUEUED){
+				this->reqState = REQ_ACTIVE;
+			}
+			__enable_irq();
+			if(this->reqState == REQ_ACTIVE){
+				this->processRequest();
+			}
+			continue;
+		}
+		if(this->srdyPin->read() == 0){
+			this->processAREQ();
+			continue;
+		}
+		osSignalWait(ZNP_SIGNAL_ALL, osWaitForever);
+	}
+}
+
+/**
+	* @brief  send a synchronous request and wait for its response
+	* @param  uint16_t cmd
+	* @param  uint8_t *txPtr, uint8_t len - payload, copied into a pooled buffer
+	* @param  frame_s &srsp - response, data/size set by the caller
+	* @param  uint32_t timeout - in ms
+	* @retval true if a response was received
+	* @note		for short requests, build large payloads in a ZNPBuffer
+	*/
+bool CC2530::SREQ(uint16_t cmd, uint8_t *txPtr, uint8_t len, frame_s &srsp, uint32_t timeout){
+	ZNPBuffer* frame;
+	bool retVal;
+
+	if((txPtr == NULL && len != 0) || (txPtr != NULL && len == 0) || len > ZNP_MAX_PAYLOAD){
+		return false;
+	}
+	frame = ZNPBuffer::alloc(ZNPBuffer::ZNP_SPI_HEADER);
+	if(frame == NULL){
 		return false;
 	}
-	
-	/*	get chip release ID	*/
-	this->revID.resetReason =  retData[0];
-	this->revID.transportRev = retData[1];
-	this->revID.productID = 	 retData[2];
-	this->revID.releaseNum = 	 (uint16_t)(retData[4] << 8) + (uint16_t)retData[3];
-	this->revID.hwRev = 			 retData[5];
+	if(len != 0){
+		memcpy(frame->append(len), txPtr, len);
+	}
+	retVal = this->SREQ(cmd, frame, srsp, timeout);
+	frame->release();
+	return retVal;
+}
 
-	return true;
+/**
+	* @brief  send a synchronous request from a pooled buffer, no copy
+	* @param  uint16_t cmd
+	* @param  ZNPBuffer* frame - payload with ZNP_SPI_HEADER bytes of headroom
+	* @param  frame_s &srsp - response, data/size set by the caller
+	* @param  uint32_t timeout - in ms
+	* @retval true if a response was received
+	* @note		the driver holds a reference until the frame is on the wire,
+	*					getRefs() > 1 after a timeout means it is still in use
+	*/
+bool CC2530::SREQ(uint16_t cmd, ZNPBuffer* frame, frame_s &srsp, uint32_t timeout){
+	bool retVal = false;
+	bool isTimeout = false;
+	uint8_t len;
+	uint8_t* header;
+	uint32_t start;
+
+	if(frame == NULL || frame->getLen() > ZNP_MAX_PAYLOAD){
+		return false;
+	}
+	if(osMutexWait(this->reqMutex, timeout) != osOK){
+		return false;
+	}
+	/* a previous requester timed out while its frame was on the wire */
+	if(this->reqState == REQ_ABANDONED){
+		osSemaphoreWait(this->srspSem, timeout);
+	}
+	if(this->reqState != REQ_IDLE && this->reqState != REQ_DONE){
+		osMutexRelease(this->reqMutex);
+		return false;
+	}
+	len = frame->getLen();
+	header = frame->push(ZNPBuffer::ZNP_SPI_HEADER);
+	if(header == NULL){
+		osMutexRelease(this->reqMutex);
+		return false;
+	}
+	osSemaphoreWait(this->srspSem, 0); // drop a stale token
+
+	header[0] = len;
+	header[1] = (uint8_t)(cmd >> 8);
+	header[2] = (uint8_t)(cmd);
+	frame->retain();
+	this->reqFrame = frame;
+	this->reqPtr = header;
+	this->reqLen = frame->getLen();
+	this->reqSrsp = &srsp;
+	start = osKernelSysTick();
+	this->reqState = REQ_QUEUED;
+	if(this->taskId != NULL){
+		osSignalSet(this->taskId, ZNP_SIGNAL_REQUEST);
+	}
+
+	osSemaphoreWait(this->srspSem, timeout);
+	__disable_irq();
+	switch(this->reqState){
+		case REQ_DONE:
+			retVal = (srsp.cmd != NONE);
+			this->reqState = REQ_IDLE;
+			break;
+		case REQ_QUEUED:
+			this->reqState = REQ_IDLE; // never started, the frame is ours again
+			this->reqFrame = NULL;
+			frame->pull(ZNPBuffer::ZNP_SPI_HEADER);
+			frame->release();
+			isTimeout = true;
+			break;
+		case REQ_ACTIVE:
+			this->reqState = REQ_ABANDONED;
+			isTimeout = true;
+			break;
+		default:
+			break;
+	}
+	__enable_irq();
+	this->countRequest(cmd, isTimeout, osKernelSysTick() - start);
+
+	osMutexRelease(this->reqMutex);
+	return retVal;
+}
+
+/* request counters, only the reqMutex holder writes them */
+void CC2530::countRequest(uint16_t cmd, bool isTimeout, uint32_t latency){
+	cmdMetrics_s* entry = NULL;
+	uint8_t bin = 0;
+
+	for(uint8_t i = 0; i < ZNP_METRIC_CMDS; i++){
+		if(this->metrics.cmd[i].cmd == cmd || this->metrics.cmd[i].count == 0){
+			entry = &this->metrics.cmd[i];
+			entry->cmd = cmd;
+			break;
+		}
+	}
+	if(isTimeout == true){
+		this->metrics.srspTimeout++;
+	} else {
+		while(bin < ZNP_LATENCY_BINS - 1 && latency >= ((uint32_t)1 << bin)){
+			bin++;
+		}
+		this->metrics.latency[bin]++;
+	}
+	if(entry != NULL){
+		entry->count++;
+		entry->timeouts += (isTimeout == true);
+		if(isTimeout != true && latency > entry->maxLatency){
+			entry->maxLatency = latency;
+		}
+	}
+}
+
+/**
+	* @brief  copy of the link counters
+	*/
+void CC2530::getMetrics(metrics_s &metrics){
+	osMutexWait(this->reqMutex, osWaitForever);
+	__disable_irq();
+	metrics = this->metrics;
+	__enable_irq();
+	osMutexRelease(this->reqMutex);
+}
+
+void CC2530::clearMetrics(void){
+	osMutexWait(this->reqMutex, osWaitForever);
+	__disable_irq();
+	memset(&this->metrics, 0, sizeof(this->metrics));
+	__enable_irq();
+	osMutexRelease(this->reqMutex);
+}
+
+/**
+	* @brief  add an AREQ handler
+	* @param  uint16_t cmd
+	* @param  AREQCallBack_t callBack - runs in the ZNP task, must not block on ZNP
+	* @param  void* arg
+	* @retval false if the table is full
+	*/
+bool CC2530::registerAREQ(uint16_t cmd, AREQCallBack_t callBack, void* arg){
+	for(uint8_t i = 0; i < ZNP_MAX_AREQ; i++){
+		if(this->AREQTable[i].callBack == NULL || this->AREQTable[i].cmd == cmd){
+			__disable_irq();
+			this->AREQTable[i].cmd = cmd;
+			this->AREQTable[i].arg = arg;
+			this->AREQTable[i].callBack = callBack;
+			__enable_irq();
+			return true;
+		}
+	}
+	return false;
 }
 
-bool CC2530::checkNewMes(void){
-	if(this->srdyPin->read() != 0){
+/**
+	* @brief  hardware reset, wait for SYS_RESET_IND
+	* @param  none
+	* @retval true if the ZNP came back
+	* @note		call from a task, the ZNP task reads the indication
+	*/
+bool CC2530::reset(void){
+	this->isInit = false;
+	osSemaphoreWait(this->resetSem, 0);
+
+	this->rstPin->reset();
+	osDelay(2);
+	this->rstPin->set();
+
+	if(osSemaphoreWait(this->resetSem, ZNP_RESET_TIMEOUT) != osOK){
 		return false;
 	}
-	this->Poll();
-	return true;
+	return this->isInit;
 }
 
 } /* hv_driver namespace */
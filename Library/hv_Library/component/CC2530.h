@@ -9,6 +9,8 @@
 //-------------------------------------------------------------------------
 #include "GPIO.h"
 #include "SPI.h"
+#include "cmsis_os.h"
+#include "ZNPBuffer.h"
 
 #ifndef CC2530_H
 #define CC2530_H
@@ -78,6 +80,58 @@ enum COMMAND {
 	ZB_FIND_DEVICE_CONFIRM      = 0x4685,
 };
 
+enum ZNP_PARAM {
+	ZNP_MAX_PAYLOAD 		= 100,	// longer frames are truncated
+	ZNP_MAX_AREQ 				= 8,		// AREQ callback table size
+	ZNP_SRDY_TIMEOUT 		= 100,	// ms, ZNP ready after MRDY
+	ZNP_SRSP_TIMEOUT 		= 1000,	// ms, default SREQ timeout
+	ZNP_SPI_TIMEOUT 		= 10,		// ms, one DMA transfer
+	ZNP_RESET_TIMEOUT 	= 2000,	// ms, SYS_RESET_IND after reset
+	ZNP_IRQ_PRIORITY 		= 6,		// SRDY EXTI and SPI DMA, below syscall level
+	ZNP_LATENCY_BINS 		= 8,		// SREQ to SRSP, bin i below 2^i ms, last one open
+	ZNP_METRIC_CMDS 		= 8,		// SREQ commands tracked one by one
+
+	ZNP_SIGNAL_SRDY 		= 0x01,
+	ZNP_SIGNAL_REQUEST 	= 0x02,
+	ZNP_SIGNAL_DMA 			= 0x04,
+	ZNP_SIGNAL_ALL 			= 0x07,
+};
+
+typedef struct {
+	uint16_t cmd;
+	uint8_t  len;		// payload length received
+	uint8_t  size;	// data buffer size
+	uint8_t* data;
+} frame_s;
+
+/**
+	* @brief  AREQ handler, runs in the ZNP task
+	* @param  uint16_t cmd
+	* @param  ZNPBuffer* frame - payload, retain() it to use it after the call
+	* @param  void* arg - registered argument
+	*/
+typedef void (*AREQCallBack_t)(uint16_t cmd, ZNPBuffer* frame, void* arg);
+
+typedef struct {
+	uint16_t cmd;
+	uint32_t count;
+	uint32_t timeouts;
+	uint32_t maxLatency;		// ms
+} cmdMetrics_s;
+
+typedef struct {
+	uint32_t latency[ZNP_LATENCY_BINS];
+	uint32_t srspTimeout;
+	uint32_t srdyTimeout;
+	uint32_t srdyWait;			// ms spent waiting for SRDY
+	uint32_t dmaTimeout;		// SPI transfers aborted
+	uint32_t bytesOut;
+	uint32_t bytesIn;
+	uint32_t areq;
+	uint32_t dropAREQ;			// no handler or no free buffer
+	cmdMetrics_s cmd[ZNP_METRIC_CMDS];
+} metrics_s;
+
 typedef struct {
 	uint8_t resetReason;
 	uint8_t transportRev; // transport protocol revision
@@ -89,25 +143,59 @@ public:
 	CC2530(GPIO* rstPin, GPIO* srdyPin, GPIO* mrdyPin, SPI* spi,GPIO* ssPin);
 
 	bool init(void);
-	void Poll(void);
-	bool SREQ(uint16_t cmd, uint8_t *txPtr, uint8_t len);
+	void run(void);
+	bool SREQ(uint16_t cmd, uint8_t *txPtr, uint8_t len, frame_s &srsp, uint32_t timeout = ZNP_SRSP_TIMEOUT);
+	bool SREQ(uint16_t cmd, ZNPBuffer* frame, frame_s &srsp, uint32_t timeout = ZNP_SRSP_TIMEOUT);
+	bool registerAREQ(uint16_t cmd, AREQCallBack_t callBack, void* arg);
 
 	bool reset(void);
-	bool checkNewMes(void);
 	bool isZNPInit(){ return this->isInit;}
-	uint16_t getRetCMD(void){return this->retCMD;}
-	uint8_t  getRetLen(void){return this->retLen;}
-	uint8_t* getRetData(void){return this->retData;}
+	revID_s& getRevID(void){return this->revID;}
+	uint32_t getDropAREQ(void){return this->metrics.dropAREQ;}
+	void getMetrics(metrics_s &metrics);
+	void clearMetrics(void);
+
+	void srdyHandler(void);
+	void dmaHandler(void);
 private:
+	enum REQUEST_STATE {
+		REQ_IDLE, REQ_QUEUED, REQ_ACTIVE, REQ_DONE, REQ_ABANDONED
+	};
+	typedef struct {
+		uint16_t cmd;
+		AREQCallBack_t callBack;
+		void* arg;
+	} AREQEntry_s;
+
+	bool waitSrdy(uint8_t level, uint32_t timeout);
+	bool transfer(uint8_t* txPtr, uint8_t* rxPtr, uint8_t size);
+	bool readFrame(ZNPBuffer* &frame);
+	void processRequest(void);
+	void processAREQ(void);
+	void select(bool enable);
+	void countRequest(uint16_t cmd, bool isTimeout, uint32_t latency);
+
 	GPIO* rstPin;
 	GPIO* srdyPin;
 	GPIO* mrdyPin;
 	GPIO* ssPin;
 	SPI*  spi;
 
-	uint16_t retCMD;
-	uint8_t  retLen;
-	uint8_t	 retData[100];
+	osThreadId taskId;
+	osMutexId reqMutex;
+	osSemaphoreId srspSem;
+	osSemaphoreId resetSem;
+	__IO bool dmaDone;
+
+	/* single SREQ slot, owned by the reqMutex holder */
+	__IO REQUEST_STATE reqState;
+	frame_s* reqSrsp;
+	ZNPBuffer* reqFrame;		// referenced until it is on the wire
+	uint8_t* reqPtr;
+	uint8_t  reqLen;
+
+	AREQEntry_s AREQTable[ZNP_MAX_AREQ];
+	metrics_s metrics;
 
 	revID_s	 revID;
 	bool isInit;
@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+ * @file    CmdDispatcher.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Downlink command table, received Zigbee data by cmdID
+  */
+//-------------------------------------------------------------------------
+#include "CmdDispatcher.h"
+
+namespace hv_driver {
+
+CmdDispatcher::CmdDispatcher(uint16_t base) {
+	_base = base;
+	for (uint8_t i = 0; i < CMD_TABLE_SIZE; i++) {
+		_table[i].handler = NULL;
+		_table[i].arg = NULL;
+		_table[i].minLen = 0;
+	}
+	_metrics.handled = 0;
+	_metrics.rejected = 0;
+	_metrics.unknown = 0;
+}
+
+/**
+	* @brief  register a handler, before the application is registered
+	* @param  uint16_t cmdID - base .. base + CMD_TABLE_SIZE - 1
+	* @param  uint8_t minLen - shorter payloads are rejected
+	* @param  CmdHandler_t handler, void* arg
+	* @retval false if cmdID is out of range
+	*/
+bool CmdDispatcher::add(uint16_t cmdID, uint8_t minLen, CmdHandler_t handler, void* arg) {
+	uint16_t index = cmdID - _base;
+
+	if (index >= CMD_TABLE_SIZE || handler == NULL) {
+		return false;
+	}
+	_table[index].minLen = minLen;
+	_table[index].arg = arg;
+	_table[index].handler = handler;
+	return true;
+}
+
+/**
+	* @brief  registered command IDs, for the application input list
+	* @retval number of IDs written
+	*/
+uint8_t CmdDispatcher::getCmdList(uint16_t* cmdID, uint8_t max) {
+	uint8_t count = 0;
+
+	for (uint8_t i = 0; i < CMD_TABLE_SIZE && count < max; i++) {
+		if (_table[i].handler != NULL) {
+			cmdID[count++] = _base + i;
+		}
+	}
+	return count;
+}
+
+/**
+	* @brief  run the handler of a received command
+	* @retval true if handled
+	*/
+bool CmdDispatcher::dispatch(uint16_t srcAddr, uint16_t cmdID, const uint8_t* data, uint16_t len) {
+	uint16_t index = cmdID - _base;
+
+	if (index >= CMD_TABLE_SIZE || _table[index].handler == NULL) {
+		_metrics.unknown++;
+		return false;
+	}
+	entry_s &entry = _table[index];
+	if (len < entry.minLen || len > 0xFF
+			|| entry.handler(srcAddr, data, (uint8_t)len, entry.arg) != true) {
+		_metrics.rejected++;
+		return false;
+	}
+	_metrics.handled++;
+	return true;
+}
+
+} /* hv_driver */
@@ -0,0 +1,62 @@
+/**
+  ******************************************************************************
+ * @file    CmdDispatcher.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Downlink command table, received Zigbee data by cmdID
+ *
+ *	Handlers are kept in a table indexed by cmdID - base, so the downlink
+ *	command IDs are one contiguous range. The registered IDs are also the
+ *	input command list given to Z_stack::appReg. Handlers run in the ZNP
+ *	task and should only store what they received.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef CMD_DISPATCHER_H
+#define CMD_DISPATCHER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace hv_driver {
+
+class CmdDispatcher {
+public:
+	enum CMD_PARAM {
+		CMD_TABLE_SIZE 		= 8,
+	};
+	/**
+		* @brief  downlink command handler
+		* @param  uint16_t srcAddr
+		* @param  const uint8_t* data, uint8_t len - at least the registered minLen
+		* @param  void* arg - registered argument
+		* @retval false if the payload was rejected
+		*/
+	typedef bool (*CmdHandler_t)(uint16_t srcAddr, const uint8_t* data, uint8_t len, void* arg);
+	typedef struct {
+		uint32_t handled;
+		uint32_t rejected;		// short payload or refused by the handler
+		uint32_t unknown;
+	} metrics_s;
+public:
+	CmdDispatcher(uint16_t base);
+
+	bool add(uint16_t cmdID, uint8_t minLen, CmdHandler_t handler, void* arg);
+	uint8_t getCmdList(uint16_t* cmdID, uint8_t max);
+	bool dispatch(uint16_t srcAddr, uint16_t cmdID, const uint8_t* data, uint16_t len);
+	const metrics_s& getMetrics(void){return _metrics;}
+private:
+	typedef struct {
+		CmdHandler_t handler;
+		void* arg;
+		uint8_t minLen;
+	} entry_s;
+
+	uint16_t _base;
+	entry_s _table[CMD_TABLE_SIZE];
+	metrics_s _metrics;
+};
+
+} /* hv_driver */
+#endif /* CMD_DISPATCHER_H */
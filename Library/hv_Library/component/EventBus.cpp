@@ -0,0 +1,128 @@
+/**
+  ******************************************************************************
+ * @file    EventBus.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Typed application events delivered through one event group
+  */
+//-------------------------------------------------------------------------
+#include "EventBus.h"
+
+namespace hv_driver {
+
+EventBus::EventBus(void) {
+	_group = NULL;
+	_count = 0;
+	_published = 0;
+	_dropped = 0;
+	for (uint8_t i = 0; i < BUS_MAX_SUBSCRIBER; i++) {
+		_subscriber[i].thread = NULL;
+		_subscriber[i].events = EV_NONE;
+		_subscriber[i].wakeups = 0;
+	}
+}
+
+/**
+	* @brief  create the event group, once the scheduler runs
+	* @param  none
+	* @retval false if the heap is short
+	*/
+bool EventBus::init(void) {
+	if (_group == NULL) {
+		_group = xEventGroupCreate();
+	}
+	return (_group != NULL);
+}
+
+/**
+	* @brief  add events for the calling thread
+	* @param  uint32_t events - EVENT bits
+	* @retval false if the table is full
+	*/
+bool EventBus::subscribe(uint32_t events) {
+	osThreadId self = osThreadGetId();
+	int8_t index;
+
+	__disable_irq();
+	index = find(self);
+	if (index < 0 && _count < BUS_MAX_SUBSCRIBER) {
+		index = _count;
+		_subscriber[index].thread = self;
+		_subscriber[index].events = EV_NONE;
+		_subscriber[index].wakeups = 0;
+		_count++;
+	}
+	if (index >= 0) {
+		_subscriber[index].events |= events & EV_ALL;
+	}
+	__enable_irq();
+	return (index >= 0);
+}
+
+/**
+	* @brief  wake every thread subscribed to any of the events
+	* @param  uint32_t events - EVENT bits
+	* @retval none
+	*/
+void EventBus::publish(uint32_t events) {
+	EventBits_t bits = 0;
+	BaseType_t isWoken = pdFALSE;
+
+	_published++;
+	for (uint8_t i = 0; i < _count; i++) {
+		bits |= (EventBits_t)(_subscriber[i].events & events) << (i * BUS_LANE);
+	}
+	if (bits == 0 || _group == NULL) {
+		return;
+	}
+	if (__get_IPSR() != 0) {
+		if (xEventGroupSetBitsFromISR(_group, bits, &isWoken) != pdPASS) {
+			_dropped++;
+			return;
+		}
+		portYIELD_FROM_ISR(isWoken);
+	} else {
+		xEventGroupSetBits(_group, bits);
+	}
+}
+
+/**
+	* @brief  block the calling thread until a subscribed event
+	* @param  uint32_t timeout - ms, osWaitForever
+	* @retval events received, EV_NONE on timeout
+	*/
+uint32_t EventBus::wait(uint32_t timeout) {
+	int8_t index = find(osThreadGetId());
+	EventBits_t lane;
+	uint32_t events;
+
+	if (index < 0 || _group == NULL) {
+		osDelay(timeout);
+		return EV_NONE;
+	}
+	lane = (EventBits_t)_subscriber[index].events << (index * BUS_LANE);
+	events = (uint32_t)(xEventGroupWaitBits(_group, lane, pdTRUE, pdFALSE,
+				(timeout == osWaitForever) ? portMAX_DELAY : (TickType_t)timeout) & lane) >> (index * BUS_LANE);
+	if (events != EV_NONE) {
+		_subscriber[index].wakeups++;
+	}
+	return events;
+}
+
+uint32_t EventBus::getWakeups(osThreadId thread) {
+	int8_t index = find(thread);
+
+	return (index < 0) ? 0 : _subscriber[index].wakeups;
+}
+
+int8_t EventBus::find(osThreadId thread) {
+	for (uint8_t i = 0; i < _count; i++) {
+		if (_subscriber[i].thread == thread) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+} /* hv_driver */
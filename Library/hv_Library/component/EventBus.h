@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+ * @file    EventBus.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Typed application events delivered through one event group
+ *
+ *	Each subscriber owns a lane of BUS_LANE bits in a FreeRTOS event
+ *	group, one bit per event. A thread subscribes to a set of events and
+ *	blocks in wait() until one of them is published, so it only runs when
+ *	something it shows or sends has changed. Events published while the
+ *	thread is busy are merged, the payload is the current state of the
+ *	publisher (status, BPM, time), not a copy. publish() works from tasks
+ *	and from interrupts at or below the syscall priority, from an
+ *	interrupt the timer daemon sets the bits on its way out.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include "stm32f1xx.h"
+#include "cmsis_os.h"
+#include "event_groups.h"
+
+namespace hv_driver {
+
+class EventBus {
+public:
+	enum EVENT {
+		EV_NONE 				= 0x00,
+		EV_MOTION 			= 0x01,	// ADXL345 interrupt source or free fall hold changed
+		EV_HEART_RATE 	= 0x02,	// BPM reading ready
+		EV_SECOND 			= 0x04,	// RTC second tick
+		EV_MINUTE 			= 0x08,	// activity minute counted
+		EV_NETWORK 			= 0x10,	// joined or lost the network
+		EV_GYRO 				= 0x20,	// ADXL345 INT1 raised or its configuration changed
+		EV_ALL 					= 0x3F,
+	};
+	enum BUS_PARAM {
+		BUS_MAX_SUBSCRIBER = 4,
+		BUS_LANE = 6,						// bits per subscriber, 4 lanes fill the 24 event group bits
+	};
+	typedef struct {
+		osThreadId thread;
+		uint32_t events;
+		uint32_t wakeups;
+	} subscriber_s;
+public:
+	EventBus(void);
+
+	bool init(void);
+	bool subscribe(uint32_t events);
+	void publish(uint32_t events);
+	uint32_t wait(uint32_t timeout);
+	uint32_t getPublished(void){return _published;}
+	uint32_t getDropped(void){return _dropped;}
+	uint32_t getWakeups(osThreadId thread);
+private:
+	int8_t find(osThreadId thread);
+
+	EventGroupHandle_t _group;
+	subscriber_s _subscriber[BUS_MAX_SUBSCRIBER];
+	uint8_t _count;
+	uint32_t _published;
+	uint32_t _dropped;					// timer daemon queue full, from interrupts only
+};
+
+} /* hv_driver */
+#endif /* EVENT_BUS_H */
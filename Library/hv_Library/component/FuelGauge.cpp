@@ -0,0 +1,225 @@
+/**
+  ******************************************************************************
+ * @file    FuelGauge.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Battery state of charge estimator and power budget
+  */
+//-------------------------------------------------------------------------
+#include "FuelGauge.h"
+#include "string.h"
+
+/* LiPo open circuit voltage in mV at 0%, 10% .. 100% */
+static const uint16_t FG_OcvTable[hv_driver::FuelGauge::FG_OCV_POINTS] = {
+	3300, 3610, 3690, 3710, 3730, 3750, 3780, 3820, 3870, 3950, 4150
+};
+
+/* subsystem current while active in uA */
+static const uint32_t FG_CurrentTable[hv_driver::FuelGauge::SUB_NUM] = {
+	12000,	// SUB_BASE: MCU at 64MHz, accelerometer, ZNP idle
+	15000,	// SUB_LCD: panel and backlight
+	34000,	// SUB_ZIGBEE_TX: CC2530 transmitting
+	4000,		// SUB_ADC: ADC and PPG sensor LED
+};
+
+namespace hv_driver {
+
+FuelGauge::FuelGauge(void) {
+	_chargingMv = FG_CHARGING_MV;
+	init();
+}
+
+/**
+	* @brief  reset duty cycle and energy accounting
+	* @param  none
+	* @retval none
+	* @note		the base load is always active
+	*/
+void FuelGauge::init(void) {
+	memset(_isActive, 0, sizeof(_isActive));
+	memset(_onStart, 0, sizeof(_onStart));
+	memset(_onTime, 0, sizeof(_onTime));
+	memset(_chargeRem, 0, sizeof(_chargeRem));
+	memset(_chargeUc, 0, sizeof(_chargeUc));
+	memset(_charge, 0, sizeof(_charge));
+	memset(_energyRem, 0, sizeof(_energyRem));
+	memset(_energy, 0, sizeof(_energy));
+
+	_lastUpdate = Sys_getTick();
+	_isActive[SUB_BASE] = true;
+	_onStart[SUB_BASE] = _lastUpdate;
+
+	_loadCurrent = 0;
+	_socFiltered = 0;
+	_soc = 0;
+	_isCharging = false;
+	_isFirst = true;
+}
+
+/**
+	* @brief  mark a subsystem on or off for the load model
+	* @param  SUBSYSTEM sub
+	* @param  bool isActive
+	* @retval none
+	*/
+void FuelGauge::setActive(SUBSYSTEM sub, bool isActive) {
+	uint32_t primask = __get_PRIMASK();
+	uint32_t now;
+
+	if (sub >= SUB_NUM) {
+		return;
+	}
+	/* update runs in another task */
+	__disable_irq();
+	now = Sys_getTick();
+	if (_isActive[sub] != isActive) {
+		if (isActive == true) {
+			_onStart[sub] = now;
+		} else {
+			_onTime[sub] += now - _onStart[sub];
+		}
+		_isActive[sub] = isActive;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+	* @brief  terminal voltage taken as the charger connected
+	* @param  uint16_t mv - FG_CHARGING_MV by default
+	* @retval none
+	* @note		a CC/CV charger holds the cell at 4200mV +-1% once it is near
+	*					full, a resting full cell is 4150mV (FG_OcvTable). 4180mV sits
+	*					between them, a board whose charger ends lower sets its own.
+	*					The constant current phase below it is not seen as charging.
+	*/
+void FuelGauge::setChargingThreshold(uint16_t mv) {
+	_chargingMv = mv;
+}
+
+/**
+	* @brief  SoC from the OCV table, linear between points
+	* @param  uint16_t ocv - open circuit voltage in mV
+	* @retval SoC in %
+	*/
+uint8_t FuelGauge::lookupSoC(uint16_t ocv) {
+	if (ocv <= FG_OcvTable[0]) {
+		return 0;
+	}
+	if (ocv >= FG_OcvTable[FG_OCV_POINTS - 1]) {
+		return 100;
+	}
+	for (uint8_t i = 1; i < FG_OCV_POINTS; i++) {
+		if (ocv < FG_OcvTable[i]) {
+			uint16_t low = FG_OcvTable[i - 1];
+			return (uint8_t)((i - 1) * 10 + (uint32_t)(ocv - low) * 10 / (FG_OcvTable[i] - low));
+		}
+	}
+	return 100;
+}
+
+/**
+	* @brief  account the last interval and estimate SoC
+	* @param  uint16_t voltage - battery voltage under load in mV
+	* @retval none
+	* @note		call periodically (~1s), the terminal voltage is compensated
+	*					with the average load current of the interval
+	*/
+void FuelGauge::update(uint16_t voltage) {
+	uint32_t primask = __get_PRIMASK();
+	uint32_t onTimes[SUB_NUM];
+	uint32_t now, interval;
+	uint32_t loadSum = 0;
+
+	if (voltage == 0) {
+		return;
+	}
+	/* take the on times while setActive is held off */
+	__disable_irq();
+	now = Sys_getTick();
+	interval = now - _lastUpdate;
+	if (interval == 0) {
+		__set_PRIMASK(primask);
+		return;
+	}
+	_lastUpdate = now;
+	for (uint8_t i = 0; i < SUB_NUM; i++) {
+		onTimes[i] = _onTime[i];
+		if (_isActive[i] == true) {
+			onTimes[i] += now - _onStart[i];
+			_onStart[i] = now;
+		}
+		_onTime[i] = 0;
+	}
+	__set_PRIMASK(primask);
+
+	for (uint8_t i = 0; i < SUB_NUM; i++) {
+		uint32_t onTime = onTimes[i];
+		uint32_t charge;
+
+		if (onTime > FG_MAX_INTERVAL) {
+			onTime = FG_MAX_INTERVAL;
+		}
+
+		/* charge in uAh, energy in mJ, remainders carried */
+		charge = FG_CurrentTable[i] * onTime + _chargeRem[i];
+		_chargeRem[i] = charge % 1000;
+		charge /= 1000;
+		_chargeUc[i] += charge;
+		_charge[i] += _chargeUc[i] / 3600;
+		_chargeUc[i] %= 3600;
+
+		_energyRem[i] += charge * voltage;	// nJ
+		_energy[i] += _energyRem[i] / 1000000;
+		_energyRem[i] %= 1000000;
+
+		loadSum += FG_CurrentTable[i] * (onTime > interval ? interval : onTime) / 100;
+	}
+	if (interval > FG_MAX_INTERVAL) {
+		interval = FG_MAX_INTERVAL;
+	}
+	_loadCurrent = loadSum * 100 / interval;
+
+	_isCharging = (voltage >= _chargingMv);
+	if (_isCharging == true) {
+		return;	// terminal voltage says nothing about SoC while charging
+	}
+
+	/* remove the IR drop of the average load */
+	uint16_t ocv = voltage + (uint16_t)(_loadCurrent * FG_INTERNAL_RES / 1000000);
+	uint8_t soc = lookupSoC(ocv);
+
+	if (_isFirst == true) {
+		_socFiltered = (uint16_t)soc << FG_FILTER_SHIFT;
+		_isFirst = false;
+	} else {
+		_socFiltered += soc - (_socFiltered >> FG_FILTER_SHIFT);
+	}
+	_soc = (uint8_t)((_socFiltered + (1 << (FG_FILTER_SHIFT - 1))) >> FG_FILTER_SHIFT);
+}
+
+/**
+	* @brief  charge drawn by a subsystem since init
+	* @param  SUBSYSTEM sub
+	* @retval charge in uAh
+	*/
+uint32_t FuelGauge::getCharge(SUBSYSTEM sub) {
+	if (sub >= SUB_NUM) {
+		return 0;
+	}
+	return _charge[sub];
+}
+
+/**
+	* @brief  energy drawn by a subsystem since init
+	* @param  SUBSYSTEM sub
+	* @retval energy in mJ
+	*/
+uint32_t FuelGauge::getEnergy(SUBSYSTEM sub) {
+	if (sub >= SUB_NUM) {
+		return 0;
+	}
+	return _energy[sub];
+}
+
+} /* hv_driver */
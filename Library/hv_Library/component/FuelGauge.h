@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+ * @file    FuelGauge.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Battery state of charge estimator and power budget
+  */
+//-------------------------------------------------------------------------
+
+#ifndef FUEL_GAUGE_H
+#define FUEL_GAUGE_H
+
+#include "stm32f1xx.h"
+#include "MISC.h"
+
+namespace hv_driver {
+
+class FuelGauge {
+public:
+	enum SUBSYSTEM {
+		SUB_BASE, 			// MCU run and always on sensors
+		SUB_LCD,
+		SUB_ZIGBEE_TX,
+		SUB_ADC,
+		SUB_NUM
+	};
+	enum FUEL_PARAM {
+		FG_OCV_POINTS 		= 11,			// 0%..100% by 10%
+		FG_INTERNAL_RES 	= 400,		// cell + protection resistance in mOhm
+		FG_CHARGING_MV 		= 4180,		// default charging threshold, see setChargingThreshold
+		FG_MAX_INTERVAL 	= 10000,	// longest update interval accounted, in ms
+		FG_FILTER_SHIFT 	= 3,			// SoC low pass, 1/8 per update
+	};
+public:
+	FuelGauge(void);
+
+	void init(void);
+	void setActive(SUBSYSTEM sub, bool isActive);
+	void update(uint16_t voltage);
+	void setChargingThreshold(uint16_t mv);
+
+	uint8_t getSoC(void){return _soc;}
+	bool isCharging(void){return _isCharging;}
+	uint32_t getLoadCurrent(void){return _loadCurrent;}
+	uint32_t getCharge(SUBSYSTEM sub);
+	uint32_t getEnergy(SUBSYSTEM sub);
+private:
+	uint8_t lookupSoC(uint16_t ocv);
+
+	/* duty cycle tracking */
+	bool _isActive[SUB_NUM];
+	uint32_t _onStart[SUB_NUM];
+	uint32_t _onTime[SUB_NUM];		// ms on since last update
+	uint32_t _lastUpdate;
+
+	/* per subsystem accounting */
+	uint32_t _chargeRem[SUB_NUM];	// uA*ms below 1uC
+	uint32_t _chargeUc[SUB_NUM];	// uC below 1uAh
+	uint32_t _charge[SUB_NUM];		// uAh, uC wrapped after 4 days of base load
+	uint32_t _energyRem[SUB_NUM];	// nJ below 1mJ
+	uint32_t _energy[SUB_NUM];		// mJ
+
+	uint32_t _loadCurrent;				// average uA over last interval
+	uint16_t _socFiltered;				// SoC << FG_FILTER_SHIFT
+	uint8_t _soc;									// %
+	uint16_t _chargingMv;
+	bool _isCharging;
+	bool _isFirst;
+};
+
+} /* hv_driver */
+#endif /* FUEL_GAUGE_H */
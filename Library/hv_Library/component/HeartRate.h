@@ -13,6 +13,7 @@
 
 #include "stm32f1xx.h"
 #include "MISC.h"
+#include "SpscRing.h"
 	
 namespace hv_driver {	
 class HeartRate {
@@ -29,36 +30,32 @@ public:
 
 		HEART_RATE_HIGH_PULSE_TOP	= 2550,
 		HEART_RATE_HIGH_PULSE_END	= 2000,
+
+		HEART_RATE_PULSE_TRIM = 2, // pulse samples dropped at each end before averaging
+		HEART_RATE_PULSE_RING = 16, // pulse times queued for getHeartRate, power of two
 	};
 public:
-	HeartRate(ADC_TypeDef *ADCx, uint32_t ADC_CHANNEL_x, GPIO_TypeDef* sensorPort, uint16_t sensorPin);
+	HeartRate(void);
 	~HeartRate(void);
 
 	void init(void);
-	void processing(void);
+	void processSample(uint16_t adcValue, uint32_t cycle);
 	bool getHeartRate(uint8_t &ppmValue);
-	uint16_t readADC(void);
+	bool isReady(void){return _pulses.getCount() >= HEART_RATE_PULSE_SAMPLE;}
 private:
 	/*	private function	*/
-	bool getHighPulse(void);
-	bool getLowPulse(void);
+	bool getHighPulse(uint16_t adcValue);
+	bool getLowPulse(uint16_t adcValue);
+	uint32_t elapsedMs(uint32_t startCycle, uint32_t cycle);
 
 	/* private variable */
-	ADC_HandleTypeDef _AdcHandle_p;
-	uint32_t _ADC_CHANNEL_x;
-	GPIO_TypeDef* _sensorPort;
-	uint16_t _sensorPin;
-	ADC_ChannelConfTypeDef _sConf;
-	
-
-	bool _processDone; // processing done flag
 	bool _init;
 
 	uint16_t _tmpADCValue[HEART_RATE_ADC_SAMPLE];
-	uint16_t _tmpPulseValue[HEART_RATE_PULSE_SAMPLE];
-	uint8_t  _pulseValueCount;
+	SpscRing<uint32_t, HEART_RATE_PULSE_RING> _pulses; // pulse time in us, sampling interrupt to task
 	uint8_t _step;
-	uint32_t _startTick, _endTick;	
+	uint32_t _cyclePerUs;
+	uint32_t _startCycle;	
 };
 
 } /* hv_driver */
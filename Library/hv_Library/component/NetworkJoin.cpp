@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+ * @file    NetworkJoin.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Zigbee join: cached rejoin first, scan of all channels after
+  */
+//-------------------------------------------------------------------------
+#include "NetworkJoin.h"
+#include "string.h"
+
+namespace hv_driver {
+
+NetworkJoin::NetworkJoin(CC2530* znp, Z_stack* zigbee, _RTC* clock, uint32_t bkpBase) {
+	_znp = znp;
+	_zigbee = zigbee;
+	_clock = clock;
+	_bkpBase = bkpBase;
+	memset(&_app, 0, sizeof(_app));
+	_queuedPollRate = 0;
+	_responsePollRate = 0;
+	_isStartTried = false;
+	_shortAddr = 0xFFFE;
+	_joinTime = 0;
+	_attempts = 0;
+}
+
+/**
+	* @brief  what every start registers with the ZNP
+	* @param  const Z_stack::AppReg_s &app - copied
+	* @param  uint16_t queuedPollRate, uint16_t responsePollRate - ms, 0 leaves NV
+	* @retval none
+	*/
+void NetworkJoin::setApp(const Z_stack::AppReg_s &app, uint16_t queuedPollRate, uint16_t responsePollRate) {
+	_app = app;
+	_queuedPollRate = queuedPollRate;
+	_responsePollRate = responsePollRate;
+}
+
+/**
+	* @brief  last network first, on its channel only, then a scan of all channels
+	* @param  none
+	* @retval true once joined, the network is cached for the next start
+	*/
+bool NetworkJoin::start(void) {
+	uint16_t panID;
+	uint8_t channel;
+	uint32_t start = osKernelSysTick();
+	bool retVal = false;
+
+	if (loadCache(panID, channel) == true) {
+		retVal = tryJoin(panID, (uint32_t)1 << channel, JOIN_REJOIN_TIMEOUT);
+	}
+	if (retVal != true) {
+		retVal = tryJoin(0xFFFF, Z_stack::ZCD_chanList_allChannels, JOIN_START_TIMEOUT);
+	}
+	if (retVal != true) {
+		return false;
+	}
+	saveCache();
+	_joinTime = osKernelSysTick() - start;
+	return true;
+}
+
+/**
+	* @brief  start until joined, retryDelay between the attempts
+	* @param  uint32_t retryDelay - ms
+	* @param  uint32_t attempts - start() calls, 0 for no limit
+	* @retval false if every attempt failed
+	*/
+bool NetworkJoin::join(uint32_t retryDelay, uint32_t attempts) {
+	for (uint32_t i = 0; attempts == 0 || i < attempts; i++) {
+		if (i != 0) {
+			osDelay(retryDelay);
+		}
+		if (start() == true) {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool NetworkJoin::tryJoin(uint16_t panID, uint32_t chanList, uint32_t timeout) {
+	/* NV is only read on start, an earlier attempt may still be scanning */
+	if (_isStartTried == true && _znp->reset() != true) {
+		return false;
+	}
+	_isStartTried = true;
+	_attempts++;
+	if (_zigbee->init(Z_stack::ZCD_startOpt_noClear, Z_stack::ZCD_endDevice, panID, chanList) != true) {
+		return false;
+	}
+	if (_queuedPollRate != 0) {
+		_zigbee->updateConf(Z_stack::ZCD_NV_queuedPollRate, _queuedPollRate);
+	}
+	if (_responsePollRate != 0) {
+		_zigbee->updateConf(Z_stack::ZCD_NV_responsePollRate, _responsePollRate);
+	}
+	if (_zigbee->appReg(_app) != Z_stack::ZSuccess) {
+		return false;
+	}
+	if (_zigbee->startReq() != Z_stack::ZSuccess) {
+		return false;
+	}
+	return (_zigbee->waitStartConfirm(timeout) == Z_stack::Zb_success);
+}
+
+/* network parameters of the last join, a torn write fails the check */
+bool NetworkJoin::loadCache(uint16_t &panID, uint8_t &channel) {
+	uint16_t check;
+	uint16_t shortAddr;
+
+	if (_clock->readBackup(_bkpBase + JOIN_BKP_MAGIC) != JOIN_CACHE_MAGIC) {
+		return false;
+	}
+	panID = _clock->readBackup(_bkpBase + JOIN_BKP_PAN);
+	channel = (uint8_t)_clock->readBackup(_bkpBase + JOIN_BKP_CHANNEL);
+	shortAddr = _clock->readBackup(_bkpBase + JOIN_BKP_SHORT_ADDR);
+	check = _clock->readBackup(_bkpBase + JOIN_BKP_CHECK);
+	if (check != (uint16_t)(JOIN_CACHE_MAGIC ^ panID ^ channel ^ shortAddr)) {
+		return false;
+	}
+	if (channel < 11 || channel > 26 || panID == 0xFFFF) {
+		return false;
+	}
+	_shortAddr = shortAddr;
+	return true;
+}
+
+void NetworkJoin::saveCache(void) {
+	Z_stack::DeviceInfo_s info;
+	uint16_t panID;
+	uint8_t channel;
+
+	info.infoParam = Z_stack::Zb_panID;
+	if (_zigbee->getDeviceInfo(info) != Z_stack::ZSuccess) {
+		return;
+	}
+	panID = (uint16_t)(info.value[1] << 8) | info.value[0];
+	info.infoParam = Z_stack::Zb_workingChannel;
+	if (_zigbee->getDeviceInfo(info) != Z_stack::ZSuccess) {
+		return;
+	}
+	channel = info.value[0];
+	info.infoParam = Z_stack::Zb_deviceShortAddr;
+	if (_zigbee->getDeviceInfo(info) != Z_stack::ZSuccess) {
+		return;
+	}
+	_shortAddr = (uint16_t)(info.value[1] << 8) | info.value[0];
+
+	_clock->writeBackup(_bkpBase + JOIN_BKP_MAGIC, 0); // invalid while it is written
+	_clock->writeBackup(_bkpBase + JOIN_BKP_PAN, panID);
+	_clock->writeBackup(_bkpBase + JOIN_BKP_CHANNEL, channel);
+	_clock->writeBackup(_bkpBase + JOIN_BKP_SHORT_ADDR, _shortAddr);
+	_clock->writeBackup(_bkpBase + JOIN_BKP_CHECK, (uint16_t)(JOIN_CACHE_MAGIC ^ panID ^ channel ^ _shortAddr));
+	_clock->writeBackup(_bkpBase + JOIN_BKP_MAGIC, JOIN_CACHE_MAGIC);
+}
+
+} /* hv_driver */
@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+ * @file    NetworkJoin.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Zigbee join: cached rejoin first, scan of all channels after
+ *
+ *	The PAN, channel and short address of the last join are kept in RTC
+ *	backup registers, which hold over a reset and a power cycle on VBAT.
+ *	With a valid cache the ZNP is started on that channel only and gets
+ *	JOIN_REJOIN_TIMEOUT to rejoin. Otherwise, or if that fails, it is reset
+ *	and scans every channel for JOIN_START_TIMEOUT. The ZNP reads its NV
+ *	only when it starts, so every attempt after the first resets it.
+ *	Runs on the task that owns the network, blocking.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef NETWORK_JOIN_H
+#define NETWORK_JOIN_H
+
+#include "CC2530.h"
+#include "Z_stack.h"
+#include "RTC.h"
+
+namespace hv_driver {
+
+class NetworkJoin {
+public:
+	enum JOIN_PARAM {
+		JOIN_CACHE_MAGIC 		= 0xBEE1,
+		JOIN_START_TIMEOUT 	= 30000,	// ms, network formation and join
+		JOIN_REJOIN_TIMEOUT = 5000,		// ms, rejoin on the cached channel
+	};
+	enum JOIN_BKP {
+		JOIN_BKP_MAGIC = 0, JOIN_BKP_PAN, JOIN_BKP_CHANNEL, JOIN_BKP_SHORT_ADDR, JOIN_BKP_CHECK,
+		JOIN_BKP_NUM					// backup registers from bkpBase on
+	};
+public:
+	NetworkJoin(CC2530* znp, Z_stack* zigbee, _RTC* clock, uint32_t bkpBase);
+
+	void setApp(const Z_stack::AppReg_s &app, uint16_t queuedPollRate, uint16_t responsePollRate);
+	bool start(void);
+	bool join(uint32_t retryDelay, uint32_t attempts);
+	uint32_t getJoinTime(void){return _joinTime;}
+	uint16_t getShortAddr(void){return _shortAddr;}
+	uint32_t getAttempts(void){return _attempts;}
+private:
+	bool tryJoin(uint16_t panID, uint32_t chanList, uint32_t timeout);
+	bool loadCache(uint16_t &panID, uint8_t &channel);
+	void saveCache(void);
+
+	CC2530* _znp;
+	Z_stack* _zigbee;
+	_RTC* _clock;
+	uint32_t _bkpBase;
+	Z_stack::AppReg_s _app;
+	uint16_t _queuedPollRate;
+	uint16_t _responsePollRate;
+	bool _isStartTried;
+	uint16_t _shortAddr;
+	uint32_t _joinTime;		// ms the last successful start took
+	uint32_t _attempts;		// ZNP starts
+};
+
+} /* hv_driver */
+#endif /* NETWORK_JOIN_H */
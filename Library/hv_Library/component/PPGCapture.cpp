@@ -0,0 +1,172 @@
+/**
+  ******************************************************************************
+ * @file    PPGCapture.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Stream raw PPG blocks over USART1 TX DMA
+  */
+//-------------------------------------------------------------------------
+#include "PPGCapture.h"
+#include "MISC.h"
+#include "string.h"
+
+static hv_driver::PPGCapture* PPGCapture_instance = NULL;
+
+namespace hv_driver {
+
+PPGCapture::PPGCapture(void) {
+	_isRunning = false;
+	_isBusy = false;
+	_head = 0;
+	_tail = 0;
+	_dmaLen = 0;
+	_seq = 0;
+	_infoCount = 0;
+	_sampleRate = 0;
+	_dropCount = 0;
+}
+
+/**
+	* @brief  init USART1 TX only and its DMA channel (DMA1 channel 4)
+	* @param  uint32_t baudRate
+	* @param  uint16_t sampleRate - PPG sampling rate reported to the host
+	* @retval none
+	* @note		TX pin must be set as AF push pull by the caller
+	*					DMA IRQ shares the ADC scan priority so pushBlock never preempts it
+	*/
+void PPGCapture::init(uint32_t baudRate, uint16_t sampleRate) {
+	__HAL_RCC_USART1_CLK_ENABLE();
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	_sampleRate = sampleRate;
+
+	USART1->CR1 = 0;
+	USART1->CR2 = 0;
+	USART1->BRR = (HAL_RCC_GetPCLK2Freq() + baudRate / 2) / baudRate;
+	USART1->CR3 = USART_CR3_DMAT;
+	USART1->CR1 = USART_CR1_UE | USART_CR1_TE;
+
+	DMA1_Channel4->CCR = 0;
+	DMA1_Channel4->CPAR = (uint32_t)(uintptr_t)&USART1->DR;
+	DMA1->IFCR = DMA_IFCR_CGIF4;
+
+	PPGCapture_instance = this;
+	HAL_NVIC_SetPriority(DMA1_Channel4_IRQn, 4, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Channel4_IRQn);
+}
+
+/**
+	* @brief  start streaming, an info frame goes first
+	* @param  none
+	* @retval none
+	*/
+void PPGCapture::start(void) {
+	__disable_irq();
+	_infoCount = 0;
+	pushInfo();
+	_isRunning = true;
+	__enable_irq();
+}
+
+void PPGCapture::stop(void) {
+	_isRunning = false;
+}
+
+/**
+	* @brief  start DMA on the oldest contiguous part of the ring
+	*/
+void PPGCapture::kick(void) {
+	if (_isBusy == true || _head == _tail) {
+		return;
+	}
+	_dmaLen = (_head > _tail) ? (_head - _tail) : (PPG_CAPTURE_BUFFER - _tail);
+	DMA1_Channel4->CMAR = (uint32_t)(uintptr_t)&_ring[_tail];
+	DMA1_Channel4->CNDTR = _dmaLen;
+	DMA1_Channel4->CCR = DMA_CCR_MINC | DMA_CCR_DIR | DMA_CCR_TCIE | DMA_CCR_EN;
+	_isBusy = true;
+}
+
+/**
+	* @brief  copy a frame into the ring, dropped whole if it does not fit
+	*/
+void PPGCapture::push(const uint8_t* frame, uint8_t len) {
+	uint16_t used = (_head - _tail + PPG_CAPTURE_BUFFER) % PPG_CAPTURE_BUFFER;
+
+	if (PPG_CAPTURE_BUFFER - 1 - used < len) {
+		_dropCount++;	// host sees the gap from the sequence number
+		return;
+	}
+	for (uint8_t i = 0; i < len; i++) {
+		_ring[_head] = frame[i];
+		_head = (_head + 1) % PPG_CAPTURE_BUFFER;
+	}
+	kick();
+}
+
+void PPGCapture::pushInfo(void) {
+	uint8_t frame[PPGFrame::PPG_FRAME_MAX_SIZE];
+	PPGFrame::info_s info;
+
+	info.cyclePerSecond = SystemCoreClock;
+	info.sampleRate = _sampleRate;
+	info.version = PPGFrame::PPG_FRAME_VERSION;
+	push(frame, PPGFrame::encodeInfo(frame, _seq++, info));
+}
+
+/**
+	* @brief  queue a block of raw samples
+	* @param  const uint16_t* samples, uint8_t len
+	* @param  uint32_t cycle - DWT timestamp of the first sample
+	* @retval none
+	* @note		called from the ADC scan DMA interrupt
+	*/
+void PPGCapture::pushBlock(const uint16_t* samples, uint8_t len, uint32_t cycle) {
+	uint8_t frame[PPGFrame::PPG_FRAME_MAX_SIZE];
+
+	if (_isRunning != true) {
+		return;
+	}
+	if (++_infoCount >= PPG_CAPTURE_INFO_PERIOD) {
+		_infoCount = 0;
+		pushInfo();	// lets the host join a running stream
+	}
+	while (len > 0) {
+		uint8_t count = (len > PPGFrame::PPG_FRAME_MAX_SAMPLES) ? (uint8_t)PPGFrame::PPG_FRAME_MAX_SAMPLES : len;
+		push(frame, PPGFrame::encodeSamples(frame, _seq++, samples, count, cycle));
+		samples += count;
+		len -= count;
+		cycle += count * (SystemCoreClock / _sampleRate);	// first sample of the next frame
+	}
+}
+
+/**
+	* @brief  DMA1 channel 4 transfer complete
+	* @param  none
+	* @retval none
+	*/
+void PPGCapture::IRQHandler(void) {
+	if (DMA1->ISR & DMA_ISR_TCIF4) {
+		DMA1->IFCR = DMA_IFCR_CTCIF4;
+		DMA1_Channel4->CCR = 0;
+		_tail = (_tail + _dmaLen) % PPG_CAPTURE_BUFFER;
+		_isBusy = false;
+		kick();
+	}
+	if (DMA1->ISR & DMA_ISR_TEIF4) {
+		DMA1->IFCR = DMA_IFCR_CTEIF4;
+	}
+}
+
+} /* hv_driver */
+
+extern "C" {
+	void DMA1_Channel4_IRQHandler(void) {
+		uint32_t start = hv_driver::Sys_getCycle();
+
+		if (PPGCapture_instance != NULL) {
+			PPGCapture_instance->IRQHandler();
+		}
+		hv_driver::Sys_isrAccount(hv_driver::SYS_ISR_UART_DMA, start);
+	}
+}
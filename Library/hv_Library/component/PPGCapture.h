@@ -0,0 +1,53 @@
+/**
+  ******************************************************************************
+ * @file    PPGCapture.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Stream raw PPG blocks over USART1 TX DMA
+  */
+//-------------------------------------------------------------------------
+
+#ifndef PPG_CAPTURE_H
+#define PPG_CAPTURE_H
+
+#include "stm32f1xx.h"
+#include "PPGFrame.h"
+
+namespace hv_driver {
+
+class PPGCapture {
+public:
+	enum CAPTURE_PARAM {
+		PPG_CAPTURE_BUFFER 			= 512,	// TX ring in bytes
+		PPG_CAPTURE_INFO_PERIOD = 125,	// sample frames between info frames
+	};
+public:
+	PPGCapture(void);
+
+	void init(uint32_t baudRate, uint16_t sampleRate);
+	void start(void);
+	void stop(void);
+	bool isRunning(void){return _isRunning;}
+	void pushBlock(const uint16_t* samples, uint8_t len, uint32_t cycle);
+	uint32_t getDropCount(void){return _dropCount;}
+	void IRQHandler(void);
+private:
+	void push(const uint8_t* frame, uint8_t len);
+	void pushInfo(void);
+	void kick(void);
+
+	__IO bool _isRunning;
+	__IO bool _isBusy;
+	uint16_t _head;
+	uint16_t _tail;
+	uint16_t _dmaLen;
+	uint8_t _seq;
+	uint8_t _infoCount;
+	uint16_t _sampleRate;
+	uint32_t _dropCount;
+	uint8_t _ring[PPG_CAPTURE_BUFFER];
+};
+
+} /* hv_driver */
+#endif /* PPG_CAPTURE_H */
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+ * @file    PPGFrame.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   PPG capture frame encoder / stream decoder
+  */
+//-------------------------------------------------------------------------
+#include "PPGFrame.h"
+#include "string.h"
+
+namespace hv_driver {
+
+PPGFrame::PPGFrame(void) {
+	reset();
+	_lostFrames = 0;
+	_crcErrors = 0;
+}
+
+/**
+	* @brief  crc16 CCITT, one byte
+	*/
+uint16_t PPGFrame::crc16(uint16_t crc, uint8_t byte) {
+	crc ^= (uint16_t)byte << 8;
+	for (uint8_t i = 0; i < 8; i++) {
+		crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+	}
+	return crc;
+}
+
+/**
+	* @brief  write header and crc around a payload already in buff
+	* @retval frame size
+	*/
+uint8_t PPGFrame::finish(uint8_t* buff, uint8_t type, uint8_t seq, uint8_t len) {
+	uint16_t crc = 0xFFFF;
+
+	buff[0] = PPG_FRAME_SYNC;
+	buff[1] = type;
+	buff[2] = seq;
+	buff[3] = len;
+	for (uint8_t i = 1; i < PPG_FRAME_HEADER + len; i++) {
+		crc = crc16(crc, buff[i]);
+	}
+	buff[PPG_FRAME_HEADER + len] = (uint8_t)crc;
+	buff[PPG_FRAME_HEADER + len + 1] = (uint8_t)(crc >> 8);
+	return PPG_FRAME_HEADER + len + PPG_FRAME_CRC;
+}
+
+/**
+	* @brief  encode a capture info frame
+	* @param  uint8_t* buff - at least PPG_FRAME_MAX_SIZE bytes
+	* @param  uint8_t seq - frame sequence number
+	* @param  info_s &info
+	* @retval frame size
+	*/
+uint8_t PPGFrame::encodeInfo(uint8_t* buff, uint8_t seq, const info_s &info) {
+	uint8_t* payload = &buff[PPG_FRAME_HEADER];
+
+	for (uint8_t i = 0; i < 4; i++) {
+		payload[i] = (uint8_t)(info.cyclePerSecond >> (8 * i));
+	}
+	payload[4] = (uint8_t)info.sampleRate;
+	payload[5] = (uint8_t)(info.sampleRate >> 8);
+	payload[6] = info.version;
+	return finish(buff, FRAME_INFO, seq, PPG_FRAME_INFO_LEN);
+}
+
+/**
+	* @brief  encode a block of 12bit samples
+	* @param  uint8_t* buff - at least PPG_FRAME_MAX_SIZE bytes
+	* @param  uint8_t seq - frame sequence number
+	* @param  const uint16_t* samples, uint8_t count - at most PPG_FRAME_MAX_SAMPLES
+	* @param  uint32_t cycle - timestamp of the first sample
+	* @retval frame size, 0 if count too large
+	*/
+uint8_t PPGFrame::encodeSamples(uint8_t* buff, uint8_t seq, const uint16_t* samples,
+																uint8_t count, uint32_t cycle) {
+	uint8_t* payload = &buff[PPG_FRAME_HEADER];
+	uint8_t len = 5;
+
+	if (count > PPG_FRAME_MAX_SAMPLES) {
+		return 0;
+	}
+	for (uint8_t i = 0; i < 4; i++) {
+		payload[i] = (uint8_t)(cycle >> (8 * i));
+	}
+	payload[4] = count;
+	for (uint8_t i = 0; i < count; i += 2) {
+		uint16_t s0 = samples[i] & 0x0FFF;
+		uint16_t s1 = (i + 1 < count) ? (samples[i + 1] & 0x0FFF) : 0;
+		payload[len++] = (uint8_t)s0;
+		payload[len++] = (uint8_t)((s0 >> 8) | ((s1 & 0x0F) << 4));
+		if (i + 1 < count) {
+			payload[len++] = (uint8_t)(s1 >> 4);
+		}
+	}
+	return finish(buff, FRAME_SAMPLES, seq, len);
+}
+
+/**
+	* @brief  drop any partial frame and wait for sync
+	* @param  none
+	* @retval none
+	*/
+void PPGFrame::reset(void) {
+	_pos = 0;
+	_seq = 0;
+	_isSynced = false;
+	memset(&_info, 0, sizeof(_info));
+	memset(&_samples, 0, sizeof(_samples));
+}
+
+/**
+	* @brief  unpack a frame with valid crc
+	*/
+PPGFrame::FRAME_TYPE PPGFrame::decode(void) {
+	uint8_t* payload = &_buff[PPG_FRAME_HEADER];
+	uint8_t len = _buff[3];
+	uint8_t seq = _buff[2];
+
+	if (_isSynced == true && seq != (uint8_t)(_seq + 1)) {
+		_lostFrames += (uint8_t)(seq - _seq - 1);
+	}
+	_seq = seq;
+	_isSynced = true;
+
+	if (_buff[1] == FRAME_INFO && len == PPG_FRAME_INFO_LEN) {
+		_info.cyclePerSecond = 0;
+		for (uint8_t i = 0; i < 4; i++) {
+			_info.cyclePerSecond |= (uint32_t)payload[i] << (8 * i);
+		}
+		_info.sampleRate = payload[4] | ((uint16_t)payload[5] << 8);
+		_info.version = payload[6];
+		return FRAME_INFO;
+	}
+	if (_buff[1] == FRAME_SAMPLES && len >= 5) {
+		uint8_t count = payload[4];
+		if (count > PPG_FRAME_MAX_SAMPLES || len != 5 + (count * 3 + 1) / 2) {
+			return FRAME_NONE;
+		}
+		_samples.cycle = 0;
+		for (uint8_t i = 0; i < 4; i++) {
+			_samples.cycle |= (uint32_t)payload[i] << (8 * i);
+		}
+		_samples.count = count;
+		uint8_t* p = &payload[5];
+		for (uint8_t i = 0; i < count; i += 2) {
+			_samples.samples[i] = p[0] | ((uint16_t)(p[1] & 0x0F) << 8);
+			if (i + 1 < count) {
+				_samples.samples[i + 1] = (p[1] >> 4) | ((uint16_t)p[2] << 4);
+			}
+			p += 3;
+		}
+		return FRAME_SAMPLES;
+	}
+	return FRAME_NONE;
+}
+
+/**
+	* @brief  feed one received byte
+	* @param  uint8_t byte
+	* @retval frame type when a valid frame completed, FRAME_NONE otherwise
+	*/
+PPGFrame::FRAME_TYPE PPGFrame::parse(uint8_t byte) {
+	if (_pos == 0 && byte != PPG_FRAME_SYNC) {
+		return FRAME_NONE;
+	}
+	_buff[_pos++] = byte;
+
+	if (_pos == PPG_FRAME_HEADER && _buff[3] > PPG_FRAME_MAX_PAYLOAD) {
+		_pos = 0;	// bad length, hunt for the next sync
+		return FRAME_NONE;
+	}
+	if (_pos < PPG_FRAME_HEADER || _pos < PPG_FRAME_HEADER + _buff[3] + PPG_FRAME_CRC) {
+		return FRAME_NONE;
+	}
+
+	/* complete frame, check crc */
+	uint8_t len = _buff[3];
+	uint16_t crc = 0xFFFF;
+	_pos = 0;
+	for (uint8_t i = 1; i < PPG_FRAME_HEADER + len; i++) {
+		crc = crc16(crc, _buff[i]);
+	}
+	if (_buff[PPG_FRAME_HEADER + len] != (uint8_t)crc ||
+			_buff[PPG_FRAME_HEADER + len + 1] != (uint8_t)(crc >> 8)) {
+		_crcErrors++;
+		return FRAME_NONE;
+	}
+	return decode();
+}
+
+} /* hv_driver */
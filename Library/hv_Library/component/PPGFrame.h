@@ -0,0 +1,81 @@
+/**
+  ******************************************************************************
+ * @file    PPGFrame.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   PPG capture frame encoder / stream decoder
+ *
+ *	frame:	SYNC | type | seq | len | payload[len] | crc16 (lo, hi)
+ *					crc16 CCITT (0xFFFF init) over type, seq, len and payload
+ *	INFO:		cyclePerSecond (u32) | sampleRate (u16) | version (u8)
+ *	SAMPLES:cycle of first sample (u32) | count (u8) | 12bit samples packed
+ *					two per 3 bytes: s0[7:0], s0[11:8] | s1[3:0] << 4, s1[11:4]
+ *	multi byte fields are little endian. No HAL dependency, the decoder
+ *	builds on the host as well.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef PPG_FRAME_H
+#define PPG_FRAME_H
+
+#include <stdint.h>
+
+namespace hv_driver {
+
+class PPGFrame {
+public:
+	enum FRAME_PARAM {
+		PPG_FRAME_SYNC 				= 0xA5,
+		PPG_FRAME_VERSION 		= 1,
+		PPG_FRAME_MAX_SAMPLES = 16,
+		PPG_FRAME_HEADER 			= 4,
+		PPG_FRAME_CRC 				= 2,
+		PPG_FRAME_INFO_LEN 		= 7,
+		PPG_FRAME_MAX_PAYLOAD = 5 + (PPG_FRAME_MAX_SAMPLES * 3 + 1) / 2,
+		PPG_FRAME_MAX_SIZE 		= PPG_FRAME_HEADER + PPG_FRAME_MAX_PAYLOAD + PPG_FRAME_CRC,
+	};
+	enum FRAME_TYPE {
+		FRAME_NONE = 0, FRAME_INFO = 1, FRAME_SAMPLES = 2
+	};
+	typedef struct {
+		uint32_t cyclePerSecond;	// timestamp clock
+		uint16_t sampleRate;			// Hz
+		uint8_t version;
+	} info_s;
+	typedef struct {
+		uint32_t cycle;						// timestamp of samples[0]
+		uint8_t count;
+		uint16_t samples[PPG_FRAME_MAX_SAMPLES];
+	} samples_s;
+public:
+	PPGFrame(void);
+
+	static uint8_t encodeInfo(uint8_t* buff, uint8_t seq, const info_s &info);
+	static uint8_t encodeSamples(uint8_t* buff, uint8_t seq, const uint16_t* samples,
+															 uint8_t count, uint32_t cycle);
+
+	void reset(void);
+	FRAME_TYPE parse(uint8_t byte);
+	const info_s& getInfo(void){return _info;}
+	const samples_s& getSamples(void){return _samples;}
+	uint8_t getSeq(void){return _seq;}
+	uint32_t getLostFrames(void){return _lostFrames;}
+	uint32_t getCrcErrors(void){return _crcErrors;}
+private:
+	static uint16_t crc16(uint16_t crc, uint8_t byte);
+	static uint8_t finish(uint8_t* buff, uint8_t type, uint8_t seq, uint8_t len);
+	FRAME_TYPE decode(void);
+
+	uint8_t _buff[PPG_FRAME_MAX_SIZE];
+	uint8_t _pos;
+	uint8_t _seq;
+	bool _isSynced;
+	uint32_t _lostFrames;
+	uint32_t _crcErrors;
+	info_s _info;
+	samples_s _samples;
+};
+
+} /* hv_driver */
+#endif /* PPG_FRAME_H */
@@ -0,0 +1,89 @@
+/**
+  ******************************************************************************
+ * @file    Profiler.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Task CPU, stack, heap and interrupt time profiler
+  */
+//-------------------------------------------------------------------------
+#include "Profiler.h"
+#include "string.h"
+
+namespace hv_driver {
+
+/* part of whole in per mille, counters are differences so part <= whole */
+static uint16_t share(uint32_t part, uint32_t whole) {
+	uint64_t scaled;
+
+	if (whole == 0) {
+		return 0;
+	}
+	scaled = (uint64_t)part * Profiler::PROFILE_SCALE / whole;
+	return (scaled > Profiler::PROFILE_SCALE) ? (uint16_t)Profiler::PROFILE_SCALE : (uint16_t)scaled;
+}
+
+Profiler::Profiler(void) {
+	_lastCount = 0;
+	_lastTime = 0;
+	memset(_lastIsrCycle, 0, sizeof(_lastIsrCycle));
+	memset(_lastIsrCount, 0, sizeof(_lastIsrCount));
+}
+
+/**
+	* @brief  take a report covering the time since the last one
+	* @param  report_s &report
+	* @retval false if there are more than PROFILE_MAX_TASK tasks
+	* @note		the first report covers the time since the scheduler started,
+	*					call from a task at least every 71 minutes
+	*/
+bool Profiler::sample(report_s &report) {
+	uint32_t cycle[SYS_ISR_NUM], count[SYS_ISR_NUM];
+	uint32_t cyclePerUs = SystemCoreClock / 1000000;
+	uint32_t now;
+	UBaseType_t num;
+
+	num = uxTaskGetSystemState(_status, PROFILE_MAX_TASK, &now);
+	Sys_getIsrTime(cycle, count);
+	if (num == 0) {
+		return false;
+	}
+
+	report.period = now - _lastTime;
+	report.heapFree = xPortGetFreeHeapSize();
+	report.heapMin = xPortGetMinimumEverFreeHeapSize();
+	for (uint8_t i = 0; i < SYS_ISR_NUM; i++) {
+		report.isr[i] = share((cycle[i] - _lastIsrCycle[i]) / cyclePerUs, report.period);
+		report.isrCount[i] = count[i] - _lastIsrCount[i];
+		_lastIsrCycle[i] = cycle[i];
+		_lastIsrCount[i] = count[i];
+	}
+	report.taskCount = num;
+	for (uint8_t i = 0; i < num; i++) {
+		report.task[i].number = (uint8_t)_status[i].xTaskNumber;
+		report.task[i].cpu = share(_status[i].ulRunTimeCounter - lastRunTime(_status[i].xTaskNumber),
+															 report.period);
+		report.task[i].stackFree = _status[i].usStackHighWaterMark;
+	}
+
+	/* tasks deleted since drop out here */
+	for (uint8_t i = 0; i < num; i++) {
+		_lastNumber[i] = _status[i].xTaskNumber;
+		_lastTaskTime[i] = _status[i].ulRunTimeCounter;
+	}
+	_lastCount = num;
+	_lastTime = now;
+	return true;
+}
+
+/* run time at the last report, 0 for a task created since */
+uint32_t Profiler::lastRunTime(UBaseType_t number) {
+	for (uint8_t i = 0; i < _lastCount; i++) {
+		if (_lastNumber[i] == number) {
+			return _lastTaskTime[i];
+		}
+	}
+	return 0;
+}
+
+} /* hv_driver */
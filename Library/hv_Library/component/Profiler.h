@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+ * @file    Profiler.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Task CPU, stack, heap and interrupt time profiler
+ *
+ *	sample() reports what happened since the previous call: CPU share of
+ *	each task from the RTOS run time stats (us, Sys_getRunTime), share of
+ *	each interrupt group from Sys_isrAccount, the lowest free stack each
+ *	task ever had and the heap_4 free / minimum ever free. Interrupt time
+ *	is also part of the task it preempted, the task shares add up to 100%
+ *	with the interrupts on top.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "stm32f1xx.h"
+#include "cmsis_os.h"
+#include "MISC.h"
+
+namespace hv_driver {
+
+class Profiler {
+public:
+	enum PROFILE_PARAM {
+		PROFILE_MAX_TASK 	= 8,
+		PROFILE_SCALE 		= 1000,	// shares in per mille
+	};
+	typedef struct {
+		uint8_t number;				// creation order, 1 is the first task
+		uint16_t cpu;					// per mille
+		uint16_t stackFree;		// words, lowest ever
+	} task_s;
+	typedef struct {
+		uint32_t period;			// us covered
+		uint32_t heapFree;		// bytes
+		uint32_t heapMin;			// bytes, lowest ever
+		uint16_t isr[SYS_ISR_NUM];	// per mille
+		uint32_t isrCount[SYS_ISR_NUM];
+		uint8_t taskCount;
+		task_s task[PROFILE_MAX_TASK];
+	} report_s;
+public:
+	Profiler(void);
+	bool sample(report_s &report);
+private:
+	uint32_t lastRunTime(UBaseType_t number);
+
+	TaskStatus_t _status[PROFILE_MAX_TASK];
+	UBaseType_t _lastNumber[PROFILE_MAX_TASK];
+	uint32_t _lastTaskTime[PROFILE_MAX_TASK];
+	uint8_t _lastCount;
+	uint32_t _lastTime;
+	uint32_t _lastIsrCycle[SYS_ISR_NUM];
+	uint32_t _lastIsrCount[SYS_ISR_NUM];
+};
+
+} /* hv_driver */
+#endif /* PROFILER_H */
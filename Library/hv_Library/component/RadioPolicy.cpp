@@ -0,0 +1,85 @@
+/**
+  ******************************************************************************
+ * @file    RadioPolicy.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   End device poll rate and reporting period controller
+  */
+//-------------------------------------------------------------------------
+#include "RadioPolicy.h"
+
+namespace hv_driver {
+
+/* ordered from the most to the least radio time */
+const RadioPolicy::mode_s RadioPolicy::_table[MODE_NUM] = {
+	{1000,	1},		// ALERT, report at a quarter of the base period
+	{1000,	4},		// RESPONSE
+	{5000,	4},		// ACTIVE
+	{30000,	16},	// IDLE
+};
+
+RadioPolicy::RadioPolicy(void) {
+	_mode = MODE_ACTIVE;
+	_candidate = MODE_ACTIVE;
+	_candidateSince = 0;
+	_reportBase = 3000;
+	_lastUpdate = 0;
+	for (uint8_t i = 0; i < MODE_NUM; i++) {
+		_modeTime[i] = 0;
+	}
+	apply(_mode, 100);
+}
+
+/**
+	* @brief  pick the mode for the current inputs
+	* @param  const input_s &input - events as timestamps, a fall between
+	*					two calls is not missed however far apart they are
+	* @param  uint32_t now - ms
+	* @retval true if the poll rate changed and has to be written
+	*/
+bool RadioPolicy::update(const input_s &input, uint32_t now) {
+	RADIO_MODE mode;
+	uint16_t pollRate = _pollRate;
+
+	if (_lastUpdate != 0) {
+		_modeTime[_mode] += now - _lastUpdate;
+	}
+	_lastUpdate = now;
+
+	mode = select(input, now);
+	if (mode != _candidate) {
+		_candidate = mode;
+		_candidateSince = now;
+	}
+	/* faster at once, slower once it held */
+	if (mode < _mode || (mode > _mode && now - _candidateSince >= RP_SETTLE_MS)) {
+		_mode = mode;
+	}
+	apply(_mode, input.soc);
+	return (_pollRate != pollRate);
+}
+
+RadioPolicy::RADIO_MODE RadioPolicy::select(const input_s &input, uint32_t now) {
+	if (input.lastAlert != 0 && now - input.lastAlert < RP_ALERT_HOLD_MS) {
+		return MODE_ALERT;
+	}
+	if (input.lastDownlink != 0 && now - input.lastDownlink < RP_RESPONSE_HOLD_MS) {
+		return MODE_RESPONSE;
+	}
+	return (input.isActive == true) ? MODE_ACTIVE : MODE_IDLE;
+}
+
+void RadioPolicy::apply(RADIO_MODE mode, uint8_t soc) {
+	uint32_t pollRate = _table[mode].pollRate;
+	uint32_t reportPeriod = _reportBase * _table[mode].reportScale / 4;
+
+	if (soc < RP_LOW_SOC && mode != MODE_ALERT) {
+		pollRate *= 2;
+		reportPeriod *= 2;
+	}
+	_pollRate = (pollRate > 0xFFFF) ? 0xFFFF : (uint16_t)pollRate;
+	_reportPeriod = reportPeriod;
+}
+
+} /* hv_driver */
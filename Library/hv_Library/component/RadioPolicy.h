@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+ * @file    RadioPolicy.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   End device poll rate and reporting period controller
+ *
+ *	The radio mode follows the wearer: ALERT after a fall, RESPONSE while
+ *	the coordinator is talking to us, ACTIVE and IDLE from the activity
+ *	state. A low battery stretches everything but alerts. The poll rate
+ *	ends up in ZNP NV, so a slower rate is only taken after it held for
+ *	RP_SETTLE_MS, a faster one at once.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef RADIO_POLICY_H
+#define RADIO_POLICY_H
+
+#include <stdint.h>
+
+namespace hv_driver {
+
+class RadioPolicy {
+public:
+	enum RADIO_MODE {
+		MODE_ALERT, MODE_RESPONSE, MODE_ACTIVE, MODE_IDLE, MODE_NUM
+	};
+	enum POLICY_PARAM {
+		RP_ALERT_HOLD_MS 		= 60000,	// after a fall
+		RP_RESPONSE_HOLD_MS = 30000,	// after a downlink command
+		RP_SETTLE_MS 				= 60000,	// a slower mode must hold this long
+		RP_LOW_SOC 					= 20,			// %, below it poll and report half as often
+	};
+	typedef struct {
+		uint16_t pollRate;				// ms, ZCD_NV_pollRate
+		uint32_t reportScale;			// report period = base * scale / 4
+	} mode_s;
+	typedef struct {
+		bool isActive;
+		uint32_t lastAlert;				// ms timestamp of the last fall, 0 if none yet
+		uint32_t lastDownlink;		// ms timestamp, 0 if none yet
+		uint8_t soc;							// %
+	} input_s;
+public:
+	RadioPolicy(void);
+
+	void setReportBase(uint32_t period){_reportBase = period;}
+	bool update(const input_s &input, uint32_t now);
+
+	RADIO_MODE getMode(void){return _mode;}
+	uint16_t getPollRate(void){return _pollRate;}
+	uint32_t getReportPeriod(void){return _reportPeriod;}
+	uint32_t getModeTime(RADIO_MODE mode){return _modeTime[mode];}
+private:
+	RADIO_MODE select(const input_s &input, uint32_t now);
+	void apply(RADIO_MODE mode, uint8_t soc);
+
+	static const mode_s _table[MODE_NUM];
+
+	RADIO_MODE _mode;
+	RADIO_MODE _candidate;
+	uint32_t _candidateSince;
+	uint32_t _reportBase;
+	uint16_t _pollRate;
+	uint32_t _reportPeriod;
+	uint32_t _lastUpdate;
+	uint32_t _modeTime[MODE_NUM];		// ms spent per mode
+};
+
+} /* hv_driver */
+#endif /* RADIO_POLICY_H */
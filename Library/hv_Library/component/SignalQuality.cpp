@@ -0,0 +1,220 @@
+/**
+  ******************************************************************************
+ * @file    SignalQuality.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Heart Rate signal quality index
+  */
+//-------------------------------------------------------------------------
+#include "SignalQuality.h"
+#include "string.h"
+
+/* One pulse sampled at 31.25Hz: upstroke, systolic peak, dicrotic notch, decay */
+static const q15_t SQI_Template[hv_driver::SignalQuality::SQI_TEMPLATE_SIZE] = {
+	-900, -600, 300, 1500, 2048, 1700, 1100, 600, 500, 650, 500, 200, -150, -450, -700, -850
+};
+
+/**
+	* @brief  integer square root
+	* @param  uint32_t value
+	* @retval floor(sqrt(value))
+	*/
+static uint32_t SQI_isqrt(uint32_t value) {
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;
+
+	while (bit > value) {
+		bit >>= 2;
+	}
+	while (bit != 0) {
+		if (value >= root + bit) {
+			value -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+namespace hv_driver {
+
+SignalQuality::SignalQuality(void) {
+	_accumulator = 0;
+	_accCount = 0;
+	_head = 0;
+	_fill = 0;
+	_clipCount = 0;
+	_sampleCount = 0;
+	_last[0] = 0;
+	_last[1] = 0;
+	_lastCount = 0;
+	_noiseSum = 0;
+	_templateEnergy = 0;
+	_confidence = 0;
+}
+
+/**
+	* @brief  reset window and pre-compute template energy
+	* @param  none
+	* @retval none
+	*/
+void SignalQuality::init(void) {
+	_accumulator = 0;
+	_accCount = 0;
+	_head = 0;
+	_fill = 0;
+	_clipCount = 0;
+	_sampleCount = 0;
+	_lastCount = 0;
+	_noiseSum = 0;
+	_confidence = 0;
+
+	/* energy in the same q15 scale as arm_correlate_fast_q15 output */
+	_templateEnergy = 0;
+	for (uint8_t i = 0; i < SQI_TEMPLATE_SIZE; i++) {
+		_templateEnergy += ((int32_t)SQI_Template[i] * SQI_Template[i]) >> 15;
+	}
+}
+
+/**
+	* @brief  feed one raw ADC sample
+	* @param  uint16_t adcValue - 12bit sample
+	* @retval none
+	* @note		called from the sampling interrupt, only sums and counts here
+	*/
+void SignalQuality::pushSample(uint16_t adcValue) {
+	if (adcValue <= SQI_CLIP_LOW || adcValue >= SQI_CLIP_HIGH) {
+		_clipCount++;
+	}
+	_sampleCount++;
+
+	/* at 1kHz the pulse barely bends between samples, the 2nd difference
+		 is white noise with 6 times its power */
+	if (_lastCount == 2) {
+		int32_t d2 = (int32_t)adcValue - 2 * _last[0] + _last[1];
+		_noiseSum += (uint32_t)(d2 * d2);
+	} else {
+		_lastCount++;
+	}
+	_last[1] = _last[0];
+	_last[0] = adcValue;
+
+	_accumulator += adcValue;
+	_accCount++;
+	if (_accCount < SQI_DECIMATION) {
+		return;
+	}
+	/* 12bit average scaled to q15 */
+	_window[_head] = (q15_t)((_accumulator / SQI_DECIMATION) << 3);
+	_head = (_head + 1) % SQI_WINDOW_SIZE;
+	if (_fill < SQI_WINDOW_SIZE) {
+		_fill++;
+	}
+	_accumulator = 0;
+	_accCount = 0;
+}
+
+/**
+	* @brief  map a metric to 0..100 between its minimum and good level
+	*/
+uint8_t SignalQuality::score(uint16_t value, uint16_t minValue, uint16_t goodValue) {
+	if (value <= minValue) {
+		return 0;
+	}
+	if (value >= goodValue) {
+		return 100;
+	}
+	return (uint8_t)((uint32_t)(value - minValue) * 100 / (goodValue - minValue));
+}
+
+/**
+	* @brief  compute SNR, perfusion index, clipping and template correlation
+	*					of the last window
+	* @param  quality_s &quality - output metrics
+	* @retval true if a full window was available
+	* @note		call from task context, not from the sampling interrupt
+	*/
+bool SignalQuality::evaluate(quality_s &quality) {
+	q15_t mean, acVar, corrMax;
+	uint32_t clipCount, sampleCount;
+	uint64_t noiseSum;
+	uint8_t head;
+
+	if (_fill < SQI_WINDOW_SIZE) {
+		return false;
+	}
+
+	/* snapshot the ring in time order */
+	__disable_irq();
+	head = _head;
+	memcpy(_scratch, &_window[head], (SQI_WINDOW_SIZE - head) * sizeof(q15_t));
+	memcpy(&_scratch[SQI_WINDOW_SIZE - head], _window, head * sizeof(q15_t));
+	clipCount = _clipCount;
+	sampleCount = _sampleCount;
+	noiseSum = _noiseSum;
+	_clipCount = 0;
+	_sampleCount = 0;
+	_noiseSum = 0;
+	__enable_irq();
+
+	/* DC level */
+	arm_mean_q15(_scratch, SQI_WINDOW_SIZE, &mean);
+
+	/* AC part in ADC counts scaled by 2^4 */
+	for (uint8_t i = 0; i < SQI_WINDOW_SIZE; i++) {
+		int32_t ac = ((int32_t)_scratch[i] - mean) >> 3;
+		_scratch[i] = (q15_t)__SSAT(ac << 4, 16);
+	}
+	arm_var_q15(_scratch, SQI_WINDOW_SIZE, &acVar);
+
+	/* SNR: signal power vs the noise left after averaging SQI_DECIMATION
+		 raw samples, both in ADC counts^2 * 16, 3dB per doubling */
+	uint32_t signalPow = (uint32_t)acVar << 11;
+	uint32_t noisePow = (sampleCount == 0) ? 0
+		: (uint32_t)(noiseSum * 16 / (6 * SQI_DECIMATION * (uint64_t)sampleCount));
+	uint32_t ratio = signalPow / (noisePow + 1);
+	quality.snrDb = (ratio == 0) ? 0 : (uint8_t)(3 * (31 - __CLZ(ratio)));
+
+	/* perfusion index: peak to peak (2*sqrt(2)*rms) over DC, in 0.1% */
+	uint32_t rms = SQI_isqrt((uint32_t)acVar << 7);	// ADC counts
+	uint32_t dc = (uint32_t)mean >> 3;
+	quality.perfusion = (dc == 0) ? 0 : (uint16_t)(rms * 2828 / dc);
+
+	quality.clipPercent = (sampleCount == 0) ? 0 : (uint8_t)((uint64_t)clipCount * 100 / sampleCount);
+
+	/* normalised correlation against the pulse template,
+		 the first (window - template) outputs are zero padding and not written */
+	arm_correlate_fast_q15(_scratch, SQI_WINDOW_SIZE, (q15_t*)SQI_Template, SQI_TEMPLATE_SIZE, _corr);
+	corrMax = 0;
+	for (uint8_t i = SQI_WINDOW_SIZE - SQI_TEMPLATE_SIZE; i < SQI_CORR_SIZE; i++) {
+		if (_corr[i] > corrMax) {
+			corrMax = _corr[i];
+		}
+	}
+	uint32_t norm = SQI_isqrt(_templateEnergy) * SQI_isqrt((uint32_t)acVar * SQI_TEMPLATE_SIZE);
+	uint32_t correlation = (norm == 0) ? 0 : (uint32_t)corrMax * 100 / norm;
+	quality.correlation = (correlation > 100) ? 100 : (uint8_t)correlation;
+
+	/* confidence is the weakest metric, clipping rejects the window */
+	uint8_t confidence = score(quality.snrDb, SQI_SNR_MIN_DB, SQI_SNR_GOOD_DB);
+	uint8_t temp = (quality.perfusion > SQI_PI_MAX) ? 0 : score(quality.perfusion, SQI_PI_MIN, SQI_PI_GOOD);
+	if (temp < confidence) {
+		confidence = temp;
+	}
+	temp = score(quality.correlation, SQI_CORR_MIN, SQI_CORR_GOOD);
+	if (temp < confidence) {
+		confidence = temp;
+	}
+	if (quality.clipPercent > SQI_CLIP_MAX_PERCENT) {
+		confidence = 0;
+	}
+
+	quality.confidence = confidence;
+	_confidence = confidence;
+	return true;
+}
+
+} /* hv_driver */
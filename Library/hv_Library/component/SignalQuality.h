@@ -0,0 +1,77 @@
+/**
+  ******************************************************************************
+ * @file    SignalQuality.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Heart Rate signal quality index
+  */
+//-------------------------------------------------------------------------
+
+#ifndef SIGNAL_QUALITY_H
+#define SIGNAL_QUALITY_H
+
+#include "stm32f1xx.h"
+#include "arm_math.h"
+
+namespace hv_driver {
+
+class SignalQuality {
+public:
+	enum SQI_PARAM {
+		SQI_DECIMATION 		= 32,		// raw samples averaged into one window sample (1kHz -> 31.25Hz)
+		SQI_WINDOW_SIZE 	= 64,		// window samples, ~2s at 31.25Hz
+		SQI_TEMPLATE_SIZE = 16,		// pulse template length, ~0.5s
+		SQI_CORR_SIZE 		= 2 * SQI_WINDOW_SIZE - 1,
+
+		SQI_CLIP_LOW 	= 16,				// ADC value at the bottom rail
+		SQI_CLIP_HIGH = 4080,			// ADC value at the top rail
+		SQI_CLIP_MAX_PERCENT = 5,	// clipped samples allowed in a window
+
+		SQI_SNR_MIN_DB 	= 6,
+		SQI_SNR_GOOD_DB = 18,
+		SQI_PI_MIN 	= 300,				// perfusion index in 0.1%, of the amplified front end:
+		SQI_PI_GOOD = 800,				// HeartRate needs the pulse from below 750 to 2000 counts
+		SQI_PI_MAX 	= 2500,				// larger swings are motion or ambient light
+		SQI_CORR_MIN 	= 30,				// template correlation in %
+		SQI_CORR_GOOD = 80,
+	};
+
+	typedef struct {
+		uint8_t snrDb;				// signal to noise ratio in dB
+		uint16_t perfusion;		// AC/DC ratio in 0.1%
+		uint8_t clipPercent;	// samples on the ADC rail in %
+		uint8_t correlation;	// pulse template correlation in %
+		uint8_t confidence;		// combined quality 0..100
+	} quality_s;
+public:
+	SignalQuality(void);
+
+	void init(void);
+	void pushSample(uint16_t adcValue);
+	bool evaluate(quality_s &quality);
+	uint8_t getConfidence(void){return _confidence;}
+private:
+	uint8_t score(uint16_t value, uint16_t minValue, uint16_t goodValue);
+
+	/* filled from the sampling interrupt */
+	__IO uint32_t _accumulator;
+	__IO uint8_t  _accCount;
+	__IO uint8_t  _head;
+	__IO uint8_t  _fill;
+	__IO uint32_t _clipCount;			// since the last evaluate, 32bit as it may come late
+	__IO uint32_t _sampleCount;
+	__IO uint16_t _last[2];				// previous two raw samples
+	__IO uint8_t  _lastCount;
+	__IO uint64_t _noiseSum;			// squared raw 2nd differences
+	q15_t _window[SQI_WINDOW_SIZE];
+
+	/* evaluate scratch */
+	q15_t _scratch[SQI_WINDOW_SIZE];
+	q15_t _corr[SQI_CORR_SIZE];
+	uint32_t _templateEnergy;
+	uint8_t _confidence;
+};
+
+} /* hv_driver */
+#endif /* SIGNAL_QUALITY_H */
@@ -0,0 +1,383 @@
+/**
+  ******************************************************************************
+ * @file    TelemetryFrame.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Batched telemetry payload encoder / decoder
+  */
+//-------------------------------------------------------------------------
+#include "TelemetryFrame.h"
+
+namespace hv_driver {
+
+TelemetryFrame::TelemetryFrame(uint8_t* buff, uint8_t size) {
+	_buff = buff;
+	_size = size;
+	reset();
+}
+
+/**
+	* @brief  start a new frame, only the version byte
+	*/
+void TelemetryFrame::reset(void) {
+	_len = 0;
+	_record = 0;
+	_isOverflow = false;
+	if (_size > 0) {
+		_buff[_len++] = TLM_VERSION;
+	}
+}
+
+uint8_t TelemetryFrame::putVarint(uint8_t* buff, uint32_t value) {
+	uint8_t len = 0;
+
+	while (value >= 0x80) {
+		buff[len++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	buff[len++] = (uint8_t)value;
+	return len;
+}
+
+/**
+	* @brief  read a varint
+	* @retval bytes used, 0 if truncated or longer than 32 bits
+	*/
+uint8_t TelemetryFrame::getVarint(const uint8_t* buff, uint8_t len, uint32_t &value) {
+	value = 0;
+	for (uint8_t i = 0; i < len && i < 5; i++) {
+		value |= (uint32_t)(buff[i] & 0x7F) << (7 * i);
+		if ((buff[i] & 0x80) == 0) {
+			return i + 1;
+		}
+	}
+	return 0;
+}
+
+bool TelemetryFrame::open(uint8_t type) {
+	_record = _len;
+	_isOverflow = false;
+	put(type);
+	put(0);	// length, patched by close
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::put(uint8_t byte) {
+	if (_len >= _size || _len - _record - 2 >= TLM_MAX_RECORD) {
+		_isOverflow = true;
+		return false;
+	}
+	_buff[_len++] = byte;
+	return true;
+}
+
+bool TelemetryFrame::putVarint(uint32_t value) {
+	uint8_t tmp[5];
+	uint8_t len = putVarint(tmp, value);
+
+	for (uint8_t i = 0; i < len; i++) {
+		put(tmp[i]);
+	}
+	return (_isOverflow != true);
+}
+
+/* patch the record length or drop the record if it did not fit */
+void TelemetryFrame::close(void) {
+	if (_isOverflow == true) {
+		_len = _record;
+		return;
+	}
+	_buff[_record + 1] = _len - _record - 2;
+}
+
+/**
+	* @brief  add a heart rate series, delta coded
+	* @param  const hrSample_s* samples - oldest first
+	* @param  uint8_t count
+	* @retval samples encoded, the rest did not fit
+	* @note		a sample older than the one before it (RTC set back by a time
+	*					sync) closes the record, the next one starts from its absolute
+	*					time so no sample is moved in time
+	*/
+uint8_t TelemetryFrame::addHeartRate(const hrSample_s* samples, uint8_t count) {
+	uint8_t tmp[11];
+	uint8_t len;
+	uint8_t added = 0;
+	int32_t dbpm;
+	bool isFull = false;
+
+	while (added < count && isFull != true) {
+		if (open(TLM_HEART_RATE) != true) {
+			close();
+			break;
+		}
+		putVarint(samples[added].time);
+		put(samples[added].bpm);
+		put(samples[added].confidence);
+		if (_isOverflow == true) {
+			close();
+			break;
+		}
+		for (added++; added < count; added++) {
+			if (samples[added].time < samples[added - 1].time) {
+				break; // time went back, new record
+			}
+			dbpm = (int32_t)samples[added].bpm - samples[added - 1].bpm;
+
+			len = putVarint(tmp, samples[added].time - samples[added - 1].time);
+			len += putVarint(tmp + len, (uint32_t)((dbpm << 1) ^ (dbpm >> 31)));
+			tmp[len++] = samples[added].confidence;
+			if (_len + len > _size || _len + len - _record - 2 > TLM_MAX_RECORD) {
+				isFull = true;
+				break;
+			}
+			for (uint8_t i = 0; i < len; i++) {
+				put(tmp[i]);
+			}
+		}
+		close();
+	}
+	return added;
+}
+
+bool TelemetryFrame::addActivity(uint32_t actMin, uint32_t inActMin) {
+	open(TLM_ACTIVITY);
+	putVarint(actMin);
+	putVarint(inActMin);
+	close();
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::addSteps(uint32_t steps) {
+	open(TLM_STEPS);
+	putVarint(steps);
+	close();
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::addBattery(uint8_t soc, uint16_t voltage) {
+	open(TLM_BATTERY);
+	put(soc);
+	putVarint(voltage);
+	close();
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::addEvent(uint8_t code, uint32_t time) {
+	open(TLM_EVENT);
+	put(code);
+	putVarint(time);
+	close();
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::addLink(const link_s &link) {
+	open(TLM_LINK);
+	putVarint(link.srspTimeout);
+	putVarint(link.srdyTimeout);
+	putVarint(link.srdyWait);
+	putVarint(link.bytesOut);
+	putVarint(link.bytesIn);
+	putVarint(link.dropAREQ);
+	putVarint(link.retries);
+	putVarint(link.txFail);
+	putVarint(link.confirmFail);
+	for (uint8_t i = 0; i < TLM_LATENCY_BINS; i++) {
+		putVarint(link.latency[i]);
+	}
+	close();
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::addProfile(const profile_s &profile) {
+	open(TLM_PROFILE);
+	putVarint(profile.period);
+	putVarint(profile.heapFree);
+	putVarint(profile.heapMin);
+	putVarint(profile.overflow);
+	for (uint8_t i = 0; i < TLM_PROFILE_ISR; i++) {
+		putVarint(profile.isr[i]);
+	}
+	for (uint8_t i = 0; i < profile.taskCount && i < TLM_PROFILE_TASKS; i++) {
+		put(profile.task[i].number);
+		putVarint(profile.task[i].cpu);
+		putVarint(profile.task[i].stackFree);
+	}
+	close();
+	return (_isOverflow != true);
+}
+
+bool TelemetryFrame::isValid(const uint8_t* buff, uint8_t len) {
+	return (buff != 0 && len >= 1 && buff[0] == TLM_VERSION);
+}
+
+/**
+	* @brief  walk the records of a frame
+	* @param  const uint8_t* buff, uint8_t len - whole frame
+	* @param  uint8_t &offset - start at 1, advanced past the record
+	* @param  record_s &record
+	* @retval false at the end or on a malformed record
+	*/
+bool TelemetryFrame::nextRecord(const uint8_t* buff, uint8_t len, uint8_t &offset, record_s &record) {
+	uint32_t recordLen;
+	uint8_t n;
+
+	if (offset >= len) {
+		return false;
+	}
+	n = getVarint(buff + offset + 1, len - offset - 1, recordLen);
+	if (offset + 1 >= len || n == 0 || recordLen > (uint32_t)(len - offset - 1 - n)) {
+		return false;
+	}
+	record.type = buff[offset];
+	record.len = (uint8_t)recordLen;
+	record.value = buff + offset + 1 + n;
+	offset += 1 + n + record.len;
+	return true;
+}
+
+uint8_t TelemetryFrame::decodeHeartRate(const record_s &record, hrSample_s* samples, uint8_t max) {
+	uint8_t pos, n, count = 0;
+	uint32_t value, dt;
+
+	if (record.type != TLM_HEART_RATE || max == 0) {
+		return 0;
+	}
+	n = getVarint(record.value, record.len, value);
+	if (n == 0 || n + 2 > record.len) {
+		return 0;
+	}
+	samples[0].time = value;
+	samples[0].bpm = record.value[n];
+	samples[0].confidence = record.value[n + 1];
+	pos = n + 2;
+	count = 1;
+
+	while (pos < record.len && count < max) {
+		n = getVarint(record.value + pos, record.len - pos, dt);
+		if (n == 0) {
+			break;
+		}
+		pos += n;
+		n = getVarint(record.value + pos, record.len - pos, value);
+		if (n == 0 || pos + n >= record.len) {
+			break;
+		}
+		pos += n;
+		samples[count].time = samples[count - 1].time + dt;
+		samples[count].bpm = (uint8_t)(samples[count - 1].bpm + (int32_t)((value >> 1) ^ (0 - (value & 1))));
+		samples[count].confidence = record.value[pos++];
+		count++;
+	}
+	return count;
+}
+
+bool TelemetryFrame::decodeActivity(const record_s &record, uint32_t &actMin, uint32_t &inActMin) {
+	uint8_t n;
+
+	if (record.type != TLM_ACTIVITY) {
+		return false;
+	}
+	n = getVarint(record.value, record.len, actMin);
+	if (n == 0) {
+		return false;
+	}
+	return (getVarint(record.value + n, record.len - n, inActMin) != 0);
+}
+
+bool TelemetryFrame::decodeSteps(const record_s &record, uint32_t &steps) {
+	if (record.type != TLM_STEPS) {
+		return false;
+	}
+	return (getVarint(record.value, record.len, steps) != 0);
+}
+
+bool TelemetryFrame::decodeBattery(const record_s &record, uint8_t &soc, uint16_t &voltage) {
+	uint32_t value;
+
+	if (record.type != TLM_BATTERY || record.len < 2) {
+		return false;
+	}
+	soc = record.value[0];
+	if (getVarint(record.value + 1, record.len - 1, value) == 0) {
+		return false;
+	}
+	voltage = (uint16_t)value;
+	return true;
+}
+
+bool TelemetryFrame::decodeEvent(const record_s &record, uint8_t &code, uint32_t &time) {
+	if (record.type != TLM_EVENT || record.len < 2) {
+		return false;
+	}
+	code = record.value[0];
+	return (getVarint(record.value + 1, record.len - 1, time) != 0);
+}
+
+bool TelemetryFrame::decodeLink(const record_s &record, link_s &link) {
+	uint32_t* field[9 + TLM_LATENCY_BINS] = {
+		&link.srspTimeout, &link.srdyTimeout, &link.srdyWait, &link.bytesOut, &link.bytesIn,
+		&link.dropAREQ, &link.retries, &link.txFail, &link.confirmFail
+	};
+	uint8_t pos = 0, n;
+
+	if (record.type != TLM_LINK) {
+		return false;
+	}
+	for (uint8_t i = 0; i < TLM_LATENCY_BINS; i++) {
+		field[9 + i] = &link.latency[i];
+	}
+	for (uint8_t i = 0; i < 9 + TLM_LATENCY_BINS; i++) {
+		n = getVarint(record.value + pos, record.len - pos, *field[i]);
+		if (n == 0) {
+			return false;
+		}
+		pos += n;
+	}
+	return true;
+}
+
+bool TelemetryFrame::decodeProfile(const record_s &record, profile_s &profile) {
+	uint32_t value;
+	uint8_t pos = 0, n;
+
+	if (record.type != TLM_PROFILE) {
+		return false;
+	}
+	for (uint8_t i = 0; i < 4 + TLM_PROFILE_ISR; i++) {
+		n = getVarint(record.value + pos, record.len - pos, value);
+		if (n == 0) {
+			return false;
+		}
+		pos += n;
+		switch (i) {
+			case 0: profile.period = value; break;
+			case 1: profile.heapFree = value; break;
+			case 2: profile.heapMin = value; break;
+			case 3: profile.overflow = (uint16_t)value; break;
+			default: profile.isr[i - 4] = (uint16_t)value; break;
+		}
+	}
+	profile.taskCount = 0;
+	while (pos < record.len && profile.taskCount < TLM_PROFILE_TASKS) {
+		taskLoad_s &task = profile.task[profile.taskCount];
+		task.number = record.value[pos++];
+		n = getVarint(record.value + pos, record.len - pos, value);
+		if (n == 0) {
+			return false;
+		}
+		pos += n;
+		task.cpu = (uint16_t)value;
+		n = getVarint(record.value + pos, record.len - pos, value);
+		if (n == 0) {
+			return false;
+		}
+		pos += n;
+		task.stackFree = (uint16_t)value;
+		profile.taskCount++;
+	}
+	return true;
+}
+
+} /* hv_driver */
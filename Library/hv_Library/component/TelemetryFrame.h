@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+ * @file    TelemetryFrame.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Batched telemetry payload encoder / decoder
+ *
+ *	frame:	version | record ... (one Zigbee payload)
+ *	record:	type | len (varint) | value[len]
+ *	varint:	LEB128, 7 bits per byte, least significant group first
+ *	svarint:zigzag mapped varint, (n << 1) ^ (n >> 31)
+ *
+ *	HEART_RATE:	time (varint, RTC s) | bpm (u8) | confidence (u8)
+ *							{ dt (varint, s) | dbpm (svarint) | confidence (u8) } ...
+ *							a series that steps back in time goes on in a new record
+ *	ACTIVITY:		actMin (varint) | inActMin (varint)
+ *	STEPS:			steps (varint)
+ *	BATTERY:		soc (u8, %) | voltage (varint, mV)
+ *	EVENT:			code (u8) | time (varint, RTC s)
+ *	LINK:				srspTimeout | srdyTimeout | srdyWait (ms) | bytesOut | bytesIn |
+ *							dropAREQ | retries | txFail | confirmFail | latency[8], all varint
+ *	PROFILE:		period (varint, ms) | heapFree | heapMin (varint, bytes) |
+ *							overflow (varint) | isr[5] (varint, per mille)
+ *							{ task (u8) | cpu (varint, per mille) | stackFree (varint, words) } ...
+ *	Unknown record types are skipped by the decoder. No HAL dependency, the
+ *	decoder builds on the host as well.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <stdint.h>
+
+namespace hv_driver {
+
+class TelemetryFrame {
+public:
+	enum TLM_PARAM {
+		TLM_VERSION 		= 1,
+		TLM_MAX_SIZE 		= 80,		// fits one TxWindow slot
+		TLM_MAX_RECORD 	= 127,	// record length always takes one varint byte
+		TLM_LATENCY_BINS = 8,		// CC2530::ZNP_LATENCY_BINS
+		TLM_PROFILE_ISR 	= 5,		// SYS_ISR_NUM
+		TLM_PROFILE_TASKS = 8,		// Profiler::PROFILE_MAX_TASK
+	};
+	enum TLM_TYPE {
+		TLM_NONE 				= 0x00,
+		TLM_HEART_RATE 	= 0x01,
+		TLM_ACTIVITY 		= 0x02,
+		TLM_STEPS 			= 0x03,
+		TLM_BATTERY 		= 0x04,
+		TLM_EVENT 			= 0x05,
+		TLM_LINK 				= 0x06,
+		TLM_PROFILE 		= 0x07,
+	};
+	enum TLM_EVENT_CODE {
+		TLM_EVENT_FALL 	= 0x01,
+	};
+	typedef struct {
+		uint32_t time;				// s since 1 January 2000, network synced RTC
+		uint8_t bpm;
+		uint8_t confidence;		// %
+	} hrSample_s;
+	typedef struct {
+		uint32_t srspTimeout;
+		uint32_t srdyTimeout;
+		uint32_t srdyWait;		// ms
+		uint32_t bytesOut;
+		uint32_t bytesIn;
+		uint32_t dropAREQ;
+		uint32_t retries;
+		uint32_t txFail;
+		uint32_t confirmFail;
+		uint32_t latency[TLM_LATENCY_BINS];
+	} link_s;
+	typedef struct {
+		uint8_t number;				// task creation order
+		uint16_t cpu;					// per mille
+		uint16_t stackFree;		// words, lowest ever
+	} taskLoad_s;
+	typedef struct {
+		uint32_t period;			// ms
+		uint32_t heapFree;
+		uint32_t heapMin;
+		uint16_t overflow;		// first two name characters of the task that
+													// overflowed its stack before the last reset
+		uint16_t isr[TLM_PROFILE_ISR];
+		uint8_t taskCount;
+		taskLoad_s task[TLM_PROFILE_TASKS];
+	} profile_s;
+	typedef struct {
+		uint8_t type;
+		uint8_t len;
+		const uint8_t* value;
+	} record_s;
+public:
+	TelemetryFrame(uint8_t* buff, uint8_t size);
+
+	/* encoder */
+	void reset(void);
+	uint8_t addHeartRate(const hrSample_s* samples, uint8_t count);
+	bool addActivity(uint32_t actMin, uint32_t inActMin);
+	bool addSteps(uint32_t steps);
+	bool addBattery(uint8_t soc, uint16_t voltage);
+	bool addEvent(uint8_t code, uint32_t time);
+	bool addLink(const link_s &link);
+	bool addProfile(const profile_s &profile);
+	uint8_t getLength(void){return _len;}
+	bool isEmpty(void){return _len <= 1;}
+
+	/* decoder */
+	static bool isValid(const uint8_t* buff, uint8_t len);
+	static bool nextRecord(const uint8_t* buff, uint8_t len, uint8_t &offset, record_s &record);
+	static uint8_t decodeHeartRate(const record_s &record, hrSample_s* samples, uint8_t max);
+	static bool decodeActivity(const record_s &record, uint32_t &actMin, uint32_t &inActMin);
+	static bool decodeSteps(const record_s &record, uint32_t &steps);
+	static bool decodeBattery(const record_s &record, uint8_t &soc, uint16_t &voltage);
+	static bool decodeEvent(const record_s &record, uint8_t &code, uint32_t &time);
+	static bool decodeLink(const record_s &record, link_s &link);
+	static bool decodeProfile(const record_s &record, profile_s &profile);
+
+	static uint8_t putVarint(uint8_t* buff, uint32_t value);
+	static uint8_t getVarint(const uint8_t* buff, uint8_t len, uint32_t &value);
+private:
+	bool open(uint8_t type);
+	bool put(uint8_t byte);
+	bool putVarint(uint32_t value);
+	void close(void);
+
+	uint8_t* _buff;
+	uint8_t _size;
+	uint8_t _len;
+	uint8_t _record;		// start of the open record
+	bool _isOverflow;
+};
+
+} /* hv_driver */
+#endif /* TELEMETRY_FRAME_H */
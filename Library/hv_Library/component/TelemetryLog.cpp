@@ -0,0 +1,373 @@
+/**
+  ******************************************************************************
+ * @file    TelemetryLog.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Store and forward log for telemetry the network did not take
+  */
+//-------------------------------------------------------------------------
+#include "TelemetryLog.h"
+#include "string.h"
+
+namespace hv_driver {
+
+osMutexDef(TLM_LOG);
+
+TelemetryLog::TelemetryLog(Flash* flash, Flash* alertFlash) {
+	_mutex = NULL;
+	_eraseCallBack = NULL;
+	_ramCount = 0;
+	_seq = 0;
+	memset(&_log, 0, sizeof(_log));
+	memset(&_alerts, 0, sizeof(_alerts));
+	_log.flash = flash;
+	_alerts.flash = alertFlash;
+	_alerts.isKept = true;
+	memset(_ram, 0, sizeof(_ram));
+	memset(&_metrics, 0, sizeof(_metrics));
+}
+
+/**
+	* @brief  find the records left in flash by the last run
+	* @retval false if the mutex or a page erase failed, an erase that is
+	*					not allowed yet is left to the first store
+	*/
+bool TelemetryLog::init(void) {
+	_mutex = osMutexCreate(osMutex(TLM_LOG));
+	if (_mutex == NULL || _log.flash->getPages() < 2 || _alerts.flash->getPages() < 1) {
+		return false;
+	}
+	return (initArea(_log) == true && initArea(_alerts) == true);
+}
+
+/**
+	* @brief  keep a record until the network takes it
+	* @retval false if it was an alert and the alert pages and RAM are full
+	*					of alerts, or it needed a page erase that is not allowed now
+	*/
+bool TelemetryLog::store(const record_s &record) {
+	bool isAlert = (record.prio == TxScheduler::PRIO_ALERT);
+	bool isDeferred = false;
+	int8_t index = -1;
+	bool retVal = true;
+
+	if (record.len > LOG_PAYLOAD) {
+		return false;
+	}
+	osMutexWait(_mutex, osWaitForever);
+	if (isAlert == true) {
+		if (isPageDue(_alerts, record.len) == true && isEraseAllowed() != true) {
+			isDeferred = true; // RAM may still have room
+		} else if (writeFlash(_alerts, record) == true) {
+			_metrics.stored++;
+			osMutexRelease(_mutex);
+			return true;
+		}
+	}
+	for (uint8_t i = 0; i < LOG_RAM_SLOTS; i++) {
+		if (_ram[i].isUsed != true) {
+			index = i;
+			break;
+		}
+	}
+	/* full, the oldest non alert record makes room */
+	if (index < 0) {
+		index = oldestRam(false);
+		if (index >= 0 && isPageDue(_log, _ram[index].record.len) == true && isEraseAllowed() != true) {
+			index = -1; // kept, not evicted
+			isDeferred = true;
+		} else if (index >= 0) {
+			if (writeFlash(_log, _ram[index].record) == true) {
+				_metrics.spilled++;
+			} else {
+				_metrics.evicted++;
+			}
+			_ram[index].isUsed = false;
+			_ramCount--;
+		}
+	}
+	if (index >= 0) {
+		_ram[index].record = record;
+		_ram[index].seq = _seq++;
+		_ram[index].isUsed = true;
+		_ramCount++;
+	} else if (isDeferred == true || (isAlert != true && isPageDue(_log, record.len) == true
+																		&& isEraseAllowed() != true)) {
+		_metrics.deferred++;
+		retVal = false;
+	} else if (isAlert != true) {
+		retVal = writeFlash(_log, record); // RAM holds only alerts
+	} else {
+		_metrics.rejected++;
+		retVal = false;
+	}
+	_metrics.stored += (retVal == true);
+	osMutexRelease(_mutex);
+	return retVal;
+}
+
+/**
+	* @brief  remove the next record to send
+	* @retval false if the log is empty
+	*/
+bool TelemetryLog::take(record_s &record) {
+	int8_t index = -1;
+	bool retVal = false;
+
+	osMutexWait(_mutex, osWaitForever);
+	if (_alerts.count != 0) {
+		retVal = readFlash(_alerts, record);
+	}
+	if (retVal != true) {
+		index = oldestRam(true);
+	}
+	if (retVal != true && index < 0 && _log.count != 0) {
+		retVal = readFlash(_log, record);
+	}
+	if (retVal != true && index < 0) {
+		index = oldestRam(false);
+	}
+	if (index >= 0) {
+		record = _ram[index].record;
+		_ram[index].isUsed = false;
+		_ramCount--;
+		retVal = true;
+	}
+	_metrics.taken += (retVal == true);
+	osMutexRelease(_mutex);
+	return retVal;
+}
+
+/**
+	* @brief  network down, move what is queued into the log
+	* @param  TxScheduler &scheduler
+	* @retval false if a record was refused, it is queued again
+	*/
+bool TelemetryLog::hold(TxScheduler &scheduler) {
+	record_s record;
+
+	while (scheduler.take(record.prio, record.dstAddr, record.cmdID, record.data, record.len) == true) {
+		if (store(record) != true) {
+			scheduler.post(record.prio, record.dstAddr, record.cmdID, record.data, record.len);
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+	* @brief  network back, hand a few records to the scheduler behind
+	*					anything queued meanwhile
+	* @param  TxScheduler &scheduler
+	* @param  uint8_t batch - records at most
+	* @retval records handed over
+	*/
+uint8_t TelemetryLog::drain(TxScheduler &scheduler, uint8_t batch) {
+	record_s record;
+	TxScheduler::PRIORITY prio;
+	uint8_t count = 0;
+
+	while (count < batch) {
+		if (scheduler.getDepth() >= TxScheduler::TX_SCHED_POOL / 2 || take(record) != true) {
+			break;
+		}
+		prio = (record.prio == TxScheduler::PRIO_ALERT) ? TxScheduler::PRIO_ALERT : TxScheduler::PRIO_LOW;
+		if (scheduler.post(prio, record.dstAddr, record.cmdID, record.data, record.len) != true) {
+			store(record);
+			break;
+		}
+		count++;
+	}
+	return count;
+}
+
+/* a record of len does not fit the write page, writing it erases one */
+bool TelemetryLog::isPageDue(area_s &area, uint8_t len) {
+	return (area.writeOffset + recordSize(len) > Flash::FLASH_PAGE);
+}
+
+int8_t TelemetryLog::oldestRam(bool isAlert) {
+	int8_t oldest = -1;
+
+	for (uint8_t i = 0; i < LOG_RAM_SLOTS; i++) {
+		if (_ram[i].isUsed != true || (_ram[i].record.prio == TxScheduler::PRIO_ALERT) != isAlert) {
+			continue;
+		}
+		if (oldest < 0 || (int32_t)(_ram[i].seq - _ram[oldest].seq) < 0) {
+			oldest = i;
+		}
+	}
+	return oldest;
+}
+
+/* read and write positions and the records not taken of one area */
+bool TelemetryLog::initArea(area_s &area) {
+	Flash* flash = area.flash;
+	bool isFound = false;
+	uint16_t seq, offset, head;
+
+	/* newest page is the one with the highest sequence */
+	for (uint8_t page = 0; page < flash->getPages(); page++) {
+		if (isPageValid(area, page) != true) {
+			continue;
+		}
+		seq = flash->read(pageOffset(page) + 2);
+		if (isFound != true || (int16_t)(seq - area.pageSeq) > 0) {
+			area.writePage = page;
+			area.pageSeq = seq;
+			isFound = true;
+		}
+	}
+	if (isFound != true) {
+		area.writePage = flash->getPages() - 1;
+		area.writeOffset = Flash::FLASH_PAGE; // no page set up yet
+		area.readPage = 0;
+		area.readOffset = LOG_PAGE_HEADER;
+		return (isEraseAllowed() != true || nextPage(area) == true);
+	}
+
+	/* oldest is the first valid page after the newest one */
+	area.readPage = area.writePage;
+	for (uint8_t i = 1; i < flash->getPages(); i++) {
+		uint8_t page = (area.writePage + i) % flash->getPages();
+		if (isPageValid(area, page) == true) {
+			area.readPage = page;
+			break;
+		}
+	}
+	area.readOffset = LOG_PAGE_HEADER;
+
+	/* count what is still pending and find the end of the newest page */
+	for (uint8_t page = area.readPage; ; page = (page + 1) % flash->getPages()) {
+		offset = LOG_PAGE_HEADER;
+		if (isPageValid(area, page) == true) {
+			while (offset + LOG_RECORD_HEADER <= Flash::FLASH_PAGE) {
+				head = flash->read(pageOffset(page) + offset);
+				if (head == 0xFFFF) {
+					break;
+				}
+				if (flash->read(pageOffset(page) + offset + 6) == 0xFFFF) {
+					area.count++;
+				}
+				offset += recordSize((uint8_t)head);
+			}
+		}
+		if (page == area.writePage) {
+			area.writeOffset = offset;
+			break;
+		}
+	}
+	return true;
+}
+
+/* append at the write position, a failed write skips to a new page */
+bool TelemetryLog::writeFlash(area_s &area, const record_s &record) {
+	uint16_t size = recordSize(record.len);
+	uint32_t offset;
+
+	for (uint8_t attempt = 0; attempt < 2; attempt++) {
+		if (area.writeOffset + size > Flash::FLASH_PAGE && nextPage(area) != true) {
+			return false;
+		}
+		offset = pageOffset(area.writePage) + area.writeOffset;
+		area.writeOffset += size;
+		if (area.flash->program(offset + 2, record.dstAddr) == true
+				&& area.flash->program(offset + 4, record.cmdID) == true
+				&& area.flash->program(offset + LOG_RECORD_HEADER, record.data, record.len) == true
+				&& area.flash->program(offset, (uint16_t)(record.prio << 8 | record.len)) == true) {
+			area.count++;
+			return true;
+		}
+		area.writeOffset = Flash::FLASH_PAGE;
+	}
+	return false;
+}
+
+/* oldest pending record, marked as taken */
+bool TelemetryLog::readFlash(area_s &area, record_s &record) {
+	uint32_t offset;
+	uint16_t head;
+
+	while (area.count != 0) {
+		offset = pageOffset(area.readPage) + area.readOffset;
+		head = (area.readOffset + LOG_RECORD_HEADER <= Flash::FLASH_PAGE) ? area.flash->read(offset) : 0xFFFF;
+		if (head == 0xFFFF || (uint8_t)head > LOG_PAYLOAD) {
+			if (area.readPage == area.writePage) {
+				area.count = 0; // count and content disagree
+				return false;
+			}
+			area.readPage = (area.readPage + 1) % area.flash->getPages();
+			area.readOffset = LOG_PAGE_HEADER;
+			continue;
+		}
+		area.readOffset += recordSize((uint8_t)head);
+		if (area.flash->read(offset + 6) != 0xFFFF) {
+			continue; // taken before a reset
+		}
+		record.len = (uint8_t)head;
+		record.prio = (TxScheduler::PRIORITY)(head >> 8);
+		record.dstAddr = area.flash->read(offset + 2);
+		record.cmdID = area.flash->read(offset + 4);
+		area.flash->read(offset + LOG_RECORD_HEADER, record.data, record.len);
+		area.flash->program(offset + 6, (uint16_t)0x0000);
+		area.count--;
+		return true;
+	}
+	return false;
+}
+
+/* erase the next page for writing, evicting its records if it is the
+	 oldest, or refusing to if the area keeps its records */
+bool TelemetryLog::nextPage(area_s &area) {
+	uint8_t next = (area.writePage + 1) % area.flash->getPages();
+	uint16_t offset = LOG_PAGE_HEADER;
+	uint16_t head;
+
+	if (isEraseAllowed() != true) {
+		return false;
+	}
+	if (next == area.readPage && area.count != 0) {
+		if (area.isKept == true) {
+			return false;
+		}
+		while (offset + LOG_RECORD_HEADER <= Flash::FLASH_PAGE) {
+			head = area.flash->read(pageOffset(next) + offset);
+			if (head == 0xFFFF) {
+				break;
+			}
+			if (area.flash->read(pageOffset(next) + offset + 6) == 0xFFFF && area.count != 0) {
+				area.count--;
+				_metrics.evicted++;
+			}
+			offset += recordSize((uint8_t)head);
+		}
+	}
+	if (next == area.readPage) {
+		area.readPage = (next + 1) % area.flash->getPages();
+		area.readOffset = LOG_PAGE_HEADER;
+	}
+
+	area.writePage = next;
+	area.writeOffset = Flash::FLASH_PAGE; // unusable until it is set up
+	if (area.flash->erase(next) != true) {
+		return false;
+	}
+	area.pageSeq++;
+	if (area.flash->program(pageOffset(next), (uint16_t)LOG_MAGIC) != true
+			|| area.flash->program(pageOffset(next) + 2, area.pageSeq) != true) {
+		return false;
+	}
+	area.writeOffset = LOG_PAGE_HEADER;
+	if (area.count == 0) {
+		area.readPage = next; // nothing older to read
+		area.readOffset = LOG_PAGE_HEADER;
+	}
+	return true;
+}
+
+bool TelemetryLog::isPageValid(area_s &area, uint8_t page) {
+	return (area.flash->read(pageOffset(page)) == LOG_MAGIC);
+}
+
+} /* hv_driver */
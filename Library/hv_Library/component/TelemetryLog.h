@@ -0,0 +1,114 @@
+/**
+  ******************************************************************************
+ * @file    TelemetryLog.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Store and forward log for telemetry the network did not take
+ *
+ *	Alerts are written to flash pages of their own at once, which are
+ *	never evicted: when they are full of alerts not yet taken the next
+ *	alert waits in RAM, and is refused once RAM holds only alerts. Other
+ *	records wait in a small RAM ring. When it is full the oldest non alert
+ *	record spills to a ring of flash pages, when those are full the oldest
+ *	page is erased. take() gives alerts first, flash then RAM, then the
+ *	other records, flash oldest first, then the newer RAM ones. A refused
+ *	record stays with the caller, hold() leaves it queued in the
+ *	TxScheduler.
+ *
+ *	A page erase stalls the CPU for about 20ms, longer than an ADC scan
+ *	DMA half buffer. While the erase callback says no, a record that needs
+ *	a new page is refused instead and the erase waits for a later store.
+ *
+ *	page:		magic | seq | record ..., the same in both areas
+ *	record:	len | prio (u8 each) | dstAddr | cmdID | state | data, padded to
+ *					a half word. The first half word is written last, state is
+ *					cleared to 0x0000 once the record was taken.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef TELEMETRY_LOG_H
+#define TELEMETRY_LOG_H
+
+#include "TxScheduler.h"
+#include "Flash.h"
+
+namespace hv_driver {
+
+class TelemetryLog {
+public:
+	enum LOG_PARAM {
+		LOG_RAM_SLOTS 		= 4,
+		LOG_PAYLOAD 			= TxScheduler::TX_SCHED_PAYLOAD,
+		LOG_MAGIC 				= 0xB10C,
+		LOG_PAGE_HEADER 	= 4,
+		LOG_RECORD_HEADER = 8,
+	};
+	typedef struct {
+		TxScheduler::PRIORITY prio;
+		uint8_t len;
+		uint16_t dstAddr;
+		uint16_t cmdID;
+		uint8_t data[LOG_PAYLOAD];
+	} record_s;
+	typedef struct {
+		uint32_t stored;
+		uint32_t spilled;			// moved from RAM to flash
+		uint32_t evicted;			// lost with an erased flash page
+		uint32_t rejected;		// alert pages and RAM full of alerts
+		uint32_t deferred;		// refused, a page erase was not allowed
+		uint32_t taken;
+	} metrics_s;
+	typedef bool (*EraseCallBack_t)(void);	// true if a page may be erased now
+public:
+	TelemetryLog(Flash* flash, Flash* alertFlash);
+
+	bool init(void);
+	bool store(const record_s &record);
+	bool take(record_s &record);
+	bool hold(TxScheduler &scheduler);
+	uint8_t drain(TxScheduler &scheduler, uint8_t batch);
+	void setEraseCallBack(EraseCallBack_t callBack){_eraseCallBack = callBack;}
+	uint16_t getCount(void){return _ramCount + _log.count + _alerts.count;}
+	uint16_t getAlertCount(void){return _alerts.count;}
+	const metrics_s& getMetrics(void){return _metrics;}
+private:
+	typedef struct {
+		bool isUsed;
+		uint32_t seq;
+		record_s record;
+	} slot_s;
+	typedef struct {
+		Flash* flash;
+		bool isKept;					// full of records not taken: refuse, not evict
+		uint8_t readPage;
+		uint16_t readOffset;
+		uint8_t writePage;
+		uint16_t writeOffset;
+		uint16_t pageSeq;
+		uint16_t count;				// records not taken
+	} area_s;
+
+	int8_t oldestRam(bool isAlert);
+	bool initArea(area_s &area);
+	bool writeFlash(area_s &area, const record_s &record);
+	bool readFlash(area_s &area, record_s &record);
+	bool nextPage(area_s &area);
+	bool isPageDue(area_s &area, uint8_t len);
+	bool isEraseAllowed(void){return (_eraseCallBack == NULL || _eraseCallBack() == true);}
+	static bool isPageValid(area_s &area, uint8_t page);
+	static uint32_t pageOffset(uint8_t page){return (uint32_t)page * Flash::FLASH_PAGE;}
+	static uint16_t recordSize(uint8_t len){return LOG_RECORD_HEADER + ((len + 1) & ~1);}
+
+	osMutexId _mutex;
+	EraseCallBack_t _eraseCallBack;
+	slot_s _ram[LOG_RAM_SLOTS];
+	uint8_t _ramCount;
+	uint32_t _seq;
+	area_s _log;
+	area_s _alerts;
+	metrics_s _metrics;
+};
+
+} /* hv_driver */
+#endif /* TELEMETRY_LOG_H */
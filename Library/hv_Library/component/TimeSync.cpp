@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+ * @file    TimeSync.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Network time offset and RTC drift estimator
+  */
+//-------------------------------------------------------------------------
+#include "TimeSync.h"
+
+namespace hv_driver {
+
+TimeSync::TimeSync(void) {
+	_isSynced = false;
+	_isPending = false;
+	_request.seconds = 0;
+	_request.ms = 0;
+	_retry = TS_RETRY_S;
+	_interval = TS_MIN_INTERVAL_S;
+	_nextTime = 0;
+	_baseTime = 0;
+	_baseOffset = 0;
+	_baseRtt = 0;
+	_offset = 0;
+	_drift = 0;
+	_estimates = 0;
+}
+
+/**
+	* @brief  drift kept over a reset, its calibration is still in the RTC
+	* @param  int32_t drift - ppb
+	*/
+void TimeSync::restore(int32_t drift) {
+	_drift = clampDrift(drift);
+	_estimates = (_drift != 0) ? 1 : 0;
+}
+
+/* the clock was set another way, the next exchange starts a new baseline */
+void TimeSync::restart(void) {
+	_isSynced = false;
+	_interval = TS_MIN_INTERVAL_S;
+	_nextTime = 0;
+}
+
+/**
+	* @brief  time for a request
+	* @param  uint32_t now - local s
+	*/
+bool TimeSync::isDue(uint32_t now) {
+	return (_nextTime == 0 || (int32_t)(now - _nextTime) >= 0);
+}
+
+/**
+	* @brief  a request left with this stamp, a reply has to echo it
+	* @param  const stamp_s &request - local t1
+	*/
+void TimeSync::requested(const stamp_s &request) {
+	_isPending = true;
+	_request = request;
+	_nextTime = request.seconds + _retry;
+	_retry = (_retry * 2 < TS_MAX_INTERVAL_S) ? _retry * 2 : (uint32_t)TS_MAX_INTERVAL_S;
+}
+
+/**
+	* @brief  take the reply to the last request
+	* @param  const stamp_s &request - t1 echoed by the coordinator
+	* @param  const stamp_s &reference - coordinator time t2
+	* @param  const stamp_s &reply - local t4
+	* @param  int32_t &step - s to add to the clock, 0 for none
+	* @retval false if it does not answer the last request
+	* @note		the drift changes on true, the caller applies getCalibration
+	*/
+bool TimeSync::update(const stamp_s &request, const stamp_s &reference, const stamp_s &reply,
+											int32_t &step) {
+	int64_t rtt, offset;
+	int32_t residual, noise;
+	uint32_t elapsed;
+
+	step = 0;
+	if (_isPending != true || request.seconds != _request.seconds || request.ms != _request.ms) {
+		return false;
+	}
+	rtt = diff(reply, request);
+	if (rtt < 0) {
+		return false;
+	}
+	_isPending = false;
+
+	offset = (diff(reference, request) + diff(reference, reply)) / 2;
+	_offset = (offset > 0x7FFFFFFF) ? 0x7FFFFFFF : (offset < -0x7FFFFFFF) ? -0x7FFFFFFF : (int32_t)offset;
+	if (offset >= TS_STEP_MS || offset <= -TS_STEP_MS) {
+		step = (int32_t)((offset + ((offset >= 0) ? 500 : -500)) / 1000);
+	}
+
+	/* a slow exchange is only good for a coarse step, try again later */
+	if (rtt > TS_MAX_RTT_MS) {
+		_baseTime += step;
+		_baseOffset -= (int64_t)step * 1000;
+		_nextTime = reply.seconds + step + _retry;
+		return true;
+	}
+	_retry = TS_RETRY_S;
+
+	elapsed = reply.seconds - _baseTime;
+	if (_isSynced == true && elapsed >= TS_MIN_INTERVAL_S) {
+		residual = (int32_t)(-(offset - _baseOffset) * 1000000 / elapsed);
+		noise = (int32_t)((rtt + _baseRtt) * 500000 / elapsed); // half of each round trip
+		if (residual > TS_MAX_PPB || residual < -TS_MAX_PPB) {
+			_isSynced = false;
+		} else {
+			/* the first estimate is taken whole, later ones halfway */
+			_drift = clampDrift(_drift + ((_estimates == 0) ? residual : residual / 2));
+			_estimates = (_estimates < 255) ? _estimates + 1 : 255;
+			if (residual <= TS_SETTLED_PPB + noise && residual >= -TS_SETTLED_PPB - noise) {
+				_interval = (_interval * 2 < TS_MAX_INTERVAL_S) ? _interval * 2 : (uint32_t)TS_MAX_INTERVAL_S;
+			} else {
+				_interval = (_interval / 2 > TS_MIN_INTERVAL_S) ? _interval / 2 : (uint32_t)TS_MIN_INTERVAL_S;
+			}
+		}
+	} else if (_isSynced == true) {
+		/* too soon to tell the drift from the round trip, keep the baseline */
+		_baseTime += step;
+		_baseOffset -= (int64_t)step * 1000;
+		_nextTime = _baseTime + _interval;
+		return true;
+	}
+
+	if (_isSynced != true) {
+		_interval = TS_MIN_INTERVAL_S;
+	}
+	_isSynced = true;
+	_baseTime = reply.seconds + step;
+	_baseOffset = offset - (int64_t)step * 1000;
+	_baseRtt = (uint32_t)rtt;
+	_nextTime = _baseTime + _interval;
+	return true;
+}
+
+/**
+	* @brief  RTC setting for the current drift
+	* @param  uint8_t &cal - BKP RTCCR CAL, clocks dropped per 2^20
+	* @param  bool &isFast - prescaler one count short
+	*/
+void TimeSync::getCalibration(uint8_t &cal, bool &isFast) {
+	int32_t slow = _drift;
+	int64_t steps;
+
+	isFast = (_drift < 0);
+	if (isFast == true) {
+		slow += TS_FAST_PPB;
+	}
+	steps = ((int64_t)slow * 1048576 + 500000000) / 1000000000;
+	cal = (steps > TS_CAL_MAX) ? (uint8_t)TS_CAL_MAX : (uint8_t)steps;
+}
+
+/* what the RTC can correct */
+int32_t TimeSync::clampDrift(int32_t drift) {
+	if (drift < -TS_FAST_PPB) {
+		return -TS_FAST_PPB;
+	}
+	return (drift > TS_SLOW_MAX_PPB) ? (int32_t)TS_SLOW_MAX_PPB : drift;
+}
+
+/* a - b in ms */
+int64_t TimeSync::diff(const stamp_s &a, const stamp_s &b) {
+	return ((int64_t)a.seconds - (int64_t)b.seconds) * 1000 + ((int32_t)a.ms - (int32_t)b.ms);
+}
+
+} /* hv_driver */
@@ -0,0 +1,82 @@
+/**
+  ******************************************************************************
+ * @file    TimeSync.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Network time offset and RTC drift estimator
+ *
+ *	One exchange is an NTP style round trip: the request leaves at local
+ *	t1, the coordinator stamps it with its time t2 and echoes t1, the
+ *	reply arrives at local t4. The offset is t2 - (t1 + t4) / 2, good to
+ *	half the round trip. Whole seconds of offset are stepped out of the
+ *	clock, what is left over the time since the last accepted exchange is
+ *	the drift of the crystal. It is smoothed and turned into a calibration
+ *	the RTC can take: CAL drops up to 127 of every 2^20 clocks (0..121 ppm
+ *	slower) and a prescaler one count short runs 30.5 ppm faster.
+ *	The interval doubles while the drift stays put, so a settled watch
+ *	asks once a day.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <stdint.h>
+
+namespace hv_driver {
+
+class TimeSync {
+public:
+	enum SYNC_PARAM {
+		TS_STEP_MS 					= 500,			// offset from which the clock is stepped
+		TS_MAX_RTT_MS 			= 1000,			// slower exchanges only step the clock
+		TS_RETRY_S 					= 60,				// first retry without a reply, doubles
+		TS_MIN_INTERVAL_S 	= 3600,			// shortest span a drift is measured over
+		TS_MAX_INTERVAL_S 	= 86400,
+		TS_SETTLED_PPB 			= 2000,			// residual drift beyond the round trip noise that
+																		// still doubles the interval
+		TS_MAX_PPB 					= 200000,		// beyond any crystal, the reference jumped
+		TS_FAST_PPB 				= 30518,		// prescaler 32766 instead of 32767
+		TS_SLOW_MAX_PPB 		= 121117,		// CAL 127
+		TS_CAL_MAX 					= 127,
+	};
+	typedef struct {
+		uint32_t seconds;		// since RTC_EPOCH_YEAR
+		uint16_t ms;
+	} stamp_s;
+public:
+	TimeSync(void);
+
+	void restore(int32_t drift);
+	void restart(void);
+	bool isDue(uint32_t now);
+	void requested(const stamp_s &request);
+	bool update(const stamp_s &request, const stamp_s &reference, const stamp_s &reply, int32_t &step);
+
+	bool isSynced(void){return _isSynced;}
+	int32_t getDrift(void){return _drift;}
+	int32_t getOffset(void){return _offset;}
+	uint32_t getInterval(void){return _interval;}
+	void getCalibration(uint8_t &cal, bool &isFast);
+
+	static int64_t diff(const stamp_s &a, const stamp_s &b);
+private:
+	static int32_t clampDrift(int32_t drift);
+
+	bool _isSynced;				// baseline valid
+	bool _isPending;			// request out, no reply yet
+	stamp_s _request;
+	uint32_t _retry;			// s
+	uint32_t _interval;		// s
+	uint32_t _nextTime;		// local s of the next request, 0 at once
+	uint32_t _baseTime;		// local s of the baseline
+	int64_t _baseOffset;	// ms left after the step at the baseline
+	uint32_t _baseRtt;		// ms, round trip of the baseline exchange
+	int32_t _offset;			// ms, last exchange before stepping
+	int32_t _drift;				// ppb, positive when the crystal is fast
+	uint8_t _estimates;
+};
+
+} /* hv_driver */
+#endif /* TIME_SYNC_H */
@@ -0,0 +1,322 @@
+/**
+  ******************************************************************************
+ * @file    TxScheduler.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Priority outbound queue for Zigbee telemetry
+  */
+//-------------------------------------------------------------------------
+#include "TxScheduler.h"
+#include "string.h"
+
+namespace hv_driver {
+
+TxScheduler::TxScheduler(TxWindow* window) {
+	_window = window;
+	_taskId = NULL;
+	_historyNext = 0;
+	_seq = 0;
+	memset(_pool, 0, sizeof(_pool));
+	memset(_history, 0, sizeof(_history));
+	memset(&_metrics, 0, sizeof(_metrics));
+	for (uint8_t i = 0; i < TX_SCHED_HISTORY; i++) {
+		_history[i].cmdID = CC2530::NONE;
+	}
+}
+
+/**
+	* @brief  queue a packet for the dispatcher task
+	* @param  PRIORITY prio - PRIO_ALERT always goes first and is never dropped
+	*					for unchanged data
+	* @param  uint16_t dstAddr, uint16_t cmdID
+	* @param  const uint8_t* data, uint8_t len - copied
+	* @param  uint8_t flags - POST_FLAG bits
+	* @retval true if queued, coalesced or dropped as unchanged
+	*					false if the pool is full of packets of the same or higher class
+	*/
+bool TxScheduler::post(PRIORITY prio, uint16_t dstAddr, uint16_t cmdID, const uint8_t* data,
+											 uint8_t len, uint8_t flags) {
+	int8_t target = -1;
+	uint32_t now = osKernelSysTick();
+	uint8_t depth = 0;
+	uint16_t crc;
+
+	if (prio >= PRIO_NUM || len > TX_SCHED_PAYLOAD || (len != 0 && data == NULL)) {
+		return false;
+	}
+	crc = crc16(data, len); // outside the critical section
+
+	__disable_irq();
+	_metrics.posted++;
+	if (flags & POST_COALESCE) {
+		for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+			if (_pool[i].isUsed == true && _pool[i].cmdID == cmdID && _pool[i].dstAddr == dstAddr) {
+				target = i;
+				break;
+			}
+		}
+	}
+
+	if (prio != PRIO_ALERT && (flags & POST_DROP_UNCHANGED) && isUnchanged(cmdID, crc, len, now)) {
+		if (target >= 0) {
+			_pool[target].isUsed = false; // the queued one is older than what was sent
+		}
+		_metrics.unchanged++;
+		__enable_irq();
+		return true;
+	}
+
+	if (target >= 0) {
+		_metrics.coalesced++; // keeps its place and age in the queue
+		if (prio < _pool[target].prio) {
+			_pool[target].prio = prio;
+		}
+	} else {
+		for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+			if (_pool[i].isUsed != true) {
+				target = i;
+				break;
+			}
+		}
+	}
+
+	/* full, evict the oldest packet of the lowest class below this one */
+	if (target < 0) {
+		for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+			if (_pool[i].prio <= prio) {
+				continue;
+			}
+			if (target < 0 || _pool[i].prio > _pool[target].prio
+					|| (_pool[i].prio == _pool[target].prio && _pool[i].seq < _pool[target].seq)) {
+				target = i;
+			}
+		}
+		_metrics.dropped++;
+		if (target < 0) {
+			__enable_irq();
+			return false;
+		}
+		_pool[target].isUsed = false;
+	}
+
+	entry_s &entry = _pool[target];
+	if (entry.isUsed != true) {
+		entry.isUsed = true;
+		entry.prio = prio;
+		entry.seq = _seq++;
+		entry.time = now;
+	}
+	entry.flags = flags;
+	entry.dstAddr = dstAddr;
+	entry.cmdID = cmdID;
+	entry.len = len;
+	entry.crc = crc;
+	if (len != 0) {
+		memcpy(entry.data, data, len);
+	}
+
+	for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+		if (_pool[i].isUsed == true) {
+			depth++;
+		}
+	}
+	if (depth > _metrics.maxDepth) {
+		_metrics.maxDepth = depth;
+	}
+	__enable_irq();
+
+	if (_taskId != NULL) {
+		osSignalSet(_taskId, TX_SCHED_SIGNAL_POST);
+	}
+	return true;
+}
+
+/**
+	* @brief  hand queued packets to the transmit window, best first
+	* @param  uint32_t timeout - return after this many ms
+	* @retval none
+	* @note		the packet is chosen once the window has room, so an alert
+	*					posted meanwhile still goes first
+	*					POST_DROP_UNCHANGED history takes the payload once the window
+	*					has accepted it, a packet it refused does not hold back a repost
+	*/
+void TxScheduler::dispatch(uint32_t timeout) {
+	uint32_t start = osKernelSysTick();
+	uint32_t elapsed, left;
+	Z_stack::TxPacket_s txPacket;
+	entry_s entry;
+	int8_t index;
+
+	_taskId = osThreadGetId();
+	while (1) {
+		elapsed = osKernelSysTick() - start;
+		if (elapsed >= timeout) {
+			return;
+		}
+		left = timeout - elapsed;
+
+		if (getDepth() == 0) {
+			osSignalWait(TX_SCHED_SIGNAL_POST, left);
+			continue;
+		}
+		if (_window->waitFree(left) != true) {
+			return;
+		}
+
+		__disable_irq();
+		index = pick(osKernelSysTick());
+		if (index >= 0) {
+			entry = _pool[index];
+			_pool[index].isUsed = false;
+		}
+		__enable_irq();
+		if (index < 0) {
+			continue;
+		}
+
+		txPacket.dstAddr = entry.dstAddr;
+		txPacket.cmdID = entry.cmdID;
+		txPacket.handle = 0;
+		txPacket.len = entry.len;
+		txPacket.txPtr = entry.data;
+		if (_window->submit(txPacket, false, TX_SCHED_RADIUS, NULL, left) == true) {
+			_metrics.sent++;
+			if (entry.flags & POST_DROP_UNCHANGED) {
+				__disable_irq();
+				remember(entry, osKernelSysTick()); // only what went out, a refused one is not sent again
+				__enable_irq();
+			}
+		} else {
+			_metrics.dropped++;
+		}
+	}
+}
+
+/**
+	* @brief  remove the best queued packet without sending it, to keep it
+	*					while the network is down
+	* @param  uint8_t* data - TX_SCHED_PAYLOAD bytes
+	* @retval false if nothing is queued
+	*/
+bool TxScheduler::take(PRIORITY &prio, uint16_t &dstAddr, uint16_t &cmdID, uint8_t* data, uint8_t &len) {
+	int8_t index;
+
+	__disable_irq();
+	index = pick(osKernelSysTick());
+	if (index >= 0) {
+		entry_s &entry = _pool[index];
+		prio = entry.prio;
+		dstAddr = entry.dstAddr;
+		cmdID = entry.cmdID;
+		len = entry.len;
+		memcpy(data, entry.data, len);
+		entry.isUsed = false;
+	}
+	__enable_irq();
+	return (index >= 0);
+}
+
+uint8_t TxScheduler::getDepth(void) {
+	uint8_t depth = 0;
+
+	for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+		if (_pool[i].isUsed == true) {
+			depth++;
+		}
+	}
+	return depth;
+}
+
+void TxScheduler::getMetrics(metrics_s &metrics) {
+	__disable_irq();
+	metrics = _metrics;
+	for (uint8_t prio = 0; prio < PRIO_NUM; prio++) {
+		metrics.depth[prio] = 0;
+	}
+	for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+		if (_pool[i].isUsed == true) {
+			metrics.depth[_pool[i].prio]++;
+		}
+	}
+	__enable_irq();
+}
+
+/**
+	* @brief  best queued packet: lowest class, then oldest
+	* @note		non-alert packets gain a class every TX_SCHED_AGING_MS so a busy
+	*					normal class can not starve the low one, but never reach alerts
+	*/
+int8_t TxScheduler::pick(uint32_t now) {
+	int8_t best = -1;
+	int32_t bestPrio = PRIO_NUM;
+	int32_t prio;
+
+	for (uint8_t i = 0; i < TX_SCHED_POOL; i++) {
+		if (_pool[i].isUsed != true) {
+			continue;
+		}
+		prio = _pool[i].prio;
+		if (prio != PRIO_ALERT) {
+			prio -= (now - _pool[i].time) / TX_SCHED_AGING_MS;
+			if (prio <= PRIO_ALERT) {
+				prio = PRIO_ALERT + 1;
+			}
+		}
+		if (best < 0 || prio < bestPrio || (prio == bestPrio && _pool[i].seq < _pool[best].seq)) {
+			best = i;
+			bestPrio = prio;
+		}
+	}
+	return best;
+}
+
+int8_t TxScheduler::findHistory(uint16_t cmdID) {
+	for (uint8_t i = 0; i < TX_SCHED_HISTORY; i++) {
+		if (_history[i].cmdID == cmdID) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+bool TxScheduler::isUnchanged(uint16_t cmdID, uint16_t crc, uint8_t len, uint32_t now) {
+	int8_t index = findHistory(cmdID);
+
+	if (index < 0) {
+		return false;
+	}
+	history_s &history = _history[index];
+	if (now - history.time >= TX_SCHED_REFRESH_MS) {
+		return false; // let the coordinator know we are still here
+	}
+	return (history.len == len && history.crc == crc);
+}
+
+void TxScheduler::remember(const entry_s &entry, uint32_t now) {
+	int8_t index = findHistory(entry.cmdID);
+
+	if (index < 0) {
+		index = _historyNext;
+		_historyNext = (_historyNext + 1) % TX_SCHED_HISTORY;
+	}
+	_history[index].cmdID = entry.cmdID;
+	_history[index].len = entry.len;
+	_history[index].time = now;
+	_history[index].crc = entry.crc;
+}
+
+/* crc16 CCITT */
+uint16_t TxScheduler::crc16(const uint8_t* data, uint8_t len) {
+	uint16_t crc = 0xFFFF;
+
+	for (uint8_t i = 0; i < len; i++) {
+		crc ^= (uint16_t)data[i] << 8;
+		for (uint8_t bit = 0; bit < 8; bit++) {
+			crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+		}
+	}
+	return crc;
+}
+
+} /* hv_driver */
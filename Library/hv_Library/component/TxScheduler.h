@@ -0,0 +1,91 @@
+/**
+  ******************************************************************************
+ * @file    TxScheduler.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Priority outbound queue for Zigbee telemetry
+  */
+//-------------------------------------------------------------------------
+
+#ifndef TX_SCHEDULER_H
+#define TX_SCHEDULER_H
+
+#include "TxWindow.h"
+
+namespace hv_driver {
+
+class TxScheduler {
+public:
+	enum PRIORITY {
+		PRIO_ALERT = 0, PRIO_NORMAL, PRIO_LOW, PRIO_NUM
+	};
+	enum POST_FLAG {
+		POST_NONE 						= 0x00,
+		POST_COALESCE 				= 0x01,	// replace a queued packet with the same cmdID
+		POST_DROP_UNCHANGED 	= 0x02	// drop if equal to the last one sent
+	};
+	enum SCHED_PARAM {
+		TX_SCHED_POOL 				= 6,		// queued packets
+		TX_SCHED_PAYLOAD 			= TxWindow::TX_MAX_PAYLOAD,
+		TX_SCHED_HISTORY 			= 4,		// cmdIDs remembered for POST_DROP_UNCHANGED
+		TX_SCHED_AGING_MS 		= 10000,// waiting this long raises a packet one class
+		TX_SCHED_REFRESH_MS 	= 60000,// unchanged packets are still sent this often
+		TX_SCHED_RADIUS 			= 10,
+		TX_SCHED_SIGNAL_POST 	= 0x01
+	};
+	typedef struct {
+		uint8_t depth[PRIO_NUM];	// queued now
+		uint8_t maxDepth;					// high water mark of the pool
+		uint32_t posted;
+		uint32_t coalesced;
+		uint32_t unchanged;				// dropped, same payload as last sent
+		uint32_t dropped;					// pool full or evicted
+		uint32_t sent;
+	} metrics_s;
+public:
+	TxScheduler(TxWindow* window);
+
+	bool post(PRIORITY prio, uint16_t dstAddr, uint16_t cmdID, const uint8_t* data,
+						uint8_t len, uint8_t flags = POST_NONE);
+	void dispatch(uint32_t timeout);
+	bool take(PRIORITY &prio, uint16_t &dstAddr, uint16_t &cmdID, uint8_t* data, uint8_t &len);
+	uint8_t getDepth(void);
+	void getMetrics(metrics_s &metrics);
+private:
+	typedef struct {
+		bool isUsed;
+		PRIORITY prio;
+		uint8_t flags;
+		uint16_t dstAddr;
+		uint16_t cmdID;
+		uint8_t len;
+		uint16_t crc;
+		uint32_t seq;			// arrival order
+		uint32_t time;		// post tick, for aging
+		uint8_t data[TX_SCHED_PAYLOAD];
+	} entry_s;
+	typedef struct {
+		uint16_t cmdID;
+		uint8_t len;
+		uint16_t crc;			// payload is not kept, only its crc
+		uint32_t time;
+	} history_s;
+
+	int8_t pick(uint32_t now);
+	int8_t findHistory(uint16_t cmdID);
+	bool isUnchanged(uint16_t cmdID, uint16_t crc, uint8_t len, uint32_t now);
+	void remember(const entry_s &entry, uint32_t now);
+	static uint16_t crc16(const uint8_t* data, uint8_t len);
+
+	TxWindow* _window;
+	osThreadId _taskId;
+	entry_s _pool[TX_SCHED_POOL];
+	history_s _history[TX_SCHED_HISTORY];
+	uint8_t _historyNext;
+	uint32_t _seq;
+	metrics_s _metrics;
+};
+
+} /* hv_driver */
+#endif /* TX_SCHEDULER_H */
@@ -0,0 +1,343 @@
+/**
+  ******************************************************************************
+ * @file    TxWindow.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Zigbee transmit window, several data requests in flight
+  */
+//-------------------------------------------------------------------------
+#include "TxWindow.h"
+#include "string.h"
+
+namespace hv_driver {
+
+osSemaphoreDef(TX_FREE);
+osSemaphoreDef(TX_DONE);
+
+TxWindow::TxWindow(Z_stack* zigbee) {
+	_zigbee = zigbee;
+	_taskId = NULL;
+	_freeSem = NULL;
+	_busyCallBack = NULL;
+	_failCallBack = NULL;
+	_failArg = NULL;
+	_handle = 0;
+	_inFlight = 0;
+	_retryCount = 0;
+	_failCount = 0;
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		_slot[i].state = SLOT_FREE;
+		_slot[i].gen = 0;
+		_slot[i].doneSem = NULL;
+		_slot[i].payload = NULL;
+	}
+}
+
+/**
+	* @brief  create the slot semaphores and hook the send data confirm
+	* @param  none
+	* @retval true on success
+	*/
+bool TxWindow::init(void) {
+	_freeSem = osSemaphoreCreate(osSemaphore(TX_FREE), TX_WINDOW_SIZE); // starts empty
+	if (_freeSem == NULL) {
+		return false;
+	}
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		_slot[i].doneSem = osSemaphoreCreate(osSemaphore(TX_DONE), 1);
+		if (_slot[i].doneSem == NULL) {
+			return false;
+		}
+		osSemaphoreWait(_slot[i].doneSem, 0);
+		osSemaphoreRelease(_freeSem);
+	}
+	_zigbee->setConfirmCallBack(confirmHandler, this);
+	return true;
+}
+
+/**
+	* @brief  queue a packet, the payload is copied
+	* @param  Z_stack::TxPacket_s &txPacket - handle is assigned here
+	* @param  bool ack, uint8_t radius
+	* @param  future_s* future - NULL to fire and forget
+	* @param  uint32_t timeout - wait for a free slot, in ms
+	* @retval true if queued
+	*/
+bool TxWindow::submit(Z_stack::TxPacket_s &txPacket, bool ack, uint8_t radius,
+											future_s* future, uint32_t timeout) {
+	uint8_t index;
+	ZNPBuffer* payload;
+
+	if (txPacket.len > TX_MAX_PAYLOAD || (txPacket.len != 0 && txPacket.txPtr == NULL)) {
+		return false;
+	}
+	if (osSemaphoreWait(_freeSem, timeout) != osOK) {
+		return false;
+	}
+
+	__disable_irq();
+	for (index = 0; index < TX_WINDOW_SIZE; index++) {
+		if (_slot[index].state == SLOT_FREE) {
+			_slot[index].state = SLOT_RESERVED;
+			break;
+		}
+	}
+	__enable_irq();
+	if (index == TX_WINDOW_SIZE) {
+		osSemaphoreRelease(_freeSem); // token without a slot, should not happen
+		return false;
+	}
+
+	payload = ZNPBuffer::alloc(Z_stack::ZB_DATA_HEADROOM);
+	if (payload == NULL) {
+		_slot[index].state = SLOT_FREE;
+		osSemaphoreRelease(_freeSem);
+		return false;
+	}
+	if (txPacket.len != 0) {
+		memcpy(payload->append(txPacket.len), txPacket.txPtr, txPacket.len);
+	}
+
+	slot_s &slot = _slot[index];
+	slot.packet = txPacket;
+	slot.packet.txPtr = payload->getData();
+	slot.payload = payload;
+	slot.ack = ack;
+	slot.radius = radius;
+	slot.retry = 0;
+	slot.gen++;
+	slot.isDetached = (future == NULL);
+	slot.due = osKernelSysTick();
+	if (future != NULL) {
+		future->slot = index;
+		future->gen = slot.gen;
+	}
+	slot.state = SLOT_PENDING;
+
+	if (_taskId != NULL) {
+		osSignalSet(_taskId, TX_SIGNAL_SUBMIT);
+	}
+	return true;
+}
+
+/**
+	* @brief  wait for the result of a packet
+	* @param  future_s &future - from submit
+	* @param  uint32_t timeout - in ms
+	* @retval confirm status, zdoTimeout if not completed in time
+	* @note		on timeout the packet keeps going but its result is dropped
+	*/
+Z_stack::STATUS TxWindow::wait(future_s &future, uint32_t timeout) {
+	Z_stack::STATUS retVal = Z_stack::zdoTimeout;
+	bool isDone;
+
+	if (future.slot >= TX_WINDOW_SIZE) {
+		return Z_stack::ZInvalidParameter;
+	}
+	slot_s &slot = _slot[future.slot];
+	if (slot.gen != future.gen || slot.isDetached == true || slot.state == SLOT_FREE) {
+		return Z_stack::ZInvalidParameter;
+	}
+
+	isDone = (osSemaphoreWait(slot.doneSem, timeout) == osOK);
+	if (isDone != true) {
+		__disable_irq();
+		if (slot.state == SLOT_DONE) {
+			isDone = true; // completed right after the timeout
+		} else {
+			slot.isDetached = true;
+		}
+		__enable_irq();
+		if (isDone == true) {
+			osSemaphoreWait(slot.doneSem, osWaitForever); // released just after DONE
+		}
+	}
+
+	if (isDone == true) {
+		retVal = slot.status;
+		freeSlot(slot);
+	}
+	return retVal;
+}
+
+/**
+	* @brief  wait until a slot is free without taking it
+	* @param  uint32_t timeout - in ms
+	* @retval true if a slot is free
+	* @note		lets a caller pick what to send once there is room
+	*/
+bool TxWindow::waitFree(uint32_t timeout) {
+	if (osSemaphoreWait(_freeSem, timeout) != osOK) {
+		return false;
+	}
+	osSemaphoreRelease(_freeSem);
+	return true;
+}
+
+/**
+	* @brief  window task, sends pending slots and handles confirms and retries
+	* @param  none
+	* @retval none
+	*/
+void TxWindow::run(void) {
+	uint32_t now, sleep;
+	uint8_t inFlight;
+	bool isBusy = false;
+
+	_taskId = osThreadGetId();
+	while (1) {
+		now = osKernelSysTick();
+		sleep = osWaitForever;
+		inFlight = 0;
+
+		for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+			slot_s &slot = _slot[i];
+
+			if (slot.state == SLOT_CONFIRMED) {
+				if (slot.status == Z_stack::ZSuccess) {
+					complete(slot, Z_stack::ZSuccess);
+				} else {
+					retryOrFail(slot, slot.status, now);
+				}
+			} else if (slot.state == SLOT_INFLIGHT && (int32_t)(now - slot.due) >= 0) {
+				retryOrFail(slot, Z_stack::zdoTimeout, now);
+			}
+			if (slot.state == SLOT_PENDING && (int32_t)(now - slot.due) >= 0) {
+				transmit(slot, now);
+				now = osKernelSysTick(); // SREQ takes a while
+			}
+
+			if (slot.state == SLOT_PENDING || slot.state == SLOT_INFLIGHT) {
+				uint32_t left = ((int32_t)(slot.due - now) > 0) ? (slot.due - now) : 0;
+				if (left < sleep) {
+					sleep = left;
+				}
+				inFlight++;
+			} else if (slot.state == SLOT_CONFIRMED) {
+				sleep = 0;
+				inFlight++;
+			}
+		}
+		_inFlight = inFlight;
+
+		if (isBusy != (inFlight != 0)) {
+			isBusy = (inFlight != 0);
+			if (_busyCallBack != NULL) {
+				_busyCallBack(isBusy);
+			}
+		}
+		if (sleep != 0) {
+			osSignalWait(TX_SIGNAL_ALL, sleep);
+		}
+	}
+}
+
+/**
+	* @brief  send a slot with a fresh handle, a late confirm of an earlier
+	*					attempt can not be taken for this one
+	*/
+void TxWindow::transmit(slot_s &slot, uint32_t now) {
+	__disable_irq();
+	slot.handle = nextHandle();
+	slot.packet.handle = slot.handle;
+	slot.due = now + TX_CONFIRM_TIMEOUT;
+	slot.state = SLOT_INFLIGHT; // the confirm may beat the SRSP back to us
+	__enable_irq();
+
+	if (_zigbee->sendDataReq(slot.packet, slot.payload, slot.ack, slot.radius) != Z_stack::ZSuccess) {
+		__disable_irq();
+		if (slot.state == SLOT_INFLIGHT) {
+			slot.state = SLOT_CONFIRMED;
+			slot.status = Z_stack::ZFailure;
+		}
+		__enable_irq();
+	}
+}
+
+void TxWindow::retryOrFail(slot_s &slot, Z_stack::STATUS status, uint32_t now) {
+	if (slot.retry < TX_MAX_RETRY) {
+		slot.retry++;
+		_retryCount++;
+		slot.due = now + ((uint32_t)TX_BACKOFF_MS << (slot.retry - 1));
+		slot.state = SLOT_PENDING;
+	} else {
+		_failCount++;
+		complete(slot, status);
+	}
+}
+
+void TxWindow::complete(slot_s &slot, Z_stack::STATUS status) {
+	bool isDetached;
+
+	__disable_irq();
+	slot.status = status;
+	slot.state = SLOT_DONE;
+	isDetached = slot.isDetached;
+	__enable_irq();
+
+	if (isDetached == true) {
+		if (status != Z_stack::ZSuccess && _failCallBack != NULL) {
+			_failCallBack(slot.packet, _failArg);
+		}
+		freeSlot(slot);
+	} else {
+		osSemaphoreRelease(slot.doneSem);
+	}
+}
+
+void TxWindow::freeSlot(slot_s &slot) {
+	if (slot.payload != NULL) {
+		slot.payload->release();
+		slot.payload = NULL;
+	}
+	slot.state = SLOT_FREE;
+	osSemaphoreRelease(_freeSem);
+}
+
+/* 8-bit handle, 0 is not used and handles in flight are skipped */
+uint8_t TxWindow::nextHandle(void) {
+	bool isUsed;
+
+	do {
+		_handle++;
+		if (_handle == 0) {
+			_handle = 1;
+		}
+		isUsed = false;
+		for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+			if (_slot[i].state == SLOT_INFLIGHT && _slot[i].handle == _handle) {
+				isUsed = true;
+			}
+		}
+	} while (isUsed == true);
+	return _handle;
+}
+
+/**
+	* @brief  ZB_SEND_DATA_CONFIRM, runs in the ZNP task
+	*/
+void TxWindow::confirmHandler(uint8_t handle, Z_stack::STATUS status, void* arg) {
+	((TxWindow*)arg)->onConfirm(handle, status);
+}
+
+void TxWindow::onConfirm(uint8_t handle, Z_stack::STATUS status) {
+	bool isMatch = false;
+
+	__disable_irq();
+	for (uint8_t i = 0; i < TX_WINDOW_SIZE; i++) {
+		if (_slot[i].state == SLOT_INFLIGHT && _slot[i].handle == handle) {
+			_slot[i].status = status;
+			_slot[i].state = SLOT_CONFIRMED;
+			isMatch = true;
+			break;
+		}
+	}
+	__enable_irq();
+
+	if (isMatch == true && _taskId != NULL) {
+		osSignalSet(_taskId, TX_SIGNAL_CONFIRM);
+	}
+}
+
+} /* hv_driver */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+ * @file    TxWindow.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Zigbee transmit window, several data requests in flight
+  */
+//-------------------------------------------------------------------------
+
+#ifndef TX_WINDOW_H
+#define TX_WINDOW_H
+
+#include "Z_stack.h"
+
+namespace hv_driver {
+
+class TxWindow {
+public:
+	enum TX_PARAM {
+		TX_WINDOW_SIZE 			= 3,		// outstanding ZB_SEND_DATA_REQUEST
+		TX_MAX_PAYLOAD 			= 80,		// copied into a pooled buffer on submit
+		TX_MAX_RETRY 				= 3,
+		TX_BACKOFF_MS 			= 100,	// doubled on every retry
+		TX_CONFIRM_TIMEOUT 	= 3000,	// ms, no confirm counts as a failure
+		TX_SIGNAL_SUBMIT 		= 0x01,
+		TX_SIGNAL_CONFIRM 	= 0x02,
+		TX_SIGNAL_ALL 			= 0x03
+	};
+	/* handle to the result of one packet */
+	typedef struct {
+		uint8_t slot;
+		uint8_t gen;
+	} future_s;
+
+	typedef void (*BusyCallBack_t)(bool isBusy);
+	/* fire and forget packet given up after all retries, txPtr valid during the call */
+	typedef void (*FailCallBack_t)(const Z_stack::TxPacket_s &packet, void* arg);
+public:
+	TxWindow(Z_stack* zigbee);
+
+	bool init(void);
+	void run(void);
+	bool submit(Z_stack::TxPacket_s &txPacket, bool ack, uint8_t radius,
+							future_s* future = NULL, uint32_t timeout = 0);
+	Z_stack::STATUS wait(future_s &future, uint32_t timeout);
+	bool waitFree(uint32_t timeout);
+	void setBusyCallBack(BusyCallBack_t callBack){_busyCallBack = callBack;}
+	void setFailCallBack(FailCallBack_t callBack, void* arg){_failArg = arg; _failCallBack = callBack;}
+
+	uint8_t getInFlight(void){return _inFlight;}
+	uint32_t getRetryCount(void){return _retryCount;}
+	uint32_t getFailCount(void){return _failCount;}
+private:
+	enum SLOT_STATE {
+		SLOT_FREE, SLOT_RESERVED, SLOT_PENDING, SLOT_INFLIGHT, SLOT_CONFIRMED, SLOT_DONE
+	};
+	typedef struct {
+		__IO SLOT_STATE state;
+		bool isDetached;			// nobody waits, freed on completion
+		uint8_t gen;
+		uint8_t handle;
+		uint8_t retry;
+		bool ack;
+		uint8_t radius;
+		uint32_t due;					// send time when pending, confirm deadline in flight
+		__IO Z_stack::STATUS status;
+		osSemaphoreId doneSem;
+		Z_stack::TxPacket_s packet;
+		ZNPBuffer* payload;		// with Z_stack::ZB_DATA_HEADROOM, reused on retries
+	} slot_s;
+
+	static void confirmHandler(uint8_t handle, Z_stack::STATUS status, void* arg);
+	void onConfirm(uint8_t handle, Z_stack::STATUS status);
+	void transmit(slot_s &slot, uint32_t now);
+	void retryOrFail(slot_s &slot, Z_stack::STATUS status, uint32_t now);
+	void complete(slot_s &slot, Z_stack::STATUS status);
+	void freeSlot(slot_s &slot);
+	uint8_t nextHandle(void);
+
+	Z_stack* _zigbee;
+	osThreadId _taskId;
+	osSemaphoreId _freeSem;
+	BusyCallBack_t _busyCallBack;
+	FailCallBack_t _failCallBack;
+	void* _failArg;
+	slot_s _slot[TX_WINDOW_SIZE];
+	uint8_t _handle;
+	__IO uint8_t _inFlight;
+	uint32_t _retryCount;
+	uint32_t _failCount;
+};
+
+} /* hv_driver */
+#endif /* TX_WINDOW_H */
@@ -0,0 +1,136 @@
+/**
+  ******************************************************************************
+ * @file    ZNPBuffer.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Pooled, reference counted ZNP frame buffers
+  */
+//-------------------------------------------------------------------------
+#include "ZNPBuffer.h"
+
+namespace hv_driver {
+
+ZNPBuffer ZNPBuffer::_pool[ZNP_POOL_SIZE];
+uint8_t ZNPBuffer::_minFree = ZNP_POOL_SIZE;
+uint32_t ZNPBuffer::_allocFail = 0;
+
+ZNPBuffer::ZNPBuffer(void) {
+	_refs = 0;
+	_head = 0;
+	_len = 0;
+	_cmd = 0;
+}
+
+/**
+	* @brief  take a free buffer
+	* @param  uint8_t headroom - bytes kept in front for headers
+	* @retval buffer with one reference, NULL if the pool is empty
+	*/
+ZNPBuffer* ZNPBuffer::alloc(uint8_t headroom) {
+	uint32_t primask = __get_PRIMASK();
+	ZNPBuffer* buffer = NULL;
+	uint8_t free = 0;
+
+	if (headroom > ZNP_BUFFER_SIZE) {
+		return NULL;
+	}
+	__disable_irq();
+	for (uint8_t i = 0; i < ZNP_POOL_SIZE; i++) {
+		if (_pool[i]._refs == 0) {
+			if (buffer == NULL) {
+				buffer = &_pool[i];
+				buffer->_refs = 1;
+			} else {
+				free++;
+			}
+		}
+	}
+	if (buffer == NULL) {
+		_allocFail++;
+	} else if (free < _minFree) {
+		_minFree = free;
+	}
+	__set_PRIMASK(primask);
+
+	if (buffer != NULL) {
+		buffer->_head = headroom;
+		buffer->_len = 0;
+		buffer->_cmd = 0;
+	}
+	return buffer;
+}
+
+uint8_t ZNPBuffer::getFree(void) {
+	uint8_t free = 0;
+
+	for (uint8_t i = 0; i < ZNP_POOL_SIZE; i++) {
+		if (_pool[i]._refs == 0) {
+			free++;
+		}
+	}
+	return free;
+}
+
+void ZNPBuffer::retain(void) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	_refs++;
+	__set_PRIMASK(primask);
+}
+
+/**
+	* @brief  drop a reference, the last one returns the buffer to the pool
+	*/
+void ZNPBuffer::release(void) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (_refs > 0) {
+		_refs--;
+	}
+	__set_PRIMASK(primask);
+}
+
+/**
+	* @brief  grow the data at the tail
+	* @retval where to write, NULL if there is no room
+	*/
+uint8_t* ZNPBuffer::append(uint8_t len) {
+	uint8_t* ptr;
+
+	if (len > getRoom()) {
+		return NULL;
+	}
+	ptr = _buff + _head + _len;
+	_len += len;
+	return ptr;
+}
+
+/**
+	* @brief  prepend a header into the headroom
+	* @retval where to write, NULL if the headroom is too small
+	*/
+uint8_t* ZNPBuffer::push(uint8_t len) {
+	if (len > _head) {
+		return NULL;
+	}
+	_head -= len;
+	_len += len;
+	return _buff + _head;
+}
+
+/**
+	* @brief  strip a header pushed earlier
+	*/
+bool ZNPBuffer::pull(uint8_t len) {
+	if (len > _len) {
+		return false;
+	}
+	_head += len;
+	_len -= len;
+	return true;
+}
+
+} /* hv_driver */
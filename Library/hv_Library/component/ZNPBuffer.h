@@ -0,0 +1,67 @@
+/**
+  ******************************************************************************
+ * @file    ZNPBuffer.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Pooled, reference counted ZNP frame buffers
+ *
+ *	A buffer holds one ZNP frame. Payloads are written after a reserved
+ *	headroom so each layer prepends its header in place (Z_stack data
+ *	request header, then the 3 byte SPI header) and the whole frame goes
+ *	out in a single DMA transfer. Received frames are read straight into
+ *	a buffer and handed up by reference, a handler that needs the data
+ *	later calls retain() and release() when done.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef ZNP_BUFFER_H
+#define ZNP_BUFFER_H
+
+#include "stm32f1xx.h"
+
+namespace hv_driver {
+
+class ZNPBuffer {
+public:
+	enum BUFFER_PARAM {
+		ZNP_POOL_SIZE 		= 6,		// TX window slots plus received frames
+		ZNP_BUFFER_SIZE 	= 3 + 100,// SPI header + ZNP_MAX_PAYLOAD
+		ZNP_SPI_HEADER 		= 3,		// len | cmd0 | cmd1
+	};
+public:
+	static ZNPBuffer* alloc(uint8_t headroom);
+	static uint8_t getFree(void);
+	static uint8_t getMinFree(void){return _minFree;}
+	static uint32_t getAllocFail(void){return _allocFail;}
+
+	void retain(void);
+	void release(void);
+	uint8_t getRefs(void){return _refs;}
+
+	uint8_t* getData(void){return _buff + _head;}
+	uint8_t getLen(void){return _len;}
+	uint8_t getRoom(void){return ZNP_BUFFER_SIZE - _head - _len;}
+	uint16_t getCmd(void){return _cmd;}
+	void setCmd(uint16_t cmd){_cmd = cmd;}
+
+	uint8_t* append(uint8_t len);
+	uint8_t* push(uint8_t len);
+	bool pull(uint8_t len);
+	void setLen(uint8_t len){_len = len;}
+private:
+	ZNPBuffer(void);
+
+	__IO uint8_t _refs;
+	uint8_t _head;			// start of the data
+	uint8_t _len;
+	uint16_t _cmd;			// received frames
+	uint8_t _buff[ZNP_BUFFER_SIZE];
+
+	static ZNPBuffer _pool[ZNP_POOL_SIZE];
+	static uint8_t _minFree;
+	static uint32_t _allocFail;
+};
+
+} /* hv_driver */
+#endif /* ZNP_BUFFER_H */
@@ -11,45 +11,92 @@
 #include "string.h"
 
 namespace hv_driver {
+
+osSemaphoreDef(ZB_START);
+osSemaphoreDef(ZB_CONFIRM);
+osMutexDef(ZB_SEND);
 	
 Z_stack::Z_stack(CC2530 *znp){
 	this->znp = znp;
+	this->startSem = NULL;
+	this->confirmSem = NULL;
+	this->sendMutex = NULL;
+	this->startStatus = Zb_startTimeout;
+	this->confirmHandle = 0;
+	this->confirmStatus = ZFailure;
+	this->receiveCallBack = NULL;
+	this->stateCallBack = NULL;
+	this->confirmCallBack = NULL;
+	this->confirmArg = NULL;
+	memset(&this->confirmMetrics, 0, sizeof(this->confirmMetrics));
 }
 
-bool Z_stack::init(START_OPT startOpt, LOGICAL_TYPE logicalType, uint16_t panID){
+/**
+	* @brief  register AREQ handlers, reset the ZNP if needed and write the
+	*					network config
+	* @param  uint32_t chanList - RF_CHANNEL bits, one channel to rejoin fast
+	* @retval true if the ZNP answered
+	* @note		call from a task once the ZNP task runs
+	*/
+bool Z_stack::init(START_OPT startOpt, LOGICAL_TYPE logicalType, uint16_t panID, uint32_t chanList){
 	bool retVal = true;
 	
+	if(this->startSem == NULL){
+		this->startSem = osSemaphoreCreate(osSemaphore(ZB_START), 1);
+		this->confirmSem = osSemaphoreCreate(osSemaphore(ZB_CONFIRM), 1);
+		this->sendMutex = osMutexCreate(osMutex(ZB_SEND));
+		if(this->startSem == NULL || this->confirmSem == NULL || this->sendMutex == NULL){
+			return false;
+		}
+		osSemaphoreWait(this->startSem, 0);
+		osSemaphoreWait(this->confirmSem, 0);
+		
+		this->znp->registerAREQ(Zb_startConfirm, AREQHandler, this);
+		this->znp->registerAREQ(Zb_stateChangeInd, AREQHandler, this);
+		this->znp->registerAREQ(Zb_sendDataConfirm, AREQHandler, this);
+		this->znp->registerAREQ(Zb_receiveDataIndication, AREQHandler, this);
+	}
+	
 	if(this->znp->isZNPInit() != true){
-		retVal = this->znp->init();
+		retVal = this->znp->reset();
 	}
 	if(retVal == false){
 		return retVal;
 	}
-	//this->writeConf(ZCD_NV_startupOption, startOpt);
-	this->writeConf(ZCD_NV_logicalType, logicalType);
-	this->writeConf(ZCD_NV_panID, panID);
-	this->writeConf(ZCD_NV_chanList, ZCD_chanList_allChannels);
+	this->updateConf(ZCD_NV_startupOption, startOpt);
+	this->updateConf(ZCD_NV_logicalType, logicalType);
+	this->updateConf(ZCD_NV_panID, panID);
+	this->updateConf(ZCD_NV_chanList, chanList);
 	return retVal;
 }
 
+/**
+	* @brief  send an SREQ and check the SRSP command
+	* @retval ZSuccess if the matching SRSP arrived
+	*/
+Z_stack::STATUS Z_stack::request(uint16_t cmd, uint8_t* txPtr, uint8_t len, CC2530::frame_s &srsp){
+	if(this->znp->SREQ(cmd, txPtr, len, srsp) != true){
+		return ZFailure;
+	}
+	if(srsp.cmd != (uint16_t)(cmd + 0x4000)){	// SRSP type bits 0x60 for SREQ 0x20
+		return ZFailure;
+	}
+	return ZSuccess;
+}
+
 Z_stack::STATUS Z_stack::writeConf(CONF_ID confID, conf_s &conf){
 	uint8_t data[20] ;
 	uint8_t dataLen = 2 + conf.Len;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
 	data[0] = confID;
 	data[1] = conf.Len;
 	memcpy(data + 2, conf.Buffer, conf.Len);
 
-	/* send SREQ command	*/
-	znp->SREQ(CC2530::ZB_WRITE_CONFIGURATION, data, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = znp->getRetCMD();
-	uint8_t  retLen = znp->getRetLen();
-	uint8_t* retData = znp->getRetData();
-
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_WRITE_CONFIGURATION_SRSP && retLen == 1) {
-		return (STATUS)retData[0];
+	/* send SREQ command, check SRSP message	*/
+	if (request(CC2530::ZB_WRITE_CONFIGURATION, data, dataLen, srsp) == ZSuccess && srsp.len == 1) {
+		return (STATUS)rsp[0];
 	}
 	return ZFailure;	
 }
@@ -106,18 +153,21 @@ Z_stack::STATUS Z_stack::readConf(CONF_ID confID, conf_s &conf) {
 	uint8_t data[1] = {confID};
 	uint8_t dataLen = 1;
 	STATUS retVal = ZFailure;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
 	/*	send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_READ_CONFIGURATION, data, dataLen);
-
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	uint8_t* retData_p = this->znp->getRetData();
-	retVal = (STATUS)retData_p[0];
+	if (request(CC2530::ZB_READ_CONFIGURATION, data, dataLen, srsp) != ZSuccess || srsp.len < 3) {
+		return ZFailure;
+	}
+	retVal = (STATUS)rsp[0];
 
-	if (retCMD == CC2530::ZB_READ_CONFIGURATION_SRSP && retVal == ZSuccess && retData_p[1] == confID) {
-		conf.Len = retData_p[2];
-		memcpy(conf.Buffer, retData_p + 3, conf.Len);
+	if (retVal == ZSuccess && rsp[1] == confID) {
+		conf.Len = (rsp[2] > sizeof(conf.Buffer)) ? sizeof(conf.Buffer) : rsp[2];
+		if (conf.Len > srsp.len - 3) {
+			return ZFailure;
+		}
+		memcpy(conf.Buffer, rsp + 3, conf.Len);
 	}
 	return retVal;
 }
@@ -148,8 +198,24 @@ Z_stack::STATUS Z_stack::readConf(CONF_ID confID, uint32_t &retConfVal) {
 	return retVal;
 }
 
+/**
+	* @brief  write a config item only if NV holds another value, saves
+	*					flash wear and a write on every boot
+	* @retval ZSuccess if NV holds confVal
+	*/
+Z_stack::STATUS Z_stack::updateConf(CONF_ID confID, uint32_t confVal) {
+	uint32_t nvVal;
+
+	if (readConf(confID, nvVal) == ZSuccess && nvVal == confVal) {
+		return ZSuccess;
+	}
+	return writeConf(confID, confVal);
+}
+
 Z_stack::STATUS Z_stack::appReg(AppReg_s &AppReg) {
 	STATUS retVal = ZFailure;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 	uint8_t* data_p = new uint8_t [9 + 2*(AppReg.inputCmdNum + AppReg.outputCmdNum)];
 	uint8_t dataLen = 9 + 2*(AppReg.inputCmdNum + AppReg.outputCmdNum);
 
@@ -169,39 +235,29 @@ Z_stack::STATUS Z_stack::appReg(AppReg_s &AppReg) {
 	}
 	/*	copy 16bit output cmdID*/
 	data_p[8 + 2 * AppReg.inputCmdNum] = AppReg.outputCmdNum;
-	for (uint8_t index = 0; index < AppReg.inputCmdNum; index++) {
-		data_p[9 + 2 * AppReg.inputCmdNum + 2 * index] = (uint8_t)AppReg.inputCmd[index];
-		data_p[9 + 2 * AppReg.inputCmdNum + 2 * index + 1] = (uint8_t)(AppReg.inputCmd[index] >> 8);
+	for (uint8_t index = 0; index < AppReg.outputCmdNum; index++) {
+		data_p[9 + 2 * AppReg.inputCmdNum + 2 * index] = (uint8_t)AppReg.outputCmd[index];
+		data_p[9 + 2 * AppReg.inputCmdNum + 2 * index + 1] = (uint8_t)(AppReg.outputCmd[index] >> 8);
 	}
 
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_APP_REGISTER_REQUEST, data_p, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	uint8_t  retLen = this->znp->getRetLen();
-	uint8_t* retData = this->znp->getRetData();
-
-	delete [] data_p;
-
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_APP_REGISTER_REQUEST_SRSP && retLen == 1) {
-		retVal = (STATUS)retData[0];
+	/*	Send SREQ command, check SRSP message	*/
+	if (request(CC2530::ZB_APP_REGISTER_REQUEST, data_p, dataLen, srsp) == ZSuccess && srsp.len == 1) {
+		retVal = (STATUS)rsp[0];
 	}
+	delete [] data_p;
 	return retVal;
 }
 
 Z_stack::STATUS Z_stack::startReq(void) {
 	STATUS retVal = ZFailure;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_START_REQUEST, NULL, 0);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
+	osSemaphoreWait(this->startSem, 0); // drop an old confirm
+	this->startStatus = Zb_startTimeout;
 
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_START_REQUEST_SRSP ) {
-		retVal = ZSuccess;
-	}
+	/*	Send SREQ command, check SRSP message	*/
+	retVal = request(CC2530::ZB_START_REQUEST, NULL, 0, srsp);
 	return retVal;
 }
 
@@ -209,21 +265,16 @@ Z_stack::STATUS Z_stack::permitJoinReq(uint16_t destAddr, uint8_t timeOut) {
 	STATUS retVal = ZFailure;
 	uint8_t data[3];
 	uint8_t dataLen = 3;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
 	data[0] = (uint8_t)destAddr;
 	data[1] = (uint8_t)(destAddr >> 8);
 	data[2] = timeOut;
 
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_PERMIT_JOINING_REQUEST, data, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	uint8_t  retLen = this->znp->getRetLen();
-	uint8_t* retData = this->znp->getRetData();
-
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_PERMIT_JOINING_REQUEST_SRSP && retLen == 1) {
-		retVal = (STATUS)retData[0];
+	/*	Send SREQ command, check SRSP message	*/
+	if (request(CC2530::ZB_PERMIT_JOINING_REQUEST, data, dataLen, srsp) == ZSuccess && srsp.len == 1) {
+		retVal = (STATUS)rsp[0];
 	}
 	return retVal;
 }
@@ -233,11 +284,13 @@ Z_stack::STATUS Z_stack::bindDevice(bool create, uint16_t cmdID, uint8_t* ieeeAd
 	STATUS retVal = ZFailure;
 	uint8_t data[11];
 	uint8_t dataLen = 11;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
 	data[0] = create;
 	data[1] = (uint8_t)cmdID;
 	data[2] = (uint8_t)(cmdID >> 8);
-	for (uint8_t index; index < 8; index++) {
+	for (uint8_t index = 0; index < 8; index++) {
 		if (ieeeAddr != NULL) {
 			data[3 + index] = ieeeAddr[index];
 		} else {
@@ -245,14 +298,8 @@ Z_stack::STATUS Z_stack::bindDevice(bool create, uint16_t cmdID, uint8_t* ieeeAd
 		}
 	}
 
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_BIND_DEVICE, data, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_BIND_DEVICE_SRSP) {
-		retVal = ZSuccess;
-	}
+	/*	Send SREQ command, check SRSP message	*/
+	retVal = request(CC2530::ZB_BIND_DEVICE, data, dataLen, srsp);
 	return retVal;
 }
 
@@ -260,51 +307,71 @@ Z_stack::STATUS Z_stack::allowBind(uint8_t timeOut) {
 	STATUS retVal = ZFailure;
 	uint8_t data[1];
 	uint8_t dataLen = 1;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
 	data[0] = timeOut;
 
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_ALLOW_BIND, data, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_ALLOW_BIND_SRSP) {
-		retVal = ZSuccess;
-	}
+	/*	Send SREQ command, check SRSP message	*/
+	retVal = request(CC2530::ZB_ALLOW_BIND, data, dataLen, srsp);
 	return retVal;
 }
 
 
 Z_stack::STATUS Z_stack::sendDataReq(TxPacket_s &txPacket, bool ack, uint8_t radius) {
 	STATUS retVal = ZFailure;
-	uint8_t data_p[100];
-	uint8_t dataLen = 8 + txPacket.len;
+	ZNPBuffer* payload;
 
-	if(txPacket.txPtr == NULL) {	// TxBuf_p must point to static memory
+	if (txPacket.txPtr == NULL || txPacket.len > ZB_MAX_DATA) {
+		return retVal;
+	}
+	payload = ZNPBuffer::alloc(ZB_DATA_HEADROOM);
+	if (payload == NULL) {
 		return retVal;
 	}
+	memcpy(payload->append(txPacket.len), txPacket.txPtr, txPacket.len);
+	retVal = sendDataReq(txPacket, payload, ack, radius);
+	payload->release();
+	return retVal;
+}
+
+/**
+	* @brief  send data from a pooled buffer, the header is built in its headroom
+	* @param  TxPacket_s &txPacket - txPtr/len are ignored
+	* @param  ZNPBuffer* payload - at least ZB_DATA_HEADROOM bytes of headroom,
+	*					left as it was so it can be sent again
+	* @param  bool ack, uint8_t radius
+	* @retval status
+	*/
+Z_stack::STATUS Z_stack::sendDataReq(TxPacket_s &txPacket, ZNPBuffer* payload, bool ack, uint8_t radius) {
+	STATUS retVal = ZFailure;
+	uint8_t* header;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
-	data_p[0] = (uint8_t)txPacket.dstAddr;
-	data_p[1] = (uint8_t)(txPacket.dstAddr >> 8);
-	data_p[2] = (uint8_t)txPacket.cmdID;
-	data_p[3] = (uint8_t)(txPacket.cmdID >> 8);
-	data_p[4] = txPacket.handle;
-	data_p[5] = ack;
-	data_p[6] = radius;
-	data_p[7] = txPacket.len;
-	for (uint8_t index = 0; index < txPacket.len; index++) {
-		data_p[8 + index] = txPacket.txPtr[index];
+	/* still referenced by the driver after a timed out request */
+	if (payload == NULL || payload->getRefs() > 1 || payload->getLen() > ZB_MAX_DATA) {
+		return retVal;
+	}
+	txPacket.len = payload->getLen();
+	header = payload->push(ZB_DATA_HEADER);
+	if (header == NULL) {
+		return retVal;
 	}
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_SEND_DATA_REQUEST, data_p, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	uint8_t  retLen = this->znp->getRetLen();
-
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_SEND_DATA_REQUEST_SRSP && retLen == 0) {
+	header[0] = (uint8_t)txPacket.dstAddr;
+	header[1] = (uint8_t)(txPacket.dstAddr >> 8);
+	header[2] = (uint8_t)txPacket.cmdID;
+	header[3] = (uint8_t)(txPacket.cmdID >> 8);
+	header[4] = txPacket.handle;
+	header[5] = ack;
+	header[6] = radius;
+	header[7] = txPacket.len;
+	/*	Send SREQ command, check SRSP message	*/
+	if (this->znp->SREQ(CC2530::ZB_SEND_DATA_REQUEST, payload, srsp) == true
+			&& srsp.cmd == (uint16_t)(CC2530::ZB_SEND_DATA_REQUEST + 0x4000) && srsp.len == 0) {
 		retVal = ZSuccess;
 	}
+	payload->pull(ZB_DATA_HEADER);
 	return retVal;
 }
 
@@ -312,16 +379,12 @@ Z_stack::STATUS Z_stack::getDeviceInfo(DeviceInfo_s &deviceinfo) {
 	STATUS retVal = ZFailure;
 	uint8_t data[1] = {deviceinfo.infoParam};
 	uint8_t dataLen = 1;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_GET_DEVICE_INFO, data, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-	uint8_t  retLen = this->znp->getRetLen();
-	uint8_t *retData = this->znp->getRetData();
-
-	/* check SRSP message	*/
-	if (retCMD == CC2530::ZB_GET_DEVICE_INFO_SRSP && retData[0] == deviceinfo.infoParam) {
+	/*	Send SREQ command, check SRSP message	*/
+	if (request(CC2530::ZB_GET_DEVICE_INFO, data, dataLen, srsp) == ZSuccess && srsp.len == 9
+			&& rsp[0] == deviceinfo.infoParam) {
 		retVal = ZSuccess;
 
 		switch (deviceinfo.infoParam) {
@@ -342,7 +405,7 @@ Z_stack::STATUS Z_stack::getDeviceInfo(DeviceInfo_s &deviceinfo) {
     default:
         break;
 		}
-		memcpy(deviceinfo.value, retData +1, deviceinfo.len);
+		memcpy(deviceinfo.value, rsp + 1, deviceinfo.len);
 	}
 	return retVal;
 }
@@ -351,86 +414,153 @@ Z_stack::STATUS Z_stack::findDeviceReq(uint8_t* ieeeAddr) {
 	STATUS retVal = ZFailure;
 	uint8_t data[8] = {0};
 	uint8_t dataLen = 8;
+	uint8_t rsp[ZB_SRSP_BUFFER];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, ZB_SRSP_BUFFER, rsp};
 
 	/* copy 64bit ieee address to search	*/
 	memcpy(data, ieeeAddr, 8);
-	/*	Send SREQ command	*/
-	this->znp->SREQ(CC2530::ZB_FIND_DEVICE_REQUEST, data, dataLen);
-	/* get SRSP message	*/
-	uint16_t retCMD = this->znp->getRetCMD();
-
-	if (retCMD == CC2530::ZB_FIND_DEVICE_REQUEST_SRSP) {
-		retVal = ZSuccess;
-	}
+	/*	Send SREQ command, check SRSP message	*/
+	retVal = request(CC2530::ZB_FIND_DEVICE_REQUEST, data, dataLen, srsp);
 	return retVal;
 }
 
-Z_stack::CALLBACK_TYPE Z_stack::getCallBack(void) {
-	CALLBACK_TYPE retCallBack = Zb_noCallback;
-
-	/*	check new message	*/
-	if (znp->checkNewMes() == true) {
-		/* get callback data*/
-		uint16_t retCMD = this->znp->getRetCMD();
-		uint8_t  retLen = this->znp->getRetLen();
-		uint8_t *retData = this->znp->getRetData();
-
-		switch (retCMD) {
-    case Zb_startConfirm:
-    case Zb_stateChangeInd:
-    case Zb_bindConfirm:
-    case Zb_allowBindConfirm:
-    case Zb_sendDataConfirm:
-    case Zb_receiveDataIndication:
-    case Zb_findDeviceConfirm:
-    	retCallBack = (CALLBACK_TYPE)retCMD;
-    	this->lastCallBack = retCallBack;
-    	this->callBackLen = retLen;
-    	memcpy(this->callBackData, retData, this->callBackLen);
-    	break;
-    default:
-    	retCallBack = Zb_otherCallBack;
-    	break;
-		}
-	}
-	return retCallBack;
+/**
+	* @brief  AREQ trampoline registered in the ZNP callback table
+	*/
+void Z_stack::AREQHandler(uint16_t cmd, ZNPBuffer* frame, void* arg) {
+	((Z_stack*)arg)->handleAREQ(cmd, frame);
 }
 
-Z_stack::START_COMFIRM_STATUS	Z_stack::startComfirm(void) {
-	return (START_COMFIRM_STATUS)this->callBackData[0];
+/**
+	* @brief  complete waiters and forward indications, runs in the ZNP task
+	*/
+void Z_stack::handleAREQ(uint16_t cmd, ZNPBuffer* frame) {
+	RxPacket_s rxPacket;
+	uint8_t* data = frame->getData();
+	uint8_t len = frame->getLen();
+
+	switch (cmd) {
+	case Zb_startConfirm:
+		if (len >= 1) {
+			this->startStatus = (START_COMFIRM_STATUS)data[0];
+			osSemaphoreRelease(this->startSem);
+		}
+		break;
+	case Zb_sendDataConfirm:
+		if (len >= 2) {
+			this->confirmHandle = data[0];
+			this->confirmStatus = (STATUS)data[1];
+			this->countConfirm((STATUS)data[1]);
+			if (this->confirmCallBack != NULL) {
+				this->confirmCallBack(data[0], (STATUS)data[1], this->confirmArg);
+			}
+			osSemaphoreRelease(this->confirmSem);
+		}
+		break;
+	case Zb_stateChangeInd:
+		if (len >= 1 && this->stateCallBack != NULL) {
+			this->stateCallBack((STATE_CHANGE)data[0]);
+		}
+		break;
+	case Zb_receiveDataIndication:
+		if (len >= 6 && this->receiveCallBack != NULL) {
+			rxPacket.srcAddr = (uint16_t)(data[1] << 8) + data[0];
+			rxPacket.cmdID = (uint16_t)(data[3] << 8) + data[2];
+			rxPacket.len = (uint16_t)(data[5] << 8) + data[4];
+			rxPacket.rxPtr = data + 6;
+			rxPacket.frame = frame;
+			if (rxPacket.len > len - 6) {
+				rxPacket.len = len - 6; // truncated by the transport
+			}
+			this->receiveCallBack(rxPacket);
+		}
+		break;
+	default:
+		break;
+	}
 }
 
-Z_stack::STATE_CHANGE Z_stack::stateChangeInd(void){
-    return (STATE_CHANGE)this->callBackData[0];
+/* ZB_SEND_DATA_CONFIRM results by status code */
+void Z_stack::countConfirm(STATUS status) {
+	if (status == ZSuccess) {
+		this->confirmMetrics.success++;
+		return;
+	}
+	this->confirmMetrics.failure++;
+	for (uint8_t i = 0; i < ZB_CONFIRM_CODES; i++) {
+		if (this->confirmMetrics.code[i].count == 0) {
+			this->confirmMetrics.code[i].status = status;
+		}
+		if (this->confirmMetrics.code[i].status == status) {
+			this->confirmMetrics.code[i].count++;
+			return;
+		}
+	}
+	this->confirmMetrics.other++;
 }
 
-Z_stack::STATUS	Z_stack::bindComfirm(uint16_t &bindCmdID) {
-	bindCmdID = (uint16_t)(this->callBackData[1] << 8) + this->callBackData[0];
-	return (STATUS)this->callBackData[2];
+void Z_stack::getConfirmMetrics(ConfirmMetrics_s &metrics) {
+	__disable_irq();
+	metrics = this->confirmMetrics;
+	__enable_irq();
 }
 
-Z_stack::STATUS Z_stack::allowBindComfirm(uint16_t &srcAddr) {
-	srcAddr = (uint16_t)(this->callBackData[1] << 8) + this->callBackData[0];
+/**
+	* @brief  wait for ZB_START_CONFIRM after startReq
+	* @param  uint32_t timeout - in ms
+	* @retval confirm status, Zb_startTimeout if none
+	*/
+Z_stack::START_COMFIRM_STATUS Z_stack::waitStartConfirm(uint32_t timeout) {
+	if (osSemaphoreWait(this->startSem, timeout) != osOK) {
+		return Zb_startTimeout;
+	}
+	return this->startStatus;
 }
 
-Z_stack::STATUS Z_stack::sendDataComfirm(TxPacket_s &txPacket) {
-	STATUS retVal = ZFailure;
-	if (txPacket.handle == this->callBackData[0]) {
-		retVal = (STATUS)this->callBackData[1];
+/**
+	* @brief  wait for the ZB_SEND_DATA_CONFIRM of a handle
+	* @param  uint8_t handle
+	* @param  uint32_t timeout - in ms
+	* @retval confirm status, zdoTimeout if none
+	* @note		confirms of other handles are dropped
+	*/
+Z_stack::STATUS Z_stack::waitSendDataConfirm(uint8_t handle, uint32_t timeout) {
+	uint32_t start = osKernelSysTick();
+	uint32_t elapsed = 0;
+
+	while (elapsed < timeout) {
+		if (osSemaphoreWait(this->confirmSem, timeout - elapsed) != osOK) {
+			break;
+		}
+		if (this->confirmHandle == handle) {
+			return this->confirmStatus;
+		}
+		elapsed = osKernelSysTick() - start;
 	}
-	return retVal;
+	return zdoTimeout;
 }
 
-void Z_stack::receiveDataIndication(RxPacket_s &rxPacket) {
-	rxPacket.srcAddr = (uint16_t)(this->callBackData[1] << 8) + this->callBackData[0];
-	rxPacket.cmdID = (uint16_t)(this->callBackData[3] << 8) + this->callBackData[2];
-	rxPacket.len = (uint16_t)(this->callBackData[5] << 8) + this->callBackData[4];
-	rxPacket.rxPtr = this->callBackData + 5;
-}
+/**
+	* @brief  send data and wait for its confirm
+	* @param  TxPacket_s &txPacket
+	* @param  bool ack, uint8_t radius
+	* @param  uint32_t timeout - confirm timeout in ms
+	* @retval confirm status
+	* @note		one packet in flight, callers from other tasks wait their turn
+	*/
+Z_stack::STATUS Z_stack::sendData(TxPacket_s &txPacket, bool ack, uint8_t radius, uint32_t timeout) {
+	STATUS retVal;
 
-void Z_stack::findDeviceComfirm(uint8_t *&ieeeAddr,uint16_t& resultAddr) {
-	ieeeAddr = this->callBackData + 3;
-	resultAddr =  (uint16_t)(this->callBackData[2] << 8) + this->callBackData[1];
+	if (osMutexWait(this->sendMutex, timeout) != osOK) {
+		return zdoTimeout;
+	}
+	osSemaphoreWait(this->confirmSem, 0); // drop a late confirm
+	retVal = this->sendDataReq(txPacket, ack, radius);
+	if (retVal == ZSuccess) {
+		retVal = this->waitSendDataConfirm(txPacket.handle, timeout);
+	}
+	osMutexRelease(this->sendMutex);
+	return retVal;
 }
 
 } /* hv_driver namespace */
\ No newline at end of file
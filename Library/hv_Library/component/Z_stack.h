@@ -150,6 +150,16 @@ enum CALLBACK_TYPE {
 enum START_COMFIRM_STATUS {
     Zb_success = 0x00,
     Zb_init = 0x22,
+    Zb_startTimeout = 0xFF,
+};
+
+enum ZB_PARAM {
+	ZB_SRSP_BUFFER = 16,					// longest SRSP parsed here (read configuration)
+	ZB_CONFIRM_TIMEOUT = 3000,		// ms, ZB_SEND_DATA_CONFIRM after request
+	ZB_CONFIRM_CODES = 6,					// failure codes counted one by one
+	ZB_DATA_HEADER = 8,						// ZB_SEND_DATA_REQUEST header before the payload
+	ZB_DATA_HEADROOM = ZNPBuffer::ZNP_SPI_HEADER + ZB_DATA_HEADER,
+	ZB_MAX_DATA = CC2530::ZNP_MAX_PAYLOAD - ZB_DATA_HEADER,
 };
 
 /*	for state change index callback	*/
@@ -196,6 +206,7 @@ typedef struct {
 	uint16_t cmdID;
 	uint16_t len;
 	uint8_t* rxPtr;
+	ZNPBuffer* frame;		// holds rxPtr, retain() it to keep the data after the callback
 } RxPacket_s;
 
 typedef struct {
@@ -205,14 +216,30 @@ typedef struct {
 	uint8_t value[8];
 } DeviceInfo_s;
 
+typedef struct {
+	uint32_t success;
+	uint32_t failure;
+	uint32_t other;				// failures with a code not in the table
+	struct {
+		uint8_t status;
+		uint32_t count;
+	} code[ZB_CONFIRM_CODES];
+} ConfirmMetrics_s;
+
+typedef void (*ReceiveCallBack_t)(RxPacket_s &rxPacket);
+typedef void (*StateCallBack_t)(STATE_CHANGE state);
+typedef void (*ConfirmCallBack_t)(uint8_t handle, STATUS status, void* arg);
+
 public:
 	Z_stack(CC2530* znp);
 	
-	bool init(START_OPT startOpt, LOGICAL_TYPE logicalType, uint16_t panID);
+	bool init(START_OPT startOpt, LOGICAL_TYPE logicalType, uint16_t panID,
+						uint32_t chanList = ZCD_chanList_allChannels);
 	STATUS writeConf(CONF_ID confID, conf_s &conf);
 	STATUS writeConf(CONF_ID confID, uint32_t confVal);
 	STATUS readConf(CONF_ID confID, conf_s &conf);
 	STATUS readConf(CONF_ID confID, uint32_t &retConfVal);
+	STATUS updateConf(CONF_ID confID, uint32_t confVal);
 
 	STATUS appReg(AppReg_s &AppReg);
 	STATUS startReq(void);
@@ -220,22 +247,35 @@ public:
 	STATUS bindDevice(bool create, uint16_t cmdID, uint8_t* ieeeAddr);
 	STATUS allowBind(uint8_t timeOut);
 	STATUS sendDataReq(TxPacket_s &txPacket, bool ack, uint8_t radius);
+	STATUS sendDataReq(TxPacket_s &txPacket, ZNPBuffer* payload, bool ack, uint8_t radius);
 	STATUS getDeviceInfo(DeviceInfo_s &deviceinfo);
 	STATUS findDeviceReq(uint8_t* ieeeAddr);
 
-	CALLBACK_TYPE 				getCallBack(void);
-	START_COMFIRM_STATUS	startComfirm(void);
-	STATE_CHANGE 					stateChangeInd (void);
-								 STATUS bindComfirm(uint16_t &bindCmdID);
-								 STATUS allowBindComfirm(uint16_t &srcAddr);
-								 STATUS sendDataComfirm(TxPacket_s &txPacket);
-									 void receiveDataIndication(RxPacket_s &rxPacket);
-									 void findDeviceComfirm(uint8_t *&ieeeAddr,uint16_t &resultAddr);
+	STATUS sendData(TxPacket_s &txPacket, bool ack, uint8_t radius, uint32_t timeout = ZB_CONFIRM_TIMEOUT);
+	START_COMFIRM_STATUS waitStartConfirm(uint32_t timeout);
+	STATUS waitSendDataConfirm(uint8_t handle, uint32_t timeout);
+	void setReceiveCallBack(ReceiveCallBack_t callBack){this->receiveCallBack = callBack;}
+	void setStateCallBack(StateCallBack_t callBack){this->stateCallBack = callBack;}
+	void setConfirmCallBack(ConfirmCallBack_t callBack, void* arg){this->confirmArg = arg; this->confirmCallBack = callBack;}
+	void getConfirmMetrics(ConfirmMetrics_s &metrics);
 private:	
+	static void AREQHandler(uint16_t cmd, ZNPBuffer* frame, void* arg);
+	void handleAREQ(uint16_t cmd, ZNPBuffer* frame);
+	void countConfirm(STATUS status);
+	STATUS request(uint16_t cmd, uint8_t* txPtr, uint8_t len, CC2530::frame_s &srsp);
+
 	CC2530* znp;
-	CALLBACK_TYPE lastCallBack;
-	uint8_t callBackLen;
-	uint8_t callBackData[100];
+	osSemaphoreId startSem;
+	osSemaphoreId confirmSem;
+	osMutexId sendMutex;
+	__IO START_COMFIRM_STATUS startStatus;
+	__IO uint8_t confirmHandle;
+	__IO STATUS confirmStatus;
+	ReceiveCallBack_t receiveCallBack;
+	StateCallBack_t stateCallBack;
+	ConfirmCallBack_t confirmCallBack;
+	void* confirmArg;
+	ConfirmMetrics_s confirmMetrics;	// written by the ZNP task
 };	
 } /* hv_driver namespace */
 
@@ -19,26 +19,54 @@ ILI9163::ILI9163(SPI* spi, GPIO* csPin, GPIO* A0Pin, GPIO* rstPin, GPIO* BLPin){
 	this->A0Pin = A0Pin;
 	this->rstPin = rstPin;
 	this->BLPin = BLPin;
+	this->initState = INIT_RESET;
 }
 
+/**
+	* @brief  blocking init, for use before the scheduler starts
+	*/
 void ILI9163::init(void){
-	this->csPin->initOutput(GPIO::PP, GPIO::MEDIUM);
-	this->A0Pin->initOutput(GPIO::PP, GPIO::MEDIUM);
-	this->rstPin->initOutput(GPIO::PP, GPIO::MEDIUM);
-	this->BLPin->initOutput(GPIO::PP, GPIO::MEDIUM);
-	
-	__HAL_RCC_SPI2_CLK_ENABLE();
-	this->spi->init(SPI::MASTER, SPI::BAUDRATE_DIV2, SPI::NSS_SOFT, SPI::CPHA_1EDGE, SPI::CPOL_LOW);
-	
-	this->rstPin->reset();
-	Sys_Delayms(20);
-  this->rstPin->set();
-	Sys_Delayms(20);
-  this->csPin->reset();	
-	
-	this->sendCMD(0x01);
-	this->sendCMD(0x11);
-	Sys_Delayms(20);
+	uint16_t wait;
+
+	this->initState = INIT_RESET;
+	while((wait = this->initStep()) != 0){
+		Sys_Delayms(wait);
+	}
+}
+
+/**
+	* @brief  resumable init, one state per call
+	* @retval ms to wait before the next call, 0 when the panel is on
+	*/
+uint16_t ILI9163::initStep(void){
+	switch(this->initState){
+		case INIT_RESET:
+			this->csPin->initOutput(GPIO::PP, GPIO::MEDIUM);
+			this->A0Pin->initOutput(GPIO::PP, GPIO::MEDIUM);
+			this->rstPin->initOutput(GPIO::PP, GPIO::MEDIUM);
+			this->BLPin->initOutput(GPIO::PP, GPIO::MEDIUM);
+			
+			__HAL_RCC_SPI2_CLK_ENABLE();
+			this->spi->init(SPI::MASTER, SPI::BAUDRATE_DIV2, SPI::NSS_SOFT, SPI::CPHA_1EDGE, SPI::CPOL_LOW);
+			
+			this->rstPin->reset();
+			this->initState = INIT_RELEASE;
+			return 20;
+		case INIT_RELEASE:
+			this->rstPin->set();
+			this->initState = INIT_WAKE;
+			return 20;
+		case INIT_WAKE:
+			this->csPin->reset();	
+			this->sendCMD(0x01);
+			this->sendCMD(0x11);
+			this->initState = INIT_CONFIG;
+			return 20;
+		case INIT_CONFIG:
+			break;
+		default:
+			return 0;
+	}
 	
 	this->sendCMD(0x26);
 	this->sendByte(0x04);
@@ -74,6 +102,8 @@ void ILI9163::init(void){
 	this->invertMode(false);
 	//this->setScreen(0xFFFF);
 	this->BLPin->set();
+	this->initState = INIT_DONE;
+	return 0;
 }
 
 void ILI9163::setAddress(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2){
@@ -20,10 +20,16 @@
 namespace hv_driver {
 
 class ILI9163 {
+public:
+enum INIT_STATE {
+	INIT_RESET = 0, INIT_RELEASE, INIT_WAKE, INIT_CONFIG, INIT_DONE
+};
 public:
 	ILI9163(SPI* spi, GPIO* csPin, GPIO* A0Pin, GPIO* rstPin, GPIO* BLPin);
 
 	void init(void);
+	uint16_t initStep(void);
+	INIT_STATE getInitState(void){return this->initState;}
 
 	void setAddress(uint8_t x1, uint8_t y1, uint8_t x2, uint8_t y2);
 	void setScreen(uint16_t color);
@@ -46,6 +52,7 @@ private:
 	GPIO* A0Pin;
 	GPIO* rstPin;
 	GPIO* BLPin;
+	INIT_STATE initState;
 };	
 
 }
@@ -0,0 +1,48 @@
+/**
+  ******************************************************************************
+ * @file    Check.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Assertions for the host tests
+ *
+ *	A failed check prints where and carries on, main returns
+ *	Check_result() so ctest sees the failure.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+static int Check_failures = 0;
+static int Check_count = 0;
+
+static inline bool Check_assert(bool cond, const char* text, const char* file, int line) {
+	Check_count++;
+	if (cond != true) {
+		Check_failures++;
+		fprintf(stderr, "%s:%d: check failed: %s\n", file, line, text);
+	}
+	return cond;
+}
+
+static inline bool Check_equal(long long a, long long b, const char* text, const char* file, int line) {
+	Check_count++;
+	if (a != b) {
+		Check_failures++;
+		fprintf(stderr, "%s:%d: check failed: %s (%lld != %lld)\n", file, line, text, a, b);
+	}
+	return (a == b);
+}
+
+static inline int Check_result(void) {
+	printf("%d checks, %d failed\n", Check_count, Check_failures);
+	return (Check_failures == 0) ? 0 : 1;
+}
+
+#define CHECK(cond) Check_assert((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b) Check_equal((long long)(a), (long long)(b), #a " == " #b, __FILE__, __LINE__)
+
+#endif /* CHECK_H */
@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+ * @file    HostHal.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   HAL stand-in for the host tests
+  */
+//-------------------------------------------------------------------------
+#include "HostHal.h"
+#include <string.h>
+
+hostFlash_s Host_flash = {0, 0, -1};
+void (*Host_stopHook)(void) = NULL;
+
+static bool Host_flashPower(void) {
+	if (Host_flash.failAfter == 0) {
+		return false;
+	}
+	if (Host_flash.failAfter > 0) {
+		Host_flash.failAfter--;
+	}
+	return true;
+}
+
+uint32_t Host_adcRankChannel(ADC_TypeDef* ADCx, uint8_t rank) {
+	if (rank <= 6) {
+		return (ADCx->SQR3 >> (5 * (rank - 1))) & 0x1F;
+	}
+	if (rank <= 12) {
+		return (ADCx->SQR2 >> (5 * (rank - 7))) & 0x1F;
+	}
+	return (ADCx->SQR1 >> (5 * (rank - 13))) & 0x1F;
+}
+
+extern "C" {
+
+HAL_StatusTypeDef HAL_Init(void) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_OscConfig(RCC_OscInitTypeDef* RCC_OscInitStruct) {
+	(void)RCC_OscInitStruct;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCC_ClockConfig(RCC_ClkInitTypeDef* RCC_ClkInitStruct, uint32_t FLatency) {
+	(void)RCC_ClkInitStruct;
+	(void)FLatency;
+	return HAL_OK;
+}
+
+void HAL_PWR_EnterSTOPMode(uint32_t Regulator, uint8_t STOPEntry) {
+	(void)Regulator;
+	(void)STOPEntry;
+	if (Host_stopHook != NULL) {
+		Host_stopHook();
+	}
+}
+
+/* the registers were brought up to date by whoever moved the clocks */
+HAL_StatusTypeDef HAL_RTC_WaitForSynchro(RTC_HandleTypeDef* hrtc) {
+	hrtc->Instance->CRL |= RTC_CRL_RSF;
+	return HAL_OK;
+}
+
+void HAL_PWR_EnableBkUpAccess(void) {
+	PWR->CR |= PWR_CR_DBP;
+}
+
+HAL_StatusTypeDef HAL_RTC_Init(RTC_HandleTypeDef* hrtc) {
+	uint32_t prescaler = (hrtc->Init.AsynchPrediv == RTC_AUTO_1_SECOND) ? LSE_VALUE - 1 : hrtc->Init.AsynchPrediv;
+
+	hrtc->Instance->PRLH = prescaler >> 16;
+	hrtc->Instance->PRLL = prescaler & 0xFFFF;
+	hrtc->State = HAL_RTC_STATE_READY;
+	return HAL_OK;
+}
+
+void HAL_RTCEx_BKUPWrite(RTC_HandleTypeDef* hrtc, uint32_t BackupRegister, uint32_t Data) {
+	(void)hrtc;
+	*(__IO uint32_t*)(uintptr_t)(BKP_BASE + BackupRegister * 4) = Data;
+}
+
+uint32_t HAL_RTCEx_BKUPRead(RTC_HandleTypeDef* hrtc, uint32_t BackupRegister) {
+	(void)hrtc;
+	return *(__IO uint32_t*)(uintptr_t)(BKP_BASE + BackupRegister * 4) & BKP_DR1_D;
+}
+
+HAL_StatusTypeDef HAL_RTCEx_SetSmoothCalib(RTC_HandleTypeDef* hrtc, uint32_t SmoothCalibPeriod, uint32_t SmoothCalibPlusPulses,
+		uint32_t SmouthCalibMinusPulsesValue) {
+	(void)hrtc;
+	(void)SmoothCalibPeriod;
+	(void)SmoothCalibPlusPulses;
+	MODIFY_REG(BKP->RTCCR, BKP_RTCCR_CAL, SmouthCalibMinusPulsesValue);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_RCCEx_PeriphCLKConfig(RCC_PeriphCLKInitTypeDef* PeriphClkInit) {
+	(void)PeriphClkInit;
+	return HAL_OK;
+}
+
+uint32_t HAL_RCC_GetPCLK2Freq(void) {
+	return SystemCoreClock;
+}
+
+uint32_t HAL_RCC_GetPCLK1Freq(void) {
+	return SystemCoreClock / 2;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_Init) {
+	(void)GPIOx;
+	(void)GPIO_Init;
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type IRQn, uint32_t PreemptPriority, uint32_t SubPriority) {
+	(void)SubPriority;
+	NVIC_SetPriority(IRQn, PreemptPriority);
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type IRQn) {
+	NVIC_EnableIRQ(IRQn);
+}
+
+void HAL_NVIC_DisableIRQ(IRQn_Type IRQn) {
+	/* ICER clears ISER on the target, plain memory here */
+	NVIC->ISER[(uint32_t)IRQn >> 5] &= ~(1UL << ((uint32_t)IRQn & 0x1F));
+}
+
+void HAL_NVIC_ClearPendingIRQ(IRQn_Type IRQn) {
+	/* ICPR clears ISPR on the target */
+	NVIC->ISPR[(uint32_t)IRQn >> 5] &= ~(1UL << ((uint32_t)IRQn & 0x1F));
+}
+
+HAL_StatusTypeDef HAL_ADC_Init(ADC_HandleTypeDef* hadc) {
+	MODIFY_REG(hadc->Instance->CR1, ADC_CR1_SCAN, (hadc->Init.ScanConvMode == ADC_SCAN_ENABLE) ? ADC_CR1_SCAN : 0);
+	MODIFY_REG(hadc->Instance->CR2, ADC_CR2_EXTSEL | ADC_CR2_EXTTRIG | ADC_CR2_CONT,
+						 hadc->Init.ExternalTrigConv | ADC_CR2_EXTTRIG
+						 | ((hadc->Init.ContinuousConvMode == ENABLE) ? ADC_CR2_CONT : 0));
+	hadc->State = HAL_ADC_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADCEx_Calibration_Start(ADC_HandleTypeDef* hadc) {
+	(void)hadc;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_ConfigChannel(ADC_HandleTypeDef* hadc, ADC_ChannelConfTypeDef* sConfig) {
+	uint32_t shift;
+
+	if (sConfig->Rank <= 6) {
+		shift = 5 * (sConfig->Rank - 1);
+		MODIFY_REG(hadc->Instance->SQR3, 0x1FUL << shift, sConfig->Channel << shift);
+	} else if (sConfig->Rank <= 12) {
+		shift = 5 * (sConfig->Rank - 7);
+		MODIFY_REG(hadc->Instance->SQR2, 0x1FUL << shift, sConfig->Channel << shift);
+	} else {
+		shift = 5 * (sConfig->Rank - 13);
+		MODIFY_REG(hadc->Instance->SQR1, 0x1FUL << shift, sConfig->Channel << shift);
+	}
+	if (sConfig->Channel < 10) {
+		MODIFY_REG(hadc->Instance->SMPR2, 0x7UL << (3 * sConfig->Channel), sConfig->SamplingTime << (3 * sConfig->Channel));
+	} else {
+		shift = 3 * (sConfig->Channel - 10);
+		MODIFY_REG(hadc->Instance->SMPR1, 0x7UL << shift, sConfig->SamplingTime << shift);
+	}
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start(ADC_HandleTypeDef* hadc) {
+	SET_BIT(hadc->Instance->CR2, ADC_CR2_ADON);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_ADC_Stop(ADC_HandleTypeDef* hadc) {
+	CLEAR_BIT(hadc->Instance->CR2, ADC_CR2_ADON);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Init(TIM_HandleTypeDef* htim) {
+	htim->Instance->PSC = htim->Init.Prescaler;
+	htim->Instance->ARR = htim->Init.Period;
+	htim->State = HAL_TIM_STATE_READY;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIMEx_MasterConfigSynchronization(TIM_HandleTypeDef* htim, TIM_MasterConfigTypeDef* sMasterConfig) {
+	MODIFY_REG(htim->Instance->CR2, TIM_CR2_MMS, sMasterConfig->MasterOutputTrigger);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Start(TIM_HandleTypeDef* htim) {
+	SET_BIT(htim->Instance->CR1, TIM_CR1_CEN);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_TIM_Base_Stop(TIM_HandleTypeDef* htim) {
+	CLEAR_BIT(htim->Instance->CR1, TIM_CR1_CEN);
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void) {
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data) {
+	volatile uint16_t* halfWord = (volatile uint16_t*)(uintptr_t)Address;
+
+	if (TypeProgram != FLASH_TYPEPROGRAM_HALFWORD || (Address & 1) != 0 || Host_flashPower() != true) {
+		return HAL_ERROR;
+	}
+	if (*halfWord != 0xFFFF && (uint16_t)Data != 0x0000) {
+		return HAL_ERROR;
+	}
+	*halfWord = (uint16_t)Data;
+	Host_flash.programs++;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef* pEraseInit, uint32_t* PageError) {
+	*PageError = 0xFFFFFFFF;
+	for (uint32_t i = 0; i < pEraseInit->NbPages; i++) {
+		uint32_t address = pEraseInit->PageAddress + i * FLASH_PAGE_SIZE;
+		if (Host_flashPower() != true) {
+			*PageError = address;
+			return HAL_ERROR;
+		}
+		memset((void*)(uintptr_t)address, 0xFF, FLASH_PAGE_SIZE);
+		Host_flash.erases++;
+	}
+	return HAL_OK;
+}
+
+} /* extern "C" */
@@ -0,0 +1,37 @@
+/**
+  ******************************************************************************
+ * @file    HostHal.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   HAL stand-in for the host tests
+ *
+ *	Each HAL call the drivers make sets the register bits the real one
+ *	would and returns HAL_OK, there is no hardware behind them to wait on.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+#include "stm32f1xx.h"
+
+/* flash emulation behind HAL_FLASH_Program and HAL_FLASHEx_Erase: a half
+	 word is programmed only if erased or to 0x0000, anything else fails like
+	 PGERR. The power is lost after failAfter more operations, those fail. */
+typedef struct {
+	uint32_t erases;
+	uint32_t programs;
+	int32_t failAfter;		// -1 never
+} hostFlash_s;
+
+extern hostFlash_s Host_flash;
+
+/* called by HAL_PWR_EnterSTOPMode in place of the sleep, moves the clocks
+	 to the wake up. NULL wakes at once. */
+extern void (*Host_stopHook)(void);
+
+/* ADC channel of regular rank 1..16 as HAL_ADC_ConfigChannel set it */
+uint32_t Host_adcRankChannel(ADC_TypeDef* ADCx, uint8_t rank);
+
+#endif /* HOST_HAL_H */
@@ -0,0 +1,616 @@
+/**
+  ******************************************************************************
+ * @file    HostRtos.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Virtual time stand-in for the CMSIS-RTOS calls
+  */
+//-------------------------------------------------------------------------
+#include "HostRtos.h"
+#include "HostSys.h"
+#include "HostTarget.h"
+#include "MISC.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+static const uint32_t HOST_TASK_NUM = 16;
+static const uint32_t HOST_SEM_NUM = 32;
+static const uint32_t HOST_EVENT_NUM = 32;
+static const uint32_t HOST_GROUP_NUM = 4;
+static const uint32_t HOST_IDLE_LIMIT = 86400000;	// ms asleep with nothing due, a deadlock
+static const size_t HOST_STACK_SIZE = 256 * 1024;	// bytes per task thread
+static const uint8_t HOST_STACK_PAINT = 0xA5;
+
+typedef struct host_sem_s host_sem_s;
+
+typedef struct {
+	EventBits_t bits;
+} host_group_s;
+
+typedef struct {
+	const char* name;
+	uint32_t priority;
+	os_pthread pthread;
+	void* argument;
+	pthread_t thread;
+	uint8_t* stack;					// painted, NULL for main
+	pthread_cond_t go;
+	bool isReady;
+	bool isDeleted;
+	uint32_t readySeq;			// FIFO among equal priorities
+	/* what a blocked task waits for */
+	bool isTimed;
+	uint32_t wakeTick;
+	bool waitNotify;
+	host_sem_s* waitSem;
+	bool isGiven;						// token handed over by a give
+	host_group_s* waitGroup;
+	EventBits_t waitBits;
+	bool isWaitAll;
+	bool isClearOnExit;
+	EventBits_t groupBits;		// event group value that ended the wait
+	bool isTimeout;
+	/* task notification */
+	uint32_t notifyValue;
+	bool isNotified;
+	uint32_t wakeups;
+} host_task_s;
+
+struct host_sem_s {
+	bool isMutex;
+	uint32_t count;
+	uint32_t max;
+	host_task_s* owner;
+};
+
+typedef struct {
+	bool isUsed;
+	uint32_t tick;
+	int32_t irqn;
+	void (*handler)(void);
+	uint32_t seq;
+} host_event_s;
+
+static pthread_mutex_t Host_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_task_s Host_tasks[HOST_TASK_NUM];
+static uint32_t Host_taskCount = 0;
+static host_task_s* Host_current = NULL;
+static host_sem_s Host_sems[HOST_SEM_NUM];
+static uint32_t Host_semCount = 0;
+static host_event_s Host_events[HOST_EVENT_NUM];
+static host_group_s Host_groups[HOST_GROUP_NUM];
+static uint32_t Host_groupCount = 0;
+static uint32_t Host_seq = 0;
+static uint32_t Host_switchCount = 0;
+
+static bool Host_inIsr(void) {
+	return Host_ipsr != 0;
+}
+
+static uint32_t Host_priority(osPriority priority) {
+	return (uint32_t)(priority - osPriorityIdle);
+}
+
+static host_task_s* Host_pickReady(void) {
+	host_task_s* best = NULL;
+
+	for (uint32_t i = 0; i < Host_taskCount; i++) {
+		host_task_s* task = &Host_tasks[i];
+		if (task->isReady == true && task->isDeleted != true) {
+			if (best == NULL || task->priority > best->priority
+					|| (task->priority == best->priority && task->readySeq < best->readySeq)) {
+				best = task;
+			}
+		}
+	}
+	return best;
+}
+
+/* the next due event, NULL if none is due at now */
+static host_event_s* Host_dueEvent(uint32_t now) {
+	host_event_s* next = NULL;
+
+	for (uint32_t i = 0; i < HOST_EVENT_NUM; i++) {
+		host_event_s* event = &Host_events[i];
+		if (event->isUsed == true && (int32_t)(now - event->tick) >= 0
+				&& (next == NULL || event->seq < next->seq)) {
+			next = event;
+		}
+	}
+	return next;
+}
+
+static bool Host_isPending(void) {
+	for (uint32_t i = 0; i < HOST_EVENT_NUM; i++) {
+		if (Host_events[i].isUsed == true) {
+			return true;
+		}
+	}
+	for (uint32_t i = 0; i < Host_taskCount; i++) {
+		if (Host_tasks[i].isReady != true && Host_tasks[i].isDeleted != true && Host_tasks[i].isTimed == true) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void Host_unblock(host_task_s* task) {
+	task->isReady = true;
+	task->isTimed = false;
+	task->waitNotify = false;
+	task->waitSem = NULL;
+	task->waitGroup = NULL;
+	task->readySeq = ++Host_seq;
+	task->wakeups++;
+}
+
+/* lock held, nothing ready: interrupts and time until a task is */
+static host_task_s* Host_idle(void) {
+	host_task_s* best;
+	uint32_t asleep = 0;
+
+	while ((best = Host_pickReady()) == NULL) {
+		host_event_s* event = Host_dueEvent(Sys_getTick());
+		if (event != NULL) {
+			int32_t irqn = event->irqn;
+			void (*handler)(void) = event->handler;
+			event->isUsed = false;
+			pthread_mutex_unlock(&Host_lock);
+			Host_irq(irqn, handler);
+			pthread_mutex_lock(&Host_lock);
+			continue;
+		}
+		if (++asleep > HOST_IDLE_LIMIT && Host_isPending() != true) {
+			fprintf(stderr, "HostRtos: every task blocked for good at tick %u\n", (unsigned)Sys_getTick());
+			abort();
+		}
+		pthread_mutex_unlock(&Host_lock);
+		Host_advance(1);
+		pthread_mutex_lock(&Host_lock);
+		for (uint32_t i = 0; i < Host_taskCount; i++) {
+			host_task_s* task = &Host_tasks[i];
+			if (task->isReady != true && task->isDeleted != true && task->isTimed == true
+					&& (int32_t)(Sys_getTick() - task->wakeTick) >= 0) {
+				task->isTimeout = true;
+				Host_unblock(task);
+			}
+		}
+	}
+	return best;
+}
+
+/* lock held, hand the CPU to the best ready task and wait for it back */
+static void Host_schedule(void) {
+	host_task_s* prev = Host_current;
+	host_task_s* next = Host_pickReady();
+
+	if (next == NULL) {
+		next = Host_idle();
+	}
+	if (next == prev) {
+		return;
+	}
+	Host_switchCount++;
+	Host_current = next;
+	pthread_cond_signal(&next->go);
+	if (prev->isDeleted == true) {
+		return;
+	}
+	while (Host_current != prev) {
+		pthread_cond_wait(&prev->go, &Host_lock);
+	}
+}
+
+/* lock held, a task became ready: preempt at once from a task */
+static void Host_ready(host_task_s* task) {
+	Host_unblock(task);
+	if (Host_inIsr() != true && task->priority > Host_current->priority) {
+		Host_schedule();
+	}
+}
+
+/* lock held, block the current task, false on timeout */
+static bool Host_block(uint32_t ticks) {
+	host_task_s* task = Host_current;
+
+	task->isReady = false;
+	task->isTimed = (ticks != osWaitForever);
+	task->wakeTick = Sys_getTick() + ticks;
+	task->isTimeout = false;
+	Host_schedule();
+	return (task->isTimeout != true);
+}
+
+static void* Host_taskEntry(void* arg) {
+	host_task_s* task = (host_task_s*)arg;
+
+	pthread_mutex_lock(&Host_lock);
+	while (Host_current != task) {
+		pthread_cond_wait(&task->go, &Host_lock);
+	}
+	pthread_mutex_unlock(&Host_lock);
+
+	task->pthread(task->argument);
+
+	pthread_mutex_lock(&Host_lock);
+	task->isDeleted = true;
+	Host_schedule();
+	pthread_mutex_unlock(&Host_lock);
+	return NULL;
+}
+
+static host_task_s* Host_newTask(const char* name, uint32_t priority) {
+	host_task_s* task;
+
+	if (Host_taskCount >= HOST_TASK_NUM) {
+		return NULL;
+	}
+	task = &Host_tasks[Host_taskCount++];
+	task->name = name;
+	task->priority = priority;
+	pthread_cond_init(&task->go, NULL);
+	task->isReady = true;
+	task->readySeq = ++Host_seq;
+	return task;
+}
+
+void Host_rtosInit(void) {
+	pthread_mutex_lock(&Host_lock);
+	Host_current = Host_newTask("main", Host_priority(osPriorityNormal));
+	pthread_mutex_unlock(&Host_lock);
+}
+
+void Host_at(uint32_t tick, int32_t irqn, void (*handler)(void)) {
+	pthread_mutex_lock(&Host_lock);
+	for (uint32_t i = 0; i < HOST_EVENT_NUM; i++) {
+		host_event_s* event = &Host_events[i];
+		if (event->isUsed != true) {
+			event->tick = tick;
+			event->irqn = irqn;
+			event->handler = handler;
+			event->seq = ++Host_seq;
+			event->isUsed = true;
+			pthread_mutex_unlock(&Host_lock);
+			return;
+		}
+	}
+	pthread_mutex_unlock(&Host_lock);
+	fprintf(stderr, "HostRtos: event table full\n");
+	abort();
+}
+
+uint32_t Host_wakeups(osThreadId thread) {
+	return ((host_task_s*)thread)->wakeups;
+}
+
+uint32_t Host_switches(void) {
+	return Host_switchCount;
+}
+
+uint32_t Host_stackUsed(osThreadId thread) {
+	host_task_s* task = (host_task_s*)thread;
+	size_t free = 0;
+
+	if (task->stack == NULL) {
+		return 0;
+	}
+	while (free < HOST_STACK_SIZE && task->stack[free] == HOST_STACK_PAINT) {
+		free++;
+	}
+	return (uint32_t)(HOST_STACK_SIZE - free);
+}
+
+/* semaphore and mutex take, lock held */
+static bool Host_take(host_sem_s* sem, uint32_t ticks) {
+	if (sem->count != 0) {
+		sem->count--;
+		sem->owner = Host_current;
+		return true;
+	}
+	if (ticks == 0 || Host_inIsr() == true) {
+		return false;
+	}
+	Host_current->waitSem = sem;
+	Host_current->isGiven = false;
+	Host_block(ticks);
+	return Host_current->isGiven;
+}
+
+/* the token goes straight to the best waiter, lock held */
+static bool Host_give(host_sem_s* sem) {
+	host_task_s* waiter = NULL;
+
+	if (sem->isMutex == true && (Host_inIsr() == true || sem->owner != Host_current)) {
+		return false;
+	}
+	for (uint32_t i = 0; i < Host_taskCount; i++) {
+		host_task_s* task = &Host_tasks[i];
+		if (task->isReady != true && task->waitSem == sem
+				&& (waiter == NULL || task->priority > waiter->priority)) {
+			waiter = task;
+		}
+	}
+	if (waiter != NULL) {
+		waiter->isGiven = true;
+		sem->owner = waiter;
+		Host_ready(waiter);
+		return true;
+	}
+	if (sem->count >= sem->max) {
+		return false;
+	}
+	sem->count++;
+	sem->owner = NULL;
+	return true;
+}
+
+static host_sem_s* Host_newSem(bool isMutex, uint32_t count, uint32_t max) {
+	host_sem_s* sem = NULL;
+
+	pthread_mutex_lock(&Host_lock);
+	if (Host_semCount < HOST_SEM_NUM) {
+		sem = &Host_sems[Host_semCount++];
+		sem->isMutex = isMutex;
+		sem->count = count;
+		sem->max = max;
+	}
+	pthread_mutex_unlock(&Host_lock);
+	return sem;
+}
+
+int32_t osKernelRunning(void) {
+	return 1;
+}
+
+uint32_t osKernelSysTick(void) {
+	return hv_driver::Sys_getTick();
+}
+
+osThreadId osThreadCreate(const osThreadDef_t *thread_def, void *argument) {
+	host_task_s* task;
+	pthread_attr_t attr;
+
+	pthread_mutex_lock(&Host_lock);
+	task = Host_newTask(thread_def->name, Host_priority(thread_def->tpriority));
+	if (task == NULL) {
+		pthread_mutex_unlock(&Host_lock);
+		return NULL;
+	}
+	task->pthread = thread_def->pthread;
+	task->argument = argument;
+	/* the stack is painted like FreeRTOS does, for Host_stackUsed */
+	task->stack = (uint8_t*)malloc(HOST_STACK_SIZE);
+	memset(task->stack, HOST_STACK_PAINT, HOST_STACK_SIZE);
+	pthread_attr_init(&attr);
+	pthread_attr_setstack(&attr, task->stack, HOST_STACK_SIZE);
+	pthread_create(&task->thread, &attr, Host_taskEntry, task);
+	pthread_attr_destroy(&attr);
+	if (task->priority > Host_current->priority) {
+		Host_schedule();
+	}
+	pthread_mutex_unlock(&Host_lock);
+	return task;
+}
+
+osThreadId osThreadGetId(void) {
+	return Host_current;
+}
+
+osStatus osThreadSetPriority(osThreadId thread_id, osPriority priority) {
+	pthread_mutex_lock(&Host_lock);
+	((host_task_s*)thread_id)->priority = Host_priority(priority);
+	Host_schedule();
+	pthread_mutex_unlock(&Host_lock);
+	return osOK;
+}
+
+osStatus osThreadYield(void) {
+	pthread_mutex_lock(&Host_lock);
+	Host_current->readySeq = ++Host_seq;
+	Host_schedule();
+	pthread_mutex_unlock(&Host_lock);
+	return osOK;
+}
+
+osStatus osDelay(uint32_t millisec) {
+	pthread_mutex_lock(&Host_lock);
+	Host_block((millisec != 0) ? millisec : 1);
+	pthread_mutex_unlock(&Host_lock);
+	return osOK;
+}
+
+int32_t osSignalSet(osThreadId thread_id, int32_t signal) {
+	host_task_s* task = (host_task_s*)thread_id;
+
+	pthread_mutex_lock(&Host_lock);
+	task->notifyValue |= (uint32_t)signal;
+	task->isNotified = true;
+	if (task->isReady != true && task->waitNotify == true) {
+		Host_ready(task);
+	}
+	pthread_mutex_unlock(&Host_lock);
+	return osOK;
+}
+
+/* xTaskNotifyWait: any notification ends the wait, the waited bits are cleared on exit */
+osEvent osSignalWait(int32_t signals, uint32_t millisec) {
+	osEvent ret;
+	host_task_s* task;
+
+	ret.value.signals = 0;
+	if (Host_inIsr() == true) {
+		ret.status = osErrorISR;
+		return ret;
+	}
+	pthread_mutex_lock(&Host_lock);
+	task = Host_current;
+	if (task->isNotified != true && millisec != 0) {
+		task->waitNotify = true;
+		Host_block(millisec);
+		task->waitNotify = false;
+	}
+	ret.value.signals = (int32_t)task->notifyValue;
+	if (task->isNotified == true) {
+		task->notifyValue &= ~(uint32_t)signals;
+		task->isNotified = false;
+		ret.status = osEventSignal;
+	} else {
+		ret.status = (millisec == 0) ? osOK : osEventTimeout;
+	}
+	pthread_mutex_unlock(&Host_lock);
+	return ret;
+}
+
+osMutexId osMutexCreate(const osMutexDef_t *mutex_def) {
+	(void)mutex_def;
+	return Host_newSem(true, 1, 1);
+}
+
+osStatus osMutexWait(osMutexId mutex_id, uint32_t millisec) {
+	bool isTaken;
+
+	if (mutex_id == NULL) {
+		return osErrorParameter;
+	}
+	pthread_mutex_lock(&Host_lock);
+	isTaken = Host_take((host_sem_s*)mutex_id, millisec);
+	pthread_mutex_unlock(&Host_lock);
+	return (isTaken == true) ? osOK : osErrorOS;
+}
+
+osStatus osMutexRelease(osMutexId mutex_id) {
+	bool isGiven;
+
+	pthread_mutex_lock(&Host_lock);
+	isGiven = Host_give((host_sem_s*)mutex_id);
+	pthread_mutex_unlock(&Host_lock);
+	return (isGiven == true) ? osOK : osErrorOS;
+}
+
+/* as cmsis_os.c: a count of 1 is a binary semaphore created available,
+	other counts start empty */
+osSemaphoreId osSemaphoreCreate(const osSemaphoreDef_t *semaphore_def, int32_t count) {
+	(void)semaphore_def;
+	if (count == 1) {
+		return Host_newSem(false, 1, 1);
+	}
+	return Host_newSem(false, 0, (uint32_t)count);
+}
+
+int32_t osSemaphoreWait(osSemaphoreId semaphore_id, uint32_t millisec) {
+	bool isTaken;
+
+	if (semaphore_id == NULL) {
+		return osErrorParameter;
+	}
+	pthread_mutex_lock(&Host_lock);
+	isTaken = Host_take((host_sem_s*)semaphore_id, millisec);
+	pthread_mutex_unlock(&Host_lock);
+	return (isTaken == true) ? osOK : osErrorOS;
+}
+
+osStatus osSemaphoreRelease(osSemaphoreId semaphore_id) {
+	bool isGiven;
+
+	pthread_mutex_lock(&Host_lock);
+	isGiven = Host_give((host_sem_s*)semaphore_id);
+	pthread_mutex_unlock(&Host_lock);
+	return (isGiven == true) ? osOK : osErrorOS;
+}
+
+static bool Host_isGroupMatch(EventBits_t bits, EventBits_t wait, bool isWaitAll) {
+	return (isWaitAll == true) ? ((bits & wait) == wait) : ((bits & wait) != 0);
+}
+
+/* every waiter the bits satisfy is released, the bits they clear on exit
+	go after all of them saw the value, lock held */
+static bool Host_groupSet(host_group_s* group, EventBits_t bits) {
+	EventBits_t clear = 0;
+	bool isReleased = false;
+
+	group->bits |= bits;
+	for (uint32_t i = 0; i < Host_taskCount; i++) {
+		host_task_s* task = &Host_tasks[i];
+		if (task->isReady != true && task->waitGroup == group
+				&& Host_isGroupMatch(group->bits, task->waitBits, task->isWaitAll) == true) {
+			task->groupBits = group->bits;
+			if (task->isClearOnExit == true) {
+				clear |= task->waitBits;
+			}
+			Host_unblock(task);
+			isReleased = true;
+		}
+	}
+	group->bits &= ~clear;
+	return isReleased;
+}
+
+EventGroupHandle_t xEventGroupCreate(void) {
+	host_group_s* group = NULL;
+
+	pthread_mutex_lock(&Host_lock);
+	if (Host_groupCount < HOST_GROUP_NUM) {
+		group = &Host_groups[Host_groupCount++];
+		group->bits = 0;
+	}
+	pthread_mutex_unlock(&Host_lock);
+	return group;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet) {
+	host_group_s* group = (host_group_s*)xEventGroup;
+	EventBits_t bits;
+
+	pthread_mutex_lock(&Host_lock);
+	if (Host_groupSet(group, uxBitsToSet) == true && Host_pickReady()->priority > Host_current->priority) {
+		Host_schedule();
+	}
+	bits = group->bits;
+	pthread_mutex_unlock(&Host_lock);
+	return bits;
+}
+
+/* the timer daemon sets the bits at the top priority right after the
+	interrupt, so they are set here and now */
+BaseType_t xEventGroupSetBitsFromISR(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToSet, BaseType_t *pxHigherPriorityTaskWoken) {
+	pthread_mutex_lock(&Host_lock);
+	Host_groupSet((host_group_s*)xEventGroup, uxBitsToSet);
+	*pxHigherPriorityTaskWoken = pdTRUE;
+	pthread_mutex_unlock(&Host_lock);
+	return pdPASS;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t xEventGroup, const EventBits_t uxBitsToWaitFor,
+		const BaseType_t xClearOnExit, const BaseType_t xWaitForAllBits, TickType_t xTicksToWait) {
+	host_group_s* group = (host_group_s*)xEventGroup;
+	host_task_s* task;
+	EventBits_t bits;
+
+	pthread_mutex_lock(&Host_lock);
+	task = Host_current;
+	bits = group->bits;
+	if (Host_isGroupMatch(bits, uxBitsToWaitFor, xWaitForAllBits != pdFALSE) != true && xTicksToWait != 0) {
+		task->waitGroup = group;
+		task->waitBits = uxBitsToWaitFor;
+		task->isWaitAll = (xWaitForAllBits != pdFALSE);
+		task->isClearOnExit = (xClearOnExit != pdFALSE);
+		if (Host_block(xTicksToWait) == true) {
+			bits = task->groupBits;
+			pthread_mutex_unlock(&Host_lock);
+			return bits;
+		}
+		task->waitGroup = NULL;
+		bits = group->bits;
+	}
+	/* as on timeout, the bits are cleared only if they satisfy the wait */
+	if (xClearOnExit != pdFALSE && Host_isGroupMatch(bits, uxBitsToWaitFor, xWaitForAllBits != pdFALSE) == true) {
+		group->bits &= ~uxBitsToWaitFor;
+	}
+	pthread_mutex_unlock(&Host_lock);
+	return bits;
+}
@@ -0,0 +1,41 @@
+/**
+  ******************************************************************************
+ * @file    HostRtos.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Virtual time stand-in for the CMSIS-RTOS calls
+ *
+ *	Every task is a thread but only one runs at a time: the highest
+ *	priority ready one, first come first served among equals, as the
+ *	FreeRTOS scheduler picks. A task made ready from a task preempts at
+ *	once, from an interrupt it runs when the current task blocks.
+ *	While every task is blocked the idle loop raises the interrupts the
+ *	test queued with Host_at and otherwise moves virtual time on 1ms,
+ *	so time passes only while all tasks sleep and runs are repeatable.
+ *	Mutexes have no priority inheritance. Event group bits set from an
+ *	interrupt are set at once, as the timer daemon does ahead of any task.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef HOST_RTOS_H
+#define HOST_RTOS_H
+
+#include <stdint.h>
+#include "cmsis_os.h"
+
+/* the calling thread becomes the task "main" at osPriorityNormal */
+void Host_rtosInit(void);
+
+/* raise interrupt irqn at tick, once every task is blocked */
+void Host_at(uint32_t tick, int32_t irqn, void (*handler)(void));
+
+/* times a task went from blocked to ready */
+uint32_t Host_wakeups(osThreadId thread);
+/* task switches since Host_rtosInit */
+uint32_t Host_switches(void);
+/* bytes of the task's host stack ever written, glibc's thread block at
+	 its top included; differences between tasks are what a test can use */
+uint32_t Host_stackUsed(osThreadId thread);
+
+#endif /* HOST_RTOS_H */
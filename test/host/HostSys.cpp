@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+ * @file    HostSys.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Virtual time stand-in for MISC
+  */
+//-------------------------------------------------------------------------
+#include "HostSys.h"
+#include "HostTarget.h"
+#include "MISC.h"
+
+using namespace hv_driver;
+
+static const uint32_t HOST_TIMER_NUM = 16;
+
+typedef struct {
+	void (* pTimer)(void);
+	uint32_t period;		// 0 for a one shot
+	uint32_t due;
+} timer_s;
+
+static timer_s Host_timers[HOST_TIMER_NUM];
+static uint32_t Host_tick = 0;
+static uint64_t Host_cycles = 0;			// DWT->CYCCNT without the wrap
+static int32_t Host_locks = 0;
+static uint32_t Host_stops = 0;
+static uint32_t Host_prescaler = 32767;
+
+static void Host_tickHandler(void) {
+	for (uint32_t i = 0; i < HOST_TIMER_NUM; i++) {
+		timer_s &timer = Host_timers[i];
+		if (timer.pTimer != 0 && timer.due == Host_tick) {
+			void (* pTimer)(void) = timer.pTimer;
+			if (timer.period == 0) {
+				timer.pTimer = 0;
+			} else {
+				timer.due += timer.period;
+			}
+			pTimer();
+		}
+	}
+}
+
+void Host_advance(uint32_t ms) {
+	while (ms-- != 0) {
+		Host_addCycles(SystemCoreClock / 1000);
+		Host_tick++;
+		Host_irq(SysTick_IRQn, Host_tickHandler);
+	}
+}
+
+void Host_addCycles(uint32_t cycles) {
+	DWT->CYCCNT += cycles;
+	Host_cycles += cycles;
+}
+
+int32_t Host_stopLocks(void) {
+	return Host_locks;
+}
+
+uint32_t Host_rtcPrescaler(void) {
+	return Host_prescaler;
+}
+
+void Host_sysReset(void) {
+	for (uint32_t i = 0; i < HOST_TIMER_NUM; i++) {
+		Host_timers[i].pTimer = 0;
+	}
+	Host_tick = 0;
+	Host_cycles = 0;
+	DWT->CYCCNT = 0;
+	Host_locks = 0;
+	Host_stops = 0;
+	Host_prescaler = 32767;
+}
+
+static bool Host_timerAdd(void (* pTimer)(void), uint32_t period, uint32_t delay) {
+	Sys_timerRemove(pTimer);
+	for (uint32_t i = 0; i < HOST_TIMER_NUM; i++) {
+		if (Host_timers[i].pTimer == 0) {
+			Host_timers[i].period = period;
+			Host_timers[i].due = Host_tick + ((delay == 0) ? 1 : delay);
+			Host_timers[i].pTimer = pTimer;
+			return true;
+		}
+	}
+	return false;
+}
+
+namespace hv_driver {
+
+void Sys_init(void) {
+	Host_sysReset();
+}
+
+bool Sys_timerAssign(void (* pTimer)(void), uint32_t period_ms) {
+	return Host_timerAdd(pTimer, period_ms, period_ms);
+}
+
+bool Sys_timerOnce(void (* pTimer)(void), uint32_t delay_ms) {
+	return Host_timerAdd(pTimer, 0, delay_ms);
+}
+
+bool Sys_timerRemove(void (* pTimer)(void)) {
+	bool isFound = false;
+
+	for (uint32_t i = 0; i < HOST_TIMER_NUM; i++) {
+		if (Host_timers[i].pTimer == pTimer) {
+			Host_timers[i].pTimer = 0;
+			isFound = true;
+		}
+	}
+	return isFound;
+}
+
+uint32_t Sys_getTimerOverrun(void) {
+	return 0;
+}
+
+uint32_t Sys_getTick(void) {
+	return Host_tick;
+}
+
+void Sys_stopLock(void) {
+	Host_locks++;
+}
+
+void Sys_stopUnlock(void) {
+	Host_locks--;
+}
+
+uint32_t Sys_getStopCount(void) {
+	return Host_stops;
+}
+
+void Sys_setRtcPrescaler(uint32_t prl) {
+	Host_prescaler = prl;
+}
+
+void Sys_cycleCounterInit(void) {
+}
+
+uint32_t Sys_getCycle(void) {
+	return DWT->CYCCNT;
+}
+
+uint32_t Sys_getRunTime(void) {
+	return (uint32_t)(Host_cycles / (SystemCoreClock / 1000000));
+}
+
+void Sys_isrAccount(SYS_ISR isr, uint32_t startCycle) {
+	(void)isr;
+	(void)startCycle;
+}
+
+void Sys_Delayms(__IO uint16_t time_ms) {
+	Host_advance(time_ms);
+}
+
+} /* hv_driver */
+
+extern "C" {
+
+uint32_t HAL_GetTick(void) {
+	return Host_tick;
+}
+
+void HAL_Delay(__IO uint32_t Delay) {
+	Host_advance(Delay);
+}
+
+} /* extern "C" */
@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+ * @file    HostSys.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Virtual time stand-in for MISC
+ *
+ *	Sys_getTick and the DWT cycle counter only move when the test calls
+ *	Host_advance, which runs the Sys timers that fall due on the way in
+ *	interrupt context, as the tick interrupt would.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef HOST_SYS_H
+#define HOST_SYS_H
+
+#include <stdint.h>
+
+/* move virtual time on by ms, 1ms at a time */
+void Host_advance(uint32_t ms);
+/* move the cycle counter alone, within the current ms */
+void Host_addCycles(uint32_t cycles);
+/* Sys_stopLock calls not yet released */
+int32_t Host_stopLocks(void);
+/* last Sys_setRtcPrescaler value */
+uint32_t Host_rtcPrescaler(void);
+/* clear tick, timers and locks */
+void Host_sysReset(void);
+
+#endif /* HOST_SYS_H */
@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+ * @file    HostTarget.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   STM32F103 stand-in for the host tests
+  */
+//-------------------------------------------------------------------------
+#include "HostTarget.h"
+#include "stm32f1xx.h"
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern "C" {
+volatile uint32_t Host_primask = 0;
+volatile uint32_t Host_basepri = 0;
+volatile uint32_t Host_ipsr = 0;
+uint32_t SystemCoreClock = 64000000;
+}
+
+typedef struct {
+	uintptr_t base;
+	size_t size;
+} region_s;
+
+static const region_s Host_regions[] = {
+	{FLASH_BASE, 0x20000},				// flash, TelemetryLog pages at the top
+	{PERIPH_BASE, 0x30000},				// APB1, APB2, AHB
+	{PERIPH_BB_BASE, 0x30000 * 32},	// bit-band alias, written alone, not the bit it stands for
+	{0xE0000000, 0x100000},				// ITM, DWT, SCS
+};
+
+/* before any constructor, global driver objects may touch registers */
+__attribute__((constructor(101))) static void Host_map(void) {
+	for (size_t i = 0; i < sizeof(Host_regions) / sizeof(Host_regions[0]); i++) {
+		void* addr = mmap((void*)Host_regions[i].base, Host_regions[i].size, PROT_READ | PROT_WRITE,
+											MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (addr != (void*)Host_regions[i].base) {
+			fprintf(stderr, "cannot map 0x%08lx\n", (unsigned long)Host_regions[i].base);
+			exit(2);
+		}
+	}
+	Host_reset();
+}
+
+void Host_reset(void) {
+	memset((void*)PERIPH_BASE, 0, 0x30000);
+	memset((void*)PERIPH_BB_BASE, 0, 0x30000 * 32);
+	memset((void*)0xE0000000, 0, 0x100000);
+	memset((void*)FLASH_BASE, 0xFF, 0x20000);
+	Host_primask = 0;
+	Host_basepri = 0;
+	Host_ipsr = 0;
+}
+
+void* Host_alloc32(size_t size) {
+	void* addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+
+	if (addr == MAP_FAILED) {
+		fprintf(stderr, "cannot map %lu bytes below 4GB\n", (unsigned long)size);
+		exit(2);
+	}
+	return addr;
+}
+
+void Host_irq(int32_t irqn, void (*handler)(void)) {
+	uint32_t ipsr = Host_ipsr;
+
+	Host_ipsr = (uint32_t)(irqn + 16);
+	handler();
+	Host_ipsr = ipsr;
+}
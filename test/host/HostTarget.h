@@ -0,0 +1,36 @@
+/**
+  ******************************************************************************
+ * @file    HostTarget.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   STM32F103 stand-in for the host tests
+ *
+ *	Peripheral, system control and flash space are plain memory mapped at
+ *	their target addresses, so drivers read and write the registers the
+ *	test sets up and checks. PRIMASK, BASEPRI and IPSR are variables.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef HOST_TARGET_H
+#define HOST_TARGET_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+extern "C" {
+extern volatile uint32_t Host_primask;
+extern volatile uint32_t Host_basepri;
+extern volatile uint32_t Host_ipsr;
+}
+
+/* clear all registers and interrupt state */
+void Host_reset(void);
+
+/* zeroed memory below 4GB, for objects whose address a register holds */
+void* Host_alloc32(size_t size);
+
+/* run handler as the interrupt irqn would, IPSR set while it runs */
+void Host_irq(int32_t irqn, void (*handler)(void));
+
+#endif /* HOST_TARGET_H */
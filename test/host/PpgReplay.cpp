@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+ * @file    PpgReplay.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Replay of a PPG capture file through the heart rate pipeline
+  */
+//-------------------------------------------------------------------------
+#include "PpgReplay.h"
+#include "HeartRate.h"
+#include "PPGCapture.h"
+#include <stdio.h>
+
+using namespace hv_driver;
+
+PpgReplay::PpgReplay(void) {
+	_info.cyclePerSecond = 0;
+	_info.sampleRate = 0;
+	_info.version = 0;
+	_lostFrames = 0;
+	_crcErrors = 0;
+}
+
+/**
+	* @brief  decode a capture file
+	* @param  const char* path
+	* @retval false if it cannot be read or has no info frame
+	* @note		sample frames ahead of the first info frame are kept, every
+	*					sample is stamped from its frame with the clock of the info
+	*/
+bool PpgReplay::load(const char* path) {
+	FILE* file = fopen(path, "rb");
+	PPGFrame parser;
+	bool hasInfo = false;
+	int byte;
+
+	_samples.clear();
+	_cycles.clear();
+	if (file == NULL) {
+		return false;
+	}
+	std::vector<uint8_t> index;		// of each sample in its frame
+	while ((byte = fgetc(file)) != EOF) {
+		PPGFrame::FRAME_TYPE type = parser.parse((uint8_t)byte);
+
+		if (type == PPGFrame::FRAME_INFO) {
+			_info = parser.getInfo();
+			hasInfo = true;
+		} else if (type == PPGFrame::FRAME_SAMPLES) {
+			const PPGFrame::samples_s &frame = parser.getSamples();
+			for (uint8_t n = 0; n < frame.count; n++) {
+				_samples.push_back(frame.samples[n]);
+				_cycles.push_back(frame.cycle);
+				index.push_back(n);
+			}
+		}
+	}
+	fclose(file);
+	_lostFrames = parser.getLostFrames();
+	_crcErrors = parser.getCrcErrors();
+	if (hasInfo != true || _info.sampleRate == 0) {
+		return false;
+	}
+	/* frames carry the stamp of their first sample */
+	for (size_t i = 0; i < _cycles.size(); i++) {
+		_cycles[i] += index[i] * (_info.cyclePerSecond / _info.sampleRate);
+	}
+	return true;
+}
+
+/**
+	* @brief  feed the samples to HeartRate and SignalQuality, as checkPPM
+	* @param  uint8_t minConfidence - PPM_MIN_CONFIDENCE
+	* @param  std::vector<ppgReading_s> &readings - every getHeartRate result
+	* @retval none
+	* @note		a reading is taken as soon as HeartRate is ready, as the
+	*					EV_HEART_RATE event makes the MainScreen task do
+	*/
+void PpgReplay::run(uint8_t minConfidence, std::vector<ppgReading_s> &readings) {
+	HeartRate ppm;
+	SignalQuality sqi;
+	uint32_t clock = SystemCoreClock;
+
+	readings.clear();
+	if (_samples.empty() == true) {
+		return;
+	}
+	SystemCoreClock = _info.cyclePerSecond;		// HeartRate's cycles per us
+	ppm.init();
+	sqi.init();
+	for (size_t i = 0; i < _samples.size(); i++) {
+		ppgReading_s reading;
+
+		ppm.processSample(_samples[i], _cycles[i]);
+		sqi.pushSample(_samples[i]);
+		if (ppm.isReady() != true || ppm.getHeartRate(reading.bpm) != true) {
+			continue;
+		}
+		reading.ms = (uint32_t)((uint64_t)(_cycles[i] - _cycles[0]) * 1000 / _info.cyclePerSecond);
+		reading.hasQuality = sqi.evaluate(reading.quality);
+		if (reading.hasQuality != true) {
+			reading.quality = SignalQuality::quality_s();
+		}
+		reading.isAccepted = (reading.hasQuality == true && reading.quality.confidence >= minConfidence);
+		readings.push_back(reading);
+	}
+	SystemCoreClock = clock;
+}
+
+/**
+	* @brief  write samples as a capture file
+	* @param  const char* path
+	* @param  samples - at sampleRate, from firstCycle on
+	* @param  uint8_t block - samples per pushBlock, ADC_SCAN_BLOCK on the target
+	* @retval false if the file cannot be written
+	* @note		frames, sequence and info frames as PPGCapture::pushBlock makes them
+	*/
+bool PpgReplay_write(const char* path, const std::vector<uint16_t> &samples, uint32_t firstCycle,
+										 uint32_t cyclePerSecond, uint16_t sampleRate, uint8_t block) {
+	FILE* file = fopen(path, "wb");
+	uint8_t frame[PPGFrame::PPG_FRAME_MAX_SIZE];
+	PPGFrame::info_s info;
+	uint8_t seq = 0;
+	uint8_t infoCount = 0;
+	uint32_t period = cyclePerSecond / sampleRate;
+
+	if (file == NULL) {
+		return false;
+	}
+	info.cyclePerSecond = cyclePerSecond;
+	info.sampleRate = sampleRate;
+	info.version = PPGFrame::PPG_FRAME_VERSION;
+	fwrite(frame, 1, PPGFrame::encodeInfo(frame, seq++, info), file);
+	for (size_t i = 0; i + block <= samples.size(); i += block) {
+		if (++infoCount >= PPGCapture::PPG_CAPTURE_INFO_PERIOD) {
+			infoCount = 0;
+			fwrite(frame, 1, PPGFrame::encodeInfo(frame, seq++, info), file);
+		}
+		for (uint8_t n = 0; n < block; n += PPGFrame::PPG_FRAME_MAX_SAMPLES) {
+			uint8_t count = (block - n > PPGFrame::PPG_FRAME_MAX_SAMPLES) ? (uint8_t)PPGFrame::PPG_FRAME_MAX_SAMPLES : block - n;
+			fwrite(frame, 1, PPGFrame::encodeSamples(frame, seq++, &samples[i + n], count,
+						 firstCycle + (uint32_t)(i + n) * period), file);
+		}
+	}
+	return fclose(file) == 0;
+}
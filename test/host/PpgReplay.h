@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+ * @file    PpgReplay.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Replay of a PPG capture file through the heart rate pipeline
+ *
+ *	A capture file is the USART1 byte stream of PPGCapture as the host
+ *	saved it. It is decoded with PPGFrame, samples keep the DWT stamps of
+ *	their frames and lost frames stay gaps. run() feeds them to HeartRate
+ *	and SignalQuality as checkPPM does, and takes a reading the way
+ *	BeeWatch::updateHeartRate does once HeartRate is ready.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef PPG_REPLAY_H
+#define PPG_REPLAY_H
+
+#include <stdint.h>
+#include <vector>
+#include "PPGFrame.h"
+#include "SignalQuality.h"
+
+typedef struct {
+	uint32_t ms;									// since the first sample
+	uint8_t bpm;
+	bool hasQuality;							// a full SignalQuality window
+	hv_driver::SignalQuality::quality_s quality;
+	bool isAccepted;							// shown and sent by BeeWatch
+} ppgReading_s;
+
+class PpgReplay {
+public:
+	PpgReplay(void);
+
+	bool load(const char* path);
+	void run(uint8_t minConfidence, std::vector<ppgReading_s> &readings);
+
+	const hv_driver::PPGFrame::info_s& getInfo(void){return _info;}
+	const std::vector<uint16_t>& getSamples(void){return _samples;}
+	const std::vector<uint32_t>& getCycles(void){return _cycles;}
+	uint32_t getLostFrames(void){return _lostFrames;}
+	uint32_t getCrcErrors(void){return _crcErrors;}
+private:
+	hv_driver::PPGFrame::info_s _info;
+	std::vector<uint16_t> _samples;
+	std::vector<uint32_t> _cycles;	// DWT stamp per sample
+	uint32_t _lostFrames;
+	uint32_t _crcErrors;
+};
+
+/* stream a capture file as PPGCapture would, block samples per frame */
+bool PpgReplay_write(const char* path, const std::vector<uint16_t> &samples, uint32_t firstCycle,
+										 uint32_t cyclePerSecond, uint16_t sampleRate, uint8_t block);
+
+#endif /* PPG_REPLAY_H */
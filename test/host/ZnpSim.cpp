@@ -0,0 +1,382 @@
+/**
+  ******************************************************************************
+ * @file    ZnpSim.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Simulated CC2530 ZNP on the other end of the SPI link
+  */
+//-------------------------------------------------------------------------
+#include "ZnpSim.h"
+#include "HostRtos.h"
+#include "CC2530.h"
+#include "MISC.h"
+
+using namespace hv_driver;
+
+extern "C" void EXTI0_IRQHandler(void);
+
+sim_s Sim;
+
+GPIO Sim_rstPin(GPIOA, GPIO::PIN1);
+GPIO Sim_srdyPin(GPIOB, GPIO::PIN0);
+GPIO Sim_mrdyPin(GPIOC, GPIO::PIN4);
+GPIO Sim_ssPin(GPIOD, GPIO::PIN3);
+SPI Sim_spi(SPI1);
+
+static void (*Sim_dmaCallBack)(void) = NULL;
+
+static bool Sim_pinLevel(GPIO_TypeDef* port, uint32_t pin, bool level) {
+	if ((port->BSRR & (1u << pin)) != 0) {
+		return true;
+	}
+	if ((port->BSRR & (1u << (pin + 16))) != 0) {
+		return false;
+	}
+	return level;
+}
+
+/* interrupt context */
+static void Sim_setSrdy(bool level) {
+	bool old = ((GPIOB->IDR & 1) != 0);
+
+	if (level == true) {
+		GPIOB->IDR |= 1;
+	} else {
+		GPIOB->IDR &= ~1u;
+	}
+	if (old != level) {
+		EXTI0_IRQHandler();
+	}
+}
+
+std::vector<uint8_t> Sim_frame(uint16_t cmd, const uint8_t* data, uint8_t len) {
+	std::vector<uint8_t> frame;
+
+	frame.push_back(len);
+	frame.push_back((uint8_t)(cmd >> 8));
+	frame.push_back((uint8_t)cmd);
+	frame.insert(frame.end(), data, data + len);
+	return frame;
+}
+
+void Sim_queueAREQ(uint16_t cmd, const uint8_t* data, uint8_t len) {
+	Sim.areq.push_back(Sim_frame(cmd, data, len));
+}
+
+static void Sim_rise(void) {
+	if (Sim.state == SIM_TX_WAIT && (int32_t)(Sys_getTick() - Sim.riseTick) >= 0) {
+		Sim.state = SIM_TX;
+		Sim_setSrdy(true);
+	}
+}
+
+static void Sim_answer(const std::vector<uint8_t> &frame, uint32_t delay) {
+	Sim.tx = frame;
+	Sim.txPos = 0;
+	Sim.state = SIM_TX_WAIT;
+	Sim.riseTick = Sys_getTick() + delay;
+	Host_at(Sim.riseTick, EXTI0_IRQn, Sim_rise);
+}
+
+/* a whole host frame is in */
+static void Sim_frameIn(void) {
+	uint16_t cmd = (uint16_t)((Sim.rx[1] << 8) | Sim.rx[2]);
+	std::vector<uint8_t> srsp;
+
+	if (cmd == 0 && Sim.rx[0] == 0) {
+		Sim.polls++;
+		if (Sim.areq.empty() != true) {
+			std::vector<uint8_t> frame = Sim.areq.front();
+			Sim.areq.pop_front();
+			Sim_answer(frame, 1);
+		}
+		return;
+	}
+	Sim.requests++;
+	if ((Sim.rx[1] & 0xE0) != 0x20 || Sim.isMute == true) {
+		return;
+	}
+	if (Sim.onRequest == NULL) {
+		srsp.assign(Sim.rx.begin() + 3, Sim.rx.end());
+	} else if (Sim.onRequest(cmd, &Sim.rx[0] + 3, Sim.rx[0], srsp) != true) {
+		return;
+	}
+	Sim_answer(Sim_frame(cmd | 0x4000, srsp.empty() ? NULL : &srsp[0], (uint8_t)srsp.size()), Sim.srspDelay);
+}
+
+static uint8_t Sim_exchange(uint8_t in) {
+	if (Sim.state == SIM_TX) {
+		uint8_t out = Sim.tx[Sim.txPos++];
+		/* MRDY may go high and low again before the next sample */
+		if (Sim.txPos == Sim.tx.size()) {
+			Sim.state = SIM_IDLE;
+		}
+		return out;
+	}
+	if (Sim.state == SIM_TX_WAIT) {
+		Sim.state = SIM_RX;			// the host gave up on the answer
+		Sim.rx.clear();
+	}
+	if (Sim.state == SIM_RX) {
+		if (Sim.rx.size() >= 3 && Sim.rx.size() == 3u + Sim.rx[0]) {
+			Sim.rx.clear();				// a new frame, MRDY went up and down unseen
+		}
+		Sim.rx.push_back(in);
+		if (Sim.rx.size() >= 3 && Sim.rx.size() == 3u + Sim.rx[0]) {
+			Sim_frameIn();
+		}
+	}
+	return 0;
+}
+
+/* 1ms sample of MRDY and RST, Sys timer */
+static void Sim_poll(void) {
+	bool rst = Sim_pinLevel(GPIOA, 1, Sim.rstLevel);
+	bool mrdy = Sim_pinLevel(GPIOC, 4, true);
+
+	if (rst != true) {
+		Sim.state = SIM_OFF;
+		Sim.areq.clear();
+		Sim.bootTick = 0;
+		Sim_setSrdy(true);
+	} else if (Sim.rstLevel != true) {
+		Sim.bootTick = Sys_getTick() + 20;
+		Sim.resets++;
+		Sim.startGen++;
+		Sim.isJoined = false;
+	}
+	Sim.rstLevel = rst;
+	if (Sim.state == SIM_OFF) {
+		if (Sim.bootTick != 0 && Sys_getTick() == Sim.bootTick) {
+			static const uint8_t ind[6] = {0x00, 0x02, 0x00, 0x06, 0x02, 0x01};
+			Sim.state = SIM_IDLE;
+			Sim_queueAREQ(CC2530::SYS_RESET_IND, ind, 6);
+		}
+		return;
+	}
+	if (Sim.isDead == true) {
+		return;
+	}
+	switch (Sim.state) {
+		case SIM_IDLE:
+			if (mrdy != true || Sim.areq.empty() != true) {
+				Sim.rx.clear();
+				Sim.state = SIM_RX;
+				Sim_setSrdy(false);
+			}
+			break;
+		case SIM_RX:
+			if (mrdy == true && Sim.areq.empty() == true) {
+				Sim.state = SIM_IDLE;
+				Sim_setSrdy(true);
+			}
+			break;
+		default:
+			/* the host gave up or read the answer */
+			if (mrdy == true) {
+				Sim.state = SIM_IDLE;
+				Sim_setSrdy(true);
+			}
+			break;
+	}
+}
+
+static void Sim_dmaDone(void) {
+	if (Sim.isDmaBusy != true) {
+		return;		// aborted
+	}
+	Sim.isDmaBusy = false;
+	if (Sim_dmaCallBack != NULL) {
+		Sim_dmaCallBack();
+	}
+}
+
+static uint32_t Sim_nvValue(uint8_t id, uint32_t value) {
+	if (Sim.nv.count(id) != 0) {
+		value = 0;
+		for (size_t i = Sim.nv[id].size(); i > 0; i--) {
+			value = (value << 8) | Sim.nv[id][i - 1];
+		}
+	}
+	return value;
+}
+
+static uint32_t Sim_joinGen = 0;
+
+static void Sim_joined(void) {
+	static const uint8_t status[1] = {0x00};
+
+	if (Sim_joinGen != Sim.startGen || Sim.state == SIM_OFF) {
+		return;
+	}
+	Sim.isJoined = true;
+	Sim_queueAREQ(CC2530::ZB_START_CONFIRM, status, 1);
+}
+
+/* ZB_START_REQUEST: find the network on the channels NV allows */
+static void Sim_start(void) {
+	uint32_t chanList = Sim_nvValue(0x84, 0x07FFF800);		// ZCD_NV_chanList
+	uint16_t panID = (uint16_t)Sim_nvValue(0x83, 0xFFFF);	// ZCD_NV_panID
+	uint32_t channels = 0;
+
+	Sim.starts++;
+	for (uint8_t i = 11; i <= 26; i++) {
+		channels += ((chanList >> i) & 1);
+	}
+	if (Sim.isNetUp != true || (chanList & (1u << Sim.netChannel)) == 0
+			|| (panID != 0xFFFF && panID != Sim.netPanID)) {
+		return;
+	}
+	Sim_joinGen = Sim.startGen;
+	Host_at(Sys_getTick() + ((channels == 1) ? Sim.rejoinMs : Sim.scanMs * channels), EXTI0_IRQn, Sim_joined);
+}
+
+bool Sim_zstack(uint16_t cmd, const uint8_t* data, uint8_t len, std::vector<uint8_t> &srsp) {
+	uint16_t value = 0;
+	uint8_t confirm[2];
+
+	switch (cmd) {
+		case CC2530::ZB_READ_CONFIGURATION:
+			if (len < 1) {
+				return false;
+			}
+			if (Sim.nv.count(data[0]) == 0) {
+				srsp.push_back(0x09);		// NV_ITEM_UNINIT
+				srsp.push_back(data[0]);
+				srsp.push_back(0);
+				break;
+			}
+			srsp.push_back(0x00);
+			srsp.push_back(data[0]);
+			srsp.push_back((uint8_t)Sim.nv[data[0]].size());
+			srsp.insert(srsp.end(), Sim.nv[data[0]].begin(), Sim.nv[data[0]].end());
+			break;
+		case CC2530::ZB_WRITE_CONFIGURATION:
+			if (len < 2 || len != 2 + data[1]) {
+				srsp.push_back(0x02);		// ZInvalidParameter
+				break;
+			}
+			Sim.nv[data[0]].assign(data + 2, data + len);
+			Sim.nvWrites++;
+			srsp.push_back(0x00);
+			break;
+		case CC2530::ZB_APP_REGISTER_REQUEST:
+			Sim.appReg.assign(data, data + len);
+			srsp.push_back(0x00);
+			break;
+		case CC2530::ZB_SEND_DATA_REQUEST:
+			if (len < 8) {
+				return false;
+			}
+			confirm[0] = data[4];		// handle
+			confirm[1] = 0x00;
+			if (Sim.confirms.empty() != true) {
+				confirm[1] = Sim.confirms.front();
+				Sim.confirms.pop_front();
+			}
+			Sim_queueAREQ(CC2530::ZB_SEND_DATA_CONFIRM, confirm, 2);
+			break;		// empty SRSP
+		case CC2530::ZB_START_REQUEST:
+			Sim_start();
+			break;
+		case CC2530::ZB_GET_DEVICE_INFO:
+			if (len < 1) {
+				return false;
+			}
+			switch (data[0]) {
+				case 0x02: value = Sim.netShortAddr; break;	// Zb_deviceShortAddr
+				case 0x05: value = Sim.netChannel; break;		// Zb_workingChannel
+				case 0x06: value = Sim.netPanID; break;			// Zb_panID
+				default: break;
+			}
+			srsp.assign(9, 0);
+			srsp[0] = data[0];
+			if (Sim.isJoined == true) {
+				srsp[1] = (uint8_t)value;
+				srsp[2] = (uint8_t)(value >> 8);
+			}
+			break;
+		default:
+			srsp.push_back(0x00);
+			break;
+	}
+	return true;
+}
+
+void Sim_reset(void) {
+	Sim.srspDelay = 2;
+	Sim.onRequest = NULL;
+	Sim.isMute = false;
+	Sim.isDead = false;
+	Sim.isDmaStall = false;
+	Sim.isDmaBusy = false;
+	Sim.dmaAborts = 0;
+	Sim.dmaBusyStarts = 0;
+	Sim.requests = 0;
+	Sim.polls = 0;
+	Sim.resets = 0;
+	Sim.nv.clear();
+	Sim.appReg.clear();
+	Sim.nvWrites = 0;
+	Sim.confirms.clear();
+	Sim.isNetUp = false;
+	Sim.netPanID = 0x1A62;
+	Sim.netChannel = 15;
+	Sim.netShortAddr = 0x796F;
+	Sim.rejoinMs = 300;
+	Sim.scanMs = 400;
+	Sim.starts = 0;
+	Sim.isJoined = false;
+}
+
+void Sim_init(void) {
+	Sim_reset();
+	Sim.state = SIM_OFF;
+	Sys_timerAssign(Sim_poll, 1);
+}
+
+/*---------------------------- SPI stand-in --------------------------------*/
+
+namespace hv_driver {
+
+SPI::SPI(SPI_TypeDef* SPIx) {
+	this->SPIx = SPIx;
+	this->CallBack = NULL;
+}
+
+void SPI::init(MODE mode, BAUD_DIV baud, NSS nss, CPHA cpha, CPOL cpol) {
+	(void)baud;
+	this->mode = mode;
+	this->SPIx->CR1 = (uint32_t)mode | (uint32_t)nss | (uint32_t)cpha | (uint32_t)cpol;
+}
+
+bool SPI::initDMA(uint8_t priority, void (*CallBack)(void)) {
+	(void)priority;
+	this->CallBack = CallBack;
+	Sim_dmaCallBack = CallBack;
+	return true;
+}
+
+/* the bytes move at once, the completion interrupt follows when the task sleeps */
+bool SPI::transferDMA(uint8_t *txPtr, uint8_t *rxPtr, uint16_t size) {
+	Sim.dmaBusyStarts += (Sim.isDmaBusy == true);
+	Sim.isDmaBusy = true;
+	for (uint16_t i = 0; i < size; i++) {
+		uint8_t out = Sim_exchange((txPtr != NULL) ? txPtr[i] : 0);
+		if (rxPtr != NULL) {
+			rxPtr[i] = out;
+		}
+	}
+	if (Sim.isDmaStall != true) {
+		Host_at(Sys_getTick(), DMA1_Channel2_IRQn, Sim_dmaDone);
+	}
+	return true;
+}
+
+void SPI::abortDMA(void) {
+	Sim.isDmaBusy = false;
+	Sim.dmaAborts++;
+}
+
+} /* hv_driver */
@@ -0,0 +1,108 @@
+/**
+  ******************************************************************************
+ * @file    ZnpSim.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Simulated CC2530 ZNP on the other end of the SPI link
+ *
+ *	The simulated ZNP follows the SPI handshake of the ZNP interface spec:
+ *	MRDY low is answered with SRDY low, the host clocks its frame out, SRDY
+ *	goes high once the SRSP is ready and the host clocks it in. An AREQ is
+ *	announced with SRDY low and fetched with a POLL frame. It samples MRDY
+ *	and RST every 1ms, SRDY edges raise EXTI0 and every SPI transfer ends
+ *	with a DMA interrupt within the same ms. Without a request handler the
+ *	SRSP echoes the request payload so each requester can tell its own
+ *	answer. The SPI class is replaced here, link SPI.cpp nowhere else.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef ZNP_SIM_H
+#define ZNP_SIM_H
+
+#include <stdint.h>
+#include <deque>
+#include <map>
+#include <vector>
+#include "GPIO.h"
+#include "SPI.h"
+
+enum SIM_STATE {
+	SIM_OFF,				// held in reset
+	SIM_IDLE,
+	SIM_RX,					// SRDY low, host frame coming in
+	SIM_TX_WAIT,		// frame taken, SRDY high after the delay
+	SIM_TX,					// SRDY high, host clocking the answer in
+};
+
+/**
+	* @brief  SREQ handler, interrupt context
+	* @param  std::vector<uint8_t> &srsp - SRSP payload to fill
+	* @retval false to leave the request unanswered
+	*/
+typedef bool (*SimRequest_t)(uint16_t cmd, const uint8_t* data, uint8_t len, std::vector<uint8_t> &srsp);
+
+typedef struct {
+	SIM_STATE state;
+	bool rstLevel;
+	uint32_t bootTick;					// SYS_RESET_IND due, 0 for none
+	std::vector<uint8_t> rx;
+	std::vector<uint8_t> tx;
+	size_t txPos;
+	uint32_t riseTick;
+	std::deque<std::vector<uint8_t> > areq;
+	/* behaviour */
+	uint32_t srspDelay;					// ms from request to SRDY high
+	SimRequest_t onRequest;			// NULL echoes
+	bool isMute;								// requests get no SRSP
+	bool isDead;								// MRDY is ignored
+	bool isDmaStall;						// transfers never complete
+	bool isDmaBusy;							// channels running
+	uint32_t dmaAborts;
+	uint32_t dmaBusyStarts;			// transfers started on running channels
+	/* seen */
+	uint32_t requests;
+	uint32_t polls;
+	uint32_t resets;
+	/* Z-Stack, Sim_zstack */
+	std::map<uint8_t, std::vector<uint8_t> > nv;
+	std::vector<uint8_t> appReg;		// last ZB_APP_REGISTER_REQUEST payload
+	uint32_t nvWrites;
+	std::deque<uint8_t> confirms;		// next ZB_SEND_DATA_CONFIRM codes, ZSuccess when empty
+	/* the network in range, joined on ZB_START_REQUEST if NV panID and
+		 chanList allow it, otherwise the ZNP keeps scanning in silence */
+	bool isNetUp;
+	uint16_t netPanID;
+	uint8_t netChannel;
+	uint16_t netShortAddr;
+	uint32_t rejoinMs;					// start confirm after, single channel
+	uint32_t scanMs;						// per channel scanned
+	uint32_t starts;
+	uint32_t startGen;					// bumped by a reset, drops a join in progress
+	bool isJoined;
+} sim_s;
+
+extern sim_s Sim;
+
+/* each pin alone on its port, so BSRR holds its last level */
+extern hv_driver::GPIO Sim_rstPin;		// PA1
+extern hv_driver::GPIO Sim_srdyPin;		// PB0, EXTI0
+extern hv_driver::GPIO Sim_mrdyPin;		// PC4
+extern hv_driver::GPIO Sim_ssPin;			// PD3
+extern hv_driver::SPI Sim_spi;
+
+/* held in reset with default behaviour, after Sys_init */
+void Sim_init(void);
+/* default behaviour, counters cleared */
+void Sim_reset(void);
+
+/* Sim.onRequest for the Z-Stack simple API: configuration items kept in
+	 Sim.nv, application registration kept in Sim.appReg, data requests
+	 confirmed with Sim.confirms */
+bool Sim_zstack(uint16_t cmd, const uint8_t* data, uint8_t len, std::vector<uint8_t> &srsp);
+
+std::vector<uint8_t> Sim_frame(uint16_t cmd, const uint8_t* data, uint8_t len);
+/* announce an AREQ, task or interrupt context */
+void Sim_queueAREQ(uint16_t cmd, const uint8_t* data, uint8_t len);
+
+#endif /* ZNP_SIM_H */
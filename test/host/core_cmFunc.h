@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+ * @file    core_cmFunc.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Host stand-in for the CMSIS core register access functions
+ *
+ *	Found before CMSIS/Include, so core_cm3.h keeps its register maps and
+ *	takes these instead of the inline assembly. PRIMASK and IPSR are
+ *	plain variables of HostTarget a test can look at or set.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef __CORE_CMFUNC_H
+#define __CORE_CMFUNC_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern volatile uint32_t Host_primask;
+extern volatile uint32_t Host_basepri;
+extern volatile uint32_t Host_ipsr;
+
+__STATIC_INLINE void __enable_irq(void){Host_primask = 0;}
+__STATIC_INLINE void __disable_irq(void){Host_primask = 1;}
+__STATIC_INLINE uint32_t __get_PRIMASK(void){return Host_primask;}
+__STATIC_INLINE void __set_PRIMASK(uint32_t priMask){Host_primask = priMask & 1;}
+__STATIC_INLINE uint32_t __get_IPSR(void){return Host_ipsr;}
+__STATIC_INLINE uint32_t __get_APSR(void){return 0;}
+__STATIC_INLINE uint32_t __get_xPSR(void){return Host_ipsr;}
+__STATIC_INLINE uint32_t __get_CONTROL(void){return 0;}
+__STATIC_INLINE void __set_CONTROL(uint32_t control){(void) control;}
+__STATIC_INLINE uint32_t __get_PSP(void){return 0;}
+__STATIC_INLINE void __set_PSP(uint32_t topOfProcStack){(void) topOfProcStack;}
+__STATIC_INLINE uint32_t __get_MSP(void){return 0;}
+__STATIC_INLINE void __set_MSP(uint32_t topOfMainStack){(void) topOfMainStack;}
+__STATIC_INLINE void __enable_fault_irq(void){}
+__STATIC_INLINE void __disable_fault_irq(void){}
+__STATIC_INLINE uint32_t __get_BASEPRI(void){return Host_basepri;}
+__STATIC_INLINE void __set_BASEPRI(uint32_t value){Host_basepri = value & 0xFF;}
+__STATIC_INLINE void __set_BASEPRI_MAX(uint32_t value){
+	if (value != 0 && (Host_basepri == 0 || value < Host_basepri)) {
+		Host_basepri = value & 0xFF;
+	}
+}
+__STATIC_INLINE uint32_t __get_FAULTMASK(void){return 0;}
+__STATIC_INLINE void __set_FAULTMASK(uint32_t faultMask){(void) faultMask;}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CORE_CMFUNC_H */
@@ -0,0 +1,83 @@
+/**
+  ******************************************************************************
+ * @file    core_cmInstr.h
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Host stand-in for the CMSIS core instruction intrinsics
+ *
+ *	Same results as the Cortex-M3 instructions, written in C. Barriers are
+ *	full fences so code relying on __DMB between threads keeps its order.
+  */
+//-------------------------------------------------------------------------
+
+#ifndef __CORE_CMINSTR_H
+#define __CORE_CMINSTR_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+__STATIC_INLINE void __NOP(void){}
+__STATIC_INLINE void __WFI(void){}
+__STATIC_INLINE void __WFE(void){}
+__STATIC_INLINE void __SEV(void){}
+__STATIC_INLINE void __ISB(void){__sync_synchronize();}
+__STATIC_INLINE void __DSB(void){__sync_synchronize();}
+__STATIC_INLINE void __DMB(void){__sync_synchronize();}
+#define __BKPT(value) ((void)(value))
+
+__STATIC_INLINE uint32_t __REV(uint32_t value){return __builtin_bswap32(value);}
+__STATIC_INLINE uint32_t __REV16(uint32_t value){
+	return ((value & 0xFF00FF00UL) >> 8) | ((value & 0x00FF00FFUL) << 8);
+}
+__STATIC_INLINE int32_t __REVSH(int32_t value){
+	return (int32_t)(int16_t)(((value & 0xFF) << 8) | ((value >> 8) & 0xFF));
+}
+__STATIC_INLINE uint32_t __ROR(uint32_t op1, uint32_t op2){
+	op2 &= 31;
+	return (op2 == 0) ? op1 : ((op1 >> op2) | (op1 << (32 - op2)));
+}
+__STATIC_INLINE uint32_t __RBIT(uint32_t value){
+	uint32_t result = 0;
+
+	for (uint8_t i = 0; i < 32; i++) {
+		result = (result << 1) | ((value >> i) & 1);
+	}
+	return result;
+}
+__STATIC_INLINE uint8_t __CLZ(uint32_t value){
+	return (value == 0) ? 32 : (uint8_t)__builtin_clz(value);
+}
+
+/* one core, the exclusive monitor always succeeds */
+__STATIC_INLINE uint8_t __LDREXB(volatile uint8_t *addr){return *addr;}
+__STATIC_INLINE uint16_t __LDREXH(volatile uint16_t *addr){return *addr;}
+__STATIC_INLINE uint32_t __LDREXW(volatile uint32_t *addr){return *addr;}
+__STATIC_INLINE uint32_t __STREXB(uint8_t value, volatile uint8_t *addr){*addr = value; return 0;}
+__STATIC_INLINE uint32_t __STREXH(uint16_t value, volatile uint16_t *addr){*addr = value; return 0;}
+__STATIC_INLINE uint32_t __STREXW(uint32_t value, volatile uint32_t *addr){*addr = value; return 0;}
+__STATIC_INLINE void __CLREX(void){}
+
+__STATIC_INLINE int32_t Host_ssat(int32_t value, uint32_t bits){
+	int32_t max = (int32_t)((1UL << (bits - 1)) - 1);
+
+	return (value > max) ? max : (value < -max - 1) ? -max - 1 : value;
+}
+__STATIC_INLINE uint32_t Host_usat(int32_t value, uint32_t bits){
+	int32_t max = (int32_t)((1UL << bits) - 1);
+
+	return (value > max) ? (uint32_t)max : (value < 0) ? 0 : (uint32_t)value;
+}
+#define __SSAT(value, bits) Host_ssat((value), (bits))
+#define __USAT(value, bits) Host_usat((value), (bits))
+
+__STATIC_INLINE uint32_t __RRX(uint32_t value){return value >> 1;}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CORE_CMINSTR_H */
@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+ * @file    test_adc_scan.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   ADCScan against a simulated ADC, TIM3 trigger and DMA channel
+ *
+ *	Every ms the simulator converts the regular group in rank order while
+ *	TIM3, the ADC and the DMA channel are all on, writes the results where
+ *	CMAR points and raises the half / full transfer interrupt the way
+ *	DMA1 channel 1 would in circular mode.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostHal.h"
+#include "ADCScan.h"
+#include <new>
+#include <vector>
+
+using namespace hv_driver;
+
+extern "C" void DMA1_Channel1_IRQHandler(void);
+
+typedef uint16_t (*signal_t)(uint32_t channel, uint32_t ms);
+
+static uint32_t Sim_pos = 0;
+static uint32_t Sim_ms = 0;
+static uint32_t Sim_irqCount = 0;
+static signal_t Sim_signal = NULL;
+
+/* one TIM3 trigger: convert the group, DMA it out, then 1ms passes */
+static void simScan(void) {
+	bool isOn = (TIM3->CR1 & TIM_CR1_CEN) != 0 && (ADC1->CR2 & ADC_CR2_ADON) != 0
+		&& (ADC1->CR2 & ADC_CR2_DMA) != 0 && (DMA1_Channel1->CCR & DMA_CCR_EN) != 0;
+
+	if (isOn == true) {
+		uint16_t* buffer = (uint16_t*)(uintptr_t)DMA1_Channel1->CMAR;
+		uint32_t total = DMA1_Channel1->CNDTR;
+		uint32_t channels = ((ADC1->SQR1 & ADC_SQR1_L) >> 20) + 1;
+
+		for (uint8_t rank = 1; rank <= channels; rank++) {
+			buffer[Sim_pos++] = Sim_signal(Host_adcRankChannel(ADC1, rank), Sim_ms) & 0xFFF;
+		}
+		if (Sim_pos == total / 2) {
+			DMA1->ISR |= DMA_ISR_HTIF1 | DMA_ISR_GIF1;
+		} else if (Sim_pos == total) {
+			DMA1->ISR |= DMA_ISR_TCIF1 | DMA_ISR_GIF1;
+			Sim_pos = 0;
+		}
+		if ((DMA1->ISR & (DMA_ISR_HTIF1 | DMA_ISR_TCIF1)) != 0 && (NVIC->ISER[0] & (1UL << DMA1_Channel1_IRQn)) != 0) {
+			DMA1->IFCR = 0;
+			Host_irq(DMA1_Channel1_IRQn, DMA1_Channel1_IRQHandler);
+			DMA1->ISR &= ~DMA1->IFCR;
+			Sim_irqCount++;
+		}
+	}
+	Sim_ms++;
+	Host_advance(1);
+}
+
+static void simRun(uint32_t ms) {
+	while (ms-- != 0) {
+		simScan();
+	}
+}
+
+/* channel number in the top bits, scan count below, so every sample is known */
+static uint16_t rampSignal(uint32_t channel, uint32_t ms) {
+	return (uint16_t)((channel << 7) | (ms & 0x7F));
+}
+
+static uint16_t flatSignal(uint32_t channel, uint32_t ms) {
+	(void)ms;
+	return (uint16_t)(1000 + 100 * channel);
+}
+
+/* DC plus a 250Hz square wave, the boxcar has a zero there */
+static uint16_t squareSignal(uint32_t channel, uint32_t ms) {
+	(void)channel;
+	return (ms & 2) ? 2200 : 1800;
+}
+
+typedef struct {
+	std::vector<uint16_t> samples;
+	std::vector<uint32_t> cycles;
+	uint32_t calls;
+} capture_s;
+
+static void captureSamples(const uint16_t* samples, uint8_t len, uint32_t cycle, void* arg) {
+	capture_s* capture = (capture_s*)arg;
+
+	CHECK(Host_ipsr == DMA1_Channel1_IRQn + 16);
+	capture->samples.insert(capture->samples.end(), samples, samples + len);
+	capture->cycles.push_back(cycle);
+	capture->calls++;
+}
+
+static ADCScan* newScan(signal_t signal) {
+	static void* memory = Host_alloc32(sizeof(ADCScan));
+
+	Host_reset();
+	Host_sysReset();
+	Sim_pos = 0;
+	Sim_ms = 0;
+	Sim_irqCount = 0;
+	Sim_signal = signal;
+	ADCScan* scan = new (memory) ADCScan(ADC1);
+	scan->init();
+	return scan;
+}
+
+/* rank order, interleaving, every sample once, stamps of the last scan */
+static void testRaw(void) {
+	ADCScan* scan = newScan(rampSignal);
+	capture_s a = capture_s(), b = capture_s();
+
+	CHECK_EQ(scan->addChannel(ADC_CHANNEL_8, ADC_SAMPLETIME_28CYCLES_5, GPIOB, GPIO_PIN_0), 0);
+	CHECK_EQ(scan->addChannel(ADC_CHANNEL_9, ADC_SAMPLETIME_28CYCLES_5, GPIOB, GPIO_PIN_1), 1);
+	CHECK_EQ(scan->addChannel(ADC_CHANNEL_TEMPSENSOR, ADC_SAMPLETIME_239CYCLES_5), 2);
+	CHECK(scan->subscribe(0, 1, captureSamples, &a) == true);
+	CHECK(scan->subscribe(2, 1, captureSamples, &b) == true);
+	CHECK_EQ(scan->getSamplePeriod(), SystemCoreClock / 1000);
+	scan->start();
+	simRun(1000);
+	scan->stop();
+
+	CHECK_EQ(a.samples.size(), 1000);
+	CHECK_EQ(b.samples.size(), 1000);
+	CHECK_EQ(a.calls, 1000 / ADCScan::ADC_SCAN_BLOCK);
+	for (uint32_t n = 0; n < a.samples.size() && n < b.samples.size(); n++) {
+		if (CHECK_EQ(a.samples[n], (8 << 7) | (n & 0x7F)) != true
+				|| CHECK_EQ(b.samples[n], (ADC_CHANNEL_TEMPSENSOR << 7) | (n & 0x7F)) != true) {
+			break;
+		}
+	}
+	/* the interrupt comes at the end of the scan before 1ms passes */
+	for (uint32_t n = 0; n < a.cycles.size(); n++) {
+		CHECK_EQ(a.cycles[n], (n + 1) * ADCScan::ADC_SCAN_BLOCK * (SystemCoreClock / 1000) - SystemCoreClock / 1000);
+	}
+	/* one interrupt per half buffer */
+	CHECK_EQ(Sim_irqCount, 1000 / ADCScan::ADC_SCAN_BLOCK);
+}
+
+/* FIR decimation keeps DC and removes the square wave, averaging on top */
+static void testDecimation(void) {
+	ADCScan* scan = newScan(squareSignal);
+	capture_s by4 = capture_s(), by8 = capture_s(), by1000 = capture_s();
+
+	scan->addChannel(ADC_CHANNEL_8, ADC_SAMPLETIME_28CYCLES_5, GPIOB, GPIO_PIN_0);
+	CHECK(scan->subscribe(0, 4, captureSamples, &by4) == true);
+	CHECK(scan->subscribe(0, 8, captureSamples, &by8) == true);
+	CHECK(scan->subscribe(0, 1000, captureSamples, &by1000) == true);
+	scan->start();
+	simRun(2000);
+	scan->stop();
+
+	CHECK_EQ(by4.samples.size(), 2000 / 4);
+	CHECK_EQ(by8.samples.size(), 2000 / 8);
+	CHECK_EQ(by1000.samples.size(), 2);
+	/* after the filter has filled, 8 taps cover two periods */
+	for (uint32_t n = 2; n < by8.samples.size(); n++) {
+		CHECK(by8.samples[n] >= 1998 && by8.samples[n] <= 2000);
+	}
+	/* the first average still holds the filter filling from zero */
+	if (by1000.samples.size() == 2) {
+		CHECK(by1000.samples[0] >= 1980 && by1000.samples[0] <= 2000);
+		CHECK(by1000.samples[1] >= 1998 && by1000.samples[1] <= 2000);
+	}
+}
+
+static void testSubscribe(void) {
+	ADCScan* scan = newScan(flatSignal);
+	capture_s a = capture_s();
+
+	CHECK(scan->subscribe(0, 1, captureSamples, &a) == false); // no channel yet
+	scan->addChannel(ADC_CHANNEL_8, ADC_SAMPLETIME_28CYCLES_5, GPIOB, GPIO_PIN_0);
+	CHECK(scan->subscribe(1, 1, captureSamples, &a) == false);
+	CHECK(scan->subscribe(0, 0, captureSamples, &a) == false);
+	CHECK(scan->subscribe(0, 3, captureSamples, &a) == false);
+	CHECK(scan->subscribe(0, 12, captureSamples, &a) == false);
+	CHECK(scan->subscribe(0, 1, NULL, &a) == false);
+	for (uint8_t i = 0; i < ADCScan::ADC_SCAN_MAX_SUBSCRIBER; i++) {
+		CHECK(scan->subscribe(0, 1, captureSamples, &a) == true);
+	}
+	CHECK(scan->subscribe(0, 1, captureSamples, &a) == false);
+
+	scan->start();
+	simRun(8);
+	CHECK_EQ(a.calls, ADCScan::ADC_SCAN_MAX_SUBSCRIBER);
+	CHECK(scan->unsubscribe(captureSamples) == true);
+	CHECK(scan->unsubscribe(captureSamples) == false);
+	simRun(8);
+	CHECK_EQ(a.calls, ADCScan::ADC_SCAN_MAX_SUBSCRIBER);
+	scan->stop();
+
+	for (uint8_t i = 0; i < ADCScan::ADC_SCAN_MAX_CHANNEL - 1; i++) {
+		CHECK(scan->addChannel(ADC_CHANNEL_0 + i, ADC_SAMPLETIME_1CYCLE_5) != ADCScan::ADC_SCAN_INVALID);
+	}
+	CHECK_EQ(scan->addChannel(ADC_CHANNEL_7, ADC_SAMPLETIME_1CYCLE_5), ADCScan::ADC_SCAN_INVALID);
+}
+
+/* STOP mode is held off only while scanning */
+static void testStopLock(void) {
+	ADCScan* scan = newScan(flatSignal);
+	capture_s a = capture_s();
+
+	scan->start(); // nothing to scan
+	CHECK_EQ(Host_stopLocks(), 0);
+	scan->addChannel(ADC_CHANNEL_8, ADC_SAMPLETIME_28CYCLES_5, GPIOB, GPIO_PIN_0);
+	scan->subscribe(0, 1, captureSamples, &a);
+	scan->start();
+	scan->start();
+	CHECK_EQ(Host_stopLocks(), 1);
+	simRun(16);
+	scan->stop();
+	scan->stop();
+	CHECK_EQ(Host_stopLocks(), 0);
+	CHECK_EQ(TIM3->CR1 & TIM_CR1_CEN, 0);
+	CHECK_EQ(DMA1_Channel1->CCR, 0);
+	simRun(16);
+	CHECK_EQ(a.calls, 2);
+
+	/* restarts from the top of the buffer */
+	Sim_pos = 0;
+	scan->start();
+	simRun(16);
+	CHECK_EQ(a.calls, 4);
+	scan->stop();
+}
+
+int main(void) {
+	testRaw();
+	testDecimation();
+	testSubscribe();
+	testStopLock();
+	return Check_result();
+}
@@ -0,0 +1,167 @@
+/**
+  ******************************************************************************
+ * @file    test_boot_sequencer.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   BootSequencer in virtual time, boot takes the longest chain
+ *
+ *	The steps replay the waits of BeeWatch's bring-up: the ILI9163 reset
+ *	and wake states, the LSE start polled every RTC_LSE_POLL_MS and the
+ *	ADXL345 set up in one go. The caller sleeps as long as poll() says,
+ *	like the Boot task does with osDelay.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "BootSequencer.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+/* ILI9163::initStep, RTC_LSE_POLL_MS */
+static const uint16_t LCD_WAITS[] = {20, 20, 20};
+static const uint16_t LSE_POLL_MS = 50;
+
+typedef struct {
+	const uint16_t* waits;	// returned in turn, then BOOT_DONE
+	uint8_t count;
+	uint8_t calls;
+	uint32_t lastCall;
+} chain_s;
+
+static uint32_t Now = 0;
+static uint32_t LseReady = 0;		// Now the LSE is running at
+static uint32_t LseCalls = 0;
+
+static uint16_t chainStep(void* arg) {
+	chain_s* chain = (chain_s*)arg;
+
+	chain->lastCall = Now;
+	if (chain->calls >= chain->count) {
+		chain->calls++;
+		return BootSequencer::BOOT_DONE;
+	}
+	return chain->waits[chain->calls++];
+}
+
+static uint16_t lseStep(void* arg) {
+	(void)arg;
+	LseCalls++;
+	if ((int32_t)(Now - LseReady) < 0) {
+		return LSE_POLL_MS;
+	}
+	return BootSequencer::BOOT_DONE;
+}
+
+static uint16_t gyroStep(void* arg) {
+	(void)arg;
+	return BootSequencer::BOOT_DONE;
+}
+
+/* the Boot task loop, returns the polls it took */
+static uint32_t run(BootSequencer &boot, uint32_t late) {
+	uint32_t polls = 1;
+	uint16_t wait = boot.poll(Now);
+
+	while (wait != BootSequencer::BOOT_DONE) {
+		Now += wait + late;
+		wait = boot.poll(Now);
+		polls++;
+	}
+	return polls;
+}
+
+/* LCD, LSE and gyro at once: the LSE start is the longest */
+static void testInterleave(void) {
+	BootSequencer boot;
+	chain_s lcd = {LCD_WAITS, 3, 0, 0};
+	uint32_t start = Now = 1000;
+	uint32_t serial;
+	uint32_t polls;
+
+	LseReady = start + 600;
+	LseCalls = 0;
+	CHECK(boot.add(chainStep, &lcd));
+	CHECK(boot.add(lseStep, NULL));
+	CHECK(boot.add(gyroStep, NULL));
+	CHECK(boot.isDone() != true);
+	polls = run(boot, 0);
+	serial = 20 + 20 + 20 + 600 + 0;
+
+	printf("boot: %u ms interleaved, %u ms one after another, %u polls\n", boot.getBootTime(), serial, polls);
+	CHECK(boot.isDone());
+	CHECK_EQ(boot.getDoneTime(0), 60);
+	CHECK_EQ(boot.getDoneTime(1), 600);
+	CHECK_EQ(boot.getDoneTime(2), 0);
+	CHECK_EQ(boot.getBootTime(), 600);
+	CHECK_EQ(Now - start, 600);
+	CHECK_EQ(lcd.calls, 4);
+	CHECK_EQ(LseCalls, 600 / LSE_POLL_MS + 1);
+	/* one poll per distinct due time, not one per ms */
+	CHECK(polls <= LseCalls + 3);
+	CHECK(boot.getBootTime() < serial);
+}
+
+/* a caller that oversleeps runs every step that fell due, nothing twice */
+static void testLate(void) {
+	BootSequencer boot;
+	static const uint16_t waits[] = {10, 10, 10, 10};
+	chain_s a = {waits, 4, 0, 0};
+	chain_s b = {LCD_WAITS, 3, 0, 0};
+	uint32_t start = Now = 5000;
+
+	boot.add(chainStep, &a);
+	boot.add(chainStep, &b);
+	run(boot, 7);
+	CHECK_EQ(a.calls, 5);
+	CHECK_EQ(b.calls, 4);
+	/* each wait stretched by the oversleep, never shortened */
+	CHECK(boot.getDoneTime(0) >= 40);
+	CHECK(boot.getDoneTime(1) >= 60);
+	CHECK(Now - start <= 60 + 4 * 7);
+}
+
+/* now wraps during boot */
+static void testWrap(void) {
+	BootSequencer boot;
+	chain_s lcd = {LCD_WAITS, 3, 0, 0};
+
+	Now = 0xFFFFFFFF - 30;
+	LseReady = Now + 300;
+	LseCalls = 0;
+	boot.add(chainStep, &lcd);
+	boot.add(lseStep, NULL);
+	run(boot, 0);
+	CHECK_EQ(boot.getDoneTime(0), 60);
+	CHECK_EQ(boot.getDoneTime(1), 300);
+	CHECK_EQ(boot.getBootTime(), 300);
+}
+
+/* table limits and a boot with nothing to do */
+static void testTable(void) {
+	BootSequencer boot;
+	BootSequencer empty;
+
+	Now = 0;
+	for (uint8_t i = 0; i < BootSequencer::BOOT_MAX_STEP; i++) {
+		CHECK(boot.add(gyroStep, NULL));
+	}
+	CHECK(boot.add(gyroStep, NULL) != true);
+	CHECK(empty.add(NULL, NULL) != true);
+	CHECK_EQ(boot.getDoneTime(0), 0);
+	CHECK_EQ(boot.poll(Now), BootSequencer::BOOT_DONE);
+	CHECK(boot.isDone());
+	CHECK_EQ(boot.getDoneTime(BootSequencer::BOOT_MAX_STEP), 0);
+	CHECK_EQ(empty.poll(Now), BootSequencer::BOOT_DONE);
+	CHECK(empty.isDone());
+	CHECK_EQ(empty.getBootTime(), 0);
+}
+
+int main(void) {
+	testInterleave();
+	testLate();
+	testWrap();
+	testTable();
+	return Check_result();
+}
@@ -0,0 +1,280 @@
+/**
+  ******************************************************************************
+ * @file    test_cc2530.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   CC2530 driver against a simulated ZNP
+ *
+ *	SRSPs echo the request payload, see ZnpSim.h.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "ZnpSim.h"
+#include "CC2530.h"
+#include "MISC.h"
+#include <string.h>
+
+using namespace hv_driver;
+
+static CC2530 znp(&Sim_rstPin, &Sim_srdyPin, &Sim_mrdyPin, &Sim_spi, &Sim_ssPin);
+
+static void znpTask(void const* arg) {
+	(void)arg;
+	znp.run();
+}
+
+osThreadDef(ZNP, znpTask, osPriorityHigh, 0, 256);
+
+typedef struct {
+	uint32_t calls;
+	uint16_t cmd;
+	uint8_t len;
+	uint8_t data[8];
+	void* arg;
+} areq_s;
+
+static areq_s Received;
+
+static void onAREQ(uint16_t cmd, ZNPBuffer* frame, void* arg) {
+	Received.calls++;
+	Received.cmd = cmd;
+	Received.len = frame->getLen();
+	memcpy(Received.data, frame->getData(), (frame->getLen() > 8) ? 8 : frame->getLen());
+	Received.arg = arg;
+}
+
+/* reset answered by SYS_RESET_IND, release ID parsed */
+static void testReset(void) {
+	CHECK(znp.reset() == true);
+	CHECK(znp.isZNPInit() == true);
+	CHECK_EQ(znp.getRevID().transportRev, 2);
+	CHECK_EQ(znp.getRevID().releaseNum, 0x0206);
+	CHECK_EQ(znp.getRevID().hwRev, 1);
+}
+
+/* SRSP data copied, truncated to the caller's buffer */
+static void testSREQ(void) {
+	uint8_t tx[5] = {1, 2, 3, 4, 5};
+	uint8_t rx[8] = {0};
+	uint8_t small[2] = {0};
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+	CC2530::frame_s cut = {0, 0, sizeof(small), small};
+
+	CHECK(znp.SREQ(CC2530::SYS_VERSION, tx, 5, srsp) == true);
+	CHECK_EQ(srsp.cmd, CC2530::SYS_VERSION_SRSP);
+	CHECK_EQ(srsp.len, 5);
+	CHECK(memcmp(rx, tx, 5) == 0);
+
+	CHECK(znp.SREQ(CC2530::SYS_RANDOM, tx, 5, cut) == true);
+	CHECK_EQ(cut.cmd, CC2530::SYS_RANDOM_SRSP);
+	CHECK_EQ(cut.len, 2);
+	CHECK_EQ(small[1], 2);
+
+	CHECK(znp.SREQ(CC2530::SYS_VERSION, NULL, 0, srsp) == true);
+	CHECK_EQ(srsp.len, 0);
+	CHECK(znp.SREQ(CC2530::SYS_VERSION, tx, 0, srsp) == false);	// bad arguments
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* latency bins and per command counters follow the simulated delay */
+static void testMetrics(void) {
+	CC2530::metrics_s metrics;
+	uint8_t rx[4];
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+	uint8_t tx[1] = {7};
+
+	znp.clearMetrics();
+	Sim.srspDelay = 20;
+	for (int i = 0; i < 4; i++) {
+		CHECK(znp.SREQ(CC2530::SYS_GET_TIME, tx, 1, srsp) == true);
+	}
+	Sim.srspDelay = 2;
+	CHECK(znp.SREQ(CC2530::SYS_GPIO, tx, 1, srsp) == true);
+	znp.getMetrics(metrics);
+
+	/* MRDY sampled within 1ms, SRDY up after the delay */
+	CHECK_EQ(metrics.latency[5], 4);		// 16..31ms
+	CHECK_EQ(metrics.latency[2], 1);		// 2..3ms
+	CHECK_EQ(metrics.cmd[0].cmd, CC2530::SYS_GET_TIME);
+	CHECK_EQ(metrics.cmd[0].count, 4);
+	CHECK(metrics.cmd[0].maxLatency >= 20 && metrics.cmd[0].maxLatency <= 23);
+	CHECK_EQ(metrics.cmd[1].cmd, CC2530::SYS_GPIO);
+	CHECK_EQ(metrics.bytesOut, 5 * 4);
+	CHECK_EQ(metrics.bytesIn, 5 * 4);
+	CHECK_EQ(metrics.srspTimeout + metrics.srdyTimeout, 0);
+}
+
+/* AREQs go to their handler, unknown ones are counted as dropped */
+static void testAREQ(void) {
+	static const uint8_t data[3] = {0xAA, 0xBB, 0xCC};
+	int arg = 0;
+	CC2530::metrics_s metrics;
+
+	znp.clearMetrics();
+	Sim.polls = 0;
+	memset(&Received, 0, sizeof(Received));
+	CHECK(znp.registerAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, onAREQ, &arg) == true);
+	Sim_queueAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, data, 3);
+	osDelay(10);
+	CHECK_EQ(Received.calls, 1);
+	CHECK_EQ(Received.cmd, CC2530::ZB_RECEIVE_DATA_INDICATION);
+	CHECK_EQ(Received.len, 3);
+	CHECK_EQ(Received.data[2], 0xCC);
+	CHECK(Received.arg == &arg);
+
+	Sim_queueAREQ(CC2530::ZB_FIND_DEVICE_CONFIRM, data, 3);
+	Sim_queueAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, data, 1);
+	osDelay(20);
+	CHECK_EQ(Received.calls, 2);
+	CHECK_EQ(Received.len, 1);
+	CHECK_EQ(znp.getDropAREQ(), 1);
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.areq, 3);				// read, the unknown one dropped after
+	CHECK_EQ(Sim.polls, 3);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* an AREQ pending while a request goes out is fetched after it */
+static void testAREQDuringSREQ(void) {
+	static const uint8_t data[2] = {1, 2};
+	uint8_t tx[2] = {9, 8};
+	uint8_t rx[4];
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+
+	memset(&Received, 0, sizeof(Received));
+	Sim_queueAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, data, 2);
+	CHECK(znp.SREQ(CC2530::SYS_GET_TIME, tx, 2, srsp) == true);
+	CHECK_EQ(rx[0], 9);
+	osDelay(10);
+	CHECK_EQ(Received.calls, 1);
+	CHECK_EQ(Received.data[1], 2);
+}
+
+/* no SRSP: the requester times out, the next one waits for the wire */
+static void testSrspTimeout(void) {
+	uint8_t tx[1] = {1};
+	uint8_t rx[4];
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+	CC2530::metrics_s metrics;
+	uint32_t start;
+
+	znp.clearMetrics();
+	Sim.isMute = true;
+	start = osKernelSysTick();
+	CHECK(znp.SREQ(CC2530::SYS_SET_TIME, tx, 1, srsp, 50) == false);
+	CHECK_EQ(osKernelSysTick() - start, 50);
+	Sim.isMute = false;
+
+	/* the ZNP task still waits for SRDY on the abandoned request */
+	start = osKernelSysTick();
+	CHECK(znp.SREQ(CC2530::SYS_GET_TIME, tx, 1, srsp, 2000) == true);
+	CHECK(osKernelSysTick() - start >= CC2530::ZNP_SRSP_TIMEOUT - 50);
+	CHECK_EQ(srsp.cmd, CC2530::SYS_GET_TIME_SRSP);
+
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.srspTimeout, 1);
+	CHECK_EQ(metrics.cmd[0].timeouts, 1);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* ZNP not answering MRDY, and a DMA that never completes */
+static void testLinkFaults(void) {
+	uint8_t rx[4];
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+	CC2530::metrics_s metrics;
+
+	znp.clearMetrics();
+	Sim.isDead = true;
+	CHECK(znp.SREQ(CC2530::SYS_VERSION, NULL, 0, srsp, 500) == false);
+	CHECK_EQ(srsp.cmd, CC2530::NONE);
+	Sim.isDead = false;
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.srdyTimeout, 1);
+	CHECK(metrics.srdyWait >= CC2530::ZNP_SRDY_TIMEOUT);
+	CHECK_EQ(metrics.srspTimeout, 0);			// answered, with NONE
+
+	/* the stalled channels are stopped before the next transfer starts */
+	Sim.isDmaStall = true;
+	CHECK(znp.SREQ(CC2530::SYS_VERSION, NULL, 0, srsp, 500) == false);
+	Sim.isDmaStall = false;
+	CHECK(Sim.isDmaBusy == false);
+	CHECK_EQ(Sim.dmaAborts, 1);
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.dmaTimeout, 1);
+	osDelay(5);
+	CHECK(znp.SREQ(CC2530::SYS_VERSION, NULL, 0, srsp) == true);
+	CHECK_EQ(Sim.dmaBusyStarts, 0);
+	CHECK_EQ(Sim.dmaAborts, 1);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* requesters at two priorities share the single slot */
+static const uint32_t CLIENT_REQUESTS = 50;
+static uint32_t Client_ok[2];
+static uint32_t Client_wrong[2];
+
+static void clientTask(void const* arg) {
+	uint8_t id = (uint8_t)(uintptr_t)arg;
+	uint8_t tx[2];
+	uint8_t rx[4];
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+
+	for (uint32_t i = 0; i < CLIENT_REQUESTS; i++) {
+		tx[0] = id;
+		tx[1] = (uint8_t)i;
+		if (znp.SREQ(CC2530::SYS_ADC_READ, tx, 2, srsp) == true) {
+			Client_ok[id]++;
+			Client_wrong[id] += (rx[0] != id || rx[1] != (uint8_t)i);
+		}
+		osDelay(1 + id);
+	}
+	while (1) {
+		osDelay(osWaitForever);
+	}
+}
+
+osThreadDef(CLIENT0, clientTask, osPriorityAboveNormal, 0, 256);
+osThreadDef(CLIENT1, clientTask, osPriorityBelowNormal, 0, 256);
+
+static void testClients(void) {
+	static const uint8_t data[1] = {5};
+
+	memset(&Received, 0, sizeof(Received));
+	osThreadCreate(osThread(CLIENT0), (void*)0);
+	osThreadCreate(osThread(CLIENT1), (void*)1);
+	for (int i = 0; i < 10; i++) {
+		Sim_queueAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, data, 1);
+		osDelay(30);
+	}
+	osDelay(1000);
+	CHECK_EQ(Client_ok[0], CLIENT_REQUESTS);
+	CHECK_EQ(Client_ok[1], CLIENT_REQUESTS);
+	CHECK_EQ(Client_wrong[0] + Client_wrong[1], 0);
+	CHECK_EQ(Received.calls, 10);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+	Sim_init();
+
+	CHECK(znp.init() == true);
+	CHECK_EQ(GPIOA->BSRR, 1u << (1 + 16));	// held in reset
+	osThreadCreate(osThread(ZNP), NULL);
+
+	testReset();
+	testSREQ();
+	testMetrics();
+	testAREQ();
+	testAREQDuringSREQ();
+	testSrspTimeout();
+	testLinkFaults();
+	testClients();
+	return Check_result();
+}
@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+ * @file    test_downlink.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Downlink commands from the simulated ZNP to the CmdDispatcher table
+ *
+ *	ZB_RECEIVE_DATA_INDICATION frames are announced by the simulated ZNP
+ *	and go through the real CC2530, Z_stack and CmdDispatcher to handlers
+ *	registered like BeeWatch does. The registered IDs have to reach the
+ *	ZNP as the application input command list.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "ZnpSim.h"
+#include "CC2530.h"
+#include "Z_stack.h"
+#include "CmdDispatcher.h"
+#include "MISC.h"
+#include <string.h>
+
+using namespace hv_driver;
+
+/* BeeWatch::ZB_COMMAND */
+static const uint16_t CFG_REPORT = 0xABE0;
+static const uint16_t CFG_THRESHOLD = 0xABE1;
+static const uint16_t TIME_SYNC = 0xABE2;
+static const uint16_t STATUS = 0xABCD;
+static const uint16_t COORDINATOR = 0x0000;
+
+static CC2530 znp(&Sim_rstPin, &Sim_srdyPin, &Sim_mrdyPin, &Sim_spi, &Sim_ssPin);
+static Z_stack zigbee(&znp);
+static CmdDispatcher downlink(CFG_REPORT);
+
+typedef struct {
+	uint32_t calls;
+	uint16_t srcAddr;
+	uint8_t len;
+	uint8_t data[8];
+	void* arg;
+	bool isRefused;
+	bool isRetained;
+	ZNPBuffer* frame;
+} handled_s;
+
+static handled_s Handled[3];
+static ZNPBuffer* Last_frame = NULL;
+
+static bool onCommand(uint16_t srcAddr, const uint8_t* data, uint8_t len, void* arg) {
+	handled_s &handled = *(handled_s*)arg;
+
+	handled.calls++;
+	handled.srcAddr = srcAddr;
+	handled.len = len;
+	memcpy(handled.data, data, (len > 8) ? 8 : len);
+	handled.arg = arg;
+	if (handled.isRetained == true) {
+		Last_frame->retain();
+		handled.frame = Last_frame;
+	}
+	return (handled.isRefused != true);
+}
+
+/* BeeWatch zigbeeReceive */
+static void onReceive(Z_stack::RxPacket_s &rxPacket) {
+	Last_frame = rxPacket.frame;
+	downlink.dispatch(rxPacket.srcAddr, rxPacket.cmdID, rxPacket.rxPtr, rxPacket.len);
+}
+
+static void znpTask(void const* arg) {
+	(void)arg;
+	znp.run();
+}
+
+osThreadDef(ZNP, znpTask, osPriorityHigh, 0, 256);
+
+/* srcAddr | cmdID | len, little endian, then the data */
+static void indicate(uint16_t srcAddr, uint16_t cmdID, const uint8_t* data, uint8_t len, uint8_t sent) {
+	uint8_t frame[6 + 16];
+
+	frame[0] = (uint8_t)srcAddr;
+	frame[1] = (uint8_t)(srcAddr >> 8);
+	frame[2] = (uint8_t)cmdID;
+	frame[3] = (uint8_t)(cmdID >> 8);
+	frame[4] = len;
+	frame[5] = 0;
+	memcpy(frame + 6, data, sent);
+	Sim_queueAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, frame, 6 + sent);
+	osDelay(10);
+}
+
+static void testTable(void) {
+	uint16_t list[CmdDispatcher::CMD_TABLE_SIZE];
+
+	CHECK(downlink.add(CFG_REPORT, 2, onCommand, &Handled[0]));
+	CHECK(downlink.add(CFG_THRESHOLD, 6, onCommand, &Handled[1]));
+	CHECK(downlink.add(TIME_SYNC, 3, onCommand, &Handled[2]));
+	/* outside the range, or no handler */
+	CHECK(downlink.add(CFG_REPORT - 1, 0, onCommand, NULL) != true);
+	CHECK(downlink.add(CFG_REPORT + CmdDispatcher::CMD_TABLE_SIZE, 0, onCommand, NULL) != true);
+	CHECK(downlink.add(CFG_REPORT + 3, 0, NULL, NULL) != true);
+
+	CHECK_EQ(downlink.getCmdList(list, CmdDispatcher::CMD_TABLE_SIZE), 3);
+	CHECK_EQ(list[0], CFG_REPORT);
+	CHECK_EQ(list[2], TIME_SYNC);
+	CHECK_EQ(downlink.getCmdList(list, 2), 2);
+}
+
+/* the table is the input list of the registered application */
+static void testRegister(void) {
+	Z_stack::AppReg_s app;
+	const uint8_t* data;
+
+	CHECK(zigbee.init(Z_stack::ZCD_startOpt_noClear, Z_stack::ZCD_endDevice, 0xFFFF));
+	app.appEndPoint = 1;
+	app.appProfileID = 0x000A;
+	app.deviceID = 0x0001;
+	app.deviceVersion = 0x01;
+	app.inputCmdNum = downlink.getCmdList(app.inputCmd, 10);
+	app.outputCmd[0] = STATUS;
+	app.outputCmdNum = 1;
+	CHECK_EQ(zigbee.appReg(app), Z_stack::ZSuccess);
+
+	if (CHECK_EQ(Sim.appReg.size(), 9u + 2 * (3 + 1)) != true) {
+		return;
+	}
+	data = &Sim.appReg[0];
+	CHECK_EQ(data[7], 3);
+	CHECK_EQ(data[8] | (data[9] << 8), CFG_REPORT);
+	CHECK_EQ(data[10] | (data[11] << 8), CFG_THRESHOLD);
+	CHECK_EQ(data[12] | (data[13] << 8), TIME_SYNC);
+	CHECK_EQ(data[14], 1);
+	CHECK_EQ(data[15] | (data[16] << 8), STATUS);
+}
+
+static void testDispatch(void) {
+	static const uint8_t period[2] = {0x3C, 0x00};
+	static const uint8_t threshold[6] = {0x40, 0x01, 0xC8, 0x00, 0x64, 0x00};
+	static const uint8_t time[3] = {13, 45, 30};
+	const CmdDispatcher::metrics_s &metrics = downlink.getMetrics();
+
+	indicate(COORDINATOR, CFG_REPORT, period, 2, 2);
+	CHECK_EQ(Handled[0].calls, 1);
+	CHECK_EQ(Handled[0].srcAddr, COORDINATOR);
+	CHECK_EQ(Handled[0].len, 2);
+	CHECK_EQ(Handled[0].data[0], 0x3C);
+	CHECK(Handled[0].arg == &Handled[0]);
+
+	indicate(0x1234, CFG_THRESHOLD, threshold, 6, 6);
+	CHECK_EQ(Handled[1].calls, 1);
+	CHECK_EQ(Handled[1].srcAddr, 0x1234);
+	CHECK(memcmp(Handled[1].data, threshold, 6) == 0);
+
+	indicate(COORDINATOR, TIME_SYNC, time, 3, 3);
+	CHECK_EQ(Handled[2].calls, 1);
+	CHECK_EQ(Handled[2].data[1], 45);
+	CHECK_EQ(metrics.handled, 3);
+	CHECK_EQ(metrics.rejected + metrics.unknown, 0);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* short, truncated, unknown and refused commands never reach the owner */
+static void testReject(void) {
+	static const uint8_t threshold[6] = {1, 2, 3, 4, 5, 6};
+	const CmdDispatcher::metrics_s &metrics = downlink.getMetrics();
+	uint32_t handled = metrics.handled;
+
+	/* shorter than registered */
+	indicate(COORDINATOR, CFG_THRESHOLD, threshold, 5, 5);
+	CHECK_EQ(Handled[1].calls, 1);
+	CHECK_EQ(metrics.rejected, 1);
+	/* says 6, the transport carried 4 */
+	indicate(COORDINATOR, CFG_THRESHOLD, threshold, 6, 4);
+	CHECK_EQ(Handled[1].calls, 1);
+	CHECK_EQ(metrics.rejected, 2);
+	/* says 2, carries 6: only 2 handed over */
+	indicate(COORDINATOR, CFG_REPORT, threshold, 2, 6);
+	CHECK_EQ(Handled[0].calls, 2);
+	CHECK_EQ(Handled[0].len, 2);
+
+	/* free slot in the range, below it, above it */
+	indicate(COORDINATOR, CFG_REPORT + 5, threshold, 6, 6);
+	indicate(COORDINATOR, CFG_REPORT - 1, threshold, 6, 6);
+	indicate(COORDINATOR, STATUS, threshold, 6, 6);
+	CHECK_EQ(metrics.unknown, 3);
+
+	/* the handler refuses */
+	Handled[2].isRefused = true;
+	indicate(COORDINATOR, TIME_SYNC, threshold, 3, 3);
+	Handled[2].isRefused = false;
+	CHECK_EQ(Handled[2].calls, 2);
+	CHECK_EQ(metrics.rejected, 3);
+	CHECK_EQ(metrics.handled, handled + 1);
+
+	/* no room for the header, Z_stack drops it */
+	Sim_queueAREQ(CC2530::ZB_RECEIVE_DATA_INDICATION, threshold, 5);
+	osDelay(10);
+	CHECK_EQ(metrics.handled + metrics.rejected + metrics.unknown, handled + 1 + 3 + 3);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* a handler that keeps the frame holds it until release */
+static void testRetain(void) {
+	static const uint8_t period[2] = {0x78, 0x00};
+
+	Handled[0].isRetained = true;
+	indicate(COORDINATOR, CFG_REPORT, period, 2, 2);
+	Handled[0].isRetained = false;
+	if (CHECK(Handled[0].frame != NULL) != true) {
+		return;
+	}
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE - 1);
+	CHECK_EQ(Handled[0].frame->getData()[6], 0x78);
+	Handled[0].frame->release();
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+	Sim_init();
+	Sim.onRequest = Sim_zstack;
+
+	memset(Handled, 0, sizeof(Handled));
+	CHECK(znp.init() == true);
+	zigbee.setReceiveCallBack(onReceive);
+	osThreadCreate(osThread(ZNP), NULL);
+
+	testTable();
+	testRegister();
+	testDispatch();
+	testReject();
+	testRetain();
+	return Check_result();
+}
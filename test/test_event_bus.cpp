@@ -0,0 +1,233 @@
+/**
+  ******************************************************************************
+ * @file    test_event_bus.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   EventBus lanes, merging and wakeups per minute in virtual time
+ *
+ *	The screen and activity tasks subscribe as MainScreen and
+ *	ActivityStatus do. The RTC second interrupt publishes EV_SECOND and
+ *	every 60th EV_MINUTE, the ADXL345 EXTI EV_GYRO at a walking pace, the
+ *	ADC DMA a heart rate reading every PPM_PERIOD_MS and the network task
+ *	one join. Their wakeups are set against the polling they replace:
+ *	the 10ms gyro poll and the 1s screen refresh.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostRtos.h"
+#include "EventBus.h"
+#include "MISC.h"
+#include <stdio.h>
+
+using namespace hv_driver;
+
+/* BeeWatch */
+static const uint32_t GYRO_POLL_MS = 10;		// before the EXTI
+static const uint32_t SCREEN_POLL_MS = 1000;
+static const uint32_t PPM_PERIOD_MS = 300000;
+static const uint32_t GYRO_EDGE_MS = 7000;		// an INT1 edge while walking
+
+static const uint32_t RUN_MIN = 10;
+
+static EventBus bus;
+
+typedef struct {
+	uint32_t runs;
+	uint32_t events[8];				// per EVENT bit
+	uint32_t foreign;					// events it did not subscribe to
+} sink_s;
+
+static sink_s Screen;
+static sink_s Activity;
+static osThreadId ScreenId;
+static osThreadId ActivityId;
+static uint32_t Seconds = 0;
+static uint32_t GyroEdges = 0;
+static uint32_t Readings = 0;
+static uint32_t Motions = 0;
+static bool IsRunning = true;		// sources publish and re-arm
+
+static void sinkCount(sink_s &sink, uint32_t events, uint32_t subscribed) {
+	sink.runs++;
+	for (uint8_t i = 0; i < 8; i++) {
+		if (events & (1UL << i)) {
+			sink.events[i]++;
+		}
+	}
+	if ((events & ~subscribed) != 0) {
+		sink.foreign++;
+	}
+}
+
+static uint8_t bitOf(uint32_t event) {
+	uint8_t i = 0;
+
+	while ((event >> i) != 1) {
+		i++;
+	}
+	return i;
+}
+
+/*---------------------------- sources -------------------------------------*/
+
+/* TimeTick, ActivitySttCount adds the minute */
+static void rtcSecond(void) {
+	if (IsRunning != true) {
+		return;
+	}
+	Seconds++;
+	bus.publish(((Seconds % 60 == 0) ? (uint32_t)EventBus::EV_MINUTE : (uint32_t)EventBus::EV_NONE) | EventBus::EV_SECOND);
+	Host_at(Sys_getTick() + 1000, RTC_IRQn, rtcSecond);
+}
+
+static void gyroEdge(void) {
+	if (IsRunning != true) {
+		return;
+	}
+	GyroEdges++;
+	bus.publish(EventBus::EV_GYRO);
+	Host_at(Sys_getTick() + GYRO_EDGE_MS, EXTI1_IRQn, gyroEdge);
+}
+
+static void ppmReady(void) {
+	if (IsRunning != true) {
+		return;
+	}
+	Readings++;
+	bus.publish(EventBus::EV_HEART_RATE);
+	Host_at(Sys_getTick() + PPM_PERIOD_MS, DMA1_Channel1_IRQn, ppmReady);
+}
+
+/*---------------------------- tasks ---------------------------------------*/
+
+static void screenTask(void const* arg) {
+	uint32_t subscribed = EventBus::EV_SECOND | EventBus::EV_MINUTE | EventBus::EV_NETWORK;
+	(void)arg;
+
+	bus.subscribe(subscribed);
+	while (1) {
+		sinkCount(Screen, bus.wait(osWaitForever), subscribed);
+	}
+}
+
+/* every other INT1 edge changes the status, checkGyroStatus then
+	 publishes EV_MOTION to its own task */
+static void activityTask(void const* arg) {
+	uint32_t subscribed = EventBus::EV_GYRO | EventBus::EV_MOTION | EventBus::EV_HEART_RATE;
+	uint32_t events;
+	(void)arg;
+
+	bus.subscribe(subscribed);
+	while (1) {
+		events = bus.wait(osWaitForever);
+		sinkCount(Activity, events, subscribed);
+		if ((events & EventBus::EV_GYRO) && (Activity.events[bitOf(EventBus::EV_GYRO)] % 2) == 0) {
+			Motions++;
+			bus.publish(EventBus::EV_MOTION);
+		}
+	}
+}
+
+osThreadDef(SCREEN, screenTask, osPriorityAboveNormal, 0, 128);
+osThreadDef(ACTIVITY, activityTask, osPriorityHigh, 0, 128);
+
+/* per task, events merged while it runs are one wakeup */
+static void testWakeups(void) {
+	uint32_t start = Sys_getTick();
+	uint32_t screenWake;
+	uint32_t activityWake;
+
+	Host_at(start + 1000, RTC_IRQn, rtcSecond);
+	Host_at(start + 500, EXTI1_IRQn, gyroEdge);
+	Host_at(start + PPM_PERIOD_MS, DMA1_Channel1_IRQn, ppmReady);
+	osDelay(3 * 60000 + 250);
+	bus.publish(EventBus::EV_NETWORK);			// zigbeeStateChange, from a task
+	osDelay(RUN_MIN * 60000 - 3 * 60000);
+	IsRunning = false;
+
+	screenWake = bus.getWakeups(ScreenId);
+	activityWake = bus.getWakeups(ActivityId);
+	printf("screen:   %5.1f wakeups/min, polled %u/min\n", screenWake / (double)RUN_MIN, 60000 / SCREEN_POLL_MS);
+	printf("activity: %5.1f wakeups/min, polled %u/min\n", activityWake / (double)RUN_MIN, 60000 / GYRO_POLL_MS);
+	printf("%u published, %u task switches\n", bus.getPublished(), Host_switches());
+
+	CHECK_EQ(Seconds, RUN_MIN * 60);
+	CHECK_EQ(Screen.events[bitOf(EventBus::EV_SECOND)], Seconds);
+	CHECK_EQ(Screen.events[bitOf(EventBus::EV_MINUTE)], RUN_MIN);
+	CHECK_EQ(Screen.events[bitOf(EventBus::EV_NETWORK)], 1);
+	/* the minute came with its second */
+	CHECK_EQ(screenWake, Seconds + 1);
+	CHECK_EQ(Activity.events[bitOf(EventBus::EV_GYRO)], GyroEdges);
+	CHECK_EQ(Activity.events[bitOf(EventBus::EV_MOTION)], Motions);
+	CHECK_EQ(Activity.events[bitOf(EventBus::EV_HEART_RATE)], Readings);
+	CHECK_EQ(Readings, RUN_MIN * 60000 / PPM_PERIOD_MS);
+	CHECK_EQ(Screen.foreign, 0);
+	CHECK_EQ(Activity.foreign, 0);
+	/* every wakeup of the tasks was an event, EV_MOTION from the activity
+		 task itself is there when it waits again */
+	CHECK_EQ(screenWake, Screen.runs);
+	CHECK_EQ(activityWake, Activity.runs);
+	CHECK_EQ(Host_wakeups(ScreenId), screenWake);
+	CHECK_EQ(Host_wakeups(ActivityId) + Motions, activityWake);
+	CHECK(activityWake <= GyroEdges + Motions + Readings);
+	CHECK(activityWake * 100 < RUN_MIN * 60000 / GYRO_POLL_MS);
+	CHECK(screenWake <= RUN_MIN * 60000 / SCREEN_POLL_MS + 1);
+	CHECK_EQ(bus.getDropped(), 0);
+}
+
+/* published before the wait: kept and merged, timeout gives EV_NONE */
+static void testMerge(void) {
+	uint32_t start;
+
+	CHECK(bus.subscribe(EventBus::EV_MOTION | EventBus::EV_GYRO));
+	bus.publish(EventBus::EV_MOTION);
+	bus.publish(EventBus::EV_GYRO | EventBus::EV_SECOND);
+	CHECK_EQ(bus.wait(0), EventBus::EV_MOTION | EventBus::EV_GYRO);
+	CHECK_EQ(bus.wait(0), EventBus::EV_NONE);
+	start = Sys_getTick();
+	CHECK_EQ(bus.wait(250), EventBus::EV_NONE);
+	CHECK_EQ(Sys_getTick() - start, 250);
+	/* the lanes fit the 24 bits of the group */
+	CHECK(((uint32_t)EventBus::EV_ALL << ((EventBus::BUS_MAX_SUBSCRIBER - 1) * EventBus::BUS_LANE)) < 0x01000000);
+}
+
+static bool Subscribed[2];
+
+static void lateTask(void const* arg) {
+	Subscribed[(uintptr_t)arg] = bus.subscribe(EventBus::EV_SECOND);
+}
+
+osThreadDef(LATE, lateTask, osPriorityHigh, 0, 128);
+
+/* a fifth thread finds the table full, a bus without a group only sleeps */
+static void testTable(void) {
+	EventBus idle;
+	uint32_t start;
+
+	osThreadCreate(osThread(LATE), (void*)0);
+	osThreadCreate(osThread(LATE), (void*)1);
+	CHECK(Subscribed[0]);
+	CHECK(Subscribed[1] != true);
+	/* no group before init: publish does nothing */
+	idle.publish(EventBus::EV_ALL);
+	CHECK_EQ(idle.getPublished(), 1);
+	start = Sys_getTick();
+	CHECK_EQ(idle.wait(100), EventBus::EV_NONE);
+	CHECK_EQ(Sys_getTick() - start, 100);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+
+	CHECK(bus.init());
+	ScreenId = osThreadCreate(osThread(SCREEN), NULL);
+	ActivityId = osThreadCreate(osThread(ACTIVITY), NULL);
+	testWakeups();
+	testMerge();
+	testTable();
+	return Check_result();
+}
@@ -0,0 +1,228 @@
+/**
+  ******************************************************************************
+ * @file    test_fuel_gauge.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   FuelGauge over simulated discharge curves
+ *
+ *	A 150mAh cell with the gauge's OCV curve and internal resistance is
+ *	discharged by the subsystem loads of a usage profile, in virtual ms.
+ *	The gauge sees the terminal voltage once a second, like the MainScreen
+ *	task, and has to track the true SoC; the charge it accounts per
+ *	subsystem has to be exact.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostSys.h"
+#include "HostTarget.h"
+#include "FuelGauge.h"
+#include <stdlib.h>
+
+using namespace hv_driver;
+
+static const uint64_t CELL_CAPACITY = 150ULL * 3600 * 1000000;	// 150mAh in uA*ms
+static const uint32_t CELL_RES = 400;													// mOhm
+static const uint16_t Cell_ocv[] = {3300, 3610, 3690, 3710, 3730, 3750, 3780, 3820, 3870, 3950, 4150};
+static const uint32_t Sub_current[FuelGauge::SUB_NUM] = {12000, 15000, 34000, 4000};
+
+/* on for len ms every period ms, at phase */
+typedef struct {
+	uint32_t period;
+	uint32_t len;
+	uint32_t phase;
+} duty_s;
+
+typedef struct {
+	const char* name;
+	duty_s duty[FuelGauge::SUB_NUM];	// SUB_BASE is always on
+	uint32_t hours;
+} profile_s;
+
+static const profile_s Profiles[] = {
+	{"idle", 				{{1, 1, 0}, {60000, 0, 0}, 		{30000, 20, 100}, 	{1000, 0, 0}}, 		8},
+	{"typical", 		{{1, 1, 0}, {60000, 8000, 0}, {5000, 25, 1300}, 	{1, 1, 0}}, 			6},
+	{"heavy", 			{{1, 1, 0}, {1, 1, 0}, 				{1000, 200, 400}, 	{1, 1, 0}}, 			3},
+};
+
+static double cellOcv(double soc) {
+	if (soc <= 0) {
+		return Cell_ocv[0];
+	}
+	if (soc >= 100) {
+		return Cell_ocv[10];
+	}
+	int i = (int)(soc / 10);
+	return Cell_ocv[i] + (Cell_ocv[i + 1] - Cell_ocv[i]) * (soc - 10 * i) / 10;
+}
+
+static bool isOn(const duty_s &duty, uint32_t ms) {
+	return ((ms + duty.period - duty.phase) % duty.period) < duty.len;
+}
+
+static void testProfile(const profile_s &profile) {
+	FuelGauge gauge;
+	uint64_t drawn[FuelGauge::SUB_NUM] = {0};
+	uint64_t used = 0;
+	uint32_t intervalLoad = 0;
+	int32_t worstError = 0;
+	bool state[FuelGauge::SUB_NUM] = {true, false, false, false};
+
+	Host_sysReset();
+	gauge.init();
+	for (uint32_t ms = 0; ms < profile.hours * 3600000; ms++) {
+		for (uint8_t i = 1; i < FuelGauge::SUB_NUM; i++) {
+			bool on = isOn(profile.duty[i], ms);
+			if (on != state[i]) {
+				gauge.setActive((FuelGauge::SUBSYSTEM)i, on);
+				state[i] = on;
+			}
+		}
+		Host_advance(1);
+		for (uint8_t i = 0; i < FuelGauge::SUB_NUM; i++) {
+			if (state[i] == true) {
+				drawn[i] += Sub_current[i];
+				used += Sub_current[i];
+				intervalLoad += Sub_current[i];
+			}
+		}
+		if ((ms + 1) % 1000 != 0) {
+			continue;
+		}
+
+		/* terminal voltage under the average load of the last second */
+		double soc = 100.0 * (double)(CELL_CAPACITY - used) / CELL_CAPACITY;
+		uint16_t voltage = (uint16_t)(cellOcv(soc) - (intervalLoad / 1000.0) * CELL_RES / 1000000.0);
+		gauge.update(voltage);
+		CHECK(gauge.isCharging() == false);
+		CHECK_EQ(gauge.getLoadCurrent(), intervalLoad / 1000);
+		intervalLoad = 0;
+
+		/* after the filter settles the gauge follows within the table step */
+		int32_t error = (int32_t)gauge.getSoC() - (int32_t)(soc + 0.5);
+		if (ms >= 60000 && abs(error) > abs(worstError)) {
+			worstError = error;
+		}
+	}
+	printf("%-8s %3u%% left, worst error %d%%\n", profile.name,
+					(unsigned)(100 - 100 * used / CELL_CAPACITY), worstError);
+	CHECK(abs(worstError) <= 2);
+
+	/* accounted charge is exact: uA*ms -> uC carried, reported in uAh */
+	for (uint8_t i = 0; i < FuelGauge::SUB_NUM; i++) {
+		CHECK_EQ(gauge.getCharge((FuelGauge::SUBSYSTEM)i), drawn[i] / 1000 / 3600);
+	}
+	CHECK_EQ(gauge.getCharge(FuelGauge::SUB_NUM), 0);
+}
+
+/* energy is charge times the voltage seen at each update */
+static void testEnergy(void) {
+	FuelGauge gauge;
+
+	Host_sysReset();
+	gauge.init();
+	gauge.setActive(FuelGauge::SUB_LCD, true);
+	for (uint32_t s = 0; s < 3600; s++) {
+		Host_advance(1000);
+		gauge.update(3800);
+	}
+	/* 15mA for 1h at 3.8V = 205.2J, base 12mA = 164.16J */
+	CHECK_EQ(gauge.getEnergy(FuelGauge::SUB_LCD), 205200);
+	CHECK_EQ(gauge.getEnergy(FuelGauge::SUB_BASE), 164160);
+	CHECK_EQ(gauge.getCharge(FuelGauge::SUB_LCD), 15000);
+}
+
+/* the charger's 4.2V seen, a resting full cell not */
+static void testCharging(void) {
+	FuelGauge gauge;
+
+	Host_sysReset();
+	gauge.init();
+	Host_advance(1000);
+	gauge.update(3800);
+	uint8_t soc = gauge.getSoC();
+	Host_advance(1000);
+	gauge.update(4200);
+	CHECK(gauge.isCharging() == true);
+	CHECK_EQ(gauge.getSoC(), soc);	// held while charging
+	Host_advance(1000);
+	gauge.update(4158);							// charger 1% low
+	CHECK(gauge.isCharging() == false);
+	Host_advance(1000);
+	gauge.update(4150);							// full, off the charger
+	CHECK(gauge.isCharging() == false);
+	CHECK(gauge.getSoC() > soc);
+	Host_advance(1000);
+	gauge.update(3800);
+	CHECK(gauge.isCharging() == false);
+
+	/* a board with a lower charger voltage, kept over init */
+	gauge.setChargingThreshold(4155);
+	gauge.init();
+	Host_advance(1000);
+	gauge.update(4158);
+	CHECK(gauge.isCharging() == true);
+}
+
+/* days of base load: uAh do not wrap where uC did after 4 days */
+static void testLongRun(void) {
+	FuelGauge gauge;
+
+	Host_sysReset();
+	gauge.init();
+	for (uint32_t s = 0; s < 30 * 86400; s += FuelGauge::FG_MAX_INTERVAL / 1000) {
+		Host_advance(FuelGauge::FG_MAX_INTERVAL);
+		gauge.update(3800);
+	}
+	/* 12mA for 30 days */
+	CHECK_EQ(gauge.getCharge(FuelGauge::SUB_BASE), 12000 * 30 * 24);
+	CHECK_EQ(gauge.getEnergy(FuelGauge::SUB_BASE), 12000ULL * 30 * 86400 * 3800 / 1000000);
+}
+
+/* a late update counts at most FG_MAX_INTERVAL, twice on the same tick
+	 or without a reading is ignored */
+static void testIntervals(void) {
+	FuelGauge gauge;
+
+	Host_sysReset();
+	gauge.init();
+	Host_advance(60000);
+	gauge.update(3800);
+	CHECK_EQ(gauge.getLoadCurrent(), Sub_current[FuelGauge::SUB_BASE]);
+	CHECK_EQ(gauge.getCharge(FuelGauge::SUB_BASE), 12000ULL * FuelGauge::FG_MAX_INTERVAL / 1000 / 3600);
+	gauge.update(3800);
+	gauge.update(0);
+	CHECK_EQ(gauge.getCharge(FuelGauge::SUB_BASE), 12000ULL * FuelGauge::FG_MAX_INTERVAL / 1000 / 3600);
+
+	/* switching within an interval, from interrupt or task alike */
+	Host_advance(100);
+	gauge.setActive(FuelGauge::SUB_ZIGBEE_TX, true);
+	gauge.setActive(FuelGauge::SUB_ZIGBEE_TX, true);
+	Host_advance(250);
+	Host_ipsr = DMA1_Channel2_IRQn + 16;
+	gauge.setActive(FuelGauge::SUB_ZIGBEE_TX, false);
+	Host_ipsr = 0;
+	Host_advance(650);
+	gauge.update(3800);
+	CHECK_EQ(gauge.getLoadCurrent(), 12000 + 34000 * 250 / 1000);
+	CHECK_EQ(Host_primask, 0);
+
+	/* update from a critical section leaves it closed */
+	__disable_irq();
+	Host_advance(1000);
+	gauge.update(3800);
+	gauge.setActive(FuelGauge::SUB_LCD, true);
+	CHECK_EQ(Host_primask, 1);
+	__enable_irq();
+}
+
+int main(void) {
+	for (size_t i = 0; i < sizeof(Profiles) / sizeof(Profiles[0]); i++) {
+		testProfile(Profiles[i]);
+	}
+	testEnergy();
+	testCharging();
+	testIntervals();
+	testLongRun();
+	return Check_result();
+}
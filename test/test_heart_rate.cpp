@@ -0,0 +1,221 @@
+/**
+  ******************************************************************************
+ * @file    test_heart_rate.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   HeartRate bit for bit against a reference model
+ *
+ *	The reference keeps the pulse detector as run lengths of samples in the
+ *	high and low band instead of a sample window, and the trimmed mean with
+ *	std::sort and 64 bit sums. Both are fed the same 1kHz traces with DWT
+ *	timestamps that wrap, and polled at the same times, every reading and
+ *	the time it appears has to match.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostSys.h"
+#include "HeartRate.h"
+#include <algorithm>
+#include <deque>
+#include <vector>
+
+using namespace hv_driver;
+
+static const uint32_t CYCLE_PER_MS = 64000;
+
+class RefHeartRate {
+public:
+	RefHeartRate(void) : _step(0), _highRun(0), _lowRun(0), _start(0) {}
+
+	void process(uint16_t value, uint64_t cycle) {
+		if (_step == 0 && detect(value, true) == true) {
+			_step = 1;
+			_start = cycle;
+		}
+		if (_step == 1) {
+			if (detect(value, false) == true) {
+				_step = 2;
+			} else if ((cycle - _start) / CYCLE_PER_MS > HeartRate::HEART_RATE_HIGH_PULSE_MAX_TIME) {
+				_step = 0;
+			}
+		}
+		if (_step == 2) {
+			if (detect(value, true) == true) {
+				uint64_t pulse = (cycle - _start) / (CYCLE_PER_MS / 1000);
+				_step = 0;
+				if (pulse > HeartRate::HEART_RATE_PULSE_MIN_TIME * 1000ULL
+						&& pulse < HeartRate::HEART_RATE_PULSE_MAX_TIME * 1000ULL
+						&& _pulses.size() < HeartRate::HEART_RATE_PULSE_RING) {
+					_pulses.push_back(pulse - 2 * HeartRate::HEART_RATE_ADC_SAMPLE * 1000);
+				}
+			} else if ((cycle - _start) / CYCLE_PER_MS > HeartRate::HEART_RATE_PULSE_MAX_TIME) {
+				_step = 0;
+			}
+		}
+	}
+
+	bool get(uint8_t &bpm) {
+		std::vector<uint64_t> pulse;
+		uint64_t sum = 0;
+
+		if (_pulses.size() < HeartRate::HEART_RATE_PULSE_SAMPLE) {
+			return false;
+		}
+		pulse.assign(_pulses.begin(), _pulses.begin() + HeartRate::HEART_RATE_PULSE_SAMPLE);
+		_pulses.erase(_pulses.begin(), _pulses.begin() + HeartRate::HEART_RATE_PULSE_SAMPLE);
+		std::sort(pulse.begin(), pulse.end());
+		for (size_t i = HeartRate::HEART_RATE_PULSE_TRIM; i < pulse.size() - HeartRate::HEART_RATE_PULSE_TRIM; i++) {
+			sum += pulse[i];
+		}
+		sum /= pulse.size() - 2 * HeartRate::HEART_RATE_PULSE_TRIM;
+		uint64_t value = (60000000ULL + sum / 2) / sum;
+		bpm = (value > 255) ? 255 : (uint8_t)value;
+		return true;
+	}
+private:
+	/* the detecting sample is seen by the next stage too, in the other band */
+	bool detect(uint16_t value, bool isHigh) {
+		_highRun = (value >= HeartRate::HEART_RATE_HIGH_PULSE_END && value <= HeartRate::HEART_RATE_HIGH_PULSE_TOP)
+			? _highRun + 1 : 0;
+		_lowRun = (value <= HeartRate::HEART_RATE_LOW_PULSE_TOP) ? _lowRun + 1 : 0;
+		if (((isHigh == true) ? _highRun : _lowRun) >= HeartRate::HEART_RATE_ADC_SAMPLE) {
+			_highRun = 0;
+			_lowRun = 0;
+			return true;
+		}
+		return false;
+	}
+
+	uint8_t _step;
+	uint32_t _highRun;
+	uint32_t _lowRun;
+	uint64_t _start;
+	std::deque<uint64_t> _pulses;
+};
+
+typedef struct {
+	const char* name;
+	uint32_t seed;
+	uint16_t bpm;
+	uint16_t variability;		// +- ms per beat
+	uint16_t plateau;				// ms at the top of a beat
+	uint16_t noise;					// +- ADC counts
+	uint16_t poll;					// ms between getHeartRate calls
+	uint32_t seconds;
+} trace_s;
+
+static const trace_s Traces[] = {
+	{"clean 75bpm", 			1, 	75, 	0, 		15, 	0, 		1000, 	120},
+	{"clean 40bpm", 			2, 	40, 	0, 		15, 	0, 		1000, 	120},
+	{"clean 110bpm", 			3, 	110, 	0, 		12, 	0, 		1000, 	120},
+	{"variable 70bpm", 		4, 	70, 	120, 	20, 	30, 	1000, 	300},
+	{"long plateau", 			5, 	60, 	40, 	60, 	20, 	1000, 	300},
+	{"noisy", 						6, 	80, 	60, 	25, 	300, 	1000, 	300},
+	{"slow reader", 			7, 	90, 	30, 	15, 	20, 	25000, 	300},
+};
+
+static uint32_t Rand_state;
+
+static int32_t randRange(int32_t range) {
+	Rand_state = Rand_state * 1664525 + 1013904223;
+	return (range == 0) ? 0 : (int32_t)((Rand_state >> 8) % (uint32_t)(2 * range + 1)) - range;
+}
+
+/* trough, rise, plateau, fall; the plateau sits inside the high band */
+static uint16_t beatSample(uint32_t t, uint16_t plateau, uint32_t rise = 60, uint32_t fall = 150) {
+	int32_t value;
+
+	if (t < rise) {
+		value = 400 + (int32_t)((2250 - 400) * t / rise);
+	} else if (t < rise + plateau) {
+		value = 2250;
+	} else if (t < rise + plateau + fall) {
+		value = 2250 - (int32_t)((2250 - 400) * (t - rise - plateau) / fall);
+	} else {
+		value = 400;
+	}
+	return (uint16_t)value;
+}
+
+static void testTrace(const trace_s &trace) {
+	HeartRate heart;
+	RefHeartRate ref;
+	uint64_t cycle = 0xFFFFFFFFULL - 5000 * CYCLE_PER_MS;	// DWT wraps 5s in
+	uint32_t readings = 0, mismatches = 0;
+	uint32_t beat = 0, period = 0;
+
+	Rand_state = trace.seed;
+	heart.init();
+	for (uint32_t ms = 0; ms < trace.seconds * 1000; ms++, beat++) {
+		if (beat >= period) {
+			beat = 0;
+			period = 60000 / trace.bpm + randRange(trace.variability);
+		}
+		int32_t value = beatSample(beat, trace.plateau) + randRange(trace.noise);
+		value = (value < 0) ? 0 : (value > 4095) ? 4095 : value;
+		uint64_t stamp = cycle + (uint64_t)ms * CYCLE_PER_MS + (uint32_t)(randRange(50) + 50);
+
+		heart.processSample((uint16_t)value, (uint32_t)stamp);
+		ref.process((uint16_t)value, stamp);
+
+		if (ms % trace.poll == 0) {
+			uint8_t bpm = 0, refBpm = 0;
+			bool isNew = heart.getHeartRate(bpm);
+			bool isRefNew = ref.get(refBpm);
+			if (isNew != isRefNew || bpm != refBpm) {
+				if (mismatches++ == 0) {
+					printf("%s: at %ums %d/%u, reference %d/%u\n", trace.name, ms, isNew, bpm, isRefNew, refBpm);
+				}
+			}
+			readings += (isNew == true) ? 1 : 0;
+		}
+	}
+	printf("%-16s %u readings\n", trace.name, readings);
+	CHECK_EQ(mismatches, 0);
+	CHECK(readings > 0);
+}
+
+/* a steady beat with fewer than 2 * HEART_RATE_ADC_SAMPLE samples in the
+	 high band reads its period less the 2 * HEART_RATE_ADC_SAMPLE ms the
+	 detector has always taken off */
+static void testSteadyBeat(void) {
+	static const uint16_t periods[] = {600, 800, 1000, 1500};
+
+	for (size_t n = 0; n < sizeof(periods) / sizeof(periods[0]); n++) {
+		HeartRate heart;
+		uint8_t bpm = 0;
+		bool isNew = false;
+
+		heart.init();
+		for (uint32_t ms = 0; ms < 20u * periods[n] && isNew != true; ms++) {
+			heart.processSample(beatSample(ms % periods[n], 12, 10, 10), ms * CYCLE_PER_MS);
+			isNew = heart.getHeartRate(bpm);
+		}
+		CHECK(isNew == true);
+		CHECK_EQ(bpm, (60000 + (periods[n] - 20) / 2) / (periods[n] - 20));
+	}
+}
+
+/* out of range pulses never reach the average */
+static void testRange(void) {
+	HeartRate heart;
+	uint8_t bpm;
+
+	heart.init();
+	for (uint32_t ms = 0; ms < 60000; ms++) {
+		heart.processSample(beatSample(ms % 400, 12, 10, 10), ms * CYCLE_PER_MS); // 150bpm
+	}
+	CHECK(heart.isReady() == false);
+	CHECK(heart.getHeartRate(bpm) == false);
+}
+
+int main(void) {
+	Host_sysReset();
+	for (size_t i = 0; i < sizeof(Traces) / sizeof(Traces[0]); i++) {
+		testTrace(Traces[i]);
+	}
+	testSteadyBeat();
+	testRange();
+	return Check_result();
+}
@@ -0,0 +1,195 @@
+/**
+  ******************************************************************************
+ * @file    test_link_metrics.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   ZNP link counters driven through the simulated ZNP
+ *
+ *	Data requests go through the real Z_stack and CC2530 to the simulated
+ *	ZNP, which confirms them with the status codes queued in Sim.confirms.
+ *	The counters are then packed into a LINK record like
+ *	BeeWatch::sendDiagnostics does and must come back unchanged.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "ZnpSim.h"
+#include "CC2530.h"
+#include "Z_stack.h"
+#include "TelemetryFrame.h"
+#include "MISC.h"
+#include <string.h>
+
+using namespace hv_driver;
+
+static CC2530 znp(&Sim_rstPin, &Sim_srdyPin, &Sim_mrdyPin, &Sim_spi, &Sim_ssPin);
+static Z_stack zigbee(&znp);
+
+static void znpTask(void const* arg) {
+	(void)arg;
+	znp.run();
+}
+
+osThreadDef(ZNP, znpTask, osPriorityHigh, 0, 256);
+
+static Z_stack::STATUS send(uint8_t handle, uint8_t len) {
+	uint8_t data[32];
+	Z_stack::TxPacket_s packet;
+
+	memset(data, handle, sizeof(data));
+	packet.dstAddr = 0x0000;
+	packet.cmdID = 0xABCD;
+	packet.handle = handle;
+	packet.len = len;
+	packet.txPtr = data;
+	return zigbee.sendData(packet, true, 7, 1000);
+}
+
+/* one data request: SREQ out, empty SRSP in, POLL out, confirm in */
+static void testBytes(void) {
+	CC2530::metrics_s metrics;
+
+	znp.clearMetrics();
+	CHECK_EQ(send(1, 20), Z_stack::ZSuccess);
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.bytesOut, 3 + 8 + 20 + 3);
+	CHECK_EQ(metrics.bytesIn, 3 + 3 + 2);
+	CHECK_EQ(metrics.areq, 1);
+	CHECK_EQ(metrics.dropAREQ, 0);
+	CHECK_EQ(metrics.cmd[0].cmd, CC2530::ZB_SEND_DATA_REQUEST);
+	CHECK_EQ(metrics.cmd[0].count, 1);
+	/* MRDY sampled within 1ms, SRDY low then high after srspDelay */
+	CHECK(metrics.srdyWait >= Sim.srspDelay && metrics.srdyWait <= Sim.srspDelay + 4);
+}
+
+/* failures by status code, the table holds ZB_CONFIRM_CODES of them */
+static void testConfirmCodes(void) {
+	static const uint8_t codes[] = {
+		Z_stack::ZMacNoACK, Z_stack::ZMacNoACK, Z_stack::ZNwkNoRoute, Z_stack::ZApsNoAck,
+		Z_stack::ZMacNoACK, Z_stack::ZNwkNoNetwork, Z_stack::ZBufferFull, Z_stack::ZApsFail,
+		Z_stack::ZNwkNoAck, Z_stack::ZSecNoKey, Z_stack::ZSecNoKey, Z_stack::ZSuccess
+	};
+	Z_stack::ConfirmMetrics_s before;
+	Z_stack::ConfirmMetrics_s after;
+	uint8_t i;
+
+	zigbee.getConfirmMetrics(before);
+	for (i = 0; i < sizeof(codes); i++) {
+		Sim.confirms.push_back(codes[i]);
+	}
+	for (i = 0; i < sizeof(codes); i++) {
+		CHECK_EQ(send(10 + i, 4), codes[i]);
+	}
+	zigbee.getConfirmMetrics(after);
+	CHECK_EQ(after.success, before.success + 1);
+	CHECK_EQ(after.failure, before.failure + 11);
+	CHECK_EQ(after.code[0].status, Z_stack::ZMacNoACK);
+	CHECK_EQ(after.code[0].count, 3);
+	CHECK_EQ(after.code[1].status, Z_stack::ZNwkNoRoute);
+	CHECK_EQ(after.code[2].status, Z_stack::ZApsNoAck);
+	CHECK_EQ(after.code[5].status, Z_stack::ZApsFail);
+	CHECK_EQ(after.code[5].count, 1);
+	/* ZNwkNoAck and ZSecNoKey came in with the table full */
+	CHECK_EQ(after.other, 3);
+}
+
+/* a mute ZNP times the SREQ out, a dead one never raises SRDY */
+static void testTimeouts(void) {
+	CC2530::metrics_s metrics;
+	uint8_t tx[1] = {7};
+	uint8_t rx[4];
+	CC2530::frame_s srsp = {0, 0, sizeof(rx), rx};
+	uint32_t latency = 0;
+
+	znp.clearMetrics();
+	Sim.isDead = true;
+	CHECK(znp.SREQ(CC2530::SYS_GET_TIME, tx, 1, srsp) == false);
+	Sim.isDead = false;
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.srdyTimeout, 1);
+	CHECK(metrics.srdyWait >= CC2530::ZNP_SRDY_TIMEOUT && metrics.srdyWait <= CC2530::ZNP_SRDY_TIMEOUT + 2);
+	CHECK_EQ(metrics.bytesOut, 0);
+
+	znp.clearMetrics();
+	Sim.isMute = true;
+	CHECK(znp.SREQ(CC2530::SYS_GET_TIME, tx, 1, srsp, 200) == false);
+	Sim.isMute = false;
+	osDelay(CC2530::ZNP_SRSP_TIMEOUT);		// the driver gives up after the caller
+	znp.getMetrics(metrics);
+	CHECK_EQ(metrics.srspTimeout, 1);
+	CHECK_EQ(metrics.srdyTimeout, 1);
+	CHECK_EQ(metrics.cmd[0].cmd, CC2530::SYS_GET_TIME);
+	CHECK_EQ(metrics.cmd[0].timeouts, 1);
+	CHECK_EQ(metrics.cmd[0].maxLatency, 0);
+	for (uint8_t i = 0; i < CC2530::ZNP_LATENCY_BINS; i++) {
+		latency += metrics.latency[i];
+	}
+	CHECK_EQ(latency, 0);
+	/* the link comes back */
+	CHECK(znp.SREQ(CC2530::SYS_GET_TIME, tx, 1, srsp) == true);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+/* counters to a LINK record and back, as the diagnostics packet carries them */
+static void testLinkRecord(void) {
+	uint8_t buff[TelemetryFrame::TLM_MAX_SIZE];
+	TelemetryFrame frame(buff, sizeof(buff));
+	TelemetryFrame::link_s link;
+	TelemetryFrame::link_s out;
+	TelemetryFrame::record_s record;
+	CC2530::metrics_s metrics;
+	Z_stack::ConfirmMetrics_s confirm;
+	uint8_t offset = 1;		// after the version byte
+
+	Sim.srspDelay = 40;
+	for (uint8_t i = 0; i < 5; i++) {
+		CHECK_EQ(send(100 + i, 30), Z_stack::ZSuccess);
+	}
+	Sim.srspDelay = 2;
+	znp.getMetrics(metrics);
+	zigbee.getConfirmMetrics(confirm);
+	link.srspTimeout = metrics.srspTimeout;
+	link.srdyTimeout = metrics.srdyTimeout;
+	link.srdyWait = metrics.srdyWait;
+	link.bytesOut = metrics.bytesOut;
+	link.bytesIn = metrics.bytesIn;
+	link.dropAREQ = metrics.dropAREQ;
+	link.retries = 3;
+	link.txFail = 1;
+	link.confirmFail = confirm.failure;
+	for (uint8_t i = 0; i < TelemetryFrame::TLM_LATENCY_BINS; i++) {
+		link.latency[i] = metrics.latency[i];
+	}
+	CHECK_EQ(metrics.latency[6], 5);		// 32..63ms
+	CHECK(frame.addLink(link));
+
+	memset(&out, 0, sizeof(out));
+	if (CHECK(TelemetryFrame::nextRecord(buff, frame.getLength(), offset, record)) != true) {
+		return;
+	}
+	CHECK(TelemetryFrame::decodeLink(record, out));
+	CHECK(memcmp(&out, &link, sizeof(link)) == 0);
+	CHECK_EQ(out.confirmFail, 11);
+	CHECK_EQ(out.latency[6], 5);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+	Sim_init();
+	Sim.onRequest = Sim_zstack;
+
+	CHECK(znp.init() == true);
+	osThreadCreate(osThread(ZNP), NULL);
+	CHECK(zigbee.init(Z_stack::ZCD_startOpt_noClear, Z_stack::ZCD_endDevice, 0xFFFF));
+
+	testBytes();
+	testConfirmCodes();
+	testTimeouts();
+	testLinkRecord();
+	return Check_result();
+}
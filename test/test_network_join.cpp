@@ -0,0 +1,312 @@
+/**
+  ******************************************************************************
+ * @file    test_network_join.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Cached rejoin, scan fallback and time to first screen
+ *
+ *	The Network task runs NetworkJoin, as BeeWatch::startZigbee does,
+ *	against the simulated ZNP through the real CC2530 and Z_stack, with the
+ *	cache in the RTC backup registers. Each power up builds a new
+ *	NetworkJoin on the registers the last one left. Meanwhile the boot task
+ *	brings the display up with the BootSequencer like main.cpp does. The
+ *	first screen must not wait for the network whatever the ZNP does, and
+ *	the join time must follow the simulated rejoin and scan times.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "ZnpSim.h"
+#include "CC2530.h"
+#include "Z_stack.h"
+#include "NetworkJoin.h"
+#include "RTC.h"
+#include "BootSequencer.h"
+#include "MISC.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+/* BeeWatch ZB_BKP_CACHE and ZB_RETRY_DELAY */
+static const uint32_t BKP_CACHE = RTC_BKP_DR2;
+static const uint32_t RETRY_DELAY = 5000;
+static const uint32_t START_TIMEOUT = NetworkJoin::JOIN_START_TIMEOUT;
+static const uint32_t REJOIN_TIMEOUT = NetworkJoin::JOIN_REJOIN_TIMEOUT;
+
+/* ILI9163 reset and init waits, LSE start up */
+static const uint16_t Lcd_waits[] = {20, 20, 20, 120};
+static const uint16_t Lse_waits[] = {250, 250};
+
+static CC2530 znp(&Sim_rstPin, &Sim_srdyPin, &Sim_mrdyPin, &Sim_spi, &Sim_ssPin);
+static Z_stack zigbee(&znp);
+static _RTC clock;
+static NetworkJoin* Join;
+static uint32_t Join_attempts;		// join() start calls, 0 for no limit
+
+static uint16_t backup(uint32_t reg) {
+	return clock.readBackup(BKP_CACHE + reg);
+}
+
+/*---------------------------- tasks ---------------------------------------*/
+
+static osThreadId Main_id;
+static osThreadId Network_id;
+static bool Network_result;
+static uint32_t Network_done;		// tick
+static osThreadId Coordinator_id;
+static uint32_t Coordinator_at;		// ms
+
+static void znpTask(void const* arg) {
+	(void)arg;
+	znp.run();
+}
+
+static void networkTask(void const* arg) {
+	(void)arg;
+	while (1) {
+		osSignalWait(1, osWaitForever);
+		Network_result = Join->join(RETRY_DELAY, Join_attempts);
+		Network_done = osKernelSysTick();
+		osSignalSet(Main_id, 1);
+	}
+}
+
+/* brings the coordinator up Coordinator_at ms after it is signalled */
+static void coordinatorTask(void const* arg) {
+	(void)arg;
+	while (1) {
+		osSignalWait(1, osWaitForever);
+		osDelay(Coordinator_at);
+		Sim.isNetUp = true;
+	}
+}
+
+osThreadDef(ZNP, znpTask, osPriorityRealtime, 0, 256);
+osThreadDef(COORDINATOR, coordinatorTask, osPriorityHigh, 0, 256);
+osThreadDef(NETWORK, networkTask, osPriorityHigh, 0, 256);
+
+typedef struct {
+	const uint16_t* waits;
+	uint8_t count;
+	uint8_t next;
+} step_s;
+
+static uint16_t bootStep(void* arg) {
+	step_s &step = *(step_s*)arg;
+
+	if (step.next >= step.count) {
+		return BootSequencer::BOOT_DONE;
+	}
+	return step.waits[step.next++];
+}
+
+typedef struct {
+	uint32_t firstScreen;		// ms after power up
+	uint32_t joined;				// ms after power up, 0 if it failed
+	uint32_t starts;
+	uint32_t resets;
+	uint32_t attempts;			// NetworkJoin starts of the ZNP
+} boot_s;
+
+/* power up: the boot task starts the Network task, brings the display and
+	 clock up, then waits for the network outcome */
+static boot_s powerUp(uint32_t attempts) {
+	NetworkJoin join(&znp, &zigbee, &clock, BKP_CACHE);
+	Z_stack::AppReg_s app;
+	BootSequencer boot;
+	step_s lcd = {Lcd_waits, sizeof(Lcd_waits) / sizeof(Lcd_waits[0]), 0};
+	step_s lse = {Lse_waits, sizeof(Lse_waits) / sizeof(Lse_waits[0]), 0};
+	boot_s result = {0, 0, 0, 0, 0};
+	uint32_t start;
+	uint16_t wait;
+
+	/* power cycle: the ZNP restarts, the backup domain stays, the counts
+		 start after it */
+	znp.reset();
+	Sim.starts = 0;
+	Sim.resets = 0;
+	osSignalWait(1, 0);
+	memset(&app, 0, sizeof(app));
+	app.appEndPoint = 1;
+	app.appProfileID = 0x000A;
+	app.deviceID = 0x0001;
+	app.deviceVersion = 0x01;
+	join.setApp(app, 100, 100);
+	Join = &join;
+	Join_attempts = attempts;
+
+	start = osKernelSysTick();
+	boot.add(bootStep, &lcd);
+	boot.add(bootStep, &lse);
+	wait = boot.poll(osKernelSysTick());
+	osSignalSet(Network_id, 1);
+	while (wait != BootSequencer::BOOT_DONE) {
+		osDelay(wait);
+		wait = boot.poll(osKernelSysTick());
+	}
+	result.firstScreen = osKernelSysTick() - start;
+
+	/* the NetworkJoin is on this stack, wait for the Network task to be
+		 done with it */
+	osSignalWait(1, osWaitForever);
+	result.joined = (Network_result == true) ? Network_done - start : 0;
+	result.starts = Sim.starts;
+	result.resets = Sim.resets;
+	result.attempts = join.getAttempts();
+	if (Network_result == true) {
+		CHECK(join.getJoinTime() <= result.joined);
+		CHECK_EQ(join.getShortAddr(), Sim.netShortAddr);
+	}
+	return result;
+}
+
+static void report(const char* name, const boot_s &result) {
+	printf("%-24s first screen %4u ms, joined %5u ms, %u start(s), %u reset(s)\n",
+				 name, result.firstScreen, result.joined, result.starts, result.resets);
+	CHECK_EQ(result.attempts, result.starts);
+}
+
+static uint32_t Boot_screen = 0;
+
+/*---------------------------- tests ---------------------------------------*/
+
+/* no cache yet: scan of all 16 channels */
+static void testFirstBoot(void) {
+	boot_s result;
+
+	Sim.isNetUp = true;
+	result = powerUp(1);
+	report("first boot, scan", result);
+	Boot_screen = result.firstScreen;
+	CHECK(result.joined >= 16 * Sim.scanMs && result.joined < 16 * Sim.scanMs + 500);
+	CHECK_EQ(result.starts, 1);
+	CHECK(result.firstScreen < result.joined);
+	/* cached for the next boot */
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_MAGIC), NetworkJoin::JOIN_CACHE_MAGIC);
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_PAN), Sim.netPanID);
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_CHANNEL), Sim.netChannel);
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_SHORT_ADDR), Sim.netShortAddr);
+}
+
+/* cache valid: one channel, one start */
+static void testRejoin(void) {
+	boot_s result = powerUp(1);
+
+	report("cached rejoin", result);
+	CHECK(result.joined >= Sim.rejoinMs && result.joined < Sim.rejoinMs + 200);
+	CHECK_EQ(result.starts, 1);
+	CHECK_EQ(result.resets, 0);
+	CHECK_EQ(result.firstScreen, Boot_screen);
+	/* single channel and PAN went to NV */
+	CHECK_EQ(Sim.nv[0x84][1], (1u << Sim.netChannel) >> 8);
+	CHECK_EQ(Sim.nv[0x83][0], (uint8_t)Sim.netPanID);
+
+	/* a slow ZNP delays the join, not the screen */
+	Sim.rejoinMs = 4000;
+	Sim.srspDelay = 40;
+	result = powerUp(1);
+	report("slow ZNP rejoin", result);
+	CHECK(result.joined >= 4000 && result.joined < 4000 + 1000);
+	CHECK_EQ(result.firstScreen, Boot_screen);
+	Sim.rejoinMs = 300;
+	Sim.srspDelay = 2;
+}
+
+/* coordinator moved: the rejoin times out, the ZNP is reset and scans */
+static void testMoved(void) {
+	boot_s result;
+
+	Sim.netChannel = 20;
+	result = powerUp(1);
+	report("moved, scan fallback", result);
+	CHECK(result.joined >= REJOIN_TIMEOUT + 16 * Sim.scanMs);
+	CHECK(result.joined < REJOIN_TIMEOUT + 16 * Sim.scanMs + 500);
+	CHECK_EQ(result.starts, 2);
+	CHECK_EQ(result.resets, 1);
+	CHECK_EQ(result.firstScreen, Boot_screen);
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_CHANNEL), 20);
+}
+
+/* a torn cache write is not used */
+static void testBadCache(void) {
+	boot_s result;
+
+	clock.writeBackup(BKP_CACHE + NetworkJoin::JOIN_BKP_PAN, backup(NetworkJoin::JOIN_BKP_PAN) ^ 1);
+	result = powerUp(1);
+	report("bad cache, scan", result);
+	CHECK_EQ(result.starts, 1);
+	CHECK(result.joined >= 16 * Sim.scanMs && result.joined < 16 * Sim.scanMs + 500);
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_PAN), Sim.netPanID);
+}
+
+/* no coordinator: rejoin and scan time out, the UI came up long before */
+static void testNoCoordinator(void) {
+	boot_s result;
+	uint32_t start;
+
+	Sim.isNetUp = false;
+	start = osKernelSysTick();
+	result = powerUp(1);
+	report("no coordinator", result);
+	CHECK_EQ(result.joined, 0);
+	CHECK_EQ(result.starts, 2);
+	CHECK_EQ(result.firstScreen, Boot_screen);
+	CHECK(Network_done - start >= REJOIN_TIMEOUT + START_TIMEOUT);
+	CHECK(Network_done - start < REJOIN_TIMEOUT + START_TIMEOUT + 500);
+	/* the cache is kept for when the coordinator is back */
+	CHECK_EQ(backup(NetworkJoin::JOIN_BKP_MAGIC), NetworkJoin::JOIN_CACHE_MAGIC);
+}
+
+/* join retries RETRY_DELAY apart, every ZNP start after the first resets it */
+static void testRetry(void) {
+	uint32_t once = REJOIN_TIMEOUT + START_TIMEOUT;
+	boot_s result;
+	uint32_t start;
+
+	start = osKernelSysTick();
+	result = powerUp(3);
+	report("no coordinator, 3 tries", result);
+	CHECK_EQ(result.joined, 0);
+	CHECK_EQ(result.starts, 6);
+	CHECK_EQ(result.resets, 5);
+	CHECK(Network_done - start >= 3 * once + 2 * RETRY_DELAY);
+	CHECK(Network_done - start < 3 * once + 2 * RETRY_DELAY + 1500);
+
+	/* no limit: the coordinator is back during the first retry delay, the
+		 next start rejoins on the cached channel */
+	Coordinator_at = once + RETRY_DELAY / 2;
+	osSignalSet(Coordinator_id, 1);
+	result = powerUp(0);
+	report("back, no limit", result);
+	CHECK_EQ(result.starts, 3);
+	CHECK_EQ(result.resets, 2);
+	CHECK(result.joined >= once + RETRY_DELAY + Sim.rejoinMs);
+	CHECK(result.joined < once + RETRY_DELAY + Sim.rejoinMs + 500);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+	Sim_init();
+	Sim.onRequest = Sim_zstack;
+
+	CHECK(znp.init() == true);
+	Main_id = osThreadGetId();
+	osThreadSetPriority(Main_id, osPriorityRealtime);
+	osThreadCreate(osThread(ZNP), NULL);
+	Network_id = osThreadCreate(osThread(NETWORK), NULL);
+	Coordinator_id = osThreadCreate(osThread(COORDINATOR), NULL);
+
+	testFirstBoot();
+	testRejoin();
+	testMoved();
+	testBadCache();
+	testNoCoordinator();
+	testRetry();
+	return Check_result();
+}
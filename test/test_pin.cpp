@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+ * @file    test_pin.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Pin, PinGroup and PortInit against GPIO::init
+ *
+ *	GPIO.cpp is the reference. From the same CRL, CRH and BSRR every pin in
+ *	every mode PortInit writes has to leave the registers as GPIO::init
+ *	does, and a table of several pins as GPIO::init called pin by pin.
+ *	Pin and PinGroup stores are checked against the BSRR GPIO writes.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "Pin.h"
+#include <stdio.h>
+
+using namespace hv_driver;
+
+static const uint32_t SEED_CRL = 0x12345678;		// every field something other than the mode written
+static const uint32_t SEED_CRH = 0x9ABCDEF0;
+
+typedef struct {
+	uint32_t CRL;
+	uint32_t CRH;
+	uint32_t BSRR;
+} regs_s;
+
+static uint32_t Bad = 0;
+static uint32_t Compared = 0;
+
+static void seed(void) {
+	GPIOA->CRL = SEED_CRL;
+	GPIOA->CRH = SEED_CRH;
+	GPIOA->BSRR = 0;
+	GPIOA->ODR = 0;
+}
+
+static regs_s snapshot(void) {
+	regs_s regs = {GPIOA->CRL, GPIOA->CRH, GPIOA->BSRR};
+	return regs;
+}
+
+static bool isSame(const regs_s &ref, const regs_s &got) {
+	return ref.CRL == got.CRL && ref.CRH == got.CRH && ref.BSRR == got.BSRR;
+}
+
+/* one pin, one mode, GPIO::init and PortInit from the same registers */
+template <unsigned Num, GPIO::MODE Mode, GPIO::OTYPE Type, GPIO::PULL Pull, GPIO::SPEED Speed>
+static void compare(void) {
+	GPIO gpio(GPIOA, (GPIO::PIN)Num);
+	regs_s ref;
+	regs_s got;
+
+	seed();
+	gpio.init(Mode, Type, Pull, Speed);
+	ref = snapshot();
+	seed();
+	PortInit<GPIOA_BASE, PinInit<Num, Mode, Type, Pull, Speed> >::apply();
+	got = snapshot();
+	Compared++;
+	if (isSame(ref, got) != true) {
+		Bad++;
+		printf("pin %2u mode %d type %d pull %d speed %d: CRL %08x/%08x CRH %08x/%08x BSRR %08x/%08x\n",
+					 Num, Mode, Type, Pull, Speed, ref.CRL, got.CRL, ref.CRH, got.CRH, ref.BSRR, got.BSRR);
+	}
+}
+
+template <unsigned Num, GPIO::MODE Mode, GPIO::OTYPE Type>
+static void compareSpeeds(void) {
+	compare<Num, Mode, Type, GPIO::NONE, GPIO::LOW>();
+	compare<Num, Mode, Type, GPIO::NONE, GPIO::MEDIUM>();
+	compare<Num, Mode, Type, GPIO::NONE, GPIO::HIGH>();
+}
+
+/* every mode PinInit takes, analog as GPIO.cpp sets it: OD, CNF and MODE 0 */
+template <unsigned Num>
+static void compareModes(void) {
+	compareSpeeds<Num, GPIO::OUTPUT, GPIO::PP>();
+	compareSpeeds<Num, GPIO::OUTPUT, GPIO::OD>();
+	compareSpeeds<Num, GPIO::AF, GPIO::PP>();
+	compareSpeeds<Num, GPIO::AF, GPIO::OD>();
+	compare<Num, GPIO::INPUT, GPIO::PP, GPIO::NONE, GPIO::LOW>();
+	compare<Num, GPIO::INPUT, GPIO::PP, GPIO::UP, GPIO::LOW>();
+	compare<Num, GPIO::INPUT, GPIO::PP, GPIO::DOWN, GPIO::LOW>();
+	compare<Num, GPIO::ANALOG, GPIO::OD, GPIO::NONE, GPIO::LOW>();
+}
+
+template <unsigned Num>
+struct AllPins {
+	static void run(void) {
+		compareModes<Num>();
+		AllPins<Num - 1>::run();
+	}
+};
+
+template <>
+struct AllPins<0> {
+	static void run(void) {
+		compareModes<0>();
+	}
+};
+
+static void testModes(void) {
+	AllPins<15>::run();
+	printf("%u pin modes against GPIO::init\n", Compared);
+	CHECK_EQ(Compared, 16 * 16);
+	CHECK_EQ(Bad, 0);
+}
+
+/* a table of several pins as GPIO::init pin by pin, the pulls of both
+	 in one BSRR store where GPIO writes one per pin */
+static void testTable(void) {
+	typedef PinInit<5, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH,
+					PinInit<6, GPIO::INPUT, GPIO::PP, GPIO::NONE, GPIO::LOW,
+					PinInit<7, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH,
+					PinInit<9, GPIO::INPUT, GPIO::PP, GPIO::UP, GPIO::LOW,
+					PinInit<12, GPIO::INPUT, GPIO::PP, GPIO::DOWN, GPIO::LOW> > > > > Mixed;
+	typedef PinInit<0, GPIO::OUTPUT, GPIO::PP, GPIO::NONE, GPIO::LOW,
+					PinInit<1, GPIO::OUTPUT, GPIO::OD, GPIO::NONE, GPIO::MEDIUM,
+					PinInit<2, GPIO::AF, GPIO::PP, GPIO::NONE, GPIO::HIGH,
+					PinInit<3, GPIO::AF, GPIO::OD, GPIO::NONE, GPIO::LOW,
+					PinInit<4, GPIO::INPUT, GPIO::PP, GPIO::NONE, GPIO::LOW,
+					PinInit<5, GPIO::INPUT, GPIO::PP, GPIO::UP, GPIO::LOW,
+					PinInit<6, GPIO::ANALOG, GPIO::OD, GPIO::NONE, GPIO::LOW,
+					PinInit<7, GPIO::OUTPUT, GPIO::PP, GPIO::NONE, GPIO::HIGH> > > > > > > > Low;
+	GPIO pa5(GPIOA, GPIO::PIN5);
+	GPIO pa6(GPIOA, GPIO::PIN6);
+	GPIO pa7(GPIOA, GPIO::PIN7);
+	GPIO pa9(GPIOA, GPIO::PIN9);
+	GPIO pa12(GPIOA, GPIO::PIN12);
+	regs_s ref;
+	regs_s got;
+
+	seed();
+	pa5.initAF(GPIO::PP, GPIO::HIGH);
+	pa6.initInput(GPIO::NONE);
+	pa7.initAF(GPIO::PP, GPIO::HIGH);
+	pa9.initInput(GPIO::UP);
+	pa12.initInput(GPIO::DOWN);
+	ref = snapshot();
+	ref.BSRR = (1u << 9) | (1u << (12 + 16));
+	seed();
+	PortInit<GPIOA_BASE, Mixed>::apply();
+	got = snapshot();
+	CHECK(isSame(ref, got));
+	CHECK_EQ(Mixed::CRL_MASK, 0xFFFu << 20);
+	CHECK_EQ(Mixed::CRH_MASK, (0xFu << 4) | (0xFu << 16));
+
+	/* a full CRL half, written without reading, CRH untouched */
+	{
+		GPIO pins[8] = {
+			GPIO(GPIOA, GPIO::PIN0), GPIO(GPIOA, GPIO::PIN1), GPIO(GPIOA, GPIO::PIN2), GPIO(GPIOA, GPIO::PIN3),
+			GPIO(GPIOA, GPIO::PIN4), GPIO(GPIOA, GPIO::PIN5), GPIO(GPIOA, GPIO::PIN6), GPIO(GPIOA, GPIO::PIN7),
+		};
+
+		seed();
+		pins[0].initOutput(GPIO::PP, GPIO::LOW);
+		pins[1].initOutput(GPIO::OD, GPIO::MEDIUM);
+		pins[2].initAF(GPIO::PP, GPIO::HIGH);
+		pins[3].initAF(GPIO::OD, GPIO::LOW);
+		pins[4].initInput(GPIO::NONE);
+		pins[5].initInput(GPIO::UP);
+		pins[6].init(GPIO::ANALOG, GPIO::OD, GPIO::NONE, GPIO::LOW);
+		pins[7].initOutput(GPIO::PP, GPIO::HIGH);
+		ref = snapshot();
+		seed();
+		PortInit<GPIOA_BASE, Low>::apply();
+		got = snapshot();
+		CHECK(isSame(ref, got));
+		CHECK_EQ(Low::CRL_MASK, 0xFFFFFFFF);
+		CHECK_EQ(got.CRH, SEED_CRH);
+	}
+}
+
+/* the stores GPIO makes, one each */
+static void testStores(void) {
+	typedef Pin<GPIOA_BASE, 13> Pa13;
+	GPIO pa13(GPIOA, GPIO::PIN13);
+
+	Host_reset();
+	Pa13::set();
+	CHECK_EQ(GPIOA->BSRR, 1u << 13);
+	pa13.reset();
+	CHECK_EQ(GPIOA->BSRR, 1u << (13 + 16));
+	Pa13::reset();
+	CHECK_EQ(GPIOA->BSRR, 1u << (13 + 16));
+	pa13.set();
+	CHECK_EQ(GPIOA->BSRR, 1u << 13);
+	Pa13::write(false);
+	CHECK_EQ(GPIOA->BSRR, 1u << (13 + 16));
+	Pa13::write(true);
+	CHECK_EQ(GPIOA->BSRR, 1u << 13);
+	/* toggle flips the output bit only, as GPIO's */
+	GPIOA->ODR = 0x8001;
+	Pa13::toggle();
+	CHECK_EQ(GPIOA->ODR, 0xA001);
+	pa13.toggle();
+	CHECK_EQ(GPIOA->ODR, 0x8001);
+	/* IDR */
+	GPIOA->IDR = ~(1u << 13) & 0xFFFF;
+	CHECK_EQ(Pa13::read(), 0);
+	CHECK_EQ(Pa13::read(), pa13.read());
+	GPIOA->IDR = 1u << 13;
+	CHECK_EQ(Pa13::read(), 1);
+	CHECK_EQ(Pa13::read(), pa13.read());
+	CHECK_EQ(Pa13::MASK, 1u << 13);
+	CHECK_EQ((Pin<GPIOA_BASE, 15>::MASK), 0x8000);
+}
+
+/* several pins, one BSRR store, pins out of the mask left alone */
+static void testGroup(void) {
+	typedef PinGroup<GPIOB_BASE, 0x00F0> Nibble;
+
+	Host_reset();
+	Nibble::write(0x0A5);
+	CHECK_EQ(GPIOB->BSRR, (0x050u << 16) | 0x0A0);
+	Nibble::write(0xFFFF);
+	CHECK_EQ(GPIOB->BSRR, 0x00F0);
+	Nibble::write(0);
+	CHECK_EQ(GPIOB->BSRR, 0x00F0u << 16);
+	Nibble::set();
+	CHECK_EQ(GPIOB->BSRR, 0x00F0);
+	Nibble::reset();
+	CHECK_EQ(GPIOB->BSRR, 0x00F0u << 16);
+	GPIOB->IDR = 0x1234;
+	CHECK_EQ(Nibble::read(), 0x0030);
+	CHECK_EQ(GPIOA->BSRR, 0);
+}
+
+int main(void) {
+	Host_reset();
+
+	testModes();
+	testTable();
+	testStores();
+	testGroup();
+	return Check_result();
+}
@@ -0,0 +1,246 @@
+/**
+  ******************************************************************************
+ * @file    test_ppg_capture.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   PPG capture to replay through a simulated USART1 TX DMA
+ *
+ *	PPGCapture is fed 8 sample blocks at 1kHz as the ADC scan feeds it.
+ *	The simulated DMA channel 4 moves CNDTR bytes from CMAR at the line
+ *	rate, and the bytes are decoded by PPGFrame as the host tool would. The
+ *	replayed samples and timestamps have to be the captured ones, gaps have
+ *	to show as lost frames.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "PPGCapture.h"
+#include <new>
+#include <vector>
+
+using namespace hv_driver;
+
+extern "C" void DMA1_Channel4_IRQHandler(void);
+
+static const uint32_t CYCLE_PER_MS = 64000;
+
+typedef struct {
+	std::vector<uint8_t> bytes;
+	uint32_t sent;				// bytes of the running transfer already on the line
+	double credit;				// line time left over, in bytes
+} line_s;
+
+static line_s Line;
+
+/* 1ms of line time at baud, 10 bits per byte */
+static void simLine(uint32_t baud) {
+	if ((DMA1_Channel4->CCR & DMA_CCR_EN) == 0 || (USART1->CR3 & USART_CR3_DMAT) == 0) {
+		Line.credit = 0;
+		return;
+	}
+	const uint8_t* src = (const uint8_t*)(uintptr_t)DMA1_Channel4->CMAR;
+	Line.credit += baud / 10000.0;
+	while (Line.credit >= 1 && Line.sent < DMA1_Channel4->CNDTR) {
+		Line.bytes.push_back(src[Line.sent++]);
+		Line.credit -= 1;
+	}
+	if (Line.sent == DMA1_Channel4->CNDTR) {
+		Line.sent = 0;
+		DMA1->ISR |= DMA_ISR_TCIF4 | DMA_ISR_GIF4;
+		DMA1->IFCR = 0;
+		Host_irq(DMA1_Channel4_IRQn, DMA1_Channel4_IRQHandler);
+		DMA1->ISR &= ~DMA1->IFCR;
+	}
+}
+
+typedef struct {
+	std::vector<uint16_t> samples;
+	std::vector<uint32_t> cycles;	// per sample
+	uint32_t infoFrames;
+	uint32_t lostFrames;
+	uint32_t crcErrors;
+} replay_s;
+
+static void replay(const std::vector<uint8_t> &bytes, replay_s &out) {
+	PPGFrame parser;
+
+	out.infoFrames = 0;
+	for (size_t i = 0; i < bytes.size(); i++) {
+		PPGFrame::FRAME_TYPE type = parser.parse(bytes[i]);
+		if (type == PPGFrame::FRAME_INFO) {
+			CHECK_EQ(parser.getInfo().cyclePerSecond, SystemCoreClock);
+			CHECK_EQ(parser.getInfo().sampleRate, 1000);
+			CHECK_EQ(parser.getInfo().version, PPGFrame::PPG_FRAME_VERSION);
+			out.infoFrames++;
+		} else if (type == PPGFrame::FRAME_SAMPLES) {
+			const PPGFrame::samples_s &frame = parser.getSamples();
+			for (uint8_t n = 0; n < frame.count; n++) {
+				out.samples.push_back(frame.samples[n]);
+				out.cycles.push_back(frame.cycle + n * CYCLE_PER_MS);
+			}
+		}
+	}
+	out.lostFrames = parser.getLostFrames();
+	out.crcErrors = parser.getCrcErrors();
+}
+
+static uint16_t ppgSample(uint32_t ms) {
+	return (uint16_t)((2048 + 700 * ((ms % 833) < 120 ? (ms % 833) : 120) / 120 + ms * 7919) & 0xFFF);
+}
+
+static PPGCapture* newCapture(uint32_t baud) {
+	static void* memory = Host_alloc32(sizeof(PPGCapture));
+
+	Host_reset();
+	Host_sysReset();
+	Line.bytes.clear();
+	Line.sent = 0;
+	Line.credit = 0;
+	PPGCapture* capture = new (memory) PPGCapture();
+	capture->init(baud, 1000);
+	return capture;
+}
+
+/* blocks of block samples for seconds at 1kHz, the line runs at baud */
+static void run(PPGCapture* capture, uint32_t baud, uint8_t block, uint32_t seconds,
+								std::vector<uint16_t> &sent, std::vector<uint32_t> &stamps) {
+	uint16_t samples[64];
+	uint32_t cycle = 0x12345678;
+
+	for (uint32_t ms = 0; ms < seconds * 1000; ms++) {
+		samples[ms % block] = ppgSample(ms);
+		if (ms % block == (uint32_t)block - 1) {
+			uint32_t first = cycle + (ms - block + 1) * CYCLE_PER_MS;
+			Host_ipsr = DMA1_Channel1_IRQn + 16;
+			capture->pushBlock(samples, block, first);
+			Host_ipsr = 0;
+			for (uint8_t n = 0; n < block; n++) {
+				sent.push_back(samples[n]);
+				stamps.push_back(first + n * CYCLE_PER_MS);
+			}
+		}
+		simLine(baud);
+	}
+	/* drain */
+	for (uint32_t ms = 0; ms < 1000; ms++) {
+		simLine(baud);
+	}
+}
+
+/* 115200 baud carries 1kHz with room, every sample comes back */
+static void testReplay(void) {
+	PPGCapture* capture = newCapture(115200);
+	std::vector<uint16_t> sent;
+	std::vector<uint32_t> stamps;
+	replay_s out = replay_s();
+
+	CHECK_EQ(USART1->BRR, (SystemCoreClock + 115200 / 2) / 115200);
+	capture->start();
+	CHECK(capture->isRunning() == true);
+	run(capture, 115200, 8, 30, sent, stamps);
+	replay(Line.bytes, out);
+
+	printf("115200: %u bytes for %u samples, %u info frames\n", (unsigned)Line.bytes.size(),
+					(unsigned)sent.size(), out.infoFrames);
+	CHECK_EQ(capture->getDropCount(), 0);
+	CHECK_EQ(out.lostFrames, 0);
+	CHECK_EQ(out.crcErrors, 0);
+	CHECK(out.samples == sent);
+	CHECK(out.cycles == stamps);
+	CHECK_EQ(out.infoFrames, 1 + 30000 / 8 / PPGCapture::PPG_CAPTURE_INFO_PERIOD);
+	capture->stop();
+}
+
+/* blocks longer than a frame are split, each frame stamped at its first sample */
+static void testLongBlocks(void) {
+	PPGCapture* capture = newCapture(115200);
+	std::vector<uint16_t> sent;
+	std::vector<uint32_t> stamps;
+	replay_s out = replay_s();
+
+	capture->start();
+	run(capture, 115200, 40, 5, sent, stamps);
+	replay(Line.bytes, out);
+	CHECK_EQ(out.lostFrames, 0);
+	CHECK(out.samples == sent);
+	CHECK(out.cycles == stamps);
+}
+
+/* a line too slow for the stream drops whole frames, the replay sees the
+	 gaps in the sequence and what does arrive is intact */
+static void testOverrun(void) {
+	PPGCapture* capture = newCapture(19200);
+	std::vector<uint16_t> sent;
+	std::vector<uint32_t> stamps;
+	replay_s out = replay_s();
+
+	capture->start();
+	run(capture, 19200, 8, 10, sent, stamps);
+	/* one more block after the drain shows the gap at the end */
+	uint16_t last[8] = {0};
+	capture->pushBlock(last, 8, 0);
+	for (uint32_t ms = 0; ms < 100; ms++) {
+		simLine(19200);
+	}
+	sent.insert(sent.end(), last, last + 8);
+	for (uint8_t n = 0; n < 8; n++) {
+		stamps.push_back(n * CYCLE_PER_MS);
+	}
+	replay(Line.bytes, out);
+
+	printf("19200: %u frames dropped, %u lost in replay\n", capture->getDropCount(), out.lostFrames);
+	CHECK(capture->getDropCount() > 0);
+	CHECK_EQ(out.lostFrames, capture->getDropCount());
+	CHECK_EQ(out.crcErrors, 0);
+	CHECK(out.samples.size() < sent.size());
+	for (size_t i = 0, j = 0; i < out.samples.size(); i++) {
+		while (j < stamps.size() && stamps[j] != out.cycles[i]) {
+			j++;
+		}
+		if (CHECK(j < stamps.size()) != true || CHECK_EQ(out.samples[i], sent[j]) != true) {
+			break;
+		}
+	}
+}
+
+/* a corrupt byte costs its frame, the parser finds the next sync */
+static void testCorruption(void) {
+	PPGCapture* capture = newCapture(115200);
+	std::vector<uint16_t> sent;
+	std::vector<uint32_t> stamps;
+	replay_s out = replay_s();
+
+	capture->start();
+	run(capture, 115200, 8, 2, sent, stamps);
+	std::vector<uint8_t> bytes = Line.bytes;
+	bytes[100] ^= 0x10;
+	bytes[1000] = PPGFrame::PPG_FRAME_SYNC;
+	bytes.insert(bytes.begin() + 2000, 3, 0x00);
+	replay(bytes, out);
+	CHECK(out.crcErrors >= 2);
+	CHECK(out.samples.size() >= sent.size() - 5 * PPGFrame::PPG_FRAME_MAX_SAMPLES);
+	CHECK(out.lostFrames >= 2 && out.lostFrames <= 5);
+}
+
+/* nothing is queued while stopped */
+static void testStopped(void) {
+	PPGCapture* capture = newCapture(115200);
+	uint16_t samples[8] = {0};
+
+	capture->pushBlock(samples, 8, 0);
+	CHECK_EQ(DMA1_Channel4->CCR, 0);
+	capture->start();
+	CHECK((DMA1_Channel4->CCR & DMA_CCR_EN) != 0);	// info frame
+	CHECK_EQ(Host_primask, 0);
+}
+
+int main(void) {
+	testReplay();
+	testLongBlocks();
+	testOverrun();
+	testCorruption();
+	testStopped();
+	return Check_result();
+}
@@ -0,0 +1,150 @@
+/**
+  ******************************************************************************
+ * @file    test_ppg_replay.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Heart rate accuracy and quality verdicts on the capture sets
+ *
+ *	Every set in data/ppg is replayed through HeartRate and SignalQuality
+ *	as BeeWatch runs them. Usable sets have every reading accepted and
+ *	within their error limit of the true rate, unusable sets have none
+ *	accepted. The limits are today's figures with a little room, a change
+ *	to either algorithm that does worse fails here. New captures go in
+ *	data/ppg with a line in Sets.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "PpgReplay.h"
+#include <stdlib.h>
+#include <string>
+
+static const uint8_t MIN_CONFIDENCE = 50;		// BeeWatch PPM_MIN_CONFIDENCE
+
+typedef struct {
+	const char* name;
+	bool isUsable;
+	uint8_t bpm;					// true rate
+	uint8_t maxError;			// bpm, any one reading
+	uint8_t minReadings;
+} set_s;
+
+static const set_s Sets[] = {
+	{"rest_62bpm", 		true, 	62, 	3, 	4},
+	{"seated_78bpm", 	true, 	78, 	6, 	5},
+	{"walk_96bpm", 		true, 	96, 	7, 	6},
+	{"fast_112bpm", 	true, 	112, 	8, 	7},
+	{"arm_swing", 		false, 	80, 	0, 	0},
+	{"no_finger", 		false, 	72, 	0, 	0},
+};
+
+static std::string pathOf(const char* name) {
+	return std::string(PPG_DATA_DIR) + "/" + name + ".ppg";
+}
+
+static void testSet(const set_s &set) {
+	PpgReplay replay;
+	std::vector<ppgReading_s> readings;
+	uint32_t accepted = 0;
+	uint32_t bad = 0;
+	int32_t errorSum = 0;
+
+	if (CHECK(replay.load(pathOf(set.name).c_str())) != true) {
+		return;
+	}
+	CHECK_EQ(replay.getLostFrames(), 0);
+	CHECK_EQ(replay.getCrcErrors(), 0);
+	replay.run(MIN_CONFIDENCE, readings);
+	for (size_t i = 0; i < readings.size(); i++) {
+		int32_t error = (int32_t)readings[i].bpm - set.bpm;
+
+		if (readings[i].isAccepted == true) {
+			accepted++;
+			errorSum += error;
+		}
+		if (set.isUsable == true && (readings[i].isAccepted != true || abs(error) > set.maxError)) {
+			bad++;
+		}
+	}
+	printf("%-14s %2u readings, %2u accepted, mean error %+.1f bpm\n", set.name, (unsigned)readings.size(),
+				 accepted, (accepted == 0) ? 0.0 : (double)errorSum / accepted);
+	if (set.isUsable == true) {
+		CHECK(readings.size() >= set.minReadings);
+		CHECK_EQ(bad, 0);
+	} else {
+		CHECK_EQ(accepted, 0);
+	}
+}
+
+/* lost frames stay gaps in time, the readings after them still hold */
+static void testGaps(void) {
+	const char* path = "ppg_replay_gaps.ppg";
+	PpgReplay source;
+	PpgReplay replay;
+	std::vector<ppgReading_s> readings;
+	std::vector<uint8_t> bytes;
+	FILE* file;
+	int byte;
+
+	CHECK(source.load(pathOf("rest_62bpm").c_str()));
+	CHECK(PpgReplay_write(path, source.getSamples(), source.getCycles()[0], source.getInfo().cyclePerSecond,
+												source.getInfo().sampleRate, 8));
+	file = fopen(path, "rb");
+	while ((byte = fgetc(file)) != EOF) {
+		bytes.push_back((uint8_t)byte);
+	}
+	fclose(file);
+	/* the same bytes as the set */
+	{
+		PpgReplay copy;
+		CHECK(copy.load(path));
+		CHECK(copy.getSamples() == source.getSamples());
+		CHECK(copy.getCycles() == source.getCycles());
+	}
+	/* a burst on the line every 10s */
+	for (size_t at = 20000; at < bytes.size(); at += 22000) {
+		bytes[at] ^= 0xFF;
+		bytes[at + 40] ^= 0x55;
+	}
+	file = fopen(path, "wb");
+	fwrite(&bytes[0], 1, bytes.size(), file);
+	fclose(file);
+
+	CHECK(replay.load(path));
+	remove(path);
+	printf("gaps: %u frames lost, %u crc errors\n", replay.getLostFrames(), replay.getCrcErrors());
+	CHECK(replay.getLostFrames() >= 4);
+	CHECK(replay.getSamples().size() < source.getSamples().size());
+	CHECK_EQ(replay.getCycles().back(), source.getCycles().back());
+	replay.run(MIN_CONFIDENCE, readings);
+	CHECK(readings.size() >= 3);
+	for (size_t i = 0; i < readings.size(); i++) {
+		CHECK(readings[i].isAccepted == true && abs((int32_t)readings[i].bpm - 62) <= 3);
+	}
+}
+
+/* a file that is missing or holds no info frame is refused */
+static void testBadFiles(void) {
+	const char* path = "ppg_replay_empty.ppg";
+	PpgReplay replay;
+	std::vector<ppgReading_s> readings;
+	FILE* file;
+
+	CHECK(replay.load("no/such/file.ppg") != true);
+	file = fopen(path, "wb");
+	fputs("not a capture", file);
+	fclose(file);
+	CHECK(replay.load(path) != true);
+	remove(path);
+	replay.run(MIN_CONFIDENCE, readings);
+	CHECK(readings.empty());
+}
+
+int main(void) {
+	for (size_t i = 0; i < sizeof(Sets) / sizeof(Sets[0]); i++) {
+		testSet(Sets[i]);
+	}
+	testGaps();
+	testBadFiles();
+	return Check_result();
+}
@@ -0,0 +1,315 @@
+/**
+  ******************************************************************************
+ * @file    test_profiler.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Profiler accounting against a kernel model on the real MISC clock
+ *
+ *	The real MISC.cpp keeps the run time stats clock on the DWT cycle
+ *	counter and the interrupt totals. The kernel model switches tasks the
+ *	way vTaskSwitchContext does, charging each one portGET_RUN_TIME_-
+ *	COUNTER_VALUE differences, and reports them through
+ *	uxTaskGetSystemState. Every ms is a SysTick interrupt whose Sys timer
+ *	costs TICK_LOAD cycles, the EXTI handler costs EXTI_US. Built without
+ *	HostSys, MISC is the Sys.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "MISC.h"
+#include "Profiler.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+extern "C" {
+void HAL_IncTick(void);
+}
+
+static const uint32_t TICK_LOAD = 640;		// cycles, 10us of each ms at 64 MHz
+static const uint32_t EXTI_US = 200;
+static const uint8_t KERNEL_TASKS = 10;
+
+/* BeeWatch, creation order after the idle task */
+enum {IDLE = 1, NETWORK, ACTIVITY, ZNP, EXTRA};
+
+/*---------------------------- kernel model --------------------------------*/
+
+typedef struct {
+	UBaseType_t number;
+	uint32_t runTime;			// us, ulRunTimeCounter
+	uint16_t stackFree;		// words
+	bool isAlive;
+} ktask_s;
+
+typedef struct {
+	uint32_t tick;
+	ktask_s tasks[KERNEL_TASKS];
+	uint8_t count;
+	ktask_s* current;
+	uint32_t switchedIn;	// run time clock when current came in
+	size_t heapFree;
+	size_t heapMin;
+	uint64_t cycles;			// elapsed, past the CYCCNT wraps
+	uint32_t owed;				// interrupt cycles the next ms gives back
+} kernel_s;
+
+static kernel_s Kernel;
+
+extern "C" {
+
+TickType_t xTaskGetTickCount(void) {
+	return Kernel.tick;
+}
+
+BaseType_t xTaskGetSchedulerState(void) {
+	return taskSCHEDULER_RUNNING;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+	(void)xTicksToDelay;
+}
+
+void vTaskStepTick(const TickType_t xTicksToJump) {
+	Kernel.tick += xTicksToJump;
+}
+
+eSleepModeStatus eTaskConfirmSleepModeStatus(void) {
+	return eAbortSleep;
+}
+
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
+	(void)xExpectedIdleTime;
+}
+
+size_t xPortGetFreeHeapSize(void) {
+	return Kernel.heapFree;
+}
+
+size_t xPortGetMinimumEverFreeHeapSize(void) {
+	return Kernel.heapMin;
+}
+
+/* as tasks.c: 0 if the array is short, the running task's time since it
+	 came in is not in its counter yet */
+UBaseType_t uxTaskGetSystemState(TaskStatus_t * const pxTaskStatusArray, const UBaseType_t uxArraySize,
+		uint32_t * const pulTotalRunTime) {
+	UBaseType_t num = 0;
+
+	for (uint8_t i = 0; i < Kernel.count; i++) {
+		num += (Kernel.tasks[i].isAlive == true) ? 1 : 0;
+	}
+	if (uxArraySize < num) {
+		return 0;
+	}
+	num = 0;
+	for (uint8_t i = 0; i < Kernel.count; i++) {
+		ktask_s &task = Kernel.tasks[i];
+		if (task.isAlive != true) {
+			continue;
+		}
+		memset(&pxTaskStatusArray[num], 0, sizeof(TaskStatus_t));
+		pxTaskStatusArray[num].xTaskNumber = task.number;
+		pxTaskStatusArray[num].ulRunTimeCounter = task.runTime;
+		pxTaskStatusArray[num].usStackHighWaterMark = task.stackFree;
+		num++;
+	}
+	*pulTotalRunTime = Sys_runTimeCounter();
+	return num;
+}
+
+} /* extern "C" */
+
+static ktask_s* Kernel_task(UBaseType_t number) {
+	for (uint8_t i = 0; i < Kernel.count; i++) {
+		if (Kernel.tasks[i].number == number) {
+			return &Kernel.tasks[i];
+		}
+	}
+	return NULL;
+}
+
+static void Kernel_create(uint16_t stackFree) {
+	ktask_s &task = Kernel.tasks[Kernel.count];
+
+	task.number = ++Kernel.count;
+	task.runTime = 0;
+	task.stackFree = stackFree;
+	task.isAlive = true;
+}
+
+/* vTaskSwitchContext */
+static void Kernel_switch(UBaseType_t number) {
+	uint32_t now = Sys_runTimeCounter();
+
+	if (Kernel.current != NULL) {
+		Kernel.current->runTime += now - Kernel.switchedIn;
+	}
+	Kernel.switchedIn = now;
+	Kernel.current = Kernel_task(number);
+}
+
+static void Kernel_cycles(uint32_t cycles) {
+	DWT->CYCCNT += cycles;
+	Kernel.cycles += cycles;
+}
+
+/* the running task keeps the CPU for ms, SysTick, its Sys timer and
+	 interrupts before are part of them */
+static void Kernel_run(uint32_t ms) {
+	for (uint32_t i = 0; i < ms; i++) {
+		Kernel_cycles(SystemCoreClock / 1000 - TICK_LOAD - Kernel.owed);
+		Kernel.owed = 0;
+		Kernel.tick++;
+		Host_irq(SysTick_IRQn, HAL_IncTick);
+	}
+}
+
+/* 1ms Sys timer standing for the tick's work */
+static void tickLoad(void) {
+	Kernel_cycles(TICK_LOAD);
+}
+
+/* ADXL345 INT1, handled as BeeWatch's EXTI handler accounts it */
+static void extiHandler(void) {
+	uint32_t start = Sys_getCycle();
+
+	Kernel_cycles(EXTI_US * (SystemCoreClock / 1000000));
+	Kernel.owed += EXTI_US * (SystemCoreClock / 1000000);
+	Sys_isrAccount(SYS_ISR_EXTI, start);
+}
+
+/* 100ms: network 5ms, activity 10ms with one gyro interrupt, ZNP 5ms,
+	 idle the rest. Starts and ends on the network task. */
+static void Kernel_periods(uint32_t periods) {
+	for (uint32_t i = 0; i < periods; i++) {
+		Kernel_switch(NETWORK);
+		Kernel_run(5);
+		Kernel_switch(ACTIVITY);
+		Kernel_run(5);
+		Host_irq(EXTI1_IRQn, extiHandler);
+		Kernel_run(5);
+		Kernel_switch(ZNP);
+		Kernel_run(5);
+		Kernel_switch(IDLE);
+		Kernel_run(80);
+	}
+	Kernel_switch(NETWORK);
+}
+
+static uint16_t cpuOf(Profiler::report_s &report, UBaseType_t number) {
+	for (uint8_t i = 0; i < report.taskCount; i++) {
+		if (report.task[i].number == number) {
+			return report.task[i].cpu;
+		}
+	}
+	return 0xFFFF;
+}
+
+static uint16_t cpuSum(Profiler::report_s &report) {
+	uint16_t sum = 0;
+
+	for (uint8_t i = 0; i < report.taskCount; i++) {
+		sum += report.task[i].cpu;
+	}
+	return sum;
+}
+
+/*---------------------------- tests ---------------------------------------*/
+
+static Profiler profiler;
+
+/* the shares of 10s come out as the tasks ran, interrupts on top */
+static void testShares(void) {
+	Profiler::report_s report;
+
+	Kernel_switch(NETWORK);
+	CHECK(profiler.sample(report));
+	Kernel_periods(100);
+	if (CHECK(profiler.sample(report)) != true) {
+		return;
+	}
+	printf("10 s: idle %u, network %u, activity %u, ZNP %u, tick %u, EXTI %u per mille\n",
+				 cpuOf(report, IDLE), cpuOf(report, NETWORK), cpuOf(report, ACTIVITY), cpuOf(report, ZNP),
+				 report.isr[SYS_ISR_TICK], report.isr[SYS_ISR_EXTI]);
+	CHECK_EQ(report.period, 10000000);
+	CHECK_EQ(report.taskCount, 4);
+	CHECK_EQ(cpuOf(report, NETWORK), 50);
+	CHECK_EQ(cpuOf(report, ACTIVITY), 100);
+	CHECK_EQ(cpuOf(report, ZNP), 50);
+	CHECK_EQ(cpuOf(report, IDLE), 800);
+	CHECK_EQ(cpuSum(report), Profiler::PROFILE_SCALE);
+	CHECK_EQ(report.isr[SYS_ISR_TICK], 10);
+	CHECK_EQ(report.isrCount[SYS_ISR_TICK], 10000);
+	CHECK_EQ(report.isr[SYS_ISR_EXTI], 2);
+	CHECK_EQ(report.isrCount[SYS_ISR_EXTI], 100);
+	CHECK_EQ(report.isrCount[SYS_ISR_ADC_DMA], 0);
+	CHECK_EQ(report.task[0].stackFree, 40);
+	CHECK_EQ(report.heapFree, 1200);
+	CHECK_EQ(report.heapMin, 900);
+}
+
+/* minute reports across the cycle counter wraps, about every 67s */
+static void testWrap(void) {
+	Profiler::report_s report;
+	uint64_t start = Kernel.cycles;
+	bool isExact = true;
+
+	for (uint8_t minute = 0; minute < 5; minute++) {
+		Kernel_periods(600);
+		CHECK(profiler.sample(report));
+		isExact = isExact && report.period == 60000000 && cpuOf(report, ACTIVITY) == 100
+				&& cpuOf(report, IDLE) == 800 && report.isrCount[SYS_ISR_TICK] == 60000;
+	}
+	CHECK(Kernel.cycles - start > 4 * 0x100000000ULL);
+	CHECK(isExact);
+}
+
+/* a task created between reports is charged from its start, a deleted
+	 one drops out, more than PROFILE_MAX_TASK is refused */
+static void testTasks(void) {
+	Profiler::report_s report;
+
+	Kernel_create(60);
+	Kernel_periods(5);
+	Kernel_switch(EXTRA);
+	Kernel_run(50);
+	Kernel_task(ACTIVITY)->isAlive = false;
+	Kernel_switch(NETWORK);
+	if (CHECK(profiler.sample(report)) != true) {
+		return;
+	}
+	CHECK_EQ(report.period, 550000);
+	CHECK_EQ(report.taskCount, 4);
+	CHECK_EQ(cpuOf(report, EXTRA), 90);
+	CHECK_EQ(cpuOf(report, ACTIVITY), 0xFFFF);
+	/* the activity share, 50 of 550ms, is gone with it, the rest rounds down */
+	CHECK(cpuSum(report) <= Profiler::PROFILE_SCALE - 90 && cpuSum(report) >= Profiler::PROFILE_SCALE - 91 - 4);
+
+	while (Kernel.count < Profiler::PROFILE_MAX_TASK + 2) {		// ACTIVITY is gone
+		Kernel_create(60);
+	}
+	CHECK(profiler.sample(report) != true);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	CHECK(Sys_timerAssign(tickLoad, 1));
+
+	Kernel.heapFree = 1200;
+	Kernel.heapMin = 900;
+	Kernel_create(40);		// IDLE
+	Kernel_create(120);		// NETWORK
+	Kernel_create(50);		// ACTIVITY
+	Kernel_create(30);		// ZNP
+
+	testShares();
+	testWrap();
+	testTasks();
+	return Check_result();
+}
@@ -0,0 +1,236 @@
+/**
+  ******************************************************************************
+ * @file    test_radio_policy.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   RadioPolicy modes and simulated radio-on time over a day
+ *
+ *	The Network task loop is replayed in virtual ms: update the policy,
+ *	then send and wait one report period. The radio is counted on for
+ *	POLL_ON_MS per parent poll and REPORT_ON_MS per report, against the
+ *	fixed 1s poll and 3s report the watch used before the policy.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "RadioPolicy.h"
+#include <stdio.h>
+
+using namespace hv_driver;
+
+typedef RadioPolicy RP;
+
+static const uint32_t REPORT_BASE = 3000;		// BeeWatch::ZB_REPORT_PERIOD
+static const uint32_t BASE_POLL = 1000;			// ZNP default ZCD_NV_pollRate
+static const uint32_t POLL_ON_MS = 6;				// data request, MAC ack, receive window
+static const uint32_t REPORT_ON_MS = 10;		// data request with APS ack
+static const uint32_t START = 1000;					// ms, tick when the network is up
+
+typedef struct {
+	uint32_t start;		// ms
+	uint32_t end;
+} span_s;
+
+typedef struct {
+	const span_s* active;
+	uint8_t activeCount;
+	const uint32_t* falls;
+	uint8_t fallCount;
+	const uint32_t* downlinks;
+	uint8_t downlinkCount;
+	uint8_t soc;
+	uint32_t length;		// ms
+} day_s;
+
+typedef struct {
+	uint64_t radioOn;		// ms
+	uint64_t baseOn;
+	uint32_t reports;
+	uint32_t nvWrites;
+	uint32_t alertLatency;	// worst ms from a fall to MODE_ALERT
+	uint32_t alertMissed;
+} run_s;
+
+static bool isActive(const day_s &day, uint32_t now) {
+	for (uint8_t i = 0; i < day.activeCount; i++) {
+		if (now >= day.active[i].start && now < day.active[i].end) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/* latest event at or before now, 0 if none */
+static uint32_t lastEvent(const uint32_t* events, uint8_t count, uint32_t now) {
+	uint32_t last = 0;
+
+	for (uint8_t i = 0; i < count; i++) {
+		if (events[i] <= now) {
+			last = events[i];
+		}
+	}
+	return last;
+}
+
+/* Network task: updateRadio, then dispatchTelemetry for a report period */
+static run_s runDay(const day_s &day, RP &policy) {
+	RP::input_s input;
+	run_s run = {0, 0, 0, 0, 0, 0};
+	uint32_t now = START;
+	uint32_t period;
+	uint8_t fall = 0;
+
+	policy.setReportBase(REPORT_BASE);
+	while (now < day.length) {
+		input.isActive = isActive(day, now);
+		input.lastAlert = lastEvent(day.falls, day.fallCount, now);
+		input.lastDownlink = lastEvent(day.downlinks, day.downlinkCount, now);
+		input.soc = day.soc;
+		run.nvWrites += (policy.update(input, now) == true);
+
+		/* falls seen by this update */
+		while (fall < day.fallCount && day.falls[fall] <= now) {
+			if (policy.getMode() == RP::MODE_ALERT) {
+				if (now - day.falls[fall] > run.alertLatency) {
+					run.alertLatency = now - day.falls[fall];
+				}
+			} else {
+				run.alertMissed++;
+			}
+			fall++;
+		}
+		period = policy.getReportPeriod();
+		run.radioOn += (uint64_t)period * POLL_ON_MS / policy.getPollRate() + REPORT_ON_MS;
+		run.reports++;
+		now += period;
+	}
+	run.baseOn = (uint64_t)(now - START) * POLL_ON_MS / BASE_POLL
+							 + (uint64_t)(now - START) / REPORT_BASE * REPORT_ON_MS;
+	return run;
+}
+
+/* sleep, morning, office with walks, evening out, sleep */
+static const uint32_t H = 3600000;
+static const span_s Day_active[] = {
+	{7 * H, 7 * H + H / 2}, {8 * H, 9 * H}, {10 * H, 10 * H + 300000}, {12 * H, 13 * H},
+	{15 * H, 15 * H + 600000}, {17 * H, 19 * H}, {20 * H, 20 * H + 120000}
+};
+static const uint32_t Day_falls[] = {11 * H, 18 * H + 1234};
+static const uint32_t Day_downlinks[] = {9 * H + 5000, 9 * H + 20000, 14 * H};
+
+static void testDay(void) {
+	day_s day = {Day_active, 7, Day_falls, 2, Day_downlinks, 3, 80, 24 * H};
+	RP policy;
+	run_s run = runDay(day, policy);
+	uint64_t total = 0;
+
+	printf("day: radio on %llu ms, fixed 1s poll and 3s report %llu ms (%llu%%), %u reports, %u NV writes\n",
+				 (unsigned long long)run.radioOn, (unsigned long long)run.baseOn,
+				 (unsigned long long)(run.radioOn * 100 / run.baseOn), run.reports, run.nvWrites);
+	printf("day: ms in ALERT %u, RESPONSE %u, ACTIVE %u, IDLE %u\n",
+				 policy.getModeTime(RP::MODE_ALERT), policy.getModeTime(RP::MODE_RESPONSE),
+				 policy.getModeTime(RP::MODE_ACTIVE), policy.getModeTime(RP::MODE_IDLE));
+	CHECK(run.radioOn * 100 < run.baseOn * 25);
+	/* every mode change is one NV write, a handful a day */
+	CHECK(run.nvWrites >= 2 * 7 && run.nvWrites <= 40);
+	CHECK_EQ(run.alertMissed, 0);
+	for (uint8_t i = 0; i < RP::MODE_NUM; i++) {
+		total += policy.getModeTime((RP::RADIO_MODE)i);
+	}
+	/* the last report period is not accounted yet */
+	CHECK(total <= day.length - START && total + 4 * REPORT_BASE * 2 >= day.length - START);
+	CHECK(policy.getModeTime(RP::MODE_IDLE) > 12 * H);
+	CHECK(policy.getModeTime(RP::MODE_ALERT) >= 2 * RP::RP_ALERT_HOLD_MS);
+}
+
+/* IDLE reports every 12s, the fall hold on screen is 5s: the policy must
+	 still see a fall that started and ended between two updates */
+static void testFallBetweenUpdates(void) {
+	static const uint32_t falls[] = {2 * H + 1000};
+	day_s day = {NULL, 0, falls, 1, NULL, 0, 80, 3 * H};
+	RP policy;
+	run_s run = runDay(day, policy);
+
+	CHECK_EQ(run.alertMissed, 0);
+	CHECK(run.alertLatency <= REPORT_BASE * 4);
+	CHECK(policy.getModeTime(RP::MODE_ALERT) >= RP::RP_ALERT_HOLD_MS);
+}
+
+/* activity flapping faster than RP_SETTLE_MS keeps the faster mode */
+static void testSettle(void) {
+	RP policy;
+	RP::input_s input = {true, 0, 0, 80};
+	uint32_t writes = 0;
+	uint32_t now;
+
+	policy.setReportBase(REPORT_BASE);
+	for (now = START; now < START + 600000; now += REPORT_BASE) {
+		input.isActive = ((now / 20000) & 1) == 0;
+		writes += (policy.update(input, now) == true);
+		CHECK_EQ(policy.getMode(), RP::MODE_ACTIVE);
+	}
+	CHECK_EQ(writes, 0);
+
+	/* still for RP_SETTLE_MS, then IDLE */
+	input.isActive = true;
+	policy.update(input, now - 1);
+	input.isActive = false;
+	policy.update(input, now);
+	CHECK_EQ(policy.getMode(), RP::MODE_ACTIVE);
+	policy.update(input, now + RP::RP_SETTLE_MS - 1);
+	CHECK_EQ(policy.getMode(), RP::MODE_ACTIVE);
+	CHECK(policy.update(input, now + RP::RP_SETTLE_MS));
+	CHECK_EQ(policy.getMode(), RP::MODE_IDLE);
+	CHECK_EQ(policy.getPollRate(), 30000);
+	CHECK_EQ(policy.getReportPeriod(), REPORT_BASE * 4);
+
+	/* faster at once */
+	input.isActive = true;
+	CHECK(policy.update(input, now + RP::RP_SETTLE_MS + 1));
+	CHECK_EQ(policy.getMode(), RP::MODE_ACTIVE);
+}
+
+/* downlink and fall timestamps, and the low battery stretch */
+static void testModes(void) {
+	RP policy;
+	RP::input_s input = {false, 0, 0, 80};
+	uint32_t now = 100000;
+
+	policy.setReportBase(REPORT_BASE);
+	input.lastDownlink = now;
+	policy.update(input, now);
+	CHECK_EQ(policy.getMode(), RP::MODE_RESPONSE);
+	CHECK_EQ(policy.getPollRate(), 1000);
+	CHECK_EQ(policy.getReportPeriod(), REPORT_BASE);
+
+	input.lastAlert = now + 1000;
+	policy.update(input, now + 1000);
+	CHECK_EQ(policy.getMode(), RP::MODE_ALERT);
+	CHECK_EQ(policy.getReportPeriod(), REPORT_BASE / 4);
+
+	/* low battery leaves alerts alone */
+	input.soc = RP::RP_LOW_SOC - 1;
+	policy.update(input, now + 2000);
+	CHECK_EQ(policy.getPollRate(), 1000);
+	CHECK_EQ(policy.getReportPeriod(), REPORT_BASE / 4);
+
+	/* alert hold over, RESPONSE hold over, then settled to IDLE */
+	policy.update(input, now + 1000 + RP::RP_ALERT_HOLD_MS);
+	policy.update(input, now + 1000 + RP::RP_ALERT_HOLD_MS + RP::RP_SETTLE_MS);
+	CHECK_EQ(policy.getMode(), RP::MODE_IDLE);
+	CHECK_EQ(policy.getPollRate(), 60000);
+	CHECK_EQ(policy.getReportPeriod(), REPORT_BASE * 4 * 2);
+
+	/* CFG_REPORT base change */
+	policy.setReportBase(60000);
+	policy.update(input, now + 1000 + RP::RP_ALERT_HOLD_MS + RP::RP_SETTLE_MS + 1);
+	CHECK_EQ(policy.getReportPeriod(), 60000u * 4 * 2);
+}
+
+int main(void) {
+	testDay();
+	testFallBetweenUpdates();
+	testSettle();
+	testModes();
+	return Check_result();
+}
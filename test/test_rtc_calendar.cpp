@@ -0,0 +1,287 @@
+/**
+  ******************************************************************************
+ * @file    test_rtc_calendar.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   RTC second tick cache against gmtime, month ends and leap years
+ *
+ *	The real RTC.cpp runs on the register model, its counter holds the s
+ *	since RTC_EPOCH_YEAR. The test moves the counter as the LSE would and
+ *	raises the second interrupt. After every tick the cached date, time,
+ *	weekday and epoch must match gmtime of the same second.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "RTC.h"
+#include "MISC.h"
+#include <stdio.h>
+#include <time.h>
+
+using namespace hv_driver;
+
+extern "C" {
+void RTC_IRQHandler(void);
+}
+
+static const time_t UNIX_2000 = 946684800;		// 1 January 2000 in Unix time
+static const uint32_t DAY = 86400;
+
+static _RTC rtc;
+static uint8_t Fields = 0;		// of the last tick
+static uint32_t Ticks = 0;
+
+static void onTick(uint8_t fields) {
+	Fields = fields;
+	Ticks++;
+}
+
+/* the LSE moves the counter on by seconds, one interrupt for all of them
+	 as after STOP mode */
+static uint32_t counter(void) {
+	return (RTC->CNTH << 16) | (RTC->CNTL & 0xFFFF);
+}
+
+static void tick(uint32_t seconds) {
+	uint32_t counter = ::counter() + seconds;
+
+	RTC->CNTH = counter >> 16;
+	RTC->CNTL = counter & 0xFFFF;
+	RTC->CRL |= RTC_CRL_SECF;
+	Host_irq(RTC_IRQn, RTC_IRQHandler);
+}
+
+/* the cache against gmtime, epoch in s since 2000 */
+static bool isCalendar(uint32_t epoch) {
+	time_t unixTime = UNIX_2000 + (time_t)epoch;
+	struct tm* tm = gmtime(&unixTime);
+	_RTC::date_s date;
+	_RTC::time_s time;
+
+	rtc.getDate(date);
+	rtc.getTime(time);
+	return rtc.getEpoch() == epoch && date.year == tm->tm_year + 1900 && date.month == tm->tm_mon + 1
+			&& date.day == tm->tm_mday && date.weekday == tm->tm_wday && time.hours == tm->tm_hour
+			&& time.minutes == tm->tm_min && time.seconds == tm->tm_sec;
+}
+
+/* s since 2000 of a date at 00:00:00 */
+static uint32_t epochOf(uint16_t year, uint8_t month, uint8_t day) {
+	struct tm tm = {0, 0, 0, day, month - 1, year - 1900, 0, 0, 0, 0, 0};
+
+	return (uint32_t)(timegm(&tm) - UNIX_2000);
+}
+
+/* date first, then the time of day, as BeeWatch's settings do */
+static bool setClock(uint32_t epoch) {
+	time_t unixTime = UNIX_2000 + (time_t)epoch;
+	struct tm* tm = gmtime(&unixTime);
+
+	return rtc.setDate((_RTC::WEEKDAY)tm->tm_wday, tm->tm_mday, tm->tm_mon + 1, tm->tm_year + 1900)
+			&& rtc.setTime(tm->tm_hour, tm->tm_min, tm->tm_sec);
+}
+
+/* up to startTick, with the backup domain empty */
+static void testInit(void) {
+	_RTC::date_s date;
+
+	RCC->BDCR |= RCC_BDCR_LSERDY;
+	RTC->CRL = RTC_CRL_RTOFF;
+	CHECK(rtc.startTick(onTick) != true);
+	CHECK(rtc.init() != true);
+	CHECK(rtc.isTimeValid() != true);
+	CHECK_EQ(rtc.readBackup(RTC_BKP_DR1), 0x2000);
+	/* 22/3/2016 03:21 in the counter, whole */
+	CHECK_EQ(counter(), epochOf(2016, 3, 22) + 3 * 3600 + 21 * 60);
+	CHECK(isCalendar(counter()));
+	CHECK(rtc.startTick(onTick));
+	CHECK(RTC->CRH & RTC_CRH_SECIE);
+	CHECK(rtc.getDate(date));
+}
+
+/* every second across month ends, leap days and the new year */
+static void testRollover(void) {
+	static const struct {
+		uint16_t year;
+		uint8_t month;
+		uint8_t day;
+	} edges[] = {
+		{2016, 1, 31}, {2016, 2, 28}, {2016, 2, 29}, {2015, 2, 28}, {2000, 2, 28}, {2000, 2, 29},
+		{2017, 4, 30}, {2017, 6, 30}, {2017, 9, 30}, {2017, 11, 30}, {2016, 12, 31}, {2099, 12, 31},
+	};
+	uint32_t bad = 0;
+
+	for (uint8_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+		uint32_t midnight = epochOf(edges[i].year, edges[i].month, edges[i].day) + DAY;
+		uint32_t epoch = midnight - 3;
+
+		if (CHECK(setClock(epoch)) != true) {
+			continue;
+		}
+		bad += (isCalendar(epoch) == true) ? 0 : 1;
+		for (uint8_t s = 0; s < 6; s++) {
+			tick(1);
+			epoch++;
+			bad += (isCalendar(epoch) == true) ? 0 : 1;
+			if (epoch == midnight) {
+				CHECK_EQ(Fields, _RTC::FIELD_SECOND | _RTC::FIELD_MINUTE | _RTC::FIELD_HOUR | _RTC::FIELD_DATE);
+			}
+		}
+	}
+	CHECK_EQ(bad, 0);
+}
+
+/* each field changes only when the one below it carries */
+static void testFields(void) {
+	uint32_t epoch = epochOf(2016, 3, 22) + 3 * 3600 + 21 * 60 + 58;
+	uint32_t ticks;
+
+	setClock(epoch);
+	tick(1);
+	CHECK_EQ(Fields, _RTC::FIELD_SECOND);
+	tick(1);
+	CHECK_EQ(Fields, _RTC::FIELD_SECOND | _RTC::FIELD_MINUTE);
+	tick(38 * 60 - 1);
+	tick(1);
+	CHECK_EQ(Fields, _RTC::FIELD_SECOND | _RTC::FIELD_MINUTE | _RTC::FIELD_HOUR);
+	CHECK(isCalendar(epochOf(2016, 3, 22) + 4 * 3600));
+	/* a second interrupt with the counter where it was is no tick */
+	ticks = Ticks;
+	tick(0);
+	CHECK_EQ(Ticks, ticks);
+}
+
+/* STOP mode: one tick catches up on hours to weeks, through 2100 which
+	 is not a leap year */
+static void testCatchUp(void) {
+	uint32_t epoch = epochOf(2000, 1, 1);
+	uint32_t end = epochOf(2100, 3, 2);
+	uint32_t seed = 12345;
+	uint32_t steps = 0;
+	uint32_t bad = 0;
+	bool isFeb29 = false;
+
+	setClock(epoch);
+	while (epoch < end) {
+		uint32_t step;
+
+		seed = seed * 1103515245 + 12345;
+		step = 1 + (seed >> 8) % (40 * DAY);
+		if (epoch < epochOf(2100, 2, 27) && epoch + step > epochOf(2100, 2, 27)) {
+			step = epochOf(2100, 2, 27) - epoch;		// walk 2100's February a day at a time
+		} else if (epoch >= epochOf(2100, 2, 27)) {
+			step = DAY;
+		}
+		tick(step);
+		epoch += step;
+		steps++;
+		bad += (isCalendar(epoch) == true) ? 0 : 1;
+		if (epoch >= epochOf(2100, 2, 27)) {
+			_RTC::date_s date;
+			rtc.getDate(date);
+			isFeb29 = isFeb29 || (date.month == 2 && date.day == 29);
+		}
+	}
+	printf("catch up: %u ticks over 100 years, %u wrong\n", steps, bad);
+	CHECK_EQ(bad, 0);
+	CHECK(isFeb29 != true);
+}
+
+/* set while ticking reloads the cache, bad dates are refused */
+static void testSet(void) {
+	uint32_t seconds;
+	uint16_t ms;
+
+	CHECK(rtc.setDate(_RTC::MONDAY, 29, 2, 2016));
+	CHECK(rtc.setTime(12, 30, 15));
+	CHECK(isCalendar(epochOf(2016, 2, 29) + 12 * 3600 + 30 * 60 + 15));
+	CHECK(rtc.setDate(_RTC::MONDAY, 29, 2, 2015) != true);
+	CHECK(rtc.setDate(_RTC::MONDAY, 31, 4, 2016) != true);
+	CHECK(rtc.setTime(24, 0, 0) != true);
+	CHECK(isCalendar(epochOf(2016, 2, 29) + 12 * 3600 + 30 * 60 + 15));
+	tick(DAY);
+	CHECK(isCalendar(epochOf(2016, 3, 1) + 12 * 3600 + 30 * 60 + 15));
+	/* the divider counts down through the second */
+	RTC->DIVH = 0;
+	RTC->DIVL = 32767 / 4;
+	rtc.getStamp(seconds, ms);
+	CHECK_EQ(seconds, rtc.getEpoch());
+	CHECK(ms >= 749 && ms <= 751);
+}
+
+/* steps wait for the next second interrupt, nothing blocks */
+static void testAdjust(void) {
+	_RTC idle;
+	uint32_t start = epochOf(2016, 12, 31) + DAY - 2;
+	uint32_t tickNow = Sys_getTick();
+	uint32_t seconds;
+	uint16_t ms;
+
+	CHECK(idle.adjust(5) != true);
+	setClock(start);
+	RTC->DIVH = 0;
+	RTC->DIVL = 32767 / 2;
+	CHECK(rtc.adjust(3));
+	CHECK(rtc.adjust(-1));
+	/* stamps see it at once, the counter and the cache at the tick */
+	rtc.getStamp(seconds, ms);
+	CHECK_EQ(seconds, start + 2);
+	CHECK(ms >= 499 && ms <= 501);
+	CHECK_EQ(counter(), start);
+	CHECK_EQ(rtc.getEpoch(), start);
+	CHECK_EQ(Sys_getTick(), tickNow);
+	tick(1);
+	CHECK_EQ(counter(), start + 1 + 2);
+	CHECK(isCalendar(start + 3));
+	CHECK_EQ(Fields, _RTC::FIELD_SECOND | _RTC::FIELD_MINUTE | _RTC::FIELD_HOUR | _RTC::FIELD_DATE);
+	CHECK((RTC->CRL & RTC_CRL_CNF) == 0);
+	/* applied once */
+	tick(1);
+	CHECK(isCalendar(start + 4));
+	CHECK_EQ(Fields, _RTC::FIELD_SECOND);
+	/* back over midnight */
+	CHECK(rtc.adjust(-3600));
+	tick(1);
+	CHECK(isCalendar(start + 5 - 3600));
+	/* before RTC_EPOCH_YEAR is refused, the time set drops a pending step */
+	CHECK(rtc.adjust(-(int32_t)(start + DAY)) != true);
+	CHECK(rtc.adjust(60));
+	CHECK(rtc.setEpoch(start));
+	tick(1);
+	CHECK(isCalendar(start + 1));
+}
+
+/* after a reset the counter is the time, an old time of day counter is not */
+static void testReset(void) {
+	_RTC again;
+	_RTC old;
+	uint32_t epoch = epochOf(2026, 10, 19) + 12 * 3600;
+
+	rtc.setEpoch(epoch);
+	CHECK(again.init());
+	CHECK(again.isTimeValid());
+	CHECK_EQ(counter(), epoch);
+	CHECK(again.startTick(onTick));
+	CHECK_EQ(again.getEpoch(), epoch);
+
+	rtc.writeBackup(RTC_BKP_DR1, 0x1234);
+	CHECK(old.init() != true);
+	CHECK_EQ(counter(), epochOf(2016, 3, 22) + 3 * 3600 + 21 * 60);
+	CHECK_EQ(rtc.readBackup(RTC_BKP_DR1), 0x2000);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+
+	testInit();
+	testRollover();
+	testFields();
+	testCatchUp();
+	testSet();
+	testAdjust();
+	testReset();
+	return Check_result();
+}
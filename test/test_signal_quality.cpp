@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+ * @file    test_signal_quality.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   SignalQuality against labelled PPG traces
+ *
+ *	Traces are built at the 1kHz scan rate from a pulse shape, a DC level
+ *	and seeded noise, each labelled usable or not by construction. Usable
+ *	ones have to reach PPM_MIN_CONFIDENCE, the rest have to stay below it.
+ *	Levels are the amplified front end's: a usable pulse spans HeartRate's
+ *	bands, below 750 counts to 2000..2550, and motion drives it to the rails.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "SignalQuality.h"
+#include <math.h>
+
+using namespace hv_driver;
+
+static const uint8_t MIN_CONFIDENCE = 50;		// BeeWatch PPM_MIN_CONFIDENCE
+static const uint32_t WINDOW_SAMPLES = SignalQuality::SQI_WINDOW_SIZE * SignalQuality::SQI_DECIMATION;
+
+typedef struct {
+	const char* name;
+	bool isUsable;
+	uint16_t bpm;
+	int32_t dc;
+	int32_t amplitude;		// ADC counts, peak to peak of the pulse
+	int32_t noise;				// ADC counts, uniform +-noise
+	int32_t swing;				// ADC counts, peak to peak of a 1.2Hz arm swing
+} trace_s;
+
+static const trace_s Traces[] = {
+	{"rest 60bpm", 			true, 	60, 	1300, 	1900, 	2, 		0},
+	{"rest 72bpm", 			true, 	72, 	1300, 	1900, 	4, 		0},
+	{"exercise 150bpm", true, 	150, 	1250, 	1700, 	4, 		0},
+	{"weak but clean", 	true, 	72, 	1250, 	1300, 	1, 		0},
+	{"weak and noisy", 	false, 	72, 	1300, 	400, 	200, 	0},
+	{"no finger", 			false, 	72, 	400, 		0, 		60, 	0},
+	{"low perfusion", 	false, 	72, 	3000, 	40, 	1, 		0},
+	{"noisy", 					false, 	72, 	2000, 	1000, 	1400, 	0},
+	{"clipped", 				false, 	72, 	3300, 	1900, 	4, 		0},
+	{"arm swing", 			false, 	72, 	1300, 	1900, 	4, 		5000},
+};
+
+static uint32_t Rand_state;
+
+static int32_t randRange(int32_t range) {
+	Rand_state = Rand_state * 1664525 + 1013904223;
+	return (range == 0) ? 0 : (int32_t)((Rand_state >> 8) % (uint32_t)(2 * range + 1)) - range;
+}
+
+/* systolic peak and dicrotic wave, t in s after the beat, 0..1 */
+static double pulseShape(double t) {
+	double systolic = exp(-pow((t - 0.15) / 0.1, 2));
+	double dicrotic = 0.4 * exp(-pow((t - 0.45) / 0.12, 2));
+	return systolic + dicrotic;
+}
+
+static uint16_t sample(const trace_s &trace, uint32_t ms) {
+	double t = fmod((double)ms * trace.bpm / 60000.0, 1.0) * 60.0 / trace.bpm;
+	int32_t value;
+
+	value = trace.dc + (int32_t)(trace.amplitude * (pulseShape(t) - 0.4)) + randRange(trace.noise)
+		+ (int32_t)(trace.swing / 2 * sin(2 * M_PI * 1.2 * ms / 1000.0));
+	if (value < 0) {
+		value = 0;
+	} else if (value > 4095) {
+		value = 4095;
+	}
+	return (uint16_t)value;
+}
+
+static void testTrace(const trace_s &trace) {
+	SignalQuality sqi;
+	SignalQuality::quality_s quality;
+	uint32_t ms = 0;
+
+	Rand_state = 12345;
+	sqi.init();
+	/* a window is needed first */
+	for (; ms < WINDOW_SAMPLES - 1; ms++) {
+		sqi.pushSample(sample(trace, ms));
+	}
+	CHECK(sqi.evaluate(quality) == false);
+
+	/* three windows, every one has to carry the label */
+	for (uint8_t n = 0; n < 3; n++) {
+		for (uint32_t end = ms + WINDOW_SAMPLES; ms < end; ms++) {
+			sqi.pushSample(sample(trace, ms));
+		}
+		CHECK(sqi.evaluate(quality) == true);
+		printf("%-16s snr %2udB pi %4u clip %3u%% corr %3u%% -> %3u\n", trace.name, quality.snrDb,
+						quality.perfusion, quality.clipPercent, quality.correlation, quality.confidence);
+		CHECK(quality.confidence <= 100);
+		CHECK_EQ(sqi.getConfidence(), quality.confidence);
+		if (trace.isUsable == true) {
+			CHECK(quality.confidence >= MIN_CONFIDENCE);
+			CHECK_EQ(quality.clipPercent, 0);
+		} else {
+			CHECK(quality.confidence < MIN_CONFIDENCE);
+		}
+	}
+}
+
+/* clipped samples are counted per evaluate, not kept from older windows */
+static void testClipReset(void) {
+	SignalQuality sqi;
+	SignalQuality::quality_s quality;
+
+	Rand_state = 1;
+	sqi.init();
+	for (uint32_t ms = 0; ms < WINDOW_SAMPLES; ms++) {
+		sqi.pushSample(4095);
+	}
+	CHECK(sqi.evaluate(quality) == true);
+	CHECK_EQ(quality.clipPercent, 100);
+	CHECK_EQ(quality.confidence, 0);
+
+	for (uint32_t ms = 0; ms < WINDOW_SAMPLES; ms++) {
+		sqi.pushSample(sample(Traces[1], ms));
+	}
+	CHECK(sqi.evaluate(quality) == true);
+	CHECK_EQ(quality.clipPercent, 0);
+	CHECK(quality.confidence >= MIN_CONFIDENCE);
+}
+
+/* an evaluate 70s late: past 16 bit counts, the clip ratio of all of it */
+static void testLateEvaluate(void) {
+	SignalQuality sqi;
+	SignalQuality::quality_s quality;
+	uint32_t ms = 0;
+
+	Rand_state = 1;
+	sqi.init();
+	for (; ms < 7000; ms++) {
+		sqi.pushSample(4095);
+	}
+	for (; ms < 70000; ms++) {
+		sqi.pushSample(sample(Traces[1], ms));
+	}
+	CHECK(sqi.evaluate(quality) == true);
+	CHECK_EQ(quality.clipPercent, 10);
+	CHECK_EQ(quality.confidence, 0);
+	/* the window itself was clean, the SNR saw 70s of noise sums */
+	CHECK(quality.snrDb >= SignalQuality::SQI_SNR_GOOD_DB);
+}
+
+int main(void) {
+	for (size_t i = 0; i < sizeof(Traces) / sizeof(Traces[0]); i++) {
+		testTrace(Traces[i]);
+	}
+	testClipReset();
+	testLateEvaluate();
+	return Check_result();
+}
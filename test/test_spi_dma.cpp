@@ -0,0 +1,104 @@
+/**
+  ******************************************************************************
+ * @file    test_spi_dma.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   SPI1 DMA start, completion and abort on the register model
+ *
+ *	The real SPI.cpp sets up DMA1 channel 2 (RX) and 3 (TX). A transfer
+ *	that never completes is aborted: both channels off, the SPI DMA
+ *	requests off, the flags and a pending interrupt cleared, and no
+ *	callback afterwards.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "SPI.h"
+#include <new>
+#include <string.h>
+
+using namespace hv_driver;
+
+extern "C" void DMA1_Channel2_IRQHandler(void);
+
+static uint32_t Done = 0;
+static uint8_t* Buffer;					// below 4GB, CMAR holds its address
+
+static void onDone(void) {
+	Done++;
+}
+
+static bool isPending(IRQn_Type irqn) {
+	return (NVIC->ISPR[(uint32_t)irqn >> 5] & (1UL << ((uint32_t)irqn & 0x1F))) != 0;
+}
+
+/* a transfer that completes: callback once, channels off */
+static void testComplete(SPI &spi) {
+	uint8_t* tx = Buffer;
+	uint8_t* rx = Buffer + 32;
+
+	memcpy(tx, "\x01\x02\x03\x04", 4);
+	CHECK(spi.transferDMA(tx, rx, 4));
+	CHECK(DMA1_Channel2->CCR & DMA_CCR_EN);
+	CHECK(DMA1_Channel3->CCR & DMA_CCR_EN);
+	CHECK_EQ(DMA1_Channel2->CNDTR, 4);
+	CHECK_EQ(DMA1_Channel3->CMAR, (uint32_t)(uintptr_t)tx);
+	CHECK_EQ(DMA1_Channel2->CPAR, (uint32_t)(uintptr_t)&SPI1->DR);
+	CHECK((SPI1->CR2 & (SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN)) == (SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN));
+	DMA1->ISR = DMA_ISR_TCIF2 | DMA_ISR_GIF2;
+	Host_irq(DMA1_Channel2_IRQn, DMA1_Channel2_IRQHandler);
+	CHECK_EQ(Done, 1);
+	CHECK_EQ(DMA1_Channel2->CCR, 0);
+	CHECK_EQ(DMA1_Channel3->CCR, 0);
+	CHECK_EQ(SPI1->CR2 & (SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN), 0);
+}
+
+/* a stalled transfer is stopped, its late interrupt is gone */
+static void testAbort(SPI &spi) {
+	uint8_t* rx = Buffer + 32;
+
+	Done = 0;
+	CHECK(spi.transferDMA(NULL, rx, 8));
+	DMA1_Channel2->CNDTR = 3;								// 5 bytes in, then nothing
+	DMA1->ISR = DMA_ISR_HTIF2 | DMA_ISR_GIF2;
+	NVIC->ISPR[DMA1_Channel2_IRQn >> 5] |= 1UL << (DMA1_Channel2_IRQn & 0x1F);
+	DMA1->IFCR = 0;
+	spi.abortDMA();
+	CHECK_EQ(DMA1_Channel2->CCR & DMA_CCR_EN, 0);
+	CHECK_EQ(DMA1_Channel3->CCR & DMA_CCR_EN, 0);
+	CHECK_EQ(SPI1->CR2 & (SPI_CR2_RXDMAEN | SPI_CR2_TXDMAEN), 0);
+	CHECK_EQ(DMA1->IFCR, DMA_IFCR_CGIF2 | DMA_IFCR_CGIF3);
+	CHECK(isPending(DMA1_Channel2_IRQn) != true);
+	CHECK_EQ(Done, 0);
+
+	/* the next transfer starts on stopped channels */
+	CHECK(spi.transferDMA(NULL, rx, 2));
+	CHECK_EQ(DMA1_Channel2->CNDTR, 2);
+	CHECK(DMA1_Channel2->CCR & DMA_CCR_EN);
+	spi.abortDMA();
+}
+
+/* abort before initDMA does nothing */
+static void testNoDma(void) {
+	SPI spi(SPI2);
+	uint8_t* rx = Buffer;
+
+	SPI2->CR2 = SPI_CR2_TXEIE;
+	spi.abortDMA();
+	CHECK_EQ(SPI2->CR2, SPI_CR2_TXEIE);
+	CHECK(spi.transferDMA(NULL, rx, 1) != true);
+}
+
+int main(void) {
+	Host_reset();
+	Buffer = (uint8_t*)Host_alloc32(64);
+	SPI &spi = *new (Host_alloc32(sizeof(SPI))) SPI(SPI1);
+
+	spi.init(SPI::MASTER, SPI::BAUDRATE_DIV8, SPI::NSS_SOFT, SPI::CPHA_1EDGE, SPI::CPOL_LOW);
+	CHECK(spi.initDMA(5, onDone));
+	testComplete(spi);
+	testAbort(spi);
+	testNoDma();
+	return Check_result();
+}
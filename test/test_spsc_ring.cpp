@@ -0,0 +1,298 @@
+/**
+  ******************************************************************************
+ * @file    test_spsc_ring.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   SpscRing on two threads, order, loss, wrap and throughput
+ *
+ *	A producer thread stands for the interrupt, a consumer thread for the
+ *	task. Every item carries its sequence number and a copy inverted, a
+ *	torn, lost, repeated or reordered item shows up in the consumer. The
+ *	throughput runs set the ring against a mutex guarded queue doing the
+ *	same, as a critical section around the globals would.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "SpscRing.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <time.h>
+
+using namespace hv_driver;
+
+static const uint32_t STRESS_ITEMS = 2000000;
+static const uint16_t BULK_MAX = 7;		// odd, so bulk copies straddle the wrap
+
+typedef struct {
+	uint32_t seq;
+	uint32_t check;		// ~seq
+} item_s;
+
+typedef SpscRing<item_s, 64> Ring;
+
+typedef struct {
+	Ring* ring;
+	uint32_t items;
+	bool isBulk;
+	uint32_t fullCount;	// producer found it full
+	uint32_t bad;				// consumer: torn or out of order
+	uint32_t received;
+	uint16_t maxCount;	// fullest the consumer saw it
+} run_s;
+
+static double nowSec(void) {
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* producer(void* arg) {
+	run_s* run = (run_s*)arg;
+	item_s items[BULK_MAX];
+	uint32_t seq = 0;
+	uint32_t fullCount = 0;		// kept local, off the consumer's cache line
+
+	while (seq < run->items) {
+		uint16_t count = 1 + seq % BULK_MAX;
+
+		if (count > run->items - seq) {
+			count = run->items - seq;
+		}
+		for (uint16_t i = 0; i < count; i++) {
+			items[i].seq = seq + i;
+			items[i].check = ~(seq + i);
+		}
+		if (run->isBulk == true) {
+			count = run->ring->push(items, count);
+		} else {
+			count = (run->ring->push(items[0]) == true) ? 1 : 0;
+		}
+		if (count == 0) {
+			fullCount++;
+			sched_yield();
+		}
+		seq += count;
+	}
+	run->fullCount = fullCount;
+	return NULL;
+}
+
+static void* consumer(void* arg) {
+	run_s* run = (run_s*)arg;
+	item_s items[BULK_MAX];
+	uint32_t received = 0;
+	uint32_t bad = 0;
+	uint16_t maxCount = 0;
+	uint16_t count;
+
+	while (received < run->items) {
+		uint16_t used = run->ring->getCount();
+
+		if (used > maxCount) {
+			maxCount = used;
+		}
+		if (run->isBulk == true) {
+			count = run->ring->pop(items, 1 + received % BULK_MAX);
+		} else {
+			count = (run->ring->pop(items[0]) == true) ? 1 : 0;
+		}
+		if (count == 0) {
+			sched_yield();
+		}
+		for (uint16_t i = 0; i < count; i++) {
+			if (items[i].seq != received || items[i].check != ~received) {
+				bad++;
+			}
+			received++;
+		}
+	}
+	run->received = received;
+	run->bad = bad;
+	run->maxCount = maxCount;
+	return NULL;
+}
+
+static double runThreads(run_s &run) {
+	pthread_t prod;
+	pthread_t cons;
+	double start = nowSec();
+
+	pthread_create(&cons, NULL, consumer, &run);
+	pthread_create(&prod, NULL, producer, &run);
+	pthread_join(prod, NULL);
+	pthread_join(cons, NULL);
+	return nowSec() - start;
+}
+
+/* single and bulk, every item once and in order */
+static void testStress(void) {
+	for (uint8_t bulk = 0; bulk < 2; bulk++) {
+		Ring ring;
+		run_s run = {&ring, STRESS_ITEMS, bulk == 1, 0, 0, 0, 0};
+		double sec = runThreads(run);
+
+		printf("%s: %u items in %.3f s, %.1f M/s, full %u times\n", (bulk == 1) ? "bulk  " : "single",
+					 run.received, sec, run.received / sec / 1e6, run.fullCount);
+		CHECK_EQ(run.received, STRESS_ITEMS);
+		CHECK_EQ(run.bad, 0);
+		CHECK(run.maxCount <= ring.getCapacity());
+		CHECK(ring.isEmpty());
+	}
+}
+
+/*---------------------------- mutex baseline ------------------------------*/
+
+typedef struct {
+	pthread_mutex_t lock;
+	item_s buff[64];
+	uint32_t head;
+	uint32_t tail;
+	uint32_t items;
+	uint32_t received;
+	uint32_t bad;
+} locked_s;
+
+static void* lockedProducer(void* arg) {
+	locked_s* q = (locked_s*)arg;
+	uint32_t seq = 0;
+
+	while (seq < q->items) {
+		bool isPushed = false;
+
+		pthread_mutex_lock(&q->lock);
+		if (q->head - q->tail < 64) {
+			q->buff[q->head % 64].seq = seq;
+			q->buff[q->head % 64].check = ~seq;
+			q->head++;
+			isPushed = true;
+		}
+		pthread_mutex_unlock(&q->lock);
+		if (isPushed == true) {
+			seq++;
+		} else {
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+static void* lockedConsumer(void* arg) {
+	locked_s* q = (locked_s*)arg;
+
+	while (q->received < q->items) {
+		item_s item;
+		bool isPopped = false;
+
+		pthread_mutex_lock(&q->lock);
+		if (q->head != q->tail) {
+			item = q->buff[q->tail % 64];
+			q->tail++;
+			isPopped = true;
+		}
+		pthread_mutex_unlock(&q->lock);
+		if (isPopped != true) {
+			sched_yield();
+			continue;
+		}
+		if (item.seq != q->received || item.check != ~q->received) {
+			q->bad++;
+		}
+		q->received++;
+	}
+	return NULL;
+}
+
+/* printed for comparison only, the host scheduler decides the figures */
+static void testBaseline(void) {
+	static locked_s q;
+	pthread_t prod;
+	pthread_t cons;
+	double start = nowSec();
+	double sec;
+
+	pthread_mutex_init(&q.lock, NULL);
+	q.items = STRESS_ITEMS;
+	pthread_create(&cons, NULL, lockedConsumer, &q);
+	pthread_create(&prod, NULL, lockedProducer, &q);
+	pthread_join(prod, NULL);
+	pthread_join(cons, NULL);
+	sec = nowSec() - start;
+	printf("mutex : %u items in %.3f s, %.1f M/s\n", q.received, sec, q.received / sec / 1e6);
+	CHECK_EQ(q.received, STRESS_ITEMS);
+	CHECK_EQ(q.bad, 0);
+	pthread_mutex_destroy(&q.lock);
+}
+
+/*---------------------------- one thread ----------------------------------*/
+
+/* full, empty, partial bulk copies and clear */
+static void testLimits(void) {
+	SpscRing<uint8_t, 4> ring;
+	uint8_t in[6] = {1, 2, 3, 4, 5, 6};
+	uint8_t out[6] = {0};
+	uint8_t item = 0;
+
+	CHECK(ring.isEmpty());
+	CHECK(ring.pop(item) != true);
+	CHECK_EQ(ring.pop(out, 6), 0);
+	CHECK_EQ(ring.push(in, 6), 4);
+	CHECK(ring.isFull());
+	CHECK(ring.push(in[4]) != true);
+	CHECK_EQ(ring.push(in, 1), 0);
+	CHECK_EQ(ring.pop(out, 3), 3);
+	CHECK_EQ(out[0], 1);
+	CHECK_EQ(out[2], 3);
+	CHECK_EQ(ring.getCount(), 1);
+	/* straddles the end of the buffer */
+	CHECK_EQ(ring.push(in + 4, 2), 2);
+	CHECK(ring.pop(item));
+	CHECK_EQ(item, 4);
+	CHECK_EQ(ring.pop(out, 6), 2);
+	CHECK_EQ(out[0], 5);
+	CHECK_EQ(out[1], 6);
+	CHECK(ring.push(in[0]));
+	ring.clear();
+	CHECK(ring.isEmpty());
+	CHECK_EQ(ring.getCapacity(), 4);
+}
+
+/* the 16 bit indices wrap, the largest ring still tells full from empty */
+static void testWrap(void) {
+	static SpscRing<uint16_t, 32768> big;
+	SpscRing<uint32_t, 8> ring;
+	uint32_t bad = 0;
+	uint32_t item;
+	uint16_t value;
+
+	for (uint32_t i = 0; i < 3 * 65536 + 5; i++) {
+		if (ring.push(i) != true || ring.pop(item) != true || item != i) {
+			bad++;
+		}
+	}
+	CHECK_EQ(bad, 0);
+	CHECK(ring.isEmpty());
+
+	for (uint8_t pass = 0; pass < 3; pass++) {
+		for (uint32_t i = 0; i < 32768; i++) {
+			bad += (big.push((uint16_t)i) == true) ? 0 : 1;
+		}
+		CHECK(big.isFull());
+		CHECK_EQ(big.getCount(), 32768);
+		CHECK(big.push(0) != true);
+		for (uint32_t i = 0; i < 32768; i++) {
+			bad += (big.pop(value) == true && value == (uint16_t)i) ? 0 : 1;
+		}
+		CHECK(big.isEmpty());
+	}
+	CHECK_EQ(bad, 0);
+}
+
+int main(void) {
+	testLimits();
+	testWrap();
+	testStress();
+	testBaseline();
+	return Check_result();
+}
@@ -0,0 +1,121 @@
+/**
+  ******************************************************************************
+ * @file    test_static_task.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   StaticTask sizes and what it hands the kernel
+ *
+ *	xTaskGenericCreate is caught here: the stack must be the member array
+ *	at the depth of the template and the priority the CMSIS one mapped as
+ *	cmsis_os.c does. The BeeWatch tasks are the types main.cpp creates.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "StaticTask.h"
+#include "BeeWatchTasks.h"
+
+using namespace hv_driver;
+
+typedef struct {
+	uint32_t calls;
+	TaskFunction_t code;
+	const char* name;
+	uint16_t depth;
+	void* argument;
+	UBaseType_t priority;
+	StackType_t* stack;
+	BaseType_t result;
+} create_s;
+
+static create_s Create;
+static uint32_t Handle = 0x1000;
+
+extern "C" BaseType_t xTaskGenericCreate(TaskFunction_t pxTaskCode, const char * const pcName, const uint16_t usStackDepth,
+		void * const pvParameters, UBaseType_t uxPriority, TaskHandle_t * const pxCreatedTask,
+		StackType_t * const puxStackBuffer, const MemoryRegion_t * const xRegions) {
+	(void)xRegions;
+	Create.calls++;
+	Create.code = pxTaskCode;
+	Create.name = pcName;
+	Create.depth = usStackDepth;
+	Create.argument = pvParameters;
+	Create.priority = uxPriority;
+	Create.stack = puxStackBuffer;
+	if (Create.result == pdPASS) {
+		*pxCreatedTask = (TaskHandle_t)(uintptr_t)(Handle++);
+	}
+	return Create.result;
+}
+
+static void taskCode(void const* arg) {
+	(void)arg;
+}
+
+/* the object is the stack and the id, nothing from the heap */
+template <class Task>
+static bool isStackOnly(uint16_t depth) {
+	return sizeof(Task) >= depth * sizeof(StackType_t)
+			&& sizeof(Task) <= depth * sizeof(StackType_t) + 2 * sizeof(void*);
+}
+
+template <class Task>
+static bool isStackOnly(void) {
+	return isStackOnly<Task>(Task::TASK_STACK);
+}
+
+static void testSizes(void) {
+	CHECK(isStackOnly<BootTask>());
+	CHECK(isStackOnly<NetworkTask>());
+	CHECK(isStackOnly<ZnpTask>());
+	CHECK(isStackOnly<ZigbeeTxTask>());
+	CHECK(isStackOnly<ActivityTask>());
+	CHECK((isStackOnly<StaticTask<1, osPriorityIdle> >()));
+	CHECK_EQ(ZnpTask::TASK_STACK, 3 * configMINIMAL_STACK_SIZE / 2);
+	CHECK_EQ(ActivityTask::TASK_PRIORITY, osPriorityNormal);
+}
+
+/* member stack, template depth, CMSIS priority, started once */
+static void testStart(void) {
+	static ZnpTask task;
+	int argument = 0;
+	osThreadId id;
+
+	Create.calls = 0;
+	Create.result = pdPASS;
+	CHECK(task.getId() == NULL);
+	id = task.start("ZNP", taskCode, &argument);
+	CHECK(id != NULL);
+	CHECK(task.getId() == id);
+	CHECK_EQ(Create.calls, 1);
+	CHECK(Create.code == (TaskFunction_t)taskCode);
+	CHECK(Create.argument == &argument);
+	CHECK_EQ(Create.depth, ZnpTask::TASK_STACK);
+	CHECK_EQ(Create.priority, tskIDLE_PRIORITY + 6);
+	CHECK((uint8_t*)Create.stack >= (uint8_t*)&task
+				&& (uint8_t*)(Create.stack + ZnpTask::TASK_STACK) <= (uint8_t*)&task + sizeof(task));
+	/* again: the same thread, no second one on the same stack */
+	CHECK(task.start("ZNP", taskCode, NULL) == id);
+	CHECK_EQ(Create.calls, 1);
+}
+
+/* no TCB: NULL and a later start may still succeed */
+static void testNoHeap(void) {
+	static ActivityTask task;
+
+	Create.calls = 0;
+	Create.result = errCOULD_NOT_ALLOCATE_REQUIRED_MEMORY;
+	CHECK(task.start("ACTIVITY_STATUS", taskCode, NULL) == NULL);
+	CHECK(task.getId() == NULL);
+	CHECK_EQ(Create.priority, tskIDLE_PRIORITY + 3);
+	Create.result = pdPASS;
+	CHECK(task.start("ACTIVITY_STATUS", taskCode, NULL) != NULL);
+	CHECK_EQ(Create.calls, 2);
+}
+
+int main(void) {
+	testSizes();
+	testStart();
+	testNoHeap();
+	return Check_result();
+}
@@ -0,0 +1,422 @@
+/**
+  ******************************************************************************
+ * @file    test_stop_mode.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   STOP mode time keeping against a model of the LSE and the RTC
+ *
+ *	The real MISC.cpp and ADCScan.cpp run on the kernel model of
+ *	test_sys_timer. True time moves with every tick and with every sleep,
+ *	the RTC counter and divider registers follow it from an LSE of any
+ *	frequency through the prescaler programmed. A STOP sleep lasts until
+ *	the counter reaches the alarm, or less when an EXTI comes first. The
+ *	kernel tick must stay with true time whatever the prescaler.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostHal.h"
+#include "MISC.h"
+#include "ADCScan.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+using namespace hv_driver;
+
+extern "C" {
+void HAL_IncTick(void);
+void Sys_suppressTicksAndSleep(uint32_t idleTicks);
+}
+
+/* BeeWatch */
+static const uint32_t PPM_WINDOW_MS = 30000;
+static const uint32_t PPM_PERIOD_MS = 300000;
+static const uint32_t ZB_REPORT_PERIOD = 3000;
+
+static ADCScan adcScan(ADC1);
+
+/*---------------------------- LSE and RTC ---------------------------------*/
+
+typedef struct {
+	uint64_t us;					// true time
+	uint32_t lseHz;				// as the crystal runs
+	uint32_t prl;					// RTC PRL
+	uint32_t earlyEvery;	// one STOP in so many ends early on an EXTI, 0 never
+	uint32_t stops;
+	uint64_t stopUs;			// true time spent in STOP
+} world_s;
+
+static world_s World;
+
+static uint64_t World_cycles(void) {
+	return World.us * World.lseHz / 1000000;
+}
+
+/* counter and divider as the APB1 interface shows them after a resync */
+static void World_sync(void) {
+	uint64_t cycles = World_cycles();
+	uint32_t cnt = (uint32_t)(cycles / (World.prl + 1));
+	uint32_t div = World.prl - (uint32_t)(cycles % (World.prl + 1));
+
+	RTC->CNTH = cnt >> 16;
+	RTC->CNTL = cnt & 0xFFFF;
+	RTC->DIVH = div >> 16;
+	RTC->DIVL = div & 0xFFFF;
+}
+
+/* HAL_PWR_EnterSTOPMode: until the counter reaches the alarm */
+static void World_stop(void) {
+	uint32_t alarm = (RTC->ALRH << 16) | RTC->ALRL;
+	uint64_t cycles = (uint64_t)alarm * (World.prl + 1);
+	uint64_t wake = (cycles * 1000000 + World.lseHz - 1) / World.lseHz;
+
+	CHECK((EXTI->IMR & EXTI_IMR_MR17) != 0);
+	World.stops++;
+	if (World.earlyEvery != 0 && rand() % World.earlyEvery == 0) {
+		wake = World.us + (wake - World.us) * (rand() % 100) / 100; // motion
+	}
+	if (wake < World.us) {
+		wake = World.us; // alarm already passed, wakes at once
+	}
+	World.stopUs += wake - World.us;
+	World.us = wake;
+	World_sync();
+}
+
+static void World_reset(uint32_t lseHz, uint32_t prl) {
+	World.us = 0;
+	World.lseHz = lseHz;
+	World.prl = prl;
+	World.earlyEvery = 0;
+	World.stops = 0;
+	World.stopUs = 0;
+	World_sync();
+}
+
+/*---------------------------- kernel model --------------------------------*/
+
+typedef struct {
+	uint32_t period;		// ms between wakeups
+	uint32_t spread;		// ms added at random to each period
+	uint32_t busy;			// ms running per wakeup
+	uint32_t (*run)(void);	// ms to the next wakeup instead of period, may be NULL
+	uint32_t next;
+} task_s;
+
+typedef struct {
+	uint32_t tick;
+	bool isPending;
+	uint32_t irqs;
+	uint32_t expected;		// idle time the sleep was asked for
+	uint32_t overshoot;		// steps past it, configASSERT on the target
+	task_s* tasks;
+	uint8_t taskCount;
+} kernel_s;
+
+static kernel_s Kernel;
+
+extern "C" {
+
+TickType_t xTaskGetTickCount(void) {
+	return Kernel.tick;
+}
+
+BaseType_t xTaskGetSchedulerState(void) {
+	return taskSCHEDULER_RUNNING;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+	(void)xTicksToDelay;
+}
+
+void vTaskStepTick(const TickType_t xTicksToJump) {
+	if (xTicksToJump > Kernel.expected) {
+		Kernel.overshoot++;
+	}
+	Kernel.tick += xTicksToJump;
+}
+
+eSleepModeStatus eTaskConfirmSleepModeStatus(void) {
+	return eStandardSleep;
+}
+
+/* SysTick keeps true time, one tick short and the pended one does the rest */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
+	Kernel.tick += xExpectedIdleTime - 1;
+	World.us += (uint64_t)(xExpectedIdleTime - 1) * 1000;
+	World_sync();
+	Kernel.isPending = true;
+}
+
+} /* extern "C" */
+
+static void Kernel_tick(void) {
+	Kernel.irqs++;
+	Kernel.tick++;
+	World.us += 1000;
+	World_sync();
+	Host_irq(SysTick_IRQn, HAL_IncTick);
+}
+
+static void Kernel_run(uint32_t end) {
+	uint32_t next;
+
+	while ((int32_t)(Kernel.tick - end) < 0) {
+		next = end;
+		for (uint8_t i = 0; i < Kernel.taskCount; i++) {
+			task_s &task = Kernel.tasks[i];
+			if ((int32_t)(task.next - Kernel.tick) <= 0) {
+				for (uint32_t ms = 0; ms < task.busy; ms++) {
+					Kernel_tick();
+				}
+				if (task.run != NULL) {
+					task.next = Kernel.tick + task.run();
+				} else {
+					task.next += task.period + ((task.spread != 0) ? rand() % task.spread : 0);
+				}
+			}
+			if ((int32_t)(task.next - next) < 0) {
+				next = task.next;
+			}
+		}
+		if ((int32_t)(next - Kernel.tick) <= 0) {
+			continue;
+		}
+		Kernel.expected = next - Kernel.tick;
+		Sys_suppressTicksAndSleep(next - Kernel.tick);
+		Kernel.isPending = false;
+		Kernel_tick();
+	}
+}
+
+static void Kernel_reset(task_s* tasks, uint8_t count) {
+	Kernel.irqs = 0;
+	Kernel.overshoot = 0;
+	Kernel.tasks = tasks;
+	Kernel.taskCount = count;
+	for (uint8_t i = 0; i < count; i++) {
+		tasks[i].next = Kernel.tick + tasks[i].period;
+	}
+}
+
+/* ms the kernel is ahead of true time since the run started */
+static int32_t Kernel_error(uint32_t tick0, uint64_t us0) {
+	return (int32_t)(Kernel.tick - tick0) - (int32_t)((World.us - us0) / 1000);
+}
+
+/* the divider only moves on an LSE clock, a sleep that starts between two
+	 is counted from the one before: up to a clock ahead each, never behind */
+static bool isInStep(int32_t error) {
+	return error >= -1 && error <= 1 + (int32_t)((uint64_t)World.stops * 1000000 / World.lseHz / 1000);
+}
+
+/*---------------------------- heart rate window ---------------------------*/
+
+/* BeeWatch::scheduleHeartRate, the reading comes readMs into the window */
+typedef struct {
+	uint32_t start;
+	uint32_t readMs;
+	bool isRead;
+	uint32_t scans;
+} hrWindow_s;
+
+static hrWindow_s Hr;
+
+static uint32_t scheduleHeartRate(void) {
+	uint32_t elapsed = Kernel.tick - Hr.start;
+
+	if (adcScan.isRunning() == true && Hr.isRead != true && elapsed >= Hr.readMs) {
+		Hr.isRead = true; // EV_HEART_RATE woke the task
+	}
+	if (adcScan.isRunning() == true) {
+		if (Hr.isRead != true && elapsed < PPM_WINDOW_MS) {
+			return (Hr.readMs - elapsed < PPM_WINDOW_MS - elapsed) ? Hr.readMs - elapsed : PPM_WINDOW_MS - elapsed;
+		}
+		adcScan.stop();
+	}
+	if (elapsed >= PPM_PERIOD_MS) {
+		Hr.start = Kernel.tick;
+		Hr.isRead = false;
+		Hr.scans++;
+		adcScan.start();
+		return (Hr.readMs < PPM_WINDOW_MS) ? Hr.readMs : PPM_WINDOW_MS;
+	}
+	return PPM_PERIOD_MS - elapsed;
+}
+
+/*---------------------------- tests ---------------------------------------*/
+
+/* the scan holds the clocks, STOP only once it is off */
+static void testScanLock(void) {
+	task_s tasks[1] = {{ZB_REPORT_PERIOD, 0, 5, NULL, 0}};
+	uint32_t stops;
+
+	World_reset(32768, 32767);
+	Kernel_reset(tasks, 1);
+	adcScan.start();
+	Kernel_run(Kernel.tick + 60000);
+	CHECK_EQ(World.stops, 0);
+	stops = Sys_getStopCount();
+
+	adcScan.stop();
+	Kernel_run(Kernel.tick + 60000);
+	printf("scan off:             %u STOP sleeps a minute, %u interrupts\n", World.stops, Kernel.irqs);
+	CHECK_EQ(Sys_getStopCount() - stops, World.stops);
+	/* every report period but the one the scan ran into */
+	CHECK(World.stops >= 60000 / ZB_REPORT_PERIOD - 1);
+	CHECK_EQ(Kernel.overshoot, 0);
+	CHECK_EQ(Sys_getTick(), Kernel.tick);
+}
+
+/* a reading every PPM_PERIOD_MS, the network every report period */
+static void testHeartRateWindow(void) {
+	task_s tasks[2] = {{ZB_REPORT_PERIOD, 0, 5, NULL, 0}, {1, 0, 2, scheduleHeartRate, 0}};
+	uint32_t tick0 = Kernel.tick;
+	uint64_t us0;
+
+	World_reset(32768, 32767);
+	us0 = World.us;
+	Hr.start = Kernel.tick - PPM_PERIOD_MS; // first window at once, as at boot
+	Hr.readMs = 12000;
+	Hr.isRead = false;
+	Hr.scans = 0;
+	Kernel_reset(tasks, 2);
+	Kernel_run(Kernel.tick + 30 * 60000);
+
+	printf("heart rate window:    %u scans, %.1f%% of 30 min in STOP, %.1f interrupts/s, error %d ms\n",
+				 Hr.scans, World.stopUs * 100.0 / (World.us - us0), Kernel.irqs / 1800.0, Kernel_error(tick0, us0));
+	CHECK_EQ(Hr.scans, 6);
+	CHECK(adcScan.isRunning() != true);
+	/* the alarm is on a second boundary: a report period of 3 s due on one
+		 sleeps 2 s of it in STOP and the rest on SysTick */
+	CHECK(World.stopUs * 100 >= (World.us - us0) * 60);
+	CHECK(Kernel.irqs <= 1800 * 3);
+	CHECK(isInStep(Kernel_error(tick0, us0)));
+	CHECK_EQ(Kernel.overshoot, 0);
+}
+
+/* no reading: the window closes after PPM_WINDOW_MS anyway */
+static void testHeartRateNoReading(void) {
+	task_s tasks[1] = {{1, 0, 2, scheduleHeartRate, 0}};
+	uint32_t start;
+
+	World_reset(32768, 32767);
+	Hr.start = Kernel.tick - PPM_PERIOD_MS;
+	Hr.readMs = 0xFFFFFFFF;
+	Hr.isRead = false;
+	Hr.scans = 0;
+	Kernel_reset(tasks, 1);
+	start = Kernel.tick;
+	Kernel_run(start + PPM_WINDOW_MS - 1);
+	CHECK(adcScan.isRunning() == true);
+	Kernel_run(start + PPM_WINDOW_MS + 10);
+	CHECK(adcScan.isRunning() != true);
+	CHECK_EQ(Hr.scans, 1);
+}
+
+/* hours of random sleeps, some cut short by an EXTI */
+static int32_t runRandom(uint32_t hours) {
+	task_s tasks[1] = {{1500, 18500, 3, NULL, 0}};
+	uint32_t tick0 = Kernel.tick;
+	uint64_t us0 = World.us;
+	int32_t error, maxError = 0;
+
+	World.earlyEvery = 4;
+	Kernel_reset(tasks, 1);
+	for (uint32_t i = 0; i < hours * 60; i++) {
+		Kernel_run(Kernel.tick + 60000);
+		error = Kernel_error(tick0, us0);
+		if (abs(error) > abs(maxError)) {
+			maxError = error;
+		}
+	}
+	return maxError;
+}
+
+static void testAccuracy(void) {
+	int32_t error;
+
+	srand(42);
+	World_reset(32768, 32767);
+	Sys_setRtcPrescaler(32767);
+	error = runRandom(10);
+	printf("PRL 32767, 32768 Hz:  %u STOP sleeps over 10 h, %.1f%% in STOP, error %d ms\n",
+				 World.stops, World.stopUs * 100.0 / World.us, error);
+	CHECK(World.stops > 1000);
+	CHECK(World.stopUs * 100 >= World.us * 90);
+	CHECK(isInStep(error));
+	CHECK_EQ(Kernel.overshoot, 0);
+
+	/* calibrated for a slow crystal */
+	World_reset(32767, 32766);
+	Sys_setRtcPrescaler(32766);
+	error = runRandom(10);
+	printf("PRL 32766, 32767 Hz:  %u STOP sleeps over 10 h, error %d ms\n", World.stops, error);
+	CHECK(isInStep(error));
+	CHECK_EQ(Kernel.overshoot, 0);
+
+	/* RTC clocked from the 40 kHz LSI, nothing about 32768 holds */
+	World_reset(40000, 39999);
+	Sys_setRtcPrescaler(39999);
+	error = runRandom(2);
+	printf("PRL 39999, 40000 Hz:  %u STOP sleeps over 2 h, error %d ms\n", World.stops, error);
+	CHECK(isInStep(error));
+	CHECK_EQ(Kernel.overshoot, 0);
+	Sys_setRtcPrescaler(32767);
+}
+
+/* Sys_Delayms in an interrupt counts cycles, SysTick does not come in */
+static volatile bool isSpinning = false;
+static uint32_t delayCycles = 0;
+
+static void* cycleThread(void* arg) {
+	(void)arg;
+	while (isSpinning == true) {
+		DWT->CYCCNT += 64;
+	}
+	return NULL;
+}
+
+static void delayIsr(void) {
+	uint32_t start = DWT->CYCCNT;
+	uint32_t tick = Sys_getTick();
+
+	Sys_Delayms(3);
+	delayCycles = DWT->CYCCNT - start;
+	CHECK_EQ(Sys_getTick(), tick);
+}
+
+static void testDelayInIsr(void) {
+	pthread_t thread;
+
+	isSpinning = true;
+	pthread_create(&thread, NULL, cycleThread, NULL);
+	Host_irq(EXTI1_IRQn, delayIsr);
+	isSpinning = false;
+	pthread_join(thread, NULL);
+	CHECK(delayCycles >= 3 * (SystemCoreClock / 1000));
+}
+
+int main(void) {
+	Host_reset();
+	/* flags the model does not move: RTC ready, PLL locked and selected */
+	RTC->CRL = RTC_CRL_RTOFF | RTC_CRL_RSF;
+	RCC->CR |= RCC_CR_PLLRDY;
+	RCC->CFGR |= RCC_CFGR_SWS_PLL;
+	Host_stopHook = World_stop;
+	Sys_init();
+	Sys_stopUnlock(); // BeeWatch::initClock
+	adcScan.init();
+	adcScan.addChannel(ADC_CHANNEL_0, ADC_SAMPLETIME_28CYCLES_5, GPIOA, GPIO_PIN_0);
+
+	testScanLock();
+	testHeartRateWindow();
+	testHeartRateNoReading();
+	testAccuracy();
+	testDelayInIsr();
+	return Check_result();
+}
@@ -0,0 +1,308 @@
+/**
+  ******************************************************************************
+ * @file    test_sys_timer.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   MISC timer service in virtual time, interrupts per second and jitter
+ *
+ *	The real MISC.cpp runs against a model of the FreeRTOS kernel and its
+ *	tickless port: tasks wake on their own periods and stay busy for a few
+ *	ticks, every tick while they run is a SysTick interrupt, and when all
+ *	of them sleep the idle task calls portSUPPRESS_TICKS_AND_SLEEP, whose
+ *	sleep ends with one SysTick interrupt. STOP mode stays locked as it is
+ *	until BeeWatch releases it. Built without HostSys, MISC is the Sys.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "MISC.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+extern "C" {
+void HAL_IncTick(void);
+void Sys_suppressTicksAndSleep(uint32_t idleTicks);
+}
+
+/* BeeWatch, GYRO_POLL_MS as the ADXL345 poll was before its EXTI */
+static const uint32_t ACT_COUNT_MS = 1000;
+static const uint32_t GYRO_POLL_MS = 10;
+static const uint32_t FREE_FALL_HOLD_MS = 5000;
+
+/*---------------------------- kernel model --------------------------------*/
+
+typedef struct {
+	uint32_t period;		// ms between wakeups
+	uint32_t busy;			// ms running per wakeup
+	uint32_t next;
+} task_s;
+
+typedef struct {
+	uint32_t tick;				// xTaskGetTickCount
+	bool isPending;				// SysTick pended by the end of a tickless sleep
+	uint32_t irqs;				// SysTick interrupts
+	uint32_t sleeps;
+	uint32_t longest;			// longest tickless sleep, ms
+	task_s* tasks;
+	uint8_t taskCount;
+} kernel_s;
+
+static kernel_s Kernel;
+
+extern "C" {
+
+TickType_t xTaskGetTickCount(void) {
+	return Kernel.tick;
+}
+
+BaseType_t xTaskGetSchedulerState(void) {
+	return taskSCHEDULER_RUNNING;
+}
+
+void vTaskDelay(const TickType_t xTicksToDelay) {
+	(void)xTicksToDelay;
+}
+
+void vTaskStepTick(const TickType_t xTicksToJump) {
+	Kernel.tick += xTicksToJump;
+}
+
+eSleepModeStatus eTaskConfirmSleepModeStatus(void) {
+	return eStandardSleep;
+}
+
+/* port: sleeps the whole time, steps one tick short, the pended tick does the rest */
+void vPortSuppressTicksAndSleep(TickType_t xExpectedIdleTime) {
+	Kernel.tick += xExpectedIdleTime - 1;
+	Kernel.isPending = true;
+	Kernel.sleeps++;
+	if (xExpectedIdleTime > Kernel.longest) {
+		Kernel.longest = xExpectedIdleTime;
+	}
+}
+
+} /* extern "C" */
+
+/* SysTick_Handler */
+static void Kernel_tick(void) {
+	Kernel.irqs++;
+	Kernel.tick++;
+	Host_irq(SysTick_IRQn, HAL_IncTick);
+}
+
+/* run until end, the idle task sleeps whenever no task is due */
+static void Kernel_run(uint32_t end) {
+	uint32_t next;
+
+	while ((int32_t)(Kernel.tick - end) < 0) {
+		next = end;
+		for (uint8_t i = 0; i < Kernel.taskCount; i++) {
+			task_s &task = Kernel.tasks[i];
+			if ((int32_t)(task.next - Kernel.tick) <= 0) {
+				for (uint32_t ms = 0; ms < task.busy; ms++) {
+					Kernel_tick();
+				}
+				task.next += task.period;
+			}
+			if ((int32_t)(task.next - next) < 0) {
+				next = task.next;
+			}
+		}
+		if ((int32_t)(next - Kernel.tick) <= 0) {
+			continue;
+		}
+		Sys_suppressTicksAndSleep(next - Kernel.tick);
+		if (Kernel.isPending == true) {
+			Kernel.isPending = false;
+		}
+		Kernel_tick();
+	}
+}
+
+static void Kernel_reset(task_s* tasks, uint8_t count) {
+	Sys_subISRReset();
+	Kernel.irqs = 0;
+	Kernel.sleeps = 0;
+	Kernel.longest = 0;
+	Kernel.tasks = tasks;
+	Kernel.taskCount = count;
+	for (uint8_t i = 0; i < count; i++) {
+		tasks[i].next = Kernel.tick + tasks[i].period;
+	}
+}
+
+/*---------------------------- timers --------------------------------------*/
+
+typedef struct {
+	uint32_t calls;
+	uint32_t first;
+	uint32_t last;
+	uint32_t period;
+	uint32_t maxJitter;		// ms off first + n * period
+} probe_s;
+
+static probe_s Probe[4];
+
+static void Probe_hit(probe_s &probe) {
+	uint32_t now = Sys_getTick();
+	uint32_t expect = probe.first + probe.calls * probe.period;
+	uint32_t jitter = (now > expect) ? now - expect : expect - now;
+
+	if (probe.calls == 0) {
+		probe.first = now;
+	} else if (jitter > probe.maxJitter) {
+		probe.maxJitter = jitter;
+	}
+	probe.last = now;
+	probe.calls++;
+}
+
+static void timer0(void) { Probe_hit(Probe[0]); }
+static void timer1(void) { Probe_hit(Probe[1]); }
+static void timer2(void) { Probe_hit(Probe[2]); }
+static void timer3(void) { Probe_hit(Probe[3]); }
+
+static void timer3Stop(void) {
+	Probe_hit(Probe[3]);
+	if (Probe[3].calls == 3) {
+		Sys_timerRemove(timer3Stop);
+	}
+}
+
+static void probeReset(void) {
+	memset(Probe, 0, sizeof(Probe));
+}
+
+/* the 1 kHz table: one interrupt a ms whatever is registered */
+static void testBaseline(void) {
+	task_s tasks[1] = {{1000, 2, 0}};
+	uint32_t start;
+
+	Kernel_reset(tasks, 1);
+	start = Kernel.tick;
+	/* no tickless idle, every ms ticks */
+	while (Kernel.tick - start < 60000) {
+		Kernel_tick();
+	}
+	printf("1 kHz tick:           %4u interrupts/s\n", Kernel.irqs / 60);
+	CHECK_EQ(Kernel.irqs, 60000);
+}
+
+/* BeeWatch's timers, the UI task once a second and the network every 3s */
+static void testBeeWatch(void) {
+	task_s tasks[2] = {{1000, 3, 0}, {3000, 5, 0}};
+	uint32_t start;
+
+	Kernel_reset(tasks, 2);
+	probeReset();
+	Probe[0].period = ACT_COUNT_MS;
+	Probe[1].period = GYRO_POLL_MS;
+	CHECK(Sys_timerAssign(timer0, ACT_COUNT_MS));
+	CHECK(Sys_timerAssign(timer1, GYRO_POLL_MS));
+	start = Kernel.tick;
+	Kernel_run(start + 60000);
+
+	printf("BeeWatch timers:      %4u interrupts/s, %u sleeps, jitter %u ms\n",
+				 Kernel.irqs / 60, Kernel.sleeps, Probe[0].maxJitter + Probe[1].maxJitter);
+	CHECK_EQ(Probe[0].calls, 60);
+	CHECK_EQ(Probe[1].calls, 6000);
+	CHECK_EQ(Probe[0].maxJitter, 0);
+	CHECK_EQ(Probe[1].maxJitter, 0);
+	CHECK_EQ(Sys_getTimerOverrun(), 0);
+	/* the gyro poll sets the floor, a tenth of the fixed tick */
+	CHECK(Kernel.irqs <= 60 * (1000 / GYRO_POLL_MS + 2 + 5));
+	CHECK(Kernel.longest <= GYRO_POLL_MS);
+	/* Sys_getTick and the kernel tick never part */
+	CHECK_EQ(Sys_getTick(), Kernel.tick);
+}
+
+/* only slow timers: the sleeps reach them, no tick in between */
+static void testIdle(void) {
+	task_s tasks[1] = {{3000, 5, 0}};
+	uint32_t start;
+
+	Kernel_reset(tasks, 1);
+	probeReset();
+	Probe[0].period = ACT_COUNT_MS;
+	CHECK(Sys_timerAssign(timer0, ACT_COUNT_MS));
+	start = Kernel.tick;
+	Kernel_run(start + 600000);
+
+	printf("1 s timer, 3 s task:  %4.2f interrupts/s, longest sleep %u ms\n",
+				 Kernel.irqs / 600.0, Kernel.longest);
+	CHECK_EQ(Probe[0].calls, 600);
+	CHECK_EQ(Probe[0].maxJitter, 0);
+	/* one per timer call, task wake and tick the task runs for */
+	CHECK(Kernel.irqs <= 600 + 200 * 5 + 1);
+	CHECK_EQ(Kernel.longest, ACT_COUNT_MS);
+	CHECK_EQ(Sys_getTick(), Kernel.tick);
+}
+
+/* one shots, re-arming, removal before and at the deadline */
+static void testOnce(void) {
+	task_s tasks[1] = {{60000, 1, 0}};
+	uint32_t start;
+
+	Kernel_reset(tasks, 1);
+	probeReset();
+	start = Kernel.tick;
+	CHECK(Sys_timerOnce(timer0, FREE_FALL_HOLD_MS));
+	CHECK(Sys_timerOnce(timer1, 700));
+	CHECK(Sys_timerOnce(timer2, 300));
+	Kernel_run(start + 200);
+	CHECK(Sys_timerRemove(timer2));
+	/* re-armed: counts from now */
+	Kernel_run(start + 500);
+	CHECK(Sys_timerOnce(timer1, 700));
+	Kernel_run(start + 10000);
+
+	CHECK_EQ(Probe[0].calls, 1);
+	CHECK_EQ(Probe[0].first, start + FREE_FALL_HOLD_MS);
+	CHECK_EQ(Probe[1].calls, 1);
+	CHECK_EQ(Probe[1].first, start + 1200);
+	CHECK_EQ(Probe[2].calls, 0);
+	CHECK(Sys_timerRemove(timer0) != true);
+	/* nothing armed: only the task wakes */
+	CHECK(Kernel.irqs <= 2 + 1 + 1 + 1);
+
+	/* a periodic timer removing itself */
+	Probe[3].period = 50;
+	CHECK(Sys_timerAssign(timer3Stop, 50));
+	Kernel_run(Kernel.tick + 1000);
+	CHECK_EQ(Probe[3].calls, 3);
+	CHECK_EQ(Probe[3].maxJitter, 0);
+}
+
+/* a full table says so instead of dropping the timer */
+static void testFull(void) {
+	static void (* const timers[])(void) = {timer0, timer1, timer2, timer3, testBaseline, testBeeWatch, testIdle, testOnce};
+
+	Sys_subISRReset();
+	for (uint8_t i = 0; i < 8; i++) {
+		CHECK(Sys_timerAssign(timers[i], 1000 + i));
+	}
+	CHECK(Sys_timerAssign(testFull, 1000) != true);
+	CHECK(Sys_subISRAssign(testFull) != true);
+	/* assigned again: new period, no new slot */
+	CHECK(Sys_timerAssign(timer0, 10));
+	CHECK(Sys_timerRemove(timer0));
+	CHECK(Sys_timerAssign(testFull, 1000));
+	Sys_subISRReset();
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+
+	testBaseline();
+	testBeeWatch();
+	testIdle();
+	testOnce();
+	testFull();
+	return Check_result();
+}
@@ -0,0 +1,381 @@
+/**
+  ******************************************************************************
+ * @file    test_telemetry_frame.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   TelemetryFrame round trip and decoder fuzzing
+ *
+ *	Every record type is encoded, walked and decoded back. The fuzz part
+ *	truncates, flips and overwrites bytes of valid frames and feeds pure
+ *	noise: the decoder must stay inside the frame and the record it was
+ *	given, whatever it accepts. Frames are copied to a buffer of exactly
+ *	their length so a sanitizer build catches any read past the end.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "TelemetryFrame.h"
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+
+using namespace hv_driver;
+
+typedef TelemetryFrame TF;
+
+static uint32_t Rand_state = 12345;
+
+static uint32_t rand32(void) {
+	Rand_state = Rand_state * 1664525 + 1013904223;
+	return Rand_state;
+}
+
+static void testVarint(void) {
+	const uint32_t values[] = {0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFFF, 0x200000,
+														 0xFFFFFFF, 0x10000000, 0xFFFFFFFF};
+	const uint8_t lens[] = {1, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5};
+	uint8_t buff[5];
+	uint32_t value;
+
+	for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+		CHECK_EQ(TF::putVarint(buff, values[i]), lens[i]);
+		CHECK_EQ(TF::getVarint(buff, lens[i], value), lens[i]);
+		CHECK_EQ(value, values[i]);
+		/* one byte short is truncated */
+		CHECK_EQ(TF::getVarint(buff, lens[i] - 1, value), 0);
+	}
+	/* more than 5 bytes is not a 32 bit value */
+	memset(buff, 0x80, sizeof(buff));
+	CHECK_EQ(TF::getVarint(buff, sizeof(buff), value), 0);
+}
+
+static void testRoundTrip(void) {
+	uint8_t buff[TF::TLM_MAX_SIZE];
+	TF frame(buff, sizeof(buff));
+	TF::hrSample_s hr[4] = {{1000, 72, 90}, {1005, 75, 80}, {1015, 70, 95}, {1015, 200, 10}};
+	TF::hrSample_s hrOut[8];
+	TF::link_s link, linkOut;
+	TF::record_s record;
+	uint32_t a, b;
+	uint8_t soc, code, offset;
+	uint16_t mv;
+
+	CHECK(frame.isEmpty());
+	CHECK_EQ(frame.getLength(), 1);
+	CHECK_EQ(buff[0], TF::TLM_VERSION);
+
+	memset(&link, 0, sizeof(link));
+	link.srspTimeout = 3;
+	link.srdyWait = 123456;
+	link.txFail = 7;
+	link.latency[0] = 100;
+	link.latency[7] = 0xFFFFFFFF;
+
+	CHECK_EQ(frame.addHeartRate(hr, 4), 4);
+	CHECK(frame.addActivity(600, 840));
+	CHECK(frame.addSteps(12000));
+	CHECK(frame.addBattery(87, 3950));
+	CHECK(frame.addEvent(TF::TLM_EVENT_FALL, 1234567));
+	CHECK(frame.addLink(link));
+	CHECK(frame.isEmpty() != true);
+	CHECK(TF::isValid(buff, frame.getLength()));
+
+	offset = 1;
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK_EQ(TF::decodeHeartRate(record, hrOut, 8), 4);
+	for (uint8_t i = 0; i < 4; i++) {
+		CHECK_EQ(hrOut[i].time, hr[i].time);
+		CHECK_EQ(hrOut[i].bpm, hr[i].bpm);
+		CHECK_EQ(hrOut[i].confidence, hr[i].confidence);
+	}
+	/* fewer slots than samples */
+	CHECK_EQ(TF::decodeHeartRate(record, hrOut, 2), 2);
+	/* wrong type is refused */
+	CHECK(TF::decodeSteps(record, a) != true);
+
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(TF::decodeActivity(record, a, b));
+	CHECK_EQ(a, 600);
+	CHECK_EQ(b, 840);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(TF::decodeSteps(record, a));
+	CHECK_EQ(a, 12000);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(TF::decodeBattery(record, soc, mv));
+	CHECK_EQ(soc, 87);
+	CHECK_EQ(mv, 3950);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(TF::decodeEvent(record, code, a));
+	CHECK_EQ(code, TF::TLM_EVENT_FALL);
+	CHECK_EQ(a, 1234567);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(TF::decodeLink(record, linkOut));
+	CHECK(memcmp(&link, &linkOut, sizeof(link)) == 0);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record) != true);
+	CHECK_EQ(offset, frame.getLength());
+
+	frame.reset();
+	CHECK(frame.isEmpty());
+}
+
+static void testProfile(void) {
+	uint8_t buff[TF::TLM_MAX_SIZE];
+	TF frame(buff, sizeof(buff));
+	TF::profile_s profile, out;
+	TF::record_s record;
+	uint8_t offset = 1;
+
+	memset(&profile, 0, sizeof(profile));
+	profile.period = 60000;
+	profile.heapFree = 1024;
+	profile.heapMin = 512;
+	profile.overflow = 'Z' | ('i' << 8);
+	for (uint8_t i = 0; i < TF::TLM_PROFILE_ISR; i++) {
+		profile.isr[i] = i * 7;
+	}
+	profile.taskCount = TF::TLM_PROFILE_TASKS;
+	for (uint8_t i = 0; i < TF::TLM_PROFILE_TASKS; i++) {
+		profile.task[i].number = i + 1;
+		profile.task[i].cpu = 1000 - i * 100;
+		profile.task[i].stackFree = 20 + i;
+	}
+	CHECK(frame.addProfile(profile));
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	memset(&out, 0xA5, sizeof(out));
+	CHECK(TF::decodeProfile(record, out));
+	CHECK_EQ(out.period, profile.period);
+	CHECK_EQ(out.heapFree, profile.heapFree);
+	CHECK_EQ(out.heapMin, profile.heapMin);
+	CHECK_EQ(out.overflow, profile.overflow);
+	for (uint8_t i = 0; i < TF::TLM_PROFILE_ISR; i++) {
+		CHECK_EQ(out.isr[i], profile.isr[i]);
+	}
+	CHECK_EQ(out.taskCount, profile.taskCount);
+	for (uint8_t i = 0; i < TF::TLM_PROFILE_TASKS; i++) {
+		CHECK_EQ(out.task[i].number, profile.task[i].number);
+		CHECK_EQ(out.task[i].cpu, profile.task[i].cpu);
+		CHECK_EQ(out.task[i].stackFree, profile.task[i].stackFree);
+	}
+}
+
+/* a record that does not fit is dropped whole, the frame stays valid */
+static void testFull(void) {
+	uint8_t buff[TF::TLM_MAX_SIZE + 8];
+	TF frame(buff, TF::TLM_MAX_SIZE);
+	TF::hrSample_s hr[64], out[64];
+	TF::link_s link;
+	TF::record_s record;
+	uint8_t offset, len, count, records;
+
+	memset(buff, 0xEE, sizeof(buff));
+	for (uint8_t i = 0; i < 64; i++) {
+		hr[i].time = 5000 + i * 10;
+		hr[i].bpm = (uint8_t)(60 + (i * 37) % 60);
+		hr[i].confidence = (uint8_t)(i % 100);
+	}
+	/* heart rate series stops where the frame is full */
+	count = frame.addHeartRate(hr, 64);
+	CHECK(count > 1 && count < 64);
+	CHECK(frame.getLength() <= TF::TLM_MAX_SIZE);
+	offset = 1;
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK_EQ(TF::decodeHeartRate(record, out, 64), count);
+	CHECK_EQ(out[count - 1].bpm, hr[count - 1].bpm);
+	CHECK_EQ(out[count - 1].time, hr[count - 1].time);
+
+	/* fill with steps until one does not fit */
+	records = 1;
+	while (frame.addSteps(0xFFFFFFFF) == true) {
+		records++;
+	}
+	len = frame.getLength();
+	CHECK(len <= TF::TLM_MAX_SIZE);
+	CHECK(len + 7 > TF::TLM_MAX_SIZE);
+	memset(&link, 0, sizeof(link));
+	CHECK(frame.addLink(link) != true);
+	CHECK_EQ(frame.getLength(), len);
+	CHECK_EQ(frame.addHeartRate(hr, 1) <= 1, true);
+	/* nothing written past the buffer */
+	for (uint8_t i = TF::TLM_MAX_SIZE; i < sizeof(buff); i++) {
+		CHECK_EQ(buff[i], 0xEE);
+	}
+	len = frame.getLength();
+	offset = 1;
+	count = 0;
+	while (TF::nextRecord(buff, len, offset, record) == true) {
+		count++;
+	}
+	CHECK_EQ(offset, len);
+	CHECK(count >= records);
+}
+
+/* a record is never longer than one length byte can say */
+static void testMaxRecord(void) {
+	uint8_t buff[255];
+	TF frame(buff, sizeof(buff));
+	TF::hrSample_s hr[100], out[100];
+	TF::record_s record;
+	uint8_t offset = 1, count;
+
+	for (uint8_t i = 0; i < 100; i++) {
+		hr[i].time = 100000 + i * 300;	// two byte dt
+		hr[i].bpm = (uint8_t)((i & 1) ? 60 : 180);
+		hr[i].confidence = 50;
+	}
+	count = frame.addHeartRate(hr, 100);
+	CHECK(count < 100);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(record.len <= TF::TLM_MAX_RECORD);
+	CHECK_EQ(buff[2], record.len);
+	/* the rest goes on in a second record */
+	CHECK_EQ(frame.addHeartRate(hr + count, 100 - count), count);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record));
+	CHECK(record.len <= TF::TLM_MAX_RECORD);
+	CHECK_EQ(TF::decodeHeartRate(record, out, 100), count);
+	CHECK_EQ(out[count - 1].time, hr[2 * count - 1].time);
+	CHECK_EQ(out[count - 1].bpm, hr[2 * count - 1].bpm);
+	CHECK(TF::nextRecord(buff, frame.getLength(), offset, record) != true);
+}
+
+/* the RTC set back between two samples starts a new record at the absolute time */
+static void testTimeBack(void) {
+	uint8_t buff[TF::TLM_MAX_SIZE];
+	TF frame(buff, sizeof(buff));
+	TF::hrSample_s hr[6] = {{2000, 70, 90}, {2010, 72, 91}, {2020, 74, 92},
+													{1990, 75, 93}, {2000, 76, 94}, {1980, 77, 95}};
+	TF::hrSample_s out[6];
+	TF::record_s record;
+	uint8_t offset = 1;
+	uint8_t got = 0;
+	uint8_t records = 0;
+
+	CHECK_EQ(frame.addHeartRate(hr, 6), 6);
+	while (TF::nextRecord(buff, frame.getLength(), offset, record) == true) {
+		CHECK_EQ(record.type, TF::TLM_HEART_RATE);
+		got += TF::decodeHeartRate(record, out + got, 6 - got);
+		records++;
+	}
+	CHECK_EQ(records, 3);
+	if (CHECK_EQ(got, 6) == true) {
+		for (uint8_t i = 0; i < 6; i++) {
+			CHECK_EQ(out[i].time, hr[i].time);
+			CHECK_EQ(out[i].bpm, hr[i].bpm);
+			CHECK_EQ(out[i].confidence, hr[i].confidence);
+		}
+	}
+
+	/* the new record does not fit, the samples before it are kept */
+	frame.reset();
+	while (frame.getLength() + 5 + 4 <= TF::TLM_MAX_SIZE) {
+		frame.addSteps(0xFFFFFFF);
+	}
+	CHECK_EQ(frame.addHeartRate(hr + 2, 2), 1);
+}
+
+/* decode everything in a frame, the record must lie inside it */
+static void decodeAll(const uint8_t* buff, uint8_t len) {
+	TF::record_s record;
+	TF::hrSample_s hr[TF::TLM_MAX_RECORD];
+	TF::link_s link;
+	TF::profile_s profile;
+	uint32_t a, b;
+	uint8_t offset = 1, last, soc, code;
+	uint16_t mv;
+
+	if (TF::isValid(buff, len) != true) {
+		return;
+	}
+	last = offset;
+	while (TF::nextRecord(buff, len, offset, record) == true) {
+		if (CHECK(record.value > buff + last && record.value + record.len <= buff + len) != true) {
+			return;
+		}
+		if (CHECK(offset > last && offset <= len) != true) {
+			return;
+		}
+		last = offset;
+		CHECK(TF::decodeHeartRate(record, hr, TF::TLM_MAX_RECORD) <= record.len);
+		if (TF::decodeProfile(record, profile) == true) {
+			CHECK(profile.taskCount <= TF::TLM_PROFILE_TASKS);
+		}
+		TF::decodeActivity(record, a, b);
+		TF::decodeSteps(record, a);
+		TF::decodeBattery(record, soc, mv);
+		TF::decodeEvent(record, code, a);
+		TF::decodeLink(record, link);
+	}
+}
+
+static void testFuzz(void) {
+	uint8_t buff[TF::TLM_MAX_SIZE];
+	TF frame(buff, sizeof(buff));
+	TF::hrSample_s hr[6];
+	TF::link_s link;
+	TF::profile_s profile;
+	std::vector<uint8_t> input;
+	uint8_t len;
+
+	for (uint32_t round = 0; round < 20000; round++) {
+		/* a valid frame of random records */
+		frame.reset();
+		for (uint8_t i = 0; i < 6; i++) {
+			hr[i].time = rand32();
+			hr[i].bpm = (uint8_t)rand32();
+			hr[i].confidence = (uint8_t)rand32();
+		}
+		memset(&link, 0, sizeof(link));
+		link.bytesOut = rand32();
+		memset(&profile, 0, sizeof(profile));
+		profile.taskCount = rand32() % (TF::TLM_PROFILE_TASKS + 1);
+		for (uint8_t i = 0; i < 4; i++) {
+			switch (rand32() % 5) {
+				case 0: frame.addHeartRate(hr, 1 + rand32() % 6); break;
+				case 1: frame.addActivity(rand32(), rand32() >> (rand32() % 32)); break;
+				case 2: frame.addEvent((uint8_t)rand32(), rand32()); break;
+				case 3: frame.addLink(link); break;
+				default: frame.addProfile(profile); break;
+			}
+		}
+		len = frame.getLength();
+
+		/* truncated, corrupted, or noise */
+		switch (round % 4) {
+			case 0:
+				len = rand32() % (len + 1);
+				break;
+			case 1:
+				for (uint8_t i = 0; i < 1 + rand32() % 4; i++) {
+					buff[1 + rand32() % (len - 1 + (len == 1))] ^= (uint8_t)(1 << (rand32() % 8));
+				}
+				break;
+			case 2:
+				buff[1 + rand32() % (len - 1 + (len == 1))] = (uint8_t)rand32();
+				break;
+			default:
+				len = rand32() % (TF::TLM_MAX_SIZE + 1);
+				for (uint8_t i = 0; i < len; i++) {
+					buff[i] = (uint8_t)rand32();
+				}
+				if (len > 0 && (round & 4) != 0) {
+					buff[0] = TF::TLM_VERSION;
+				}
+				break;
+		}
+		input.assign(buff, buff + len);
+		decodeAll(input.empty() ? 0 : &input[0], len);
+	}
+	CHECK(TF::isValid(0, 0) != true);
+	buff[0] = TF::TLM_VERSION + 1;
+	CHECK(TF::isValid(buff, 1) != true);
+}
+
+int main(void) {
+	testVarint();
+	testRoundTrip();
+	testProfile();
+	testFull();
+	testMaxRecord();
+	testTimeBack();
+	testFuzz();
+	return Check_result();
+}
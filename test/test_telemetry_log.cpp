@@ -0,0 +1,480 @@
+/**
+  ******************************************************************************
+ * @file    test_telemetry_log.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   TelemetryLog order, eviction, reboot and power loss on emulated flash
+ *
+ *	The real Flash driver runs on the HAL flash emulation of HostHal.h at
+ *	BeeWatch's log and alert pages. The outage replays the Network task:
+ *	two reports per period go to the log while the coordinator is gone,
+ *	then LOG_DRAIN_BATCH records per period are handed back once it
+ *	returns. The alert outage does the same through a real TxScheduler
+ *	with hold() and drain(), as BeeWatch::dispatchTelemetry does.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostHal.h"
+#include "HostRtos.h"
+#include "TelemetryLog.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+typedef TelemetryLog TL;
+
+/* BeeWatch */
+static const uint32_t LOG_FLASH_BASE = 0x0800F000;
+static const uint8_t LOG_FLASH_PAGES = 3;
+static const uint32_t LOG_ALERT_BASE = 0x0800FC00;
+static const uint8_t LOG_ALERT_PAGES = 1;
+static const uint8_t LOG_DRAIN_BATCH = 4;
+static const uint32_t ZB_REPORT_PERIOD = 3000;
+static const uint16_t STATUS = 0xABCD;
+static const uint16_t FALL_ALERT = 0xABCE;
+
+static const uint8_t RECORD_LEN = 20;
+static const uint16_t ALERT_PAGE_RECORDS = (Flash::FLASH_PAGE - TelemetryLog::LOG_PAGE_HEADER)
+																					 / (TelemetryLog::LOG_RECORD_HEADER + RECORD_LEN);
+
+static Flash logFlash(LOG_FLASH_BASE, LOG_FLASH_PAGES);
+static Flash alertFlash(LOG_ALERT_BASE, LOG_ALERT_PAGES);
+
+/* the network is down, the scheduler never dispatches */
+namespace hv_driver {
+
+TxWindow::TxWindow(Z_stack* zigbee) {
+	_zigbee = zigbee;
+}
+
+bool TxWindow::waitFree(uint32_t timeout) {
+	(void)timeout;
+	return false;
+}
+
+bool TxWindow::submit(Z_stack::TxPacket_s &txPacket, bool ack, uint8_t radius,
+											future_s* future, uint32_t timeout) {
+	(void)txPacket;
+	(void)ack;
+	(void)radius;
+	(void)future;
+	(void)timeout;
+	return false;
+}
+
+} /* hv_driver */
+
+static TL::record_s record(TxScheduler::PRIORITY prio, uint32_t seq) {
+	TL::record_s rec;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.prio = prio;
+	rec.len = RECORD_LEN;
+	rec.dstAddr = 0x0000;
+	rec.cmdID = (prio == TxScheduler::PRIO_ALERT) ? FALL_ALERT : STATUS;
+	memcpy(rec.data, &seq, sizeof(seq));
+	memset(rec.data + sizeof(seq), (uint8_t)seq, RECORD_LEN - sizeof(seq));
+	return rec;
+}
+
+static uint32_t seqOf(const TL::record_s &rec) {
+	uint32_t seq;
+
+	memcpy(&seq, rec.data, sizeof(seq));
+	return seq;
+}
+
+static bool isIntact(const TL::record_s &rec) {
+	uint32_t seq = seqOf(rec);
+
+	if (rec.len != RECORD_LEN || rec.cmdID != ((rec.prio == TxScheduler::PRIO_ALERT) ? FALL_ALERT : STATUS)) {
+		return false;
+	}
+	for (uint8_t i = sizeof(seq); i < RECORD_LEN; i++) {
+		if (rec.data[i] != (uint8_t)seq) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void eraseAll(void) {
+	memset((void*)LOG_FLASH_BASE, 0xFF, LOG_FLASH_PAGES * Flash::FLASH_PAGE);
+	memset((void*)LOG_ALERT_BASE, 0xFF, LOG_ALERT_PAGES * Flash::FLASH_PAGE);
+	Host_flash.erases = 0;
+	Host_flash.programs = 0;
+	Host_flash.failAfter = -1;
+}
+
+/* RAM only, in order */
+static void testRam(void) {
+	TL log(&logFlash, &alertFlash);
+	TL::record_s rec;
+
+	eraseAll();
+	CHECK(log.init());
+	for (uint32_t i = 1; i <= 3; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_LOW, i)));
+	}
+	CHECK_EQ(log.getCount(), 3);
+	for (uint32_t i = 1; i <= 3; i++) {
+		CHECK(log.take(rec));
+		CHECK_EQ(seqOf(rec), i);
+		CHECK(isIntact(rec));
+	}
+	CHECK(log.take(rec) != true);
+	CHECK_EQ(log.getMetrics().spilled, 0);
+	/* only the first page of each area set up */
+	CHECK_EQ(Host_flash.erases, 2);
+}
+
+/* alerts first, then everything else oldest first across flash and RAM */
+static void testSpill(void) {
+	TL log(&logFlash, &alertFlash);
+	TL::record_s rec;
+	uint32_t expect = 1;
+
+	eraseAll();
+	CHECK(log.init());
+	for (uint32_t i = 1; i <= 20; i++) {
+		CHECK(log.store(record((i == 7 || i == 15) ? TxScheduler::PRIO_ALERT : TxScheduler::PRIO_LOW, i)));
+	}
+	CHECK_EQ(log.getCount(), 20);
+	CHECK_EQ(log.getMetrics().spilled, 20 - 2 - TL::LOG_RAM_SLOTS);
+	CHECK_EQ(log.getAlertCount(), 2);
+
+	CHECK(log.take(rec));
+	CHECK_EQ(seqOf(rec), 7);
+	CHECK(log.take(rec));
+	CHECK_EQ(seqOf(rec), 15);
+	while (log.take(rec) == true) {
+		if (expect == 7 || expect == 15) {
+			expect++;
+		}
+		CHECK_EQ(seqOf(rec), expect);
+		CHECK(isIntact(rec));
+		expect++;
+	}
+	CHECK_EQ(expect, 21);
+	CHECK_EQ(log.getCount(), 0);
+}
+
+/* alert pages full: alerts wait in RAM, the lows in it spill, then RAM
+	 full of alerts refuses one more while lows still go to flash */
+static void testAlertsFull(void) {
+	TL log(&logFlash, &alertFlash);
+	TL::record_s rec;
+
+	eraseAll();
+	CHECK(log.init());
+	for (uint32_t i = 0; i < ALERT_PAGE_RECORDS; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_ALERT, 100 + i)));
+	}
+	CHECK(log.store(record(TxScheduler::PRIO_LOW, 300)));
+	for (uint32_t i = 0; i < TL::LOG_RAM_SLOTS; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_ALERT, 200 + i)));
+	}
+	CHECK_EQ(log.getAlertCount(), ALERT_PAGE_RECORDS);
+	CHECK(log.store(record(TxScheduler::PRIO_LOW, 301)));
+	CHECK(log.store(record(TxScheduler::PRIO_ALERT, 204)) != true);
+	CHECK_EQ(log.getMetrics().rejected, 1);
+	for (uint32_t i = 0; i < ALERT_PAGE_RECORDS; i++) {
+		CHECK(log.take(rec));
+		CHECK_EQ(seqOf(rec), 100 + i);
+	}
+	for (uint32_t i = 0; i < TL::LOG_RAM_SLOTS; i++) {
+		CHECK(log.take(rec));
+		CHECK_EQ(seqOf(rec), 200 + i);
+	}
+	CHECK(log.take(rec));
+	CHECK_EQ(seqOf(rec), 300);
+	CHECK(log.take(rec));
+	CHECK_EQ(seqOf(rec), 301);
+	CHECK(log.take(rec) != true);
+
+	/* drained, the alert page is taken again */
+	CHECK(log.store(record(TxScheduler::PRIO_ALERT, 400)));
+	CHECK_EQ(log.getAlertCount(), 1);
+}
+
+/* flash records outlive a reset, the RAM ones and the taken ones do not come back */
+static void testReboot(void) {
+	TL::record_s rec;
+	uint32_t taken = 0;
+
+	eraseAll();
+	{
+		TL log(&logFlash, &alertFlash);
+		CHECK(log.init());
+		for (uint32_t i = 1; i <= 100; i++) {
+			log.store(record(TxScheduler::PRIO_LOW, i));
+		}
+		for (uint32_t i = 1; i <= 10; i++) {
+			log.take(rec);
+		}
+	}
+	TL log(&logFlash, &alertFlash);
+	CHECK(log.init());
+	CHECK_EQ(log.getCount(), 100 - TL::LOG_RAM_SLOTS - 10);
+	while (log.take(rec) == true) {
+		taken++;
+		CHECK_EQ(seqOf(rec), 10 + taken);
+	}
+	CHECK_EQ(taken, 100 - TL::LOG_RAM_SLOTS - 10);
+
+	/* and keeps working after */
+	for (uint32_t i = 300; i < 310; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_LOW, i)));
+	}
+	CHECK(log.take(rec));
+	CHECK_EQ(seqOf(rec), 300);
+}
+
+/* power lost while a record is being written: it never shows up, the
+	 ones before it do, and the log writes past it after the reset */
+static void testPowerLoss(void) {
+	TL::record_s rec;
+	uint32_t expect = 1;
+
+	eraseAll();
+	{
+		TL log(&logFlash, &alertFlash);
+		CHECK(log.init());
+		for (uint32_t i = 1; i <= 10; i++) {
+			log.store(record(TxScheduler::PRIO_LOW, i));
+		}
+		/* the next spill gets dstAddr and cmdID out, not the rest */
+		Host_flash.failAfter = 2;
+		log.store(record(TxScheduler::PRIO_LOW, 11));
+		Host_flash.failAfter = -1;
+	}
+	TL log(&logFlash, &alertFlash);
+	CHECK(log.init());
+	CHECK_EQ(log.getCount(), 10 - TL::LOG_RAM_SLOTS);
+	for (uint32_t i = 20; i < 30; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_LOW, i)));
+	}
+	while (log.take(rec) == true) {
+		CHECK(isIntact(rec));
+		CHECK_EQ(seqOf(rec), expect);
+		expect = (expect == 10 - TL::LOG_RAM_SLOTS) ? 20 : expect + 1;
+	}
+	CHECK_EQ(expect, 30);
+}
+
+/* 30 min without coordinator, two reports per period and two falls */
+static void testOutage(void) {
+	TL log(&logFlash, &alertFlash);
+	TL::record_s rec;
+	uint32_t stored = 0;
+	uint32_t last = 0;
+	uint32_t delivered = 0;
+	uint32_t alerts = 0;
+	uint32_t periods = 0;
+	uint32_t perPeriod;
+	bool isOrdered = true;
+	bool isNewestKept = false;
+	uint32_t seq = 1;
+
+	eraseAll();
+	CHECK(log.init());
+	for (uint32_t now = 0; now < 30 * 60000; now += ZB_REPORT_PERIOD) {
+		log.store(record(TxScheduler::PRIO_LOW, seq++));
+		log.store(record(TxScheduler::PRIO_LOW, seq++));
+		stored += 2;
+		if (now == 5 * 60000 || now == 25 * 60000) {
+			CHECK(log.store(record(TxScheduler::PRIO_ALERT, seq++)));
+			stored++;
+		}
+	}
+
+	/* link back: drainTelemetry */
+	while (log.getCount() != 0) {
+		periods++;
+		for (perPeriod = 0; perPeriod < LOG_DRAIN_BATCH && log.take(rec) == true; perPeriod++) {
+			delivered++;
+			if (rec.prio == TxScheduler::PRIO_ALERT) {
+				CHECK_EQ(delivered, ++alerts);
+				continue;
+			}
+			isOrdered = isOrdered && isIntact(rec) && seqOf(rec) > last;
+			last = seqOf(rec);
+			isNewestKept = isNewestKept || seqOf(rec) == seq - 1;
+		}
+	}
+	printf("outage: %u stored, %u delivered over %u periods, %u evicted, %u erases, %u half words\n",
+				 stored, delivered, periods, log.getMetrics().evicted, Host_flash.erases, Host_flash.programs);
+	CHECK_EQ(alerts, 2);
+	CHECK(isOrdered);
+	CHECK(isNewestKept);
+	CHECK_EQ(delivered + log.getMetrics().evicted, stored);
+	/* the oldest lows went, at least two pages worth stayed */
+	CHECK(delivered >= 2 * ((Flash::FLASH_PAGE - TL::LOG_PAGE_HEADER) / (TL::LOG_RECORD_HEADER + RECORD_LEN)));
+	CHECK_EQ(periods, (delivered + LOG_DRAIN_BATCH - 1) / LOG_DRAIN_BATCH);
+	/* one erase per page written, the alert page once */
+	CHECK(Host_flash.erases <= 2 + stored / ((Flash::FLASH_PAGE - TL::LOG_PAGE_HEADER) / (TL::LOG_RECORD_HEADER + RECORD_LEN)));
+}
+
+/* the coordinator gone for a while with a fall every period: more alerts
+	 than RAM slots go through hold() and all of them come back, over a
+	 reset as well, ahead of the reports and before the log evicts any */
+static void testAlertOutage(void) {
+	TxWindow window(NULL);
+	TxScheduler scheduler(&window);
+	TL::record_s rec;
+	TxScheduler::PRIORITY prio;
+	uint8_t data[TL::LOG_PAYLOAD];
+	uint16_t dstAddr, cmdID;
+	uint8_t len;
+	uint32_t alerts = 0;
+	uint32_t delivered = 0;
+	uint32_t falls = 3 * TL::LOG_RAM_SLOTS;
+
+	eraseAll();
+	{
+		TL log(&logFlash, &alertFlash);
+		CHECK(log.init());
+		for (uint32_t i = 0; i < falls; i++) {
+			TL::record_s alert = record(TxScheduler::PRIO_ALERT, 100 + i);
+			TL::record_s low = record(TxScheduler::PRIO_LOW, 1000 + i);
+
+			CHECK(scheduler.post(alert.prio, alert.dstAddr, alert.cmdID, alert.data, alert.len));
+			CHECK(scheduler.post(low.prio, low.dstAddr, low.cmdID, low.data, low.len));
+			CHECK(log.hold(scheduler));
+			CHECK_EQ(scheduler.getDepth(), 0);
+		}
+		CHECK_EQ(log.getAlertCount(), falls);
+		CHECK_EQ(log.getMetrics().rejected, 0);
+	}
+
+	/* reset during the outage, the lows in RAM are gone */
+	TL log(&logFlash, &alertFlash);
+	CHECK(log.init());
+	CHECK_EQ(log.getAlertCount(), falls);
+	while (log.getCount() != 0) {
+		CHECK(log.drain(scheduler, LOG_DRAIN_BATCH) != 0);
+		while (scheduler.take(prio, dstAddr, cmdID, data, len) == true) {
+			memcpy(rec.data, data, len);
+			rec.len = len;
+			rec.prio = prio;
+			rec.cmdID = cmdID;
+			CHECK(isIntact(rec));
+			if (prio == TxScheduler::PRIO_ALERT) {
+				CHECK_EQ(seqOf(rec), 100 + alerts);
+				CHECK_EQ(delivered, alerts);
+				alerts++;
+			}
+			delivered++;
+		}
+	}
+	printf("alert outage: %u alerts, %u delivered, %u evicted\n", alerts, delivered, log.getMetrics().evicted);
+	CHECK_EQ(alerts, falls);
+	CHECK_EQ(delivered, 2 * falls - TL::LOG_RAM_SLOTS);
+	CHECK_EQ(log.getMetrics().evicted, 0);
+
+	/* alert pages and RAM full: the next alert stays queued. The page is
+		 erased only once every alert in it was taken, the drained ones above
+		 still take room */
+	for (uint32_t i = 0; i < ALERT_PAGE_RECORDS - falls + TL::LOG_RAM_SLOTS; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_ALERT, i)));
+	}
+	rec = record(TxScheduler::PRIO_ALERT, 500);
+	CHECK(scheduler.post(rec.prio, rec.dstAddr, rec.cmdID, rec.data, rec.len));
+	CHECK(log.hold(scheduler) != true);
+	CHECK_EQ(scheduler.getDepth(), 1);
+	CHECK(scheduler.take(prio, dstAddr, cmdID, data, len));
+	CHECK_EQ(prio, TxScheduler::PRIO_ALERT);
+	CHECK_EQ(cmdID, FALL_ALERT);
+	memcpy(rec.data, data, len);
+	CHECK_EQ(seqOf(rec), 500);
+}
+
+static bool Scan_isRunning;
+
+static bool isEraseAllowed(void) {
+	return (Scan_isRunning != true);
+}
+
+/* no page erase while the ADC scan runs: init leaves the pages for later,
+	 records that need one are refused and stay queued, with the scan off
+	 they go in and nothing is lost */
+static void testEraseDeferred(void) {
+	TxWindow window(NULL);
+	TxScheduler scheduler(&window);
+	TL log(&logFlash, &alertFlash);
+	TL::record_s rec;
+	uint32_t seq = 1;
+	uint32_t expect = 1;
+
+	eraseAll();
+	log.setEraseCallBack(isEraseAllowed);
+	Scan_isRunning = true;
+	CHECK(log.init());
+	CHECK_EQ(Host_flash.erases, 0);
+
+	/* RAM takes the first ones and the alert, then a spill needs a page */
+	for (uint32_t i = 0; i < TL::LOG_RAM_SLOTS - 1; i++) {
+		CHECK(log.store(record(TxScheduler::PRIO_LOW, seq++)));
+	}
+	rec = record(TxScheduler::PRIO_ALERT, seq++);
+	CHECK(scheduler.post(rec.prio, rec.dstAddr, rec.cmdID, rec.data, rec.len));
+	CHECK(log.hold(scheduler));
+	CHECK_EQ(scheduler.getDepth(), 0);
+	CHECK_EQ(log.getAlertCount(), 0);
+	rec = record(TxScheduler::PRIO_LOW, seq++);
+	CHECK(log.store(rec) != true);
+	CHECK(scheduler.post(rec.prio, rec.dstAddr, rec.cmdID, rec.data, rec.len));
+	CHECK(log.hold(scheduler) != true);
+	CHECK_EQ(scheduler.getDepth(), 1);
+	CHECK_EQ(Host_flash.erases, 0);
+	CHECK_EQ(log.getMetrics().evicted, 0);
+	CHECK(log.getMetrics().deferred >= 2);
+
+	/* scan off: the pages are set up and the queued record goes in */
+	Scan_isRunning = false;
+	CHECK(log.hold(scheduler));
+	CHECK_EQ(scheduler.getDepth(), 0);
+	CHECK(Host_flash.erases >= 1);
+
+	/* the scan back on in the middle of a long outage */
+	Scan_isRunning = true;
+	while (log.store(record(TxScheduler::PRIO_LOW, seq)) == true) {
+		seq++;
+	}
+	CHECK_EQ(Host_flash.erases, 1);
+	Scan_isRunning = false;
+	CHECK(log.store(record(TxScheduler::PRIO_LOW, seq++)));
+	CHECK_EQ(Host_flash.erases, 2);
+
+	/* every record once, the alert first, the rest in order */
+	CHECK(log.take(rec));
+	CHECK_EQ(rec.prio, TxScheduler::PRIO_ALERT);
+	CHECK_EQ(seqOf(rec), TL::LOG_RAM_SLOTS);
+	while (log.take(rec) == true) {
+		if (expect == TL::LOG_RAM_SLOTS) {
+			expect++;
+		}
+		CHECK_EQ(seqOf(rec), expect);
+		expect++;
+	}
+	CHECK_EQ(expect, seq);
+	CHECK_EQ(log.getMetrics().evicted, 0);
+}
+
+int main(void) {
+	Host_reset();
+	Host_rtosInit();
+
+	testRam();
+	testSpill();
+	testAlertsFull();
+	testReboot();
+	testPowerLoss();
+	testOutage();
+	testAlertOutage();
+	testEraseDeferred();
+	return Check_result();
+}
@@ -0,0 +1,201 @@
+/**
+  ******************************************************************************
+ * @file    test_time_sync.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   TimeSync against drifting crystals, convergence and request count
+ *
+ *	A watch clock runs off a crystal of a given drift, slowed or sped up
+ *	by the calibration TimeSync asks for, as the RTC would apply it. The
+ *	coordinator answers requests after a random round trip, some replies
+ *	are lost and some are slow. Over 30 days the drift estimate has to
+ *	reach the crystal and the clock stay within a second of the reference.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "TimeSync.h"
+#include <math.h>
+#include <stdio.h>
+
+using namespace hv_driver;
+
+static const double REFERENCE_OFFSET = 1e12;		// us, coordinator epoch ahead of the watch start
+static const double START_OFFSET = 5e12;				// us, the watch is 58 days off
+static const double RUN_DAYS = 30;
+static const double SETTLE_DAYS = 7;
+static const double STEP_S = 10;								// s between looks at the clock
+static const double FAST_PPM = 1e6 / 32767.0;		// prescaler one count short, ppm
+static const double CAL_PPM = 1e6 / 1048576.0;	// one CAL step, ppm slower
+
+typedef struct {
+	double drift;			// crystal, ppm, positive fast
+	double estimate;	// ppm at the end
+	double maxError;	// ms off the reference after SETTLE_DAYS
+	uint32_t requests;
+	uint32_t interval;
+} run_s;
+
+static uint32_t Seed;
+
+static uint32_t nextRandom(uint32_t range) {
+	Seed = Seed * 1103515245 + 12345;
+	return (Seed >> 8) % range;
+}
+
+static TimeSync::stamp_s stampOf(double us) {
+	TimeSync::stamp_s stamp;
+	uint64_t ms = (uint64_t)(us / 1000);
+
+	stamp.seconds = (uint32_t)(ms / 1000);
+	stamp.ms = (uint16_t)(ms % 1000);
+	return stamp;
+}
+
+static void simulate(run_s &run, uint32_t seed) {
+	TimeSync sync;
+	double now = 0;						// true us
+	double local = START_OFFSET;	// watch us
+	double rate;
+	uint8_t cal = 0;
+	bool isFast = false;
+
+	Seed = seed;
+	run.maxError = 0;
+	run.requests = 0;
+	while (now < RUN_DAYS * 86400e6) {
+		double error;
+
+		rate = (1 + run.drift * 1e-6) * (1 - (cal * CAL_PPM - ((isFast == true) ? FAST_PPM : 0)) * 1e-6);
+		now += STEP_S * 1e6;
+		local += STEP_S * 1e6 * rate;
+		if (sync.isDue(stampOf(local).seconds) == true) {
+			TimeSync::stamp_s request = stampOf(local);
+			double rtt;
+			double uplink;
+			int32_t step;
+
+			run.requests++;
+			sync.requested(request);
+			if (nextRandom(10) != 0) {		// one in ten lost
+				rtt = (nextRandom(10) == 0) ? 1500e3 : (50 + nextRandom(350)) * 1e3;
+				uplink = rtt * (0.2 + 0.6 * nextRandom(1000) / 1000.0);
+				local += rtt * rate;
+				sync.update(request, stampOf(now + uplink + REFERENCE_OFFSET), stampOf(local), step);
+				now += rtt;
+				local += step * 1e6;
+				sync.getCalibration(cal, isFast);
+			}
+		}
+		error = fabs(local - (now + REFERENCE_OFFSET)) / 1000;
+		if (now > SETTLE_DAYS * 86400e6 && error > run.maxError) {
+			run.maxError = error;
+		}
+	}
+	run.estimate = sync.getDrift() / 1000.0;
+	run.interval = sync.getInterval();
+}
+
+/* crystals in and out of the calibration range, three seeds each */
+static void testConvergence(void) {
+	static const double drifts[] = {0, 5, -3.3, -12, 20, 45, -29, 100, -40};
+	uint32_t worstRequests = 0;
+	uint32_t bad = 0;
+
+	for (uint8_t i = 0; i < sizeof(drifts) / sizeof(drifts[0]); i++) {
+		double expect = (drifts[i] < -TimeSync::TS_FAST_PPB / 1000.0) ? -TimeSync::TS_FAST_PPB / 1000.0 : drifts[i];
+
+		for (uint32_t seed = 1; seed <= 3; seed++) {
+			run_s run;
+
+			run.drift = drifts[i];
+			simulate(run, seed);
+			if (seed == 1) {
+				printf("crystal %+7.2f ppm: estimate %+7.2f, interval %5u s, %2u requests, %4.0f ms off\n",
+							 run.drift, run.estimate, run.interval, run.requests, run.maxError);
+			}
+			/* past the fast end the clock keeps drifting, only the estimate is checked */
+			if (fabs(run.estimate - expect) >= 1.5 || (drifts[i] == expect && run.maxError >= 1000)) {
+				bad++;
+			}
+			if (drifts[i] == expect && run.interval != TimeSync::TS_MAX_INTERVAL_S) {
+				bad++;
+			}
+			if (drifts[i] == expect && run.requests > worstRequests) {
+				worstRequests = run.requests;
+			}
+		}
+	}
+	printf("calibrated out: at most %u requests in %.0f days, %.0f hourly\n", worstRequests, RUN_DAYS, RUN_DAYS * 24);
+	CHECK_EQ(bad, 0);
+	CHECK(worstRequests < RUN_DAYS * 24 / 10);
+}
+
+/* the calibration is the nearest the RTC can do */
+static void testCalibration(void) {
+	static const int32_t drifts[] = {0, 400, 1000, 20000, 121117, 150000, -1, -10000, -30518, -40000};
+	uint32_t bad = 0;
+
+	for (uint8_t i = 0; i < sizeof(drifts) / sizeof(drifts[0]); i++) {
+		TimeSync sync;
+		uint8_t cal;
+		bool isFast;
+		double left;
+
+		sync.restore(drifts[i]);
+		sync.getCalibration(cal, isFast);
+		left = sync.getDrift() / 1000.0 - (cal * CAL_PPM - ((isFast == true) ? FAST_PPM : 0));
+		if (cal > TimeSync::TS_CAL_MAX || fabs(left) > CAL_PPM / 2 + 0.001 || isFast != (sync.getDrift() < 0)) {
+			bad++;
+		}
+	}
+	CHECK_EQ(bad, 0);
+	/* restore keeps to what the RTC can correct */
+	{
+		TimeSync sync;
+		sync.restore(500000);
+		CHECK_EQ(sync.getDrift(), TimeSync::TS_SLOW_MAX_PPB);
+		sync.restore(-500000);
+		CHECK_EQ(sync.getDrift(), -TimeSync::TS_FAST_PPB);
+	}
+}
+
+/* replies that do not answer the last request change nothing */
+static void testReplies(void) {
+	TimeSync sync;
+	TimeSync::stamp_s request = {1000, 200};
+	TimeSync::stamp_s other = {1000, 201};
+	TimeSync::stamp_s reference = {1010, 0};
+	TimeSync::stamp_s reply = {1000, 400};
+	TimeSync::stamp_s early = {1000, 100};
+	int32_t step = 1;
+
+	CHECK(sync.isDue(0));
+	CHECK(sync.update(request, reference, reply, step) != true);
+	CHECK_EQ(step, 0);
+	sync.requested(request);
+	CHECK(sync.isDue(1000 + TimeSync::TS_RETRY_S - 1) != true);
+	CHECK(sync.isDue(1000 + TimeSync::TS_RETRY_S));
+	CHECK(sync.update(other, reference, reply, step) != true);
+	CHECK(sync.update(request, reference, early, step) != true);
+	CHECK(sync.update(request, reference, reply, step));
+	/* t2 - (t1 + t4) / 2 = 9.7 s, stepped by 10 */
+	CHECK_EQ(sync.getOffset(), 9700);
+	CHECK_EQ(step, 10);
+	CHECK(sync.isSynced());
+	CHECK(sync.isDue(1000 + 10 + TimeSync::TS_MIN_INTERVAL_S - 1) != true);
+	CHECK(sync.isDue(1000 + 10 + TimeSync::TS_MIN_INTERVAL_S));
+	/* answered once */
+	CHECK(sync.update(request, reference, reply, step) != true);
+	/* set by hand: a new baseline at once */
+	sync.restart();
+	CHECK(sync.isSynced() != true);
+	CHECK(sync.isDue(1100));
+}
+
+int main(void) {
+	testReplies();
+	testCalibration();
+	testConvergence();
+	return Check_result();
+}
@@ -0,0 +1,351 @@
+/**
+  ******************************************************************************
+ * @file    test_tx_scheduler.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   TxScheduler ordering, coalescing and starvation
+ *
+ *	The TxWindow stand-in has as many free slots as the test opens, each
+ *	submit takes one and gives it back Window.serviceMs later when that is
+ *	set, so the dispatcher task picks a packet whenever the link has room.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "TxScheduler.h"
+#include "MISC.h"
+#include <string.h>
+#include <vector>
+
+using namespace hv_driver;
+
+typedef struct {
+	uint16_t cmdID;
+	uint8_t tag;				// first payload byte
+	uint8_t len;
+	uint32_t tick;
+} sent_s;
+
+typedef struct {
+	osSemaphoreId room;
+	uint32_t serviceMs;			// 0 keeps the slot taken
+	bool isRefused;					// submit fails, as with no ZNPBuffer left
+	std::vector<sent_s> sent;
+} window_s;
+
+static window_s Window;
+
+osSemaphoreDef(ROOM);
+
+static void Window_free(void) {
+	osSemaphoreRelease(Window.room);
+}
+
+static void Window_open(uint32_t slots) {
+	for (uint32_t i = 0; i < slots; i++) {
+		osSemaphoreRelease(Window.room);
+	}
+}
+
+namespace hv_driver {
+
+TxWindow::TxWindow(Z_stack* zigbee) {
+	_zigbee = zigbee;
+}
+
+bool TxWindow::waitFree(uint32_t timeout) {
+	if (osSemaphoreWait(Window.room, timeout) != osOK) {
+		return false;
+	}
+	osSemaphoreRelease(Window.room);
+	return true;
+}
+
+bool TxWindow::submit(Z_stack::TxPacket_s &txPacket, bool ack, uint8_t radius,
+											future_s* future, uint32_t timeout) {
+	sent_s sent;
+
+	(void)ack;
+	(void)radius;
+	(void)future;
+	if (Window.isRefused == true) {
+		return false;
+	}
+	if (osSemaphoreWait(Window.room, timeout) != osOK) {
+		return false;
+	}
+	sent.cmdID = txPacket.cmdID;
+	sent.tag = (txPacket.len != 0) ? txPacket.txPtr[0] : 0;
+	sent.len = txPacket.len;
+	sent.tick = Sys_getTick();
+	Window.sent.push_back(sent);
+	if (Window.serviceMs != 0) {
+		Host_at(Sys_getTick() + Window.serviceMs, DMA1_Channel2_IRQn, Window_free);
+	}
+	return true;
+}
+
+} /* hv_driver */
+
+static TxWindow window(NULL);
+static TxScheduler scheduler(&window);
+
+static void dispatchTask(void const* arg) {
+	(void)arg;
+	while (1) {
+		scheduler.dispatch(1000);
+	}
+}
+
+osThreadDef(DISPATCH, dispatchTask, osPriorityHigh, 0, 256);
+
+enum {
+	CMD_TELEMETRY = 0x0010, CMD_DIAG = 0x0011, CMD_ALERT = 0x0012, CMD_PROFILE = 0x0013,
+	CMD_OTHER = 0x0020
+};
+
+static bool post(TxScheduler::PRIORITY prio, uint16_t cmdID, uint8_t tag, uint8_t flags = TxScheduler::POST_NONE) {
+	uint8_t data[6] = {tag, 0x11, 0x22, 0x33, 0x44, 0x55};
+
+	return scheduler.post(prio, 0x0000, cmdID, data, sizeof(data), flags);
+}
+
+/* let the dispatcher send whatever the open slots allow */
+static void settle(void) {
+	osDelay(5);
+}
+
+static void reset(uint32_t serviceMs) {
+	osSemaphoreWait(Window.room, 0);
+	while (osSemaphoreWait(Window.room, 0) == osOK) {
+	}
+	Window.serviceMs = serviceMs;
+	Window.isRefused = false;
+	Window.sent.clear();
+}
+
+/* alerts first, then normal, then low, oldest first within a class */
+static void testOrder(void) {
+	static const uint8_t expect[5] = {3, 2, 4, 1, 5};
+
+	reset(0);
+	post(TxScheduler::PRIO_LOW, CMD_DIAG, 1);
+	post(TxScheduler::PRIO_NORMAL, CMD_TELEMETRY, 2);
+	post(TxScheduler::PRIO_ALERT, CMD_ALERT, 3);
+	post(TxScheduler::PRIO_NORMAL, CMD_OTHER, 4);
+	post(TxScheduler::PRIO_LOW, CMD_PROFILE, 5);
+	CHECK_EQ(scheduler.getDepth(), 5);
+	settle();
+	CHECK_EQ(Window.sent.size(), 0);
+
+	for (uint8_t i = 0; i < 5; i++) {
+		Window_open(1);
+		settle();
+		if (CHECK_EQ(Window.sent.size(), i + 1u) == true) {
+			CHECK_EQ(Window.sent[i].tag, expect[i]);
+		}
+	}
+	CHECK_EQ(scheduler.getDepth(), 0);
+}
+
+/* the choice is made once there is room: an alert posted while waiting overtakes */
+static void testLateAlert(void) {
+	reset(0);
+	post(TxScheduler::PRIO_LOW, CMD_DIAG, 1);
+	settle();
+	post(TxScheduler::PRIO_ALERT, CMD_ALERT, 2);
+	Window_open(2);
+	settle();
+	CHECK_EQ(Window.sent.size(), 2);
+	CHECK_EQ(Window.sent[0].tag, 2);
+	CHECK_EQ(Window.sent[1].tag, 1);
+}
+
+/* coalesced packets keep their place and carry the newest payload */
+static void testCoalesce(void) {
+	TxScheduler::metrics_s before, after;
+
+	reset(0);
+	scheduler.getMetrics(before);
+	post(TxScheduler::PRIO_LOW, CMD_PROFILE, 10, TxScheduler::POST_COALESCE);
+	post(TxScheduler::PRIO_LOW, CMD_DIAG, 20);
+	for (uint8_t i = 11; i <= 14; i++) {
+		post(TxScheduler::PRIO_LOW, CMD_PROFILE, i, TxScheduler::POST_COALESCE);
+	}
+	CHECK_EQ(scheduler.getDepth(), 2);
+	Window_open(2);
+	settle();
+	scheduler.getMetrics(after);
+	CHECK_EQ(Window.sent.size(), 2);
+	CHECK_EQ(Window.sent[0].cmdID, CMD_PROFILE);
+	CHECK_EQ(Window.sent[0].tag, 14);
+	CHECK_EQ(Window.sent[1].tag, 20);
+	CHECK_EQ(after.coalesced - before.coalesced, 4);
+	CHECK_EQ(after.posted - before.posted, 6);
+}
+
+/* unchanged telemetry is not resent until the refresh period, alerts always go */
+static void testUnchanged(void) {
+	TxScheduler::metrics_s before, after;
+	uint8_t flags = TxScheduler::POST_DROP_UNCHANGED;
+
+	reset(1);
+	Window_open(1);
+	scheduler.getMetrics(before);
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_TELEMETRY, 30, flags) == true);
+	settle();
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_TELEMETRY, 30, flags) == true);	// dropped
+	settle();
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_TELEMETRY, 31, flags) == true);	// changed
+	settle();
+	CHECK(post(TxScheduler::PRIO_ALERT, CMD_TELEMETRY, 31, flags) == true);
+	settle();
+	CHECK_EQ(Window.sent.size(), 3);
+	osDelay(TxScheduler::TX_SCHED_REFRESH_MS);
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_TELEMETRY, 31, flags) == true);	// refresh
+	settle();
+	CHECK_EQ(Window.sent.size(), 4);
+	scheduler.getMetrics(after);
+	CHECK_EQ(after.unchanged - before.unchanged, 1);
+	CHECK_EQ(after.sent - before.sent, 4);
+}
+
+/* a packet the window refused is not taken as sent, the same payload posted again goes out */
+static void testRefused(void) {
+	TxScheduler::metrics_s before, after;
+	uint8_t flags = TxScheduler::POST_DROP_UNCHANGED;
+
+	reset(1);
+	Window_open(1);
+	scheduler.getMetrics(before);
+	Window.isRefused = true;
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_DIAG, 35, flags) == true);
+	settle();
+	CHECK_EQ(scheduler.getDepth(), 0);
+	CHECK_EQ(Window.sent.size(), 0);
+	Window.isRefused = false;
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_DIAG, 35, flags) == true);
+	settle();
+	if (CHECK_EQ(Window.sent.size(), 1) == true) {
+		CHECK_EQ(Window.sent[0].tag, 35);
+	}
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_DIAG, 35, flags) == true);	// now it is unchanged
+	settle();
+	CHECK_EQ(Window.sent.size(), 1);
+	scheduler.getMetrics(after);
+	CHECK_EQ(after.dropped - before.dropped, 1);
+	CHECK_EQ(after.unchanged - before.unchanged, 1);
+	CHECK_EQ(after.sent - before.sent, 1);
+}
+
+/* a full pool evicts the oldest packet of a lower class, never an equal one */
+static void testEvict(void) {
+	TxScheduler::metrics_s before, after;
+
+	reset(0);
+	scheduler.getMetrics(before);
+	for (uint8_t i = 0; i < TxScheduler::TX_SCHED_POOL; i++) {
+		CHECK(post(TxScheduler::PRIO_LOW, CMD_OTHER + i, 40 + i) == true);
+	}
+	CHECK(post(TxScheduler::PRIO_NORMAL, CMD_TELEMETRY, 50) == true);	// evicts tag 40
+	CHECK(post(TxScheduler::PRIO_LOW, CMD_DIAG, 51) == false);
+	CHECK(post(TxScheduler::PRIO_ALERT, CMD_ALERT, 52) == true);			// evicts tag 41
+	scheduler.getMetrics(after);
+	CHECK_EQ(after.depth[TxScheduler::PRIO_LOW], TxScheduler::TX_SCHED_POOL - 2);
+	CHECK_EQ(after.maxDepth, TxScheduler::TX_SCHED_POOL);
+	CHECK_EQ(after.dropped - before.dropped, 3);
+
+	Window_open(TxScheduler::TX_SCHED_POOL);
+	settle();
+	CHECK_EQ(Window.sent.size(), TxScheduler::TX_SCHED_POOL);
+	CHECK_EQ(Window.sent[0].tag, 52);
+	CHECK_EQ(Window.sent[1].tag, 50);
+	CHECK_EQ(Window.sent[2].tag, 42);
+}
+
+/* take() hands back the best packet for storing while the network is down */
+static void testTake(void) {
+	TxScheduler::PRIORITY prio;
+	uint16_t dstAddr, cmdID;
+	uint8_t data[TxScheduler::TX_SCHED_PAYLOAD];
+	uint8_t len;
+
+	reset(0);
+	post(TxScheduler::PRIO_LOW, CMD_DIAG, 60);
+	post(TxScheduler::PRIO_ALERT, CMD_ALERT, 61);
+	CHECK(scheduler.take(prio, dstAddr, cmdID, data, len) == true);
+	CHECK_EQ(prio, TxScheduler::PRIO_ALERT);
+	CHECK_EQ(cmdID, CMD_ALERT);
+	CHECK_EQ(data[0], 61);
+	CHECK_EQ(len, 6);
+	CHECK(scheduler.take(prio, dstAddr, cmdID, data, len) == true);
+	CHECK_EQ(data[0], 60);
+	CHECK(scheduler.take(prio, dstAddr, cmdID, data, len) == false);
+}
+
+/*
+ * normal traffic that alone fills the link: a low packet still gets out
+ * once it has aged past the normal class, the alert overtakes all of it
+ */
+static void testStarvation(void) {
+	const uint32_t serviceMs = 100;
+	uint32_t lowTick = 0;
+	uint32_t alertTick = 0;
+	uint32_t start;
+
+	reset(serviceMs);
+	Window_open(1);
+	start = osKernelSysTick();
+	for (uint32_t t = 0; t < 4 * TxScheduler::TX_SCHED_AGING_MS; t += serviceMs / 2) {
+		/* two normal packets per slot, the queue never empties */
+		post(TxScheduler::PRIO_NORMAL, (uint16_t)(CMD_OTHER + (t / (serviceMs / 2)) % 4), 71,
+				TxScheduler::POST_COALESCE);
+		if (t == 0) {
+			post(TxScheduler::PRIO_LOW, CMD_DIAG, 70);		// behind the first normal
+		}
+		if (t == 3 * TxScheduler::TX_SCHED_AGING_MS) {
+			post(TxScheduler::PRIO_ALERT, CMD_ALERT, 72);
+		}
+		osDelay(serviceMs / 2);
+	}
+	for (size_t i = 0; i < Window.sent.size(); i++) {
+		if (Window.sent[i].tag == 70 && lowTick == 0) {
+			lowTick = Window.sent[i].tick - start;
+		}
+		if (Window.sent[i].tag == 72 && alertTick == 0) {
+			alertTick = Window.sent[i].tick - start;
+		}
+	}
+	printf("low packet out after %ums under saturating normal traffic\n", (unsigned)lowTick);
+	CHECK(lowTick >= TxScheduler::TX_SCHED_AGING_MS);
+	CHECK(lowTick <= TxScheduler::TX_SCHED_AGING_MS + 2 * serviceMs);
+	CHECK(alertTick >= 3 * TxScheduler::TX_SCHED_AGING_MS);
+	CHECK(alertTick <= 3 * TxScheduler::TX_SCHED_AGING_MS + serviceMs);
+	/* the link never idles */
+	CHECK(Window.sent.size() >= 4 * TxScheduler::TX_SCHED_AGING_MS / serviceMs - 2);
+	while (scheduler.getDepth() != 0) {
+		osDelay(serviceMs);
+	}
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+
+	Window.room = osSemaphoreCreate(osSemaphore(ROOM), 16);
+	osThreadCreate(osThread(DISPATCH), NULL);
+
+	testOrder();
+	testLateAlert();
+	testCoalesce();
+	testUnchanged();
+	testRefused();
+	testEvict();
+	testTake();
+	testStarvation();
+	return Check_result();
+}
@@ -0,0 +1,345 @@
+/**
+  ******************************************************************************
+ * @file    test_tx_window.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   TxWindow against a simulated link with latency and loss
+ *
+ *	Z_stack::sendDataReq stands for the SREQ: it takes Link.srspMs in the
+ *	calling task and, when the ZNP accepts the request, queues the
+ *	ZB_SEND_DATA_CONFIRM Link.confirmMs later. A packet can be lost (no
+ *	confirm at all) or nacked (ZMacNoACK) on a seeded pseudo random draw,
+ *	so every run sees the same link.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "TxWindow.h"
+#include "MISC.h"
+#include <string.h>
+#include <vector>
+
+using namespace hv_driver;
+
+typedef struct {
+	uint32_t tick;
+	uint8_t handle;
+	Z_stack::STATUS status;
+} confirm_s;
+
+typedef struct {
+	uint8_t handle;
+	uint16_t cmdID;
+	uint8_t len;
+	uint8_t first;
+	uint32_t tick;
+} sent_s;
+
+typedef struct {
+	uint32_t srspMs;
+	uint32_t confirmMs;
+	uint32_t lossPermille;			// no confirm
+	uint32_t nackPermille;			// ZMacNoACK confirm
+	bool isBusy;								// SRSP with an error
+	uint32_t seed;
+	std::vector<confirm_s> confirms;
+	std::vector<sent_s> sent;
+	uint32_t maxInFlight;
+	uint32_t inFlight;
+	Z_stack::ConfirmCallBack_t callBack;
+	void* arg;
+} link_s;
+
+static link_s Link;
+
+static uint32_t Link_random(void) {
+	Link.seed = Link.seed * 1103515245 + 12345;
+	return (Link.seed >> 16) % 1000;
+}
+
+/* confirms due by now, in order */
+static void Link_deliver(void) {
+	for (size_t i = 0; i < Link.confirms.size(); ) {
+		if ((int32_t)(Sys_getTick() - Link.confirms[i].tick) >= 0) {
+			confirm_s confirm = Link.confirms[i];
+			Link.confirms.erase(Link.confirms.begin() + i);
+			Link.inFlight--;
+			Link.callBack(confirm.handle, confirm.status, Link.arg);
+		} else {
+			i++;
+		}
+	}
+}
+
+static void Link_reset(void) {
+	Link.srspMs = 3;
+	Link.confirmMs = 50;
+	Link.lossPermille = 0;
+	Link.nackPermille = 0;
+	Link.isBusy = false;
+	Link.seed = 1;
+	Link.sent.clear();
+	Link.maxInFlight = 0;
+}
+
+namespace hv_driver {
+
+Z_stack::Z_stack(CC2530* znp) {
+	this->znp = znp;
+	this->confirmCallBack = NULL;
+	this->confirmArg = NULL;
+}
+
+Z_stack::STATUS Z_stack::sendDataReq(TxPacket_s &txPacket, ZNPBuffer* payload, bool ack, uint8_t radius) {
+	sent_s sent;
+	confirm_s confirm;
+
+	(void)ack;
+	(void)radius;
+	Link.callBack = this->confirmCallBack;
+	Link.arg = this->confirmArg;
+	sent.handle = txPacket.handle;
+	sent.cmdID = txPacket.cmdID;
+	sent.len = payload->getLen();
+	sent.first = (payload->getLen() != 0) ? payload->getData()[0] : 0;
+	sent.tick = Sys_getTick();
+	Link.sent.push_back(sent);
+
+	osDelay(Link.srspMs);
+	if (Link.isBusy == true) {
+		return ZBufferFull;
+	}
+	uint32_t draw = Link_random();
+	if (draw < Link.lossPermille) {
+		return ZSuccess;
+	}
+	confirm.tick = Sys_getTick() + Link.confirmMs;
+	confirm.handle = txPacket.handle;
+	confirm.status = (draw < Link.lossPermille + Link.nackPermille) ? ZMacNoACK : ZSuccess;
+	Link.confirms.push_back(confirm);
+	Link.inFlight++;
+	if (Link.inFlight > Link.maxInFlight) {
+		Link.maxInFlight = Link.inFlight;
+	}
+	Host_at(confirm.tick, DMA1_Channel2_IRQn, Link_deliver);
+	return ZSuccess;
+}
+
+} /* hv_driver */
+
+static Z_stack zigbee(NULL);
+static TxWindow window(&zigbee);
+
+static void windowTask(void const* arg) {
+	(void)arg;
+	window.run();
+}
+
+osThreadDef(TX, windowTask, osPriorityHigh, 0, 256);
+
+static uint32_t Busy_edges = 0;
+static bool Busy_level = false;
+
+static void onBusy(bool isBusy) {
+	Busy_edges += (isBusy != Busy_level);
+	Busy_level = isBusy;
+}
+
+static uint32_t Fail_calls = 0;
+static uint8_t Fail_first = 0;
+
+static void onFail(const Z_stack::TxPacket_s &packet, void* arg) {
+	(void)arg;
+	Fail_calls++;
+	Fail_first = packet.txPtr[0];
+}
+
+static bool send(uint8_t tag, TxWindow::future_s* future, uint32_t timeout = osWaitForever) {
+	uint8_t data[4] = {tag, 1, 2, 3};
+	Z_stack::TxPacket_s packet = {0x0000, 0x0010, 0, sizeof(data), data};
+
+	return window.submit(packet, true, 10, future, timeout);
+}
+
+/* wait until the window is empty */
+static void drain(void) {
+	while (window.getInFlight() != 0 || Link.confirms.empty() != true) {
+		osDelay(10);
+	}
+	osDelay(10);
+}
+
+/* confirms come back in parallel: N packets take about N/window round trips */
+static void testThroughput(void) {
+	const uint32_t packets = 30;
+	uint32_t start;
+	uint32_t elapsed;
+	uint32_t roundTrip = Link.srspMs + Link.confirmMs;
+
+	Link_reset();
+	start = osKernelSysTick();
+	for (uint32_t i = 0; i < packets; i++) {
+		CHECK(send((uint8_t)i, NULL) == true);
+	}
+	drain();
+	elapsed = osKernelSysTick() - start;
+
+	CHECK_EQ(Link.sent.size(), packets);
+	CHECK_EQ(Link.maxInFlight, TxWindow::TX_WINDOW_SIZE);
+	/* one packet at a time would take packets * roundTrip */
+	CHECK(elapsed < packets * roundTrip / 2);
+	CHECK(elapsed >= packets / TxWindow::TX_WINDOW_SIZE * Link.confirmMs);
+	printf("%u packets in %ums, %ums one at a time\n", (unsigned)packets, (unsigned)elapsed,
+				(unsigned)(packets * roundTrip));
+	for (uint32_t i = 0; i < packets; i++) {
+		CHECK_EQ(Link.sent[i].first, i);		// sent in submit order
+		CHECK(Link.sent[i].handle != 0);
+	}
+	CHECK_EQ(window.getRetryCount(), 0);
+	CHECK_EQ(Busy_edges % 2, 0);
+	CHECK(Busy_level == false);
+}
+
+/* a future sees the result, a nack is retried after the backoff */
+static void testRetry(void) {
+	TxWindow::future_s future;
+	uint32_t retries = window.getRetryCount();
+
+	Link_reset();
+	Link.nackPermille = 1000;
+	CHECK(send(0xA0, &future) == true);
+	osDelay(Link.srspMs + Link.confirmMs + 1);
+	Link.nackPermille = 0;
+	CHECK_EQ(window.wait(future, 5000), Z_stack::ZSuccess);
+
+	CHECK_EQ(Link.sent.size(), 2);
+	CHECK_EQ(window.getRetryCount() - retries, 1);
+	CHECK(Link.sent[1].tick - Link.sent[0].tick >= Link.srspMs + Link.confirmMs + TxWindow::TX_BACKOFF_MS);
+	CHECK(Link.sent[1].handle != Link.sent[0].handle);
+	CHECK_EQ(Link.sent[1].first, 0xA0);
+}
+
+/* nothing comes back: confirm timeouts, doubling backoff, then the fail hook */
+static void testLoss(void) {
+	uint32_t fails = window.getFailCount();
+	uint32_t start;
+
+	Link_reset();
+	Link.lossPermille = 1000;
+	start = osKernelSysTick();
+	CHECK(send(0xB1, NULL) == true);
+	drain();
+	while (Fail_calls == 0 && osKernelSysTick() - start < 20000) {
+		osDelay(100);
+	}
+	CHECK_EQ(Link.sent.size(), 1 + TxWindow::TX_MAX_RETRY);
+	CHECK_EQ(window.getFailCount() - fails, 1);
+	CHECK_EQ(Fail_calls, 1);
+	CHECK_EQ(Fail_first, 0xB1);
+	for (uint32_t i = 1; i < Link.sent.size(); i++) {
+		uint32_t gap = Link.sent[i].tick - Link.sent[i - 1].tick;
+		uint32_t expect = Link.srspMs + TxWindow::TX_CONFIRM_TIMEOUT + ((uint32_t)TxWindow::TX_BACKOFF_MS << (i - 1));
+		CHECK(gap >= expect - Link.srspMs && gap <= expect + 2);
+	}
+}
+
+/* a confirm for an attempt that timed out is not taken for the retry */
+static void testLateConfirm(void) {
+	TxWindow::future_s future;
+	uint32_t retries = window.getRetryCount();
+
+	Link_reset();
+	Link.confirmMs = TxWindow::TX_CONFIRM_TIMEOUT + TxWindow::TX_BACKOFF_MS + 50;
+	CHECK(send(0xC2, &future) == true);
+	osDelay(TxWindow::TX_CONFIRM_TIMEOUT + 20);
+	Link.confirmMs = 1000;
+	/* the first confirm lands while the retry is in flight */
+	CHECK_EQ(window.wait(future, 10000), Z_stack::ZSuccess);
+	CHECK_EQ(Link.sent.size(), 2);
+	CHECK_EQ(window.getRetryCount() - retries, 1);
+	CHECK(osKernelSysTick() - Link.sent[1].tick >= 1000);
+	drain();
+}
+
+/* a wait that times out detaches, the slot frees itself later */
+static void testDetach(void) {
+	TxWindow::future_s future;
+	TxWindow::future_s stale;
+
+	Link_reset();
+	Link.confirmMs = 500;
+	CHECK(send(0xD3, &future) == true);
+	stale = future;
+	CHECK_EQ(window.wait(future, 100), Z_stack::zdoTimeout);
+	CHECK_EQ(window.wait(stale, 100), Z_stack::ZInvalidParameter);
+	drain();
+	CHECK(window.waitFree(0) == true);
+	for (int i = 0; i < TxWindow::TX_WINDOW_SIZE; i++) {
+		CHECK(send((uint8_t)i, NULL, 0) == true);
+	}
+	CHECK(send(0xFF, NULL, 0) == false);		// window full
+	drain();
+}
+
+/* lossy link, many packets, handles wrap: every packet ends once and nothing leaks */
+static void testSoak(void) {
+	const uint32_t packets = 400;
+	uint32_t fails = window.getFailCount();
+	uint32_t failCalls = Fail_calls;
+	uint32_t retries = window.getRetryCount();
+	uint32_t futureFails = 0;
+
+	Link_reset();
+	Link.lossPermille = 20;
+	Link.nackPermille = 100;
+	Link.confirmMs = 30;
+	for (uint32_t i = 0; i < packets; i++) {
+		TxWindow::future_s future;
+		if ((i & 3) == 0) {
+			CHECK(send((uint8_t)i, &future) == true);
+			Z_stack::STATUS status = window.wait(future, osWaitForever);
+			CHECK(status == Z_stack::ZSuccess || status == Z_stack::ZMacNoACK || status == Z_stack::zdoTimeout);
+			futureFails += (status != Z_stack::ZSuccess);
+		} else {
+			CHECK(send((uint8_t)i, NULL) == true);
+		}
+	}
+	drain();
+	while (window.getInFlight() != 0) {
+		osDelay(100);
+	}
+	for (size_t i = 0; i < Link.sent.size(); i++) {
+		CHECK(Link.sent[i].handle != 0);
+	}
+	CHECK(Link.sent.size() > 255);				// handles wrapped
+	/* each packet once plus its retries, each failure reported once */
+	CHECK_EQ(Link.sent.size(), packets + window.getRetryCount() - retries);
+	CHECK_EQ(window.getFailCount() - fails, Fail_calls - failCalls + futureFails);
+	CHECK(window.getFailCount() - fails <= packets / 10);
+	CHECK(Link.maxInFlight <= TxWindow::TX_WINDOW_SIZE);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+	CHECK(window.waitFree(0) == true);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+	Link_reset();
+
+	CHECK(window.init() == true);
+	window.setBusyCallBack(onBusy);
+	window.setFailCallBack(onFail, NULL);
+	osThreadCreate(osThread(TX), NULL);
+
+	testThroughput();
+	testRetry();
+	testLoss();
+	testLateConfirm();
+	testDetach();
+	testSoak();
+	return Check_result();
+}
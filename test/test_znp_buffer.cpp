@@ -0,0 +1,173 @@
+/**
+  ******************************************************************************
+ * @file    test_znp_buffer.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   ZNPBuffer pool, reference counts and headroom
+ *
+ *	The pool is static, every test gives back what it took so the next
+ *	one starts with ZNP_POOL_SIZE free buffers.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "ZNPBuffer.h"
+#include <string.h>
+
+using namespace hv_driver;
+
+static const uint8_t POOL = ZNPBuffer::ZNP_POOL_SIZE;
+
+static void testPool(void) {
+	ZNPBuffer* buffers[POOL];
+	uint32_t fails = ZNPBuffer::getAllocFail();
+
+	CHECK_EQ(ZNPBuffer::getFree(), POOL);
+	CHECK_EQ(ZNPBuffer::getMinFree(), POOL);
+	for (uint8_t i = 0; i < POOL; i++) {
+		buffers[i] = ZNPBuffer::alloc(0);
+		if (CHECK(buffers[i] != NULL) != true) {
+			return;
+		}
+		CHECK_EQ(buffers[i]->getRefs(), 1);
+		CHECK_EQ(ZNPBuffer::getFree(), POOL - 1 - i);
+		CHECK_EQ(ZNPBuffer::getMinFree(), POOL - 1 - i);
+		for (uint8_t j = 0; j < i; j++) {
+			CHECK(buffers[i] != buffers[j]);
+		}
+	}
+	/* empty pool fails and counts */
+	CHECK(ZNPBuffer::alloc(0) == NULL);
+	CHECK(ZNPBuffer::alloc(0) == NULL);
+	CHECK_EQ(ZNPBuffer::getAllocFail(), fails + 2);
+
+	/* a released buffer is the next one handed out */
+	buffers[2]->release();
+	CHECK_EQ(ZNPBuffer::getFree(), 1);
+	CHECK(ZNPBuffer::alloc(0) == buffers[2]);
+	CHECK_EQ(ZNPBuffer::getFree(), 0);
+
+	for (uint8_t i = 0; i < POOL; i++) {
+		buffers[i]->release();
+	}
+	CHECK_EQ(ZNPBuffer::getFree(), POOL);
+	/* the low water mark stays */
+	CHECK_EQ(ZNPBuffer::getMinFree(), 0);
+	/* headroom bigger than a buffer */
+	CHECK(ZNPBuffer::alloc(ZNPBuffer::ZNP_BUFFER_SIZE + 1) == NULL);
+	CHECK_EQ(ZNPBuffer::getFree(), POOL);
+}
+
+/* the last reference returns the buffer, extra releases do not underflow */
+static void testRefs(void) {
+	ZNPBuffer* buffer = ZNPBuffer::alloc(0);
+
+	if (CHECK(buffer != NULL) != true) {
+		return;
+	}
+	buffer->retain();
+	buffer->retain();
+	CHECK_EQ(buffer->getRefs(), 3);
+	buffer->release();
+	buffer->release();
+	CHECK_EQ(ZNPBuffer::getFree(), POOL - 1);
+	buffer->release();
+	CHECK_EQ(buffer->getRefs(), 0);
+	CHECK_EQ(ZNPBuffer::getFree(), POOL);
+	buffer->release();
+	CHECK_EQ(buffer->getRefs(), 0);
+	CHECK_EQ(ZNPBuffer::getFree(), POOL);
+}
+
+/* payload written once, Z_stack and SPI headers prepended in place */
+static void testHeadroom(void) {
+	const uint8_t HEAD = 8 + ZNPBuffer::ZNP_SPI_HEADER;
+	ZNPBuffer* buffer = ZNPBuffer::alloc(HEAD);
+	uint8_t* payload;
+	uint8_t* ptr;
+
+	if (CHECK(buffer != NULL) != true) {
+		return;
+	}
+	CHECK_EQ(buffer->getLen(), 0);
+	CHECK_EQ(buffer->getCmd(), 0);
+	CHECK_EQ(buffer->getRoom(), ZNPBuffer::ZNP_BUFFER_SIZE - HEAD);
+	payload = buffer->append(20);
+	if (CHECK(payload != NULL) != true) {
+		return;
+	}
+	CHECK(payload == buffer->getData());
+	memset(payload, 0x5A, 20);
+
+	ptr = buffer->push(8);
+	CHECK(ptr == payload - 8);
+	memset(ptr, 0x11, 8);
+	ptr = buffer->push(ZNPBuffer::ZNP_SPI_HEADER);
+	CHECK(ptr == payload - HEAD);
+	CHECK(buffer->getData() == ptr);
+	CHECK_EQ(buffer->getLen(), HEAD + 20);
+	/* no headroom left */
+	CHECK(buffer->push(1) == NULL);
+	CHECK_EQ(buffer->getLen(), HEAD + 20);
+
+	/* receive side strips the headers again */
+	CHECK(buffer->pull(ZNPBuffer::ZNP_SPI_HEADER));
+	CHECK_EQ(buffer->getData()[0], 0x11);
+	CHECK(buffer->pull(8));
+	CHECK(buffer->getData() == payload);
+	CHECK_EQ(buffer->getData()[19], 0x5A);
+	CHECK(buffer->pull(21) != true);
+	CHECK_EQ(buffer->getLen(), 20);
+
+	/* the tail stops at the end of the buffer */
+	CHECK(buffer->append(buffer->getRoom() + 1) == NULL);
+	CHECK(buffer->append(buffer->getRoom()) != NULL);
+	CHECK_EQ(buffer->getRoom(), 0);
+	CHECK(buffer->append(1) == NULL);
+	CHECK(buffer->getData() + buffer->getLen() == payload - HEAD + ZNPBuffer::ZNP_BUFFER_SIZE);
+
+	/* a reused buffer starts clean */
+	buffer->setCmd(0x4481);
+	buffer->release();
+	buffer = ZNPBuffer::alloc(0);
+	if (CHECK(buffer != NULL) != true) {
+		return;
+	}
+	CHECK_EQ(buffer->getLen(), 0);
+	CHECK_EQ(buffer->getCmd(), 0);
+	CHECK_EQ(buffer->getRoom(), ZNPBuffer::ZNP_BUFFER_SIZE);
+	buffer->release();
+}
+
+/* the DMA and EXTI handlers take and drop references, a caller's
+	 critical section has to stay closed */
+static void testCritical(void) {
+	ZNPBuffer* buffer;
+
+	__disable_irq();
+	buffer = ZNPBuffer::alloc(0);
+	CHECK_EQ(Host_primask, 1);
+	buffer->retain();
+	CHECK_EQ(Host_primask, 1);
+	buffer->release();
+	CHECK_EQ(Host_primask, 1);
+	buffer->release();
+	CHECK_EQ(Host_primask, 1);
+	__enable_irq();
+
+	buffer = ZNPBuffer::alloc(0);
+	CHECK_EQ(Host_primask, 0);
+	buffer->release();
+	CHECK_EQ(Host_primask, 0);
+	CHECK_EQ(ZNPBuffer::getFree(), POOL);
+}
+
+int main(void) {
+	Host_reset();
+	testPool();
+	testRefs();
+	testHeadroom();
+	testCritical();
+	return Check_result();
+}
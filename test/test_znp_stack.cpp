@@ -0,0 +1,147 @@
+/**
+  ******************************************************************************
+ * @file    test_znp_stack.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Stack used by the ZNP send paths, by stack painting
+ *
+ *	Each path runs once on a task of its own against the simulated ZNP,
+ *	the host stacks are painted and the bytes written are compared with a
+ *	task that only blocks once, which is what every path does as well.
+ *	The figures are for the host build (x86-64, no optimisation) and move
+ *	with the compiler; what they are for is the change from one version of
+ *	the send path to the next. The bounds are today's figures with a little
+ *	room, a change that brings a frame sized buffer back onto a sender's
+ *	stack fails here.
+  */
+//-------------------------------------------------------------------------
+#include "Check.h"
+#include "HostTarget.h"
+#include "HostSys.h"
+#include "HostRtos.h"
+#include "ZnpSim.h"
+#include "CC2530.h"
+#include "Z_stack.h"
+#include "ZNPBuffer.h"
+#include "MISC.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace hv_driver;
+
+/* bytes above the baseline, -O0 figures today: 488, 328, 328. The pool
+	 has a frame at 103 bytes, one back on the stack is over any of them */
+static const uint32_t SEND_MAX = 520;
+static const uint32_t SEND_BUFFER_MAX = 360;
+static const uint32_t SREQ_MAX = 360;
+
+static CC2530 znp(&Sim_rstPin, &Sim_srdyPin, &Sim_mrdyPin, &Sim_spi, &Sim_ssPin);
+static Z_stack zigbee(&znp);
+static volatile bool Done;
+static volatile bool IsOk;
+static uint8_t Payload[CC2530::ZNP_MAX_PAYLOAD];	// the caller's, not counted
+
+static void znpTask(void const* arg) {
+	(void)arg;
+	znp.run();
+}
+
+osThreadDef(ZNP, znpTask, osPriorityHigh, 0, 256);
+
+/* blocks once, as the senders do waiting for the SRSP */
+static void baseTask(void const* arg) {
+	(void)arg;
+	osDelay(2);
+	IsOk = true;
+	Done = true;
+}
+
+/* a caller's payload, copied into a pooled buffer */
+static void sendTask(void const* arg) {
+	Z_stack::TxPacket_s packet;
+
+	(void)arg;
+	packet.dstAddr = 0x0000;
+	packet.cmdID = 0x0010;
+	packet.handle = 1;
+	packet.len = Z_stack::ZB_MAX_DATA;
+	packet.txPtr = Payload;
+	IsOk = (zigbee.sendDataReq(packet, false, 7) == Z_stack::ZSuccess);
+	Done = true;
+}
+
+/* the payload built in place in a pooled buffer, as TxWindow does */
+static void sendBufferTask(void const* arg) {
+	Z_stack::TxPacket_s packet;
+	ZNPBuffer* payload = ZNPBuffer::alloc(Z_stack::ZB_DATA_HEADROOM);
+
+	(void)arg;
+	packet.dstAddr = 0x0000;
+	packet.cmdID = 0x0010;
+	packet.handle = 2;
+	memset(payload->append(Z_stack::ZB_MAX_DATA), 0x5A, Z_stack::ZB_MAX_DATA);
+	IsOk = (zigbee.sendDataReq(packet, payload, false, 7) == Z_stack::ZSuccess);
+	payload->release();
+	Done = true;
+}
+
+/* the copying SREQ on its own */
+static void sreqTask(void const* arg) {
+	uint8_t rsp[16];
+	CC2530::frame_s srsp = {CC2530::NONE, 0, sizeof(rsp), rsp};
+
+	(void)arg;
+	IsOk = (znp.SREQ(CC2530::SYS_VERSION, Payload, sizeof(Payload), srsp) == true);
+	Done = true;
+}
+
+osThreadDef(BASE, baseTask, osPriorityNormal, 0, 128);
+osThreadDef(SEND, sendTask, osPriorityNormal, 0, 128);
+osThreadDef(SEND_BUFFER, sendBufferTask, osPriorityNormal, 0, 128);
+osThreadDef(SREQ, sreqTask, osPriorityNormal, 0, 128);
+
+/* run a path to the end on its own task, bytes of stack it wrote */
+static uint32_t measure(const osThreadDef_t* def) {
+	osThreadId task;
+
+	Done = false;
+	IsOk = false;
+	task = osThreadCreate(def, NULL);
+	while (Done != true) {
+		osDelay(1);
+	}
+	osDelay(1);
+	CHECK(IsOk);
+	return Host_stackUsed(task);
+}
+
+static void testSendPaths(void) {
+	uint32_t base = measure(osThread(BASE));
+	uint32_t send = measure(osThread(SEND)) - base;
+	uint32_t sendBuffer = measure(osThread(SEND_BUFFER)) - base;
+	uint32_t sreq = measure(osThread(SREQ)) - base;
+
+	printf("baseline %u bytes, above it: sendDataReq %u, sendDataReq(ZNPBuffer) %u, SREQ %u\n",
+				 base, send, sendBuffer, sreq);
+	CHECK(send <= SEND_MAX);
+	CHECK(sendBuffer <= SEND_BUFFER_MAX);
+	CHECK(sreq <= SREQ_MAX);
+	CHECK_EQ(ZNPBuffer::getFree(), ZNPBuffer::ZNP_POOL_SIZE);
+}
+
+int main(void) {
+	Host_reset();
+	Sys_init();
+	Host_rtosInit();
+	Sim_init();
+	memset(Payload, 0x5A, sizeof(Payload));
+	Sim.onRequest = Sim_zstack;
+
+	CHECK(znp.init() == true);
+	osThreadCreate(osThread(ZNP), NULL);
+	CHECK(zigbee.init(Z_stack::ZCD_startOpt_noClear, Z_stack::ZCD_endDevice, 0xFFFF));
+
+	testSendPaths();
+	return Check_result();
+}
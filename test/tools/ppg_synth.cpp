@@ -0,0 +1,99 @@
+/**
+  ******************************************************************************
+ * @file    ppg_synth.cpp
+ * @author  Hoang Viet  <hoangtheviet93@gmail.com>
+ * @version 1.0
+ * @date    19-10-2026
+ * @brief   Writes the synthetic capture sets of test/data/ppg
+ *
+ *	Stand-ins until bench captures replace them: the sensor front end as
+ *	HeartRate's bands expect it, the pulse swinging from below 750 to the
+ *	2000..2550 counts band, at 1kHz with the DWT at 64MHz. Each set is
+ *	seeded, running it again writes the same bytes.
+ *
+ *	ppg_synth <dir>
+  */
+//-------------------------------------------------------------------------
+#include "PpgReplay.h"
+#include <math.h>
+#include <stdio.h>
+#include <string>
+
+static const uint32_t CYCLE_PER_SECOND = 64000000;
+static const uint16_t SAMPLE_RATE = 1000;
+static const uint8_t BLOCK = 8;										// ADC_SCAN_BLOCK
+
+typedef struct {
+	const char* name;
+	uint32_t seed;
+	uint16_t bpm;
+	uint16_t variability;		// +- ms per beat
+	int32_t trough;					// ADC counts between beats
+	int32_t peak;						// ADC counts at the systolic peak
+	int32_t noise;					// +- ADC counts
+	int32_t swing;					// ADC counts, peak to peak of a 1.3Hz arm swing
+	uint32_t seconds;
+} set_s;
+
+static const set_s Sets[] = {
+	{"rest_62bpm", 		101, 	62, 	15, 	480, 	2380, 	12, 	0, 		40},
+	{"seated_78bpm", 	102, 	78, 	40, 	520, 	2300, 	20, 	0, 		40},
+	{"walk_96bpm", 		103, 	96, 	25, 	500, 	2420, 	30, 	0, 		40},
+	{"fast_112bpm", 	104, 	112, 	10, 	460, 	2350, 	15, 	0, 		40},
+	{"arm_swing", 		105, 	80, 	30, 	500, 	2350, 	40, 	4000, 40},
+	{"no_finger", 		106, 	72, 	0, 		380, 	380, 	600, 	0, 		40},
+};
+
+static uint32_t Rand_state;
+
+static int32_t randRange(int32_t range) {
+	Rand_state = Rand_state * 1664525 + 1013904223;
+	return (range == 0) ? 0 : (int32_t)((Rand_state >> 8) % (uint32_t)(2 * range + 1)) - range;
+}
+
+/* systolic peak and dicrotic wave, t in s after the beat, 0..1 */
+static double pulseShape(double t) {
+	return exp(-pow((t - 0.15) / 0.06, 2)) + 0.35 * exp(-pow((t - 0.40) / 0.08, 2));
+}
+
+static void synth(const set_s &set, std::vector<uint16_t> &samples) {
+	uint32_t beat = 0;			// ms of the current beat
+	uint32_t next = 60000 / set.bpm;
+
+	Rand_state = set.seed;
+	samples.clear();
+	for (uint32_t ms = 0; ms < set.seconds * 1000; ms++) {
+		int32_t value;
+
+		if (ms - beat >= next) {
+			beat = ms;
+			next = 60000 / set.bpm + randRange(set.variability);
+		}
+		value = set.trough + (int32_t)((set.peak - set.trough) * pulseShape((ms - beat) / 1000.0))
+			+ randRange(set.noise) + (int32_t)(set.swing / 2 * sin(2 * M_PI * 1.3 * ms / 1000.0));
+		value = (value < 0) ? 0 : ((value > 4095) ? 4095 : value);
+		samples.push_back((uint16_t)value);
+	}
+}
+
+int main(int argc, char** argv) {
+	std::vector<uint16_t> samples;
+
+	if (argc != 2) {
+		fprintf(stderr, "ppg_synth <dir>\n");
+		return 1;
+	}
+	for (size_t i = 0; i < sizeof(Sets) / sizeof(Sets[0]); i++) {
+		std::string path = std::string(argv[1]) + "/" + Sets[i].name + ".ppg";
+
+		synth(Sets[i], samples);
+		/* starts close to the DWT wrap */
+		if (PpgReplay_write(path.c_str(), samples, 0xFFFFFFFF - 5 * CYCLE_PER_SECOND, CYCLE_PER_SECOND,
+												SAMPLE_RATE, BLOCK) != true) {
+			fprintf(stderr, "cannot write %s\n", path.c_str());
+			return 1;
+		}
+		printf("%s: %u samples\n", path.c_str(), (unsigned)samples.size());
+	}
+	return 0;
+}